@@ -17,10 +17,18 @@
 
 #include "WebSocketsModule.h"
 #include "IWebSocket.h"
+#include "WebRTC/FailoverController.h"
+#include "WebRTC/KeyFrameGovernor.h"
+#include "WebRTC/MultiOpus.h"
+#include "WebRTC/OpusEncoderSettings.h"
 #include "WebRTC/PeerConnection.h"
+#include "WebRTC/SdpEditor.h"
+#include "WebRTC/SimulcastEncoderFactory.h"
 
 #include "Util.h"
 
+#include "Async/Async.h"
+#include "Containers/Ticker.h"
 #include "Interfaces/IPluginManager.h"
 #include "Kismet/GameplayStatics.h"
 
@@ -30,6 +38,9 @@
 constexpr auto HTTP_OK = 200;
 #endif
 
+// Max framerate of the video encodings, unless a simulcast layer sets its own
+constexpr int32 MAX_VIDEO_FRAMERATE = 60;
+
 inline FString ToString(EMillicastVideoCodecs Codec)
 {
 	switch (Codec)
@@ -69,6 +80,8 @@ UMillicastPublisherComponent::UMillicastPublisherComponent(const FObjectInitiali
 	MaximumBitrate = 4'000'000;
 	StartingBitrate = 2'000'000;
 	MinimumBitrate = 1'000'000;
+
+	SimulcastLayers = FMillicastSimulcastLayer::GetDefaultLayers();
 }
 
 void UMillicastPublisherComponent::EndPlay(EEndPlayReason::Type Reason)
@@ -226,6 +239,8 @@ bool UMillicastPublisherComponent::Publish()
 		return false;
 	}
 	
+	PrepareForPublish();
+
 	UE_LOG(LogMillicastPublisher, Log, TEXT("Making HTTP director request"));
 
 	// Create an HTTP request
@@ -272,7 +287,63 @@ bool UMillicastPublisherComponent::Publish()
 
 bool UMillicastPublisherComponent::PublishWithWsAndJwt(const FString& WsUrl, const FString& Jwt)
 {
-	return IsValid(MillicastMediaSource) && StartWebSocketConnection(WsUrl, Jwt);
+	if (!IsValid(MillicastMediaSource))
+	{
+		return false;
+	}
+
+	PrepareForPublish();
+
+	return StartWebSocketConnection(WsUrl, Jwt);
+}
+
+void UMillicastPublisherComponent::PrepareForPublish()
+{
+	using namespace Millicast::Publisher;
+
+	// A backup sends the tracks of its primary publisher, which already set up the encoders
+	if (PrimarySource)
+	{
+		return;
+	}
+
+	FPublisherStats::Get().PublishStarted();
+
+	FWebRTCPeerConnection::GetPeerConnectionFactory();
+
+	// The encoders get the settings with the frames of the source, other publishers keep their own
+	auto KeyFrameSettings = MakeShared<FKeyFrameGovernorSettings, ESPMode::ThreadSafe>();
+	KeyFrameSettings->MinIntervalMs = FMath::Max(KeyFrameMinIntervalMs, 0);
+	KeyFrameSettings->bPerLayer = bPerLayerKeyFrames;
+	MillicastMediaSource->SetKeyFrameSettings(KeyFrameSettings);
+	FWebRTCPeerConnection::GetSimulcastEncoderFactory()->SetEncoderPreset(EncoderPreset);
+
+	// Pre-encoded files and relayed video are sent by the passthrough encoder, the encoders would never be used
+	if (!MillicastMediaSource->CaptureVideo || MillicastMediaSource->IsReplayingEncodedFile() || MillicastMediaSource->IsRelayingVideo())
+	{
+		return;
+	}
+
+	// The capture resolution is the render target one, or the viewport one when capturing the game window
+	FIntPoint CaptureSize = FIntPoint::ZeroValue;
+	if (MillicastMediaSource->RenderTarget)
+	{
+		CaptureSize = FIntPoint(MillicastMediaSource->RenderTarget->SizeX, MillicastMediaSource->RenderTarget->SizeY);
+	}
+	else if (GEngine && GEngine->GameViewport && GEngine->GameViewport->Viewport)
+	{
+		CaptureSize = GEngine->GameViewport->Viewport->GetSizeXY();
+	}
+
+	if (CaptureSize.X <= 0 || CaptureSize.Y <= 0)
+	{
+		return;
+	}
+
+	// The encoders are created after the SDP negotiation, create them now with the settings we are going to publish with
+	const TArray<FMillicastSimulcastLayer> Layers = Simulcast ? GetSimulcastLayers() : TArray<FMillicastSimulcastLayer>();
+	WarmEncoders = FWebRTCPeerConnection::GetSimulcastEncoderFactory()->WarmUp(ToString(SelectedVideoCodec), CaptureSize.X, CaptureSize.Y,
+		Layers, MinimumBitrate.Get(0), MaximumBitrate.Get(4'000'000), MAX_VIDEO_FRAMERATE, MillicastMediaSource->VideoContentHint == EMillicastVideoContentHint::Detail);
 }
 
 /**
@@ -280,6 +351,24 @@ bool UMillicastPublisherComponent::PublishWithWsAndJwt(const FString& WsUrl, con
 */
 void UMillicastPublisherComponent::UnPublish()
 {
+	if (BackupPublisher)
+	{
+		BackupPublisher->UnPublish();
+		BackupPublisher = nullptr;
+	}
+	Failover.Reset();
+
+	// Drop the encoders warmed up for this session that were not used
+	WarmEncoders = nullptr;
+
+	StopRecording();
+
+	// The switch to this backup can't complete anymore
+	if (auto* EncoderFactory = Millicast::Publisher::FWebRTCPeerConnection::GetSimulcastEncoderFactory())
+	{
+		EncoderFactory->NotifyNextFrameSent(GetRecordingId(), nullptr);
+	}
+
 	// Close websocket connection, can exist in inactive connection state
 	if (auto* pWS = WS.Get())
 	{
@@ -377,8 +466,54 @@ bool UMillicastPublisherComponent::PublishToMillicast()
 
 	using namespace Millicast::Publisher;
 
+	// Detect a lost connection quickly when there is a backup to fail over to, the defaults take several seconds
+	if (BackupMediaSource && !PrimarySource)
+	{
+		(*PeerConnectionConfig)->ice_check_interval_strong_connectivity = FMath::Max(FailoverTimeoutMs / 4, 25);
+		(*PeerConnectionConfig)->ice_unwritable_timeout = FailoverTimeoutMs;
+		(*PeerConnectionConfig)->ice_unwritable_min_checks = 3;
+
+		Failover = MakeUnique<FFailoverController>(FailbackDelayMs);
+	}
+
 	PeerConnection.Reset(FWebRTCPeerConnection::Create(*(*PeerConnectionConfig)));
 
+	PeerConnection->OnIceConnectionStateChanged = [WEAK_CAPTURE](webrtc::PeerConnectionInterface::IceConnectionState IceState)
+	{
+		// Called on the signaling thread while the backup may be torn down, the switch is decided on the game thread
+		const uint64 StateChangeCycles = FPlatformTime::Cycles64();
+
+		AsyncTask(ENamedThreads::GameThread, [WeakThis, IceState, StateChangeCycles]()
+		{
+			UMillicastPublisherComponent* This = WeakThis.Get();
+			if (!This || !This->Failover || !This->IsPublishing())
+			{
+				return;
+			}
+
+			const bool bWasWaitingToFailBack = This->Failover->IsWaitingToFailBack();
+
+			This->Failover->SetBackupReady(This->BackupPublisher && This->BackupPublisher->IsStandbyReady());
+			if (This->Failover->OnPrimaryIceStateChanged(IceState, FPlatformTime::ToMilliseconds64(StateChangeCycles)) == FFailoverController::EAction::FailOver)
+			{
+				This->FailOver(StateChangeCycles);
+			}
+
+			// The primary is back, check until it has been up for the fail back delay or goes down again
+			if (!bWasWaitingToFailBack && This->Failover->IsWaitingToFailBack())
+			{
+#if ENGINE_MAJOR_VERSION < 5
+				FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateLambda([WeakThis](float)
+#else
+				FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateLambda([WeakThis](float)
+#endif
+				{
+					return WeakThis.IsValid() && WeakThis->UpdateFailover();
+				}), 0.1f);
+			}
+		});
+	};
+
 	// Starts the capture first and add track to the peerconnection
 	// TODO: add a boolean to let choose autoplay or not
 	CaptureAndAddTracks();
@@ -392,18 +527,30 @@ bool UMillicastPublisherComponent::PublishToMillicast()
 	{
 		UE_LOG(LogMillicastPublisher, Display, TEXT("pc.createOffer() | sucess\nsdp : %s"), *FString(sdp.c_str()));
 
-		// Search for this expression and add the stereo flag to enable stereo
-		const std::string s = "minptime=10;useinbandfec=1";
-		std::string sdp_non_const = sdp;
-		std::ostringstream oss;
-		oss << s << "; stereo=1";
+		Millicast::Publisher::FSdpEditor Editor(sdp);
+
+		// Surround audio is only understood by the multistream variant of opus, which webrtc doesn't offer by itself
+		const int32 AudioChannels = (PrimarySource ? PrimarySource : MillicastMediaSource)->GetAudioChannels();
+		if (AudioChannels > 2 && !Millicast::Publisher::SetMultiOpusCodec(Editor, AudioChannels))
+		{
+			UE_LOG(LogMillicastPublisher, Warning, TEXT("Could not offer Opus multistream, the %d channels audio is downmixed by webrtc"), AudioChannels);
+		}
+
+		Millicast::Publisher::ApplyOpusSettings(Editor, AudioEncoderSettings, false);
 
-		auto pos = sdp.find(s);
-		if (pos != std::string::npos)
+		// Lets the receivers align the audio and video on their capture times, webrtc doesn't offer it by default
+		const int32 AbsCaptureTimeId = Editor.AddHeaderExtension("http://www.webrtc.org/experimental/rtp-hdrext/abs-capture-time", { "audio", "video" });
+		if (AbsCaptureTimeId == INDEX_NONE)
 		{
-			sdp_non_const.replace(sdp.find(s), s.size(), oss.str());
+			UE_LOG(LogMillicastPublisher, Warning, TEXT("No RTP header extension id left for the absolute capture time"));
+		}
+		else
+		{
+			UE_LOG(LogMillicastPublisher, Log, TEXT("Offering the absolute capture time header extension with id %d"), AbsCaptureTimeId);
 		}
 
+		std::string sdp_non_const = Editor.ToString();
+
 		// Set local description
 		{
 			FScopeLock Lock(&CriticalSection);
@@ -483,6 +630,17 @@ bool UMillicastPublisherComponent::PublishToMillicast()
 
 		State = EMillicastPublisherState::Connected;
 		OnPublishing.Broadcast();
+
+		if (BackupMediaSource && !PrimarySource)
+		{
+			AsyncTask(ENamedThreads::GameThread, [WEAK_CAPTURE]()
+			{
+				if (WeakThis.IsValid())
+				{
+					WeakThis->StartBackup();
+				}
+			});
+		}
 	});
 
 	RemoteFailureHandle = RemoteDescriptionObserver->OnFailureEvent.AddLambda([this](const std::string& err)
@@ -581,7 +739,13 @@ void UMillicastPublisherComponent::OnMessage(const FString& Msg)
 		if (PeerConnection) 
 		{
 			Sdp += FString(TEXT("a=x-google-flag:conference\r\n"));
-			PeerConnection->SetRemoteDescription(Millicast::Publisher::to_string(Sdp));
+
+			// The audio encoder is configured from the answer, and the encoders find the recording of this publisher in it
+			Millicast::Publisher::FSdpEditor Editor(Millicast::Publisher::to_string(Sdp));
+			Millicast::Publisher::ApplyOpusSettings(Editor, AudioEncoderSettings, true);
+			Millicast::Publisher::SetRecordingId(Editor, GetRecordingId());
+
+			PeerConnection->SetRemoteDescription(Editor.ToString());
 			PeerConnection->ServerId = MoveTemp(ServerId);
 			PeerConnection->ClusterId = MoveTemp(ClusterId);
 		}
@@ -612,92 +776,354 @@ void UMillicastPublisherComponent::OnMessage(const FString& Msg)
 
 void UMillicastPublisherComponent::SetSimulcast(webrtc::RtpTransceiverInit& TransceiverInit)
 {
-	webrtc::RtpEncodingParameters params;
-	params.active = true;
-	params.max_bitrate_bps = MaximumBitrate.Get(4'000'000);
-	params.rid = "h";
-	TransceiverInit.send_encodings.push_back(params);
+	for (const FMillicastSimulcastLayer& Layer : GetSimulcastLayers())
+	{
+		webrtc::RtpEncodingParameters params;
+		params.active = true;
+		params.rid = TCHAR_TO_UTF8(*Layer.Rid);
+		params.scale_resolution_down_by = Layer.ScaleResolutionDownBy;
+		params.max_bitrate_bps = Layer.MaxBitrate > 0 ? Layer.MaxBitrate : static_cast<int>(MaximumBitrate.Get(4'000'000) / Layer.ScaleResolutionDownBy);
+
+		if (Layer.MaxFramerate > 0)
+		{
+			params.max_framerate = Layer.MaxFramerate;
+		}
+
+		TransceiverInit.send_encodings.push_back(params);
+	}
+}
+
+TArray<FMillicastSimulcastLayer> UMillicastPublisherComponent::GetSimulcastLayers() const
+{
+	if (AreSimulcastLayersValid(SimulcastLayers))
+	{
+		return SimulcastLayers;
+	}
+
+	UE_LOG(LogMillicastPublisher, Warning, TEXT("Invalid simulcast layers, using the default ones"));
+	return FMillicastSimulcastLayer::GetDefaultLayers();
+}
+
+bool UMillicastPublisherComponent::AreSimulcastLayersValid(const TArray<FMillicastSimulcastLayer>& InSimulcastLayers)
+{
+	if (InSimulcastLayers.Num() < 2 || InSimulcastLayers.Num() > webrtc::kMaxSimulcastStreams)
+	{
+		UE_LOG(LogMillicastPublisher, Error, TEXT("Simulcast needs between 2 and %d layers, got %d"), webrtc::kMaxSimulcastStreams, InSimulcastLayers.Num());
+		return false;
+	}
+
+	TSet<FString> Rids;
+	for (const FMillicastSimulcastLayer& Layer : InSimulcastLayers)
+	{
+		if (Layer.Rid.IsEmpty() || Rids.Contains(Layer.Rid))
+		{
+			UE_LOG(LogMillicastPublisher, Error, TEXT("Simulcast layer rid must be unique and not empty : '%s'"), *Layer.Rid);
+			return false;
+		}
+		Rids.Add(Layer.Rid);
 
-	params.max_bitrate_bps = MaximumBitrate.Get(4'000'000) / 2;
-	params.active = true;
-	params.rid = "m";
-	params.scale_resolution_down_by = 2;
-	TransceiverInit.send_encodings.push_back(params);
+		if (Layer.ScaleResolutionDownBy < 1.f || Layer.MaxBitrate < 0 || Layer.MaxFramerate < 0)
+		{
+			UE_LOG(LogMillicastPublisher, Error, TEXT("Invalid settings for simulcast layer %s"), *Layer.Rid);
+			return false;
+		}
+	}
 
-	params.max_bitrate_bps = MaximumBitrate.Get(4'000'000) / 4;
-	params.active = true;
-	params.rid = "l";
-	params.scale_resolution_down_by = 4;
-	TransceiverInit.send_encodings.push_back(params);
+	return true;
 }
 
 void UMillicastPublisherComponent::CaptureAndAddTracks()
 {
+	// A backup sends the tracks of its primary publisher, nothing is captured twice
+	if (PrimarySource)
+	{
+		AddTrack(PrimarySource->GetVideoTrack());
+		AddTrack(PrimarySource->GetAudioTrack());
+		return;
+	}
+
 	// Starts audio and video capture
-	MillicastMediaSource->StartCapture(GetWorld(), Simulcast, [this](auto&& Track)
+	const TArray<FMillicastSimulcastLayer> CaptureLayers = Simulcast ? GetSimulcastLayers() : TArray<FMillicastSimulcastLayer>();
+	MillicastMediaSource->StartCapture(GetWorld(), CaptureLayers, [this](auto&& Track) { AddTrack(Track); });
+
+	if (Automute)
 	{
-		// Add transceiver with sendonly direction
-		webrtc::RtpTransceiverInit init;
-		init.direction = webrtc::RtpTransceiverDirection::kSendOnly;
-		init.stream_ids = { "unrealstream" };
+		// Muting media tracks until there are viewers watching the stream
+		UE_LOG(LogMillicastPublisher, Log, TEXT("Auto muting media tracks until viewers are watching"));
+		MillicastMediaSource->MuteVideo(true);
+		MillicastMediaSource->MuteAudio(true);
+	}
+}
+
+void UMillicastPublisherComponent::AddTrack(IMillicastSource::FStreamTrackInterface Track)
+{
+	if (!Track)
+	{
+		return;
+	}
 
-		if (Track->kind() == webrtc::MediaStreamTrackInterface::kVideoKind && Simulcast)
+	// Add transceiver with sendonly direction
+	webrtc::RtpTransceiverInit init;
+	init.direction = webrtc::RtpTransceiverDirection::kSendOnly;
+	init.stream_ids = { "unrealstream" };
+
+	if (Track->kind() == webrtc::MediaStreamTrackInterface::kVideoKind && Simulcast)
+	{
+		SetSimulcast(init);
+	}
+	else
+	{
+		webrtc::RtpEncodingParameters Encoding;
+		if (MinimumBitrate.IsSet())
 		{
-			SetSimulcast(init);
+			Encoding.min_bitrate_bps = *MinimumBitrate;
 		}
-		else
+		if (MaximumBitrate.IsSet())
 		{
-			webrtc::RtpEncodingParameters Encoding;
-			if (MinimumBitrate.IsSet())
-			{
-				Encoding.min_bitrate_bps = *MinimumBitrate;
-			}
-			if (MaximumBitrate.IsSet())
-			{
-				Encoding.max_bitrate_bps = *MaximumBitrate;
-			}
-			Encoding.max_framerate = 60;
-			Encoding.network_priority = webrtc::Priority::kHigh;
-			init.send_encodings.push_back(Encoding);
+			Encoding.max_bitrate_bps = *MaximumBitrate;
 		}
+		Encoding.max_framerate = MAX_VIDEO_FRAMERATE;
+		Encoding.network_priority = webrtc::Priority::kHigh;
+		init.send_encodings.push_back(Encoding);
+	}
+
+	// A backup in standby keeps its connection alive without sending any media
+	for (webrtc::RtpEncodingParameters& Encoding : init.send_encodings)
+	{
+		Encoding.active = !bStandby;
+	}
+
+	auto result = (*PeerConnection)->AddTransceiver(Track, init);
+
+	if (result.ok())
+	{
+		UE_LOG(LogMillicastPublisher, Log, TEXT("Add transceiver for %s track : %s"), 
+			*FString( Track->kind().c_str() ), *FString( Track->id().c_str() ) );
+	}
+	else
+	{
+		UE_LOG(LogMillicastPublisher, Error, TEXT("Couldn't add transceiver for %s track %s : %s"), 
+			*FString(Track->kind().c_str()),
+			*FString(Track->id().c_str()),
+			*FString(result.error().message()));
 
-		auto result = (*PeerConnection)->AddTransceiver(Track, init);
+		return;
+	}
+
+	// Detailed content keeps its resolution when webrtc adapts to the bandwidth, the framerate is reduced instead
+	const UMillicastPublisherSource* TrackSource = PrimarySource ? PrimarySource : MillicastMediaSource;
+	if (Track->kind() == webrtc::MediaStreamTrackInterface::kVideoKind
+		&& TrackSource->VideoContentHint == EMillicastVideoContentHint::Detail)
+	{
+		auto Sender = result.value()->sender();
+		webrtc::RtpParameters Parameters = Sender->GetParameters();
+		Parameters.degradation_preference = webrtc::DegradationPreference::MAINTAIN_RESOLUTION;
+		Sender->SetParameters(Parameters);
+	}
 
-		if (result.ok())
+	if (Track->kind() == webrtc::MediaStreamTrackInterface::kVideoKind && bUseFrameTransformer)
+	{
+		auto FrameTransformer = rtc::make_ref_counted<Millicast::Publisher::FFrameTransformer>(PeerConnection.Get());
+
+		PeerConnection->OnTransformableFrame = [this](uint32 Ssrc, uint32 Timestamp, TArray<uint8>& Data) {
+			Metadata = &Data;
+			OnAddFrameMetadata.Broadcast(Ssrc, Timestamp);
+		};
+
+		auto Transceiver = result.value();
+		Transceiver->sender()->SetEncoderToPacketizerFrameTransformer(FrameTransformer);
+	}
+}
+
+void UMillicastPublisherComponent::StartBackup()
+{
+	if (BackupPublisher || !IsPublishing())
+	{
+		return;
+	}
+
+	UE_LOG(LogMillicastPublisher, Log, TEXT("Connecting backup publisher to stream %s"), *BackupMediaSource->StreamName);
+
+	// The backup sends the same tracks, so it has the same encoding settings
+	BackupPublisher = NewObject<UMillicastPublisherComponent>(this);
+	BackupPublisher->PrimarySource = MillicastMediaSource;
+	BackupPublisher->bStandby = true;
+	BackupPublisher->SelectedVideoCodec = SelectedVideoCodec;
+	BackupPublisher->EncoderPreset = EncoderPreset;
+	BackupPublisher->SelectedAudioCodec = SelectedAudioCodec;
+	BackupPublisher->AudioEncoderSettings = AudioEncoderSettings;
+	BackupPublisher->Simulcast = Simulcast;
+	BackupPublisher->SimulcastLayers = SimulcastLayers;
+	BackupPublisher->MinimumBitrate = MinimumBitrate;
+	BackupPublisher->MaximumBitrate = MaximumBitrate;
+	BackupPublisher->StartingBitrate = StartingBitrate;
+	BackupPublisher->Initialize(BackupMediaSource);
+	BackupPublisher->Publish();
+}
+
+void UMillicastPublisherComponent::FailOver(uint64 ConnectionLostCycles)
+{
+	using namespace Millicast::Publisher;
+
+	if (!BackupPublisher)
+	{
+		return;
+	}
+
+	// The switch is over once the backup has handed its first video frame to its RTP sender, not once it is told to send.
+	// Waited for before the backup is activated so that frame can't be missed
+	FSimulcastEncoderFactory* EncoderFactory = FWebRTCPeerConnection::GetSimulcastEncoderFactory();
+	const FString BackupId = BackupPublisher->GetRecordingId();
+	const bool bWaitForFrame = EncoderFactory && BackupPublisher->HasVideoSender();
+	if (bWaitForFrame)
+	{
+		EncoderFactory->NotifyNextFrameSent(BackupId, [WEAK_CAPTURE, ConnectionLostCycles](uint64 SentCycles)
+		{
+			AsyncTask(ENamedThreads::GameThread, [WeakThis, ConnectionLostCycles, SentCycles]()
+			{
+				if (UMillicastPublisherComponent* This = WeakThis.Get())
+				{
+					This->FailedOver(FPlatformTime::ToMilliseconds64(SentCycles - ConnectionLostCycles));
+				}
+			});
+		});
+	}
+
+	if (!BackupPublisher->SetStandby(false))
+	{
+		if (bWaitForFrame)
 		{
-			UE_LOG(LogMillicastPublisher, Log, TEXT("Add transceiver for %s track : %s"), 
-				*FString( Track->kind().c_str() ), *FString( Track->id().c_str() ) );
+			EncoderFactory->NotifyNextFrameSent(BackupId, nullptr);
 		}
-		else
+		return;
+	}
+
+	// The encoder of the capture is shared by both connections, stop encoding for the lost one
+	{
+		FScopeLock Lock(&CriticalSection);
+		if (PeerConnection)
 		{
-			UE_LOG(LogMillicastPublisher, Error, TEXT("Couldn't add transceiver for %s track %s : %s"), 
-				*FString(Track->kind().c_str()),
-				*FString(Track->id().c_str()),
-				*FString(result.error().message()));
+			SetSendersActive(false);
+		}
+	}
 
-			return;
+	UE_LOG(LogMillicastPublisher, Log, TEXT("Connection lost, backup stream %s activated"), *BackupMediaSource->StreamName);
+
+	// Audio is sent as soon as the backup is active
+	if (!bWaitForFrame)
+	{
+		FailedOver(FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - ConnectionLostCycles));
+	}
+}
+
+void UMillicastPublisherComponent::FailedOver(float SwitchTimeMs)
+{
+	UE_LOG(LogMillicastPublisher, Warning, TEXT("Connection lost, failed over to the backup stream %s in %.1f ms"), *BackupMediaSource->StreamName, SwitchTimeMs);
+
+	OnFailover.Broadcast(SwitchTimeMs);
+}
+
+void UMillicastPublisherComponent::FailBack()
+{
+	// The primary starts before the backup stops, the viewers get a short overlap rather than a gap
+	{
+		FScopeLock Lock(&CriticalSection);
+		if (PeerConnection)
+		{
+			SetSendersActive(true);
 		}
+	}
 
-		if (Track->kind() == webrtc::MediaStreamTrackInterface::kVideoKind && bUseFrameTransformer)
+	if (BackupPublisher)
+	{
+		// Back before the backup sent anything, the fail over never completed
+		if (auto* EncoderFactory = Millicast::Publisher::FWebRTCPeerConnection::GetSimulcastEncoderFactory())
 		{
-			auto FrameTransformer = rtc::make_ref_counted<Millicast::Publisher::FFrameTransformer>(PeerConnection.Get());
+			EncoderFactory->NotifyNextFrameSent(BackupPublisher->GetRecordingId(), nullptr);
+		}
+		BackupPublisher->SetStandby(true);
+	}
+
+	UE_LOG(LogMillicastPublisher, Log, TEXT("Connection restored, sending to the primary stream %s again"), *MillicastMediaSource->StreamName);
+
+	OnFailback.Broadcast();
+}
 
-			PeerConnection->OnTransformableFrame = [this](uint32 Ssrc, uint32 Timestamp, TArray<uint8>& Data) {
-				Metadata = &Data;
-				OnAddFrameMetadata.Broadcast(Ssrc, Timestamp);
-			};
+bool UMillicastPublisherComponent::UpdateFailover()
+{
+	if (!Failover || !IsPublishing())
+	{
+		return false;
+	}
 
-			auto Transceiver = result.value();
-			Transceiver->sender()->SetEncoderToPacketizerFrameTransformer(FrameTransformer);
+	if (Failover->Update(FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64())) == Millicast::Publisher::FFailoverController::EAction::FailBack)
+	{
+		FailBack();
+	}
+
+	return Failover->IsWaitingToFailBack();
+}
+
+bool UMillicastPublisherComponent::IsStandbyReady() const
+{
+	return bStandby && IsPublishing() && PeerConnection.IsValid();
+}
+
+bool UMillicastPublisherComponent::HasVideoSender()
+{
+	FScopeLock Lock(&CriticalSection);
+
+	if (!PeerConnection)
+	{
+		return false;
+	}
+
+	for (const auto& Sender : (*PeerConnection)->GetSenders())
+	{
+		if (Sender->media_type() == cricket::MEDIA_TYPE_VIDEO)
+		{
+			return true;
 		}
-	});
+	}
+	return false;
+}
 
-	if (Automute)
+bool UMillicastPublisherComponent::SetStandby(bool bInStandby)
+{
+	if (!IsPublishing() || bStandby == bInStandby)
 	{
-		// Muting media tracks until there are viewers watching the stream
-		UE_LOG(LogMillicastPublisher, Log, TEXT("Auto muting media tracks until viewers are watching"));
-		MillicastMediaSource->MuteVideo(true);
-		MillicastMediaSource->MuteAudio(true);
+		return false;
+	}
+
+	FScopeLock Lock(&CriticalSection);
+
+	if (!PeerConnection)
+	{
+		return false;
+	}
+
+	bStandby = bInStandby;
+	SetSendersActive(!bInStandby);
+
+	return true;
+}
+
+void UMillicastPublisherComponent::SetSendersActive(bool bActive)
+{
+	// Changing the encodings does not need a renegotiation, the streams start again with a key frame
+	for (const auto& Sender : (*PeerConnection)->GetSenders())
+	{
+		webrtc::RtpParameters Parameters = Sender->GetParameters();
+		for (webrtc::RtpEncodingParameters& Encoding : Parameters.encodings)
+		{
+			Encoding.active = bActive;
+		}
+
+		const auto Error = Sender->SetParameters(Parameters);
+		if (!Error.ok())
+		{
+			UE_LOG(LogMillicastPublisher, Error, TEXT("Could not update the encodings of sender %s: %s"), *FString(Sender->id().c_str()), *FString(Error.message()));
+		}
 	}
 }
 
@@ -763,6 +1189,42 @@ bool UMillicastPublisherComponent::SetVideoCodec(EMillicastVideoCodecs InVideoCo
 	return true;
 }
 
+void UMillicastPublisherComponent::StartRecording(const FString& FilePath, int32 LayerIndex)
+{
+	using namespace Millicast::Publisher;
+
+	const FString FullPath = FPaths::ConvertRelativePathToFull(FPaths::ProjectSavedDir(), FilePath);
+
+	FWebRTCPeerConnection::GetPeerConnectionFactory();
+	FWebRTCPeerConnection::GetSimulcastEncoderFactory()->StartRecording(GetRecordingId(), FullPath, FMath::Max(LayerIndex, 0));
+}
+
+void UMillicastPublisherComponent::StopRecording()
+{
+	if (auto* EncoderFactory = Millicast::Publisher::FWebRTCPeerConnection::GetSimulcastEncoderFactory())
+	{
+		EncoderFactory->StopRecording(GetRecordingId());
+	}
+}
+
+FString UMillicastPublisherComponent::GetRecordingId() const
+{
+	// Unique among the publishers alive, the recording is stopped before the component goes
+	return FString::Printf(TEXT("%u"), GetUniqueID());
+}
+
+bool UMillicastPublisherComponent::SetEncoderPreset(EMillicastVideoEncoderPreset InEncoderPreset)
+{
+	if (IsConnectionActive())
+	{
+		UE_LOG(LogMillicastPublisher, Error, TEXT("Cannot set encoder preset while publishing"));
+		return false;
+	}
+
+	EncoderPreset = InEncoderPreset;
+	return true;
+}
+
 bool UMillicastPublisherComponent::SetAudioCodec(EMillicastAudioCodecs InAudioCodec)
 {
 	if (IsConnectionActive())
@@ -775,6 +1237,35 @@ bool UMillicastPublisherComponent::SetAudioCodec(EMillicastAudioCodecs InAudioCo
 	return true;
 }
 
+bool UMillicastPublisherComponent::SetAudioEncoderSettings(const FMillicastAudioEncoderSettings& InSettings)
+{
+	if (IsConnectionActive())
+	{
+		UE_LOG(LogMillicastPublisher, Error, TEXT("Cannot set audio encoder settings while publishing"));
+		return false;
+	}
+
+	AudioEncoderSettings = InSettings;
+	return true;
+}
+
+bool UMillicastPublisherComponent::SetSimulcastLayers(const TArray<FMillicastSimulcastLayer>& InSimulcastLayers)
+{
+	if (IsConnectionActive())
+	{
+		UE_LOG(LogMillicastPublisher, Error, TEXT("Cannot set simulcast layers while publishing"));
+		return false;
+	}
+
+	if (!AreSimulcastLayersValid(InSimulcastLayers))
+	{
+		return false;
+	}
+
+	SimulcastLayers = InSimulcastLayers;
+	return true;
+}
+
 void UMillicastPublisherComponent::EnableStats(bool Enable)
 {
 	RtcStatsEnabled = Enable;
@@ -3,16 +3,22 @@
 #include "AudioCapturerBase.h"
 #include "AudioSubmixCapturer.h"
 #include "AudioDeviceCapturer.h"
+#include "AudioMixerCapturer.h"
 
 #if PLATFORM_WINDOWS
 #include "WasapiDeviceCapturer.h"
 #endif
 
+#include "AudioSampleConversion.h"
+#include "CaptureClock.h"
 #include "WebRTC/PeerConnection.h"
-#include "common_audio/include/audio_util.h"
+#include "WebRTC/Stats.h"
 
 #include "Util.h"
 
+#include "HAL/Event.h"
+#include "HAL/RunnableThread.h"
+
 IMillicastAudioSource* IMillicastAudioSource::Create(EAudioCapturerType CapturerType)
 {
 	using namespace Millicast::Publisher;
@@ -21,6 +27,7 @@ IMillicastAudioSource* IMillicastAudioSource::Create(EAudioCapturerType Capturer
 	{
 	case EAudioCapturerType::Submix: return new AudioSubmixCapturer;
 	case EAudioCapturerType::Device: return new AudioDeviceCapturer;
+	case EAudioCapturerType::Mixer: return new AudioMixerCapturer;
 	}
 
 	return nullptr;
@@ -35,59 +42,249 @@ AudioCapturerBase::AudioCapturerBase() noexcept
 
 	// Number of samples for 10ms of audio data
 	NumSamples = SamplePerSecond * NumChannels * TimePerFrameMs / 1000;
-	// Number of bits for each sample
-	BitPerSample = sizeof(FSample) * 8 * NumChannels;
+
+	AudioBuffer.Init(NumSamples);
+
+	StopEvent = FPlatformProcess::GetSynchEventFromPool();
 }
 
-void AudioCapturerBase::SendAudio(const float* InAudioData, int32 InNumSamples, int32 InNumChannels)
+AudioCapturerBase::~AudioCapturerBase()
 {
-	// Mix if needed
-	Audio::TSampleBuffer<float> Buffer(InAudioData, InNumSamples, InNumChannels, SamplePerSecond);
-	if (Buffer.GetNumChannels() != NumChannels)
+	StopDelivery();
+	FPlatformProcess::ReturnSynchEventToPool(StopEvent);
+}
+
+void AudioCapturerBase::SendAudio(const float* InAudioData, int32 InNumSamples, int32 InNumChannels, int32 InSampleRate, float Gain)
+{
+	DriftCompensator.Update(InNumSamples / InNumChannels, InSampleRate, rtc::TimeMicros() * 1e-6);
+
 	{
-		Buffer.MixBufferToChannels(NumChannels);
+		FScopeLock Lock(&DriftStatsSection);
+		DriftStats = DriftCompensator.IsCompensating() ? TOptional<FAudioDriftStats>(DriftCompensator.GetStats()) : TOptional<FAudioDriftStats>();
 	}
 
-	const auto currentNum = AudioBuffer.Num(); // Get the current size of the buffer
-	AudioBuffer.AddZeroed(Buffer.GetNumSamples()); // Allocate the new number of samples
+	if (InSampleRate == SamplePerSecond)
+	{
+		WriteAudio(InAudioData, InNumSamples, InNumChannels, Gain);
+		return;
+	}
 
-	// Convert it from float to signed 16 bit audio data and add it at the end of the audio buffer
-	webrtc::FloatToS16(Buffer.GetData(), Buffer.GetNumSamples(), AudioBuffer.GetData() + currentNum);
+	// The audio is dropped if its rate can't be converted
+	if (!Resampler.Configure(InSampleRate, InNumChannels))
+	{
+		return;
+	}
 
-	// Send audio to webrtc
-	SendAudio();
+	Resampler.Process(InAudioData, InNumSamples / InNumChannels, [this, InNumChannels, Gain](const float* ResampledData, int32 NumFrames)
+	{
+		WriteAudio(ResampledData, NumFrames * InNumChannels, InNumChannels, Gain);
+	});
+}
+
+void AudioCapturerBase::WriteAudio(const float* InAudioData, int32 InNumSamples, int32 InNumChannels, float Gain)
+{
+	DriftCompensator.Process(InAudioData, InNumSamples / InNumChannels, InNumChannels, [this, InNumChannels, Gain](const float* CompensatedData, int32 NumFrames)
+	{
+		WriteCompensatedAudio(CompensatedData, NumFrames * InNumChannels, InNumChannels, Gain);
+	});
+}
+
+void AudioCapturerBase::WriteCompensatedAudio(const float* InAudioData, int32 InNumSamples, int32 InNumChannels, float Gain)
+{
+	// Mono and stereo are remixed by the conversion, other layouts are mixed beforehand
+	TOptional<Audio::TSampleBuffer<float>> MixedBuffer;
+	if (!CanRemixChannels(InNumChannels, NumChannels))
+	{
+		MixedBuffer.Emplace(InAudioData, InNumSamples, InNumChannels, SamplePerSecond);
+		MixedBuffer->MixBufferToChannels(NumChannels);
+
+		InAudioData = MixedBuffer->GetData();
+		InNumSamples = MixedBuffer->GetNumSamples();
+		InNumChannels = NumChannels;
+	}
+
+	// Apply the gain and convert from float to signed 16 bit audio data straight into the audio buffer
+	WriteFrames(InAudioData, InNumSamples / InNumChannels, InNumChannels, [this, InNumChannels, Gain](const float* Source, int32 NumFrames, FSample* Destination)
+	{
+		FloatToS16(Source, NumFrames, InNumChannels, NumChannels, Gain, Destination);
+
+		if (SurroundLayout)
+		{
+			ReorderChannels(Destination, NumFrames, NumChannels, SurroundLayout->EngineChannels);
+		}
+	});
 }
 
 void AudioCapturerBase::SendAudio(const int16* InAudioData, int32 InNumSamples, int32 InNumChannels)
 {
 	// Mix if needed
-	Audio::TSampleBuffer<int16> Buffer(InAudioData, InNumSamples, InNumChannels, SamplePerSecond);
-	if (Buffer.GetNumChannels() != NumChannels)
+	TOptional<Audio::TSampleBuffer<int16>> MixedBuffer;
+	if (InNumChannels != NumChannels)
 	{
-		Buffer.MixBufferToChannels(NumChannels);
+		MixedBuffer.Emplace(InAudioData, InNumSamples, InNumChannels, SamplePerSecond);
+		MixedBuffer->MixBufferToChannels(NumChannels);
+
+		InAudioData = MixedBuffer->GetData();
+		InNumSamples = MixedBuffer->GetNumSamples();
 	}
 
-	const auto currentNum = AudioBuffer.Num(); // Get the current size of the buffer
-	AudioBuffer.Append(Buffer.GetData(), Buffer.GetNumSamples()); // Append data to the end of the buffer
+	WriteFrames(InAudioData, InNumSamples / NumChannels, NumChannels, [this](const int16* Source, int32 NumFrames, FSample* Destination)
+	{
+		FMemory::Memcpy(Destination, Source, NumFrames * NumChannels * sizeof(FSample));
 
-	// Send audio frame to webrtc
-	SendAudio();
+		if (SurroundLayout)
+		{
+			ReorderChannels(Destination, NumFrames, NumChannels, SurroundLayout->EngineChannels);
+		}
+	});
 }
 
 void AudioCapturerBase::SendAudio()
 {
+	const auto NumFrameSamples = NumSamples / NumChannels;
+	int64 FrameIndex = WrittenFrames - AudioBuffer.GetNumSamples() / NumChannels;
+
 	// while there is enough samples in the buffer for a whole audio frame
-	while (AudioBuffer.Num() >= NumSamples)
+	while (const FSample* Frame = AudioBuffer.PeekFrame())
+	{
+		if (bDelivering)
+		{
+			// Capture time on the clock of the video frames, carried by the absolute capture time header extension
+			const TOptional<int64> CaptureTimeUs = DriftCompensator.GetCaptureTimeUs(FrameIndex);
+
+			FrameQueue.Push(Frame, NumSamples, NumChannels, CaptureTimeUs.Get(0));
+		}
+
+		// Release the audio data we just queued
+		AudioBuffer.PopFrame();
+		FrameIndex += NumFrameSamples;
+	}
+}
+
+void AudioCapturerBase::StartDelivery()
+{
+	if (DeliveryThread)
+	{
+		return;
+	}
+
+	FrameQueue.Reset();
+	bStopping = false;
+	bDelivering = true;
+
+	// The mixer pulls the frames from its own thread
+	if (bMixed)
+	{
+		return;
+	}
+
+	DeliveryThread.Reset(FRunnableThread::Create(this, TEXT("MillicastAudioDelivery"), 0, TPri_Highest));
+}
+
+void AudioCapturerBase::StopDelivery()
+{
+	bDelivering = false;
+
+	if (DeliveryThread)
 	{
-		for (auto Sink : Sinks) // call all the audio sinks
+		Stop();
+		DeliveryThread->WaitForCompletion();
+		DeliveryThread.Reset();
+	}
+
+	// The capture thread may still push a frame, emptied at the next start
+	while (FrameQueue.Peek())
+	{
+		FrameQueue.Pop();
+	}
+}
+
+uint32 AudioCapturerBase::Run()
+{
+	constexpr int64 FrameDurationUs = TimePerFrameMs * rtc::kNumMicrosecsPerMillisec;
+
+	// Paced on the system clock the drift compensation locks the capture to, the queue fill stays stable
+	int64 NextFrameUs = rtc::TimeMicros();
+
+	while (!bStopping)
+	{
+		const int64 NowUs = rtc::TimeMicros();
+		if (NowUs < NextFrameUs)
 		{
-			// Divide by the number of channels because it is included in the bit per sample
-			const auto NewNumSample = NumSamples / NumChannels;
-			// Call on data
-			Sink->OnData(AudioBuffer.GetData(), BitPerSample, SamplePerSecond, NumChannels, NewNumSample);
+			StopEvent->Wait(FMath::Max<uint32>((NextFrameUs - NowUs) / rtc::kNumMicrosecsPerMillisec, 1));
+			continue;
 		}
-		// Remove the audio data we just sent to the audio sinks
-		AudioBuffer.RemoveAt(0, NumSamples);
+
+		DeliverFrame();
+
+		// Skip ahead rather than sending a burst of frames when the thread has been stalled
+		NextFrameUs = NowUs - NextFrameUs > FrameQueue.GetCapacity() * FrameDurationUs ? NowUs + FrameDurationUs : NextFrameUs + FrameDurationUs;
+	}
+
+	return 0;
+}
+
+void AudioCapturerBase::Stop()
+{
+	bStopping = true;
+	StopEvent->Trigger();
+}
+
+const FAudioFrameQueue::FFrame* AudioCapturerBase::PullFrame()
+{
+	return FrameQueue.Pull(FMath::Max(TargetLatencyMs / TimePerFrameMs, 1));
+}
+
+void AudioCapturerBase::DeliverFrame()
+{
+	if (const FAudioFrameQueue::FFrame* Frame = PullFrame())
+	{
+		SendFrame(Frame->Samples, Frame->NumChannels, Frame->CaptureTimeUs);
+		PopFrame();
+	}
+	else
+	{
+		// Silence keeps the frames steady
+		static const FSample Silence[FAudioFrameQueue::MaxFrameSamples] = {};
+		SendFrame(Silence, NumChannels, 0);
+	}
+
+	FPublisherStats::Get().SetAudioDeliveryStats(GetQueuedMs(), TargetLatencyMs, GetNumUnderruns(), GetNumOverruns());
+
+	const TOptional<FAudioDriftStats> Drift = GetDriftStats();
+	if (Drift.IsSet())
+	{
+		FPublisherStats::Get().SetAudioDriftStats(Drift->DriftPpm, Drift->CorrectionPpm, Drift->FillMs);
+	}
+}
+
+TOptional<FAudioDriftStats> AudioCapturerBase::GetDriftStats() const
+{
+	FScopeLock Lock(&DriftStatsSection);
+	return DriftStats;
+}
+
+void AudioCapturerBase::SendFrame(const FSample* InAudioData, int32 InNumChannels, int64 InCaptureTimeUs)
+{
+	constexpr int32 NumFrameSamples = SamplePerSecond * TimePerFrameMs / 1000;
+
+	// The bits per sample include the number of channels
+	const int32 FrameBitPerSample = sizeof(FSample) * 8 * InNumChannels;
+
+	// call all the audio sinks
+	Sinks.ForEach([&](webrtc::AudioTrackSinkInterface* Sink)
+	{
+#if WEBRTC_VERSION == 84
+		Sink->OnData(InAudioData, FrameBitPerSample, SamplePerSecond, InNumChannels, NumFrameSamples);
+#else
+		Sink->OnData(InAudioData, FrameBitPerSample, SamplePerSecond, InNumChannels, NumFrameSamples,
+			InCaptureTimeUs != 0 ? absl::optional<int64_t>(InCaptureTimeUs / rtc::kNumMicrosecsPerMillisec) : absl::nullopt);
+#endif
+	});
+
+	if (InCaptureTimeUs != 0 && FPublisherStats::Get().IsMeasuringAVOffset())
+	{
+		FPublisherStats::Get().AudioFrameSent((FCaptureClock::NowUs() - InCaptureTimeUs) / 1000.0);
 	}
 }
 
@@ -98,6 +295,15 @@ void AudioCapturerBase::CreateRtcSourceTrack()
 
 	// Create audio track
 	RtcAudioTrack  = peerConnectionFactory->CreateAudioTrack(to_string(TrackId.Get("audio")), this);
+
+	StartDelivery();
+}
+
+void AudioCapturerBase::ReleaseRtcSourceTrack()
+{
+	StopDelivery();
+
+	RtcAudioTrack = nullptr;
 }
 
 IMillicastSource::FStreamTrackInterface AudioCapturerBase::GetTrack()
@@ -107,7 +313,7 @@ IMillicastSource::FStreamTrackInterface AudioCapturerBase::GetTrack()
 
 void AudioCapturerBase::AddSink(webrtc::AudioTrackSinkInterface* Sink)
 {
-	Sinks.Emplace(Sink);
+	Sinks.Add(Sink);
 }
 
 void AudioCapturerBase::RemoveSink(webrtc::AudioTrackSinkInterface* Sink)
@@ -118,9 +324,17 @@ void AudioCapturerBase::RemoveSink(webrtc::AudioTrackSinkInterface* Sink)
 void AudioCapturerBase::SetNumChannel(uint8 InNumChannel)
 {
 	NumChannels = InNumChannel;
+	SurroundLayout = FindMultiOpusLayout(NumChannels);
 
 	NumSamples = NumChannels * SamplePerSecond * TimePerFrameMs / 1000;
-	BitPerSample = NumChannels * sizeof(FSample) * 8;
+
+	// Samples buffered in the previous layout can't be sent anymore
+	AudioBuffer.Init(NumSamples);
+}
+
+void AudioCapturerBase::SetTargetLatency(int32 InLatencyMs)
+{
+	TargetLatencyMs = FMath::Clamp(InLatencyMs, TimePerFrameMs, FrameQueue.GetCapacity() * TimePerFrameMs / 2);
 }
 
-}
\ No newline at end of file
+}
@@ -3,16 +3,34 @@
 #pragma once
 
 #include "IMillicastSource.h"
+#include "AudioFrameRingBuffer.h"
+#include "AudioStreamResampler.h"
+#include "AudioDriftCompensator.h"
+#include "AudioFrameQueue.h"
+#include "AudioSinkList.h"
+#include "WebRTC/MultiOpus.h"
+
+#include "HAL/Runnable.h"
 
 #include <pc/local_audio_source.h>
 
+class FRunnableThread;
+class FEvent;
+
 namespace Millicast::Publisher
 {
-	class AudioCapturerBase : public IMillicastAudioSource, rtc::RefCountedObject<webrtc::LocalAudioSource>
+	/*
+	 * Base of the audio capturers, converts the captured audio to the 10 ms frames of webrtc.
+	 * The frames are queued for a delivery thread which hands one to the sinks every 10 ms, so the capture thread never
+	 * waits for webrtc and the sinks receive steady frames whatever the capture buffering.
+	 */
+	class AudioCapturerBase : public IMillicastAudioSource, rtc::RefCountedObject<webrtc::LocalAudioSource>, public FRunnable
 	{
-		uint8 NumChannels = 2; // TODO: Make it configurable
+		uint8 NumChannels = 2;
 		int32 NumSamples;
-		uint16 BitPerSample;
+
+		// Surround is published with Opus multistream, in the channel order of its layout
+		const FMultiOpusLayout* SurroundLayout = nullptr;
 
 	protected:
 		using FSample = int16;
@@ -22,23 +40,122 @@ namespace Millicast::Publisher
 
 		FStreamTrackInterface RtcAudioTrack = nullptr;
 
-		TSet<webrtc::AudioTrackSinkInterface*> Sinks;
-		TArray<FSample> AudioBuffer;
+		FAudioSinkList Sinks;
+		FAudioFrameRingBuffer AudioBuffer;
 
 	protected:
-		void SendAudio(const float* InAudioData, int32 InNumSamples, int32 InNumChannels);
+		/** Audio at any other rate than SamplePerSecond is resampled. Gain is the linear factor applied to the samples, see DbToGain. */
+		void SendAudio(const float* InAudioData, int32 InNumSamples, int32 InNumChannels, int32 InSampleRate, float Gain = 1.f);
 		void SendAudio(const int16* InAudioData, int32 InNumSamples, int32 InNumChannels);
+
+		/** Capture clock of the next buffer given to SendAudio in seconds, measured against the system clock to compensate its drift */
+		void SetCaptureClock(double InCaptureClock) { DriftCompensator.SetCaptureClock(InCaptureClock); }
+
+		/**
+		 * Writes interleaved frames of InNumChannels samples to the audio buffer and sends every complete 10 ms frame.
+		 * Convert(Source, NumFrames, Destination) converts the frames to FSample in the published layout straight into the buffer.
+		 */
+		template<typename SampleType, typename ConvertFunc>
+		void WriteFrames(const SampleType* InAudioData, int32 InNumFrames, int32 InNumChannels, ConvertFunc&& Convert)
+		{
+			while (InNumFrames > 0)
+			{
+				// The buffer is only ever written whole frames, the span holds a whole number of them
+				int32 SpanSamples = 0;
+				FSample* Span = AudioBuffer.GetWriteSpan(SpanSamples);
+
+				const int32 Count = FMath::Min(SpanSamples / NumChannels, InNumFrames);
+				Convert(InAudioData, Count, Span);
+				AudioBuffer.Commit(Count * NumChannels);
+				WrittenFrames += Count;
+
+				InAudioData += Count * InNumChannels;
+				InNumFrames -= Count;
+
+				// Sending the complete frames makes room for the rest of the samples
+				SendAudio();
+			}
+		}
+
+		/** Queues the complete frames of the audio buffer for the delivery thread */
 		void SendAudio();
+
+		/** Creates the track and starts the delivery thread, releasing the track stops it */
 		void CreateRtcSourceTrack();
+		void ReleaseRtcSourceTrack();
+
+		/** Called every 10 ms by the delivery thread, hands the frame due to the sinks */
+		virtual void DeliverFrame();
+		void SendFrame(const FSample* InAudioData, int32 InNumChannels, int64 InCaptureTimeUs);
+
+	private:
+		/** Writes float audio at SamplePerSecond to the audio buffer, after removing the capture clock drift */
+		void WriteAudio(const float* InAudioData, int32 InNumSamples, int32 InNumChannels, float Gain);
+		void WriteCompensatedAudio(const float* InAudioData, int32 InNumSamples, int32 InNumChannels, float Gain);
+
+		FAudioStreamResampler Resampler { SamplePerSecond };
+		FAudioDriftCompensator DriftCompensator;
+
+		// Written by the capture thread
+		mutable FCriticalSection DriftStatsSection;
+		TOptional<FAudioDriftStats> DriftStats;
+
+		// Frames written to the audio buffer since the start, locates the frames sent in the output of the drift compensator
+		int64 WrittenFrames = 0;
+
+		void StartDelivery();
+		void StopDelivery();
+
+		FAudioFrameQueue FrameQueue { 32 };
+		TAtomic<int32> TargetLatencyMs { 20 };
+		TAtomic<bool> bDelivering { false };
+		bool bMixed = false;
+
+		TAtomic<bool> bStopping { false };
+		FEvent* StopEvent = nullptr;
+		TUniquePtr<FRunnableThread> DeliveryThread;
+
 	public:
 		AudioCapturerBase() noexcept;
+		virtual ~AudioCapturerBase() override;
 
 		FStreamTrackInterface GetTrack() override;
 
 		void AddSink(webrtc::AudioTrackSinkInterface* Sink) override;
 		void RemoveSink(webrtc::AudioTrackSinkInterface* Sink) override;
 
+		/** Channels of the published audio, 5.1 and 7.1 are published with Opus multistream */
 		uint8 GetNumChannel() const { return NumChannels; }
 		void SetNumChannel(uint8 InNumChannel);
+
+		/** Audio queued before the sinks to absorb the jitter of the capture, in ms */
+		void SetTargetLatency(int32 InLatencyMs);
+		int32 GetTargetLatency() const { return TargetLatencyMs; }
+
+		/** The frames of a mixer input are pulled by the mixer thread, the capturer has no delivery thread. Set before StartCapture. */
+		void SetMixed(bool bInMixed) { bMixed = bInMixed; }
+		bool IsMixed() const { return bMixed; }
+
+		/** The capturer whose queue holds the frames, once capturing. Capturers wrapping another one return it. */
+		virtual AudioCapturerBase* GetFrameSource() { return this; }
+
+		/**
+		 * Delivery side of the queue: the frame due now, or null when silence must be sent instead because the queue is
+		 * empty or filling up to the target latency after an underrun. A frame returned is popped once sent.
+		 */
+		const FAudioFrameQueue::FFrame* PullFrame();
+		void PopFrame() { FrameQueue.Pop(); }
+
+		int32 GetQueuedMs() const { return FrameQueue.Num() * TimePerFrameMs; }
+		int32 GetNumUnderruns() const { return FrameQueue.GetNumUnderruns(); }
+		int32 GetNumOverruns() const { return FrameQueue.GetNumOverruns(); }
+
+		/** Drift of the capture clock, once measured. Read by the delivery thread, which reports it. */
+		TOptional<FAudioDriftStats> GetDriftStats() const;
+
+		// FRunnable
+		virtual uint32 Run() override;
+		virtual void Stop() override;
+		// ~FRunnable
 	};
 }
@@ -2,7 +2,7 @@
 
 #include "AudioDeviceCapturer.h"
 
-#include "common_audio/include/audio_util.h"
+#include "AudioSampleConversion.h"
 #include "MillicastPublisherPrivate.h"
 
 #if PLATFORM_WINDOWS
@@ -20,6 +20,7 @@ class InputCapturer : public AudioCapturerBase
 	Audio::FAudioCapture      AudioCapture;
 
 	float VolumeMultiplier = 0.0f; // dB
+	float Gain = 1.0f; // Volume amplifier factor of VolumeMultiplier
 
 public:
 	FStreamTrackInterface StartCapture(UWorld* InWorld) override;
@@ -27,7 +28,7 @@ public:
 
 	void SetAudioCaptureDevice(int32 InDeviceIndex);
 
-	void SetVolumeMultiplier(float f) noexcept { VolumeMultiplier = f; }
+	void SetVolumeMultiplier(float f) noexcept { VolumeMultiplier = f; Gain = DbToGain(f); }
 };
 
 AudioDeviceCapturer::FStreamTrackInterface InputCapturer::StartCapture(UWorld* InWorld)
@@ -54,11 +55,6 @@ AudioDeviceCapturer::FStreamTrackInterface InputCapturer::StartCapture(UWorld* I
 	{
 		auto AudioData = reinterpret_cast<const float*>(InAudioData);
 
-		if (SamplePerSecond != SampleRate)
-		{
-			return;
-		}
-
 		if (GetNumChannel() != InNumChannels)
 		{
 			SetNumChannel(InNumChannels);
@@ -66,15 +62,9 @@ AudioDeviceCapturer::FStreamTrackInterface InputCapturer::StartCapture(UWorld* I
 
 		int32 NumSamples = NumFrames * InNumChannels;
 
-		for (int i = 0; i < NumSamples; ++i)
-		{
-			const float factor = pow(10.0f, VolumeMultiplier / 20.f); // Volume amplifier factor
-			float value = FMath::Clamp(AudioData[i] * factor, -1.f, 1.f); // Amplify the volume by the factor and clamp it
-
-			AudioBuffer.Add(webrtc::FloatToS16(value)); // Convert the float value to S16 and add it to the Buffer
-		}
-
-		SendAudio();
+		// Amplify the volume, clamp and convert to S16 straight into the audio buffer
+		SetCaptureClock(StreamTime);
+		SendAudio(AudioData, NumSamples, InNumChannels, SampleRate, Gain);
 	};
 
 	Audio::FAudioCaptureDeviceParams Params = Audio::FAudioCaptureDeviceParams();
@@ -99,7 +89,7 @@ void InputCapturer::StopCapture()
 	if (RtcAudioTrack)
 	{
 		AudioCapture.StopStream();
-		RtcAudioTrack = nullptr;
+		ReleaseRtcSourceTrack();
 	}
 }
 
@@ -150,7 +140,10 @@ AudioDeviceCapturer::FStreamTrackInterface AudioDeviceCapturer::StartCapture(UWo
 #endif
 	}
 
-	return AudioCapture->StartCapture(InWorld);;
+	AudioCapture->SetTargetLatency(GetTargetLatency());
+	AudioCapture->SetMixed(IsMixed());
+
+	return AudioCapture->StartCapture(InWorld);
 }
 void AudioDeviceCapturer::StopCapture()
 {
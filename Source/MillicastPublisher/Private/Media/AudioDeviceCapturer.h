@@ -24,6 +24,7 @@ namespace Millicast::Publisher
 		void StopCapture() override;
 
 		IMillicastSource::FStreamTrackInterface GetTrack() override;
+		AudioCapturerBase* GetFrameSource() override { return AudioCapture.Get(); }
 
 		void SetAudioCaptureDevice(const FAudioCaptureInfo& InDeviceIndex);
 
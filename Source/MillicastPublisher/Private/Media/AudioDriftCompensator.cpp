@@ -0,0 +1,172 @@
+// Copyright Dolby.io 2023. All Rights Reserved.
+
+#include "AudioDriftCompensator.h"
+
+#include "MillicastPublisherPrivate.h"
+
+namespace Millicast::Publisher
+{
+
+namespace
+{
+	constexpr double ForgetSeconds = 60.0;        // Time constant of the drift fit
+	constexpr double MinFitSeconds = 5.0;         // Measure before correcting anything
+	constexpr double FillSmoothingSeconds = 1.0;  // Smooths out the burstiness of the capture callbacks
+	constexpr double FillCorrectionSeconds = 10.0; // Time to correct a fill error on top of the drift
+	constexpr double MaxDriftPpm = 1000.0;
+	constexpr double MaxFillCorrection = 1e-3;
+
+	// A gap or a jump in the clocks means the capture stopped or the device changed, the measure starts over
+	constexpr double MaxGapSeconds = 1.0;
+	constexpr double MaxJumpSeconds = 0.1;
+
+	constexpr int32 HistoryFrames = 3;
+
+	/** 4 points cubic Hermite interpolation between Y0 and Y1 */
+	FORCEINLINE float Interpolate(float Ym1, float Y0, float Y1, float Y2, float T)
+	{
+		const float C1 = 0.5f * (Y1 - Ym1);
+		const float C2 = Ym1 - 2.5f * Y0 + 2.f * Y1 - 0.5f * Y2;
+		const float C3 = 0.5f * (Y2 - Ym1) + 1.5f * (Y0 - Y1);
+		return ((C3 * T + C2) * T + C1) * T + Y0;
+	}
+}
+
+void FAudioDriftCompensator::SetCaptureClock(double InCaptureClock)
+{
+	CaptureClock = InCaptureClock;
+}
+
+void FAudioDriftCompensator::Update(int32 InNumFrames, int32 InSampleRate, double SystemTime)
+{
+	const double Capture = CaptureClock.Get(CountedClock);
+
+	InputBufferSeconds = double(InNumFrames) / InSampleRate;
+	CaptureClock.Reset();
+	CountedClock = Capture + InputBufferSeconds;
+
+	if (!bStarted)
+	{
+		Restart(SystemTime, Capture);
+		return;
+	}
+
+	const double Elapsed = SystemTime - SystemStart;
+	const double Offset = (Capture - CaptureStart) - Elapsed;
+	const double DeltaTime = SystemTime - LastSystemTime;
+
+	if (DeltaTime > MaxGapSeconds || FMath::Abs(Offset - LastOffset) > MaxJumpSeconds)
+	{
+		UE_LOG(LogMillicastPublisher, Log, TEXT("Audio capture clock discontinuity (%.3f s gap, %.3f s jump), restarting the drift measure"), DeltaTime, Offset - LastOffset);
+		Restart(SystemTime, Capture);
+		return;
+	}
+
+	LastSystemTime = SystemTime;
+	LastOffset = Offset;
+
+	const double Fill = double(OutputFrames - StartOutputFrames) / OutputRate - Elapsed;
+	FilteredFill = SumWeight > 0.0 ? FilteredFill + (Fill - FilteredFill) * (1.0 - FMath::Exp(-DeltaTime / FillSmoothingSeconds)) : Fill;
+
+	// The slope of the capture clock offset over time is the drift
+	const double Decay = FMath::Exp(-DeltaTime / ForgetSeconds);
+	SumWeight = SumWeight * Decay + 1.0;
+	SumX = SumX * Decay + Elapsed;
+	SumY = SumY * Decay + Offset;
+	SumXX = SumXX * Decay + Elapsed * Elapsed;
+	SumXY = SumXY * Decay + Elapsed * Offset;
+
+	const double Denominator = SumWeight * SumXX - SumX * SumX;
+	if (Elapsed < MinFitSeconds || Denominator <= 0.0)
+	{
+		return;
+	}
+
+	DriftPpm = FMath::Clamp((SumWeight * SumXY - SumX * SumY) / Denominator * 1e6, -MaxDriftPpm, MaxDriftPpm);
+
+	if (!TargetFill.IsSet())
+	{
+		TargetFill = FilteredFill;
+		UE_LOG(LogMillicastPublisher, Log, TEXT("Audio capture clock drift %.1f ppm, compensating"), DriftPpm);
+	}
+
+	// A capture clock running fast gives fewer output frames, and a fill above its target is slowly brought back
+	const double FillCorrection = FMath::Clamp((FilteredFill - TargetFill.GetValue()) / FillCorrectionSeconds, -MaxFillCorrection, MaxFillCorrection);
+	Ratio = 1.0 / (1.0 + DriftPpm * 1e-6) - FillCorrection;
+}
+
+void FAudioDriftCompensator::Restart(double SystemTime, double Capture)
+{
+	bStarted = true;
+	CaptureStart = Capture;
+	SystemStart = SystemTime;
+	LastSystemTime = SystemTime;
+	LastOffset = 0.0;
+
+	SumWeight = SumX = SumY = SumXX = SumXY = 0.0;
+	DriftPpm = 0.0;
+
+	StartOutputFrames = OutputFrames;
+	FilteredFill = 0.0;
+	TargetFill.Reset();
+
+	Ratio = 1.0;
+}
+
+TOptional<int64> FAudioDriftCompensator::GetCaptureTimeUs(int64 OutputFrame) const
+{
+	if (!bStarted)
+	{
+		return {};
+	}
+
+	// The lead of the output over the system clock includes the buffering of the capture, the first frame of a buffer
+	// was captured a buffer earlier than it was received
+	const double OutputTime = double(OutputFrame - StartOutputFrames) / OutputRate;
+	return static_cast<int64>((SystemStart + OutputTime - FilteredFill - InputBufferSeconds) * 1e6);
+}
+
+int32 FAudioDriftCompensator::Resample(const float* InAudioData, int32 InNumFrames, int32 InNumChannels)
+{
+	if (InNumChannels != NumChannels)
+	{
+		NumChannels = InNumChannels;
+		History.SetNumZeroed(HistoryFrames * NumChannels);
+		Position = 1.0;
+	}
+
+	// The last frames of the previous buffer followed by this one, so the interpolation continues across buffers.
+	// The position stays above 1, truncating it is flooring it.
+	const int32 NumWorkFrames = HistoryFrames + InNumFrames;
+	WorkBuffer.SetNumUninitialized(NumWorkFrames * NumChannels, false);
+	FMemory::Memcpy(WorkBuffer.GetData(), History.GetData(), History.Num() * sizeof(float));
+	FMemory::Memcpy(WorkBuffer.GetData() + History.Num(), InAudioData, InNumFrames * NumChannels * sizeof(float));
+
+	OutputBuffer.SetNumUninitialized((FMath::CeilToInt(InNumFrames * Ratio) + 2) * NumChannels, false);
+
+	const double Step = 1.0 / Ratio;
+	const float* Work = WorkBuffer.GetData();
+	float* Output = OutputBuffer.GetData();
+	int32 NumOutputFrames = 0;
+
+	for (int32 Index = static_cast<int32>(Position); Index + 2 < NumWorkFrames; Index = static_cast<int32>(Position))
+	{
+		const float T = static_cast<float>(Position - Index);
+		const float* Frame = Work + Index * NumChannels;
+
+		for (int32 Channel = 0; Channel < NumChannels; ++Channel)
+		{
+			*Output++ = Interpolate(Frame[Channel - NumChannels], Frame[Channel], Frame[Channel + NumChannels], Frame[Channel + 2 * NumChannels], T);
+		}
+
+		++NumOutputFrames;
+		Position += Step;
+	}
+
+	Position -= InNumFrames;
+	FMemory::Memcpy(History.GetData(), Work + InNumFrames * NumChannels, History.Num() * sizeof(float));
+
+	return NumOutputFrames;
+}
+
+}
@@ -0,0 +1,101 @@
+// Copyright Dolby.io 2023. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+namespace Millicast::Publisher
+{
+	struct FAudioDriftStats
+	{
+		double DriftPpm = 0.0;
+		double CorrectionPpm = 0.0;
+		double FillMs = 0.0;
+	};
+
+	/*
+	 * Keeps the published audio in step with the system clock video frames are stamped with.
+	 * webrtc timestamps audio by counting samples, so audio produced by a device clock running a few hundred ppm fast or
+	 * slow slowly drifts away from the video. The drift of the capture clock is estimated against rtc::TimeMicros by a
+	 * least squares fit with exponential forgetting, and a fractional resampler removes it. The lead of the published audio
+	 * over the system clock, its fill, is kept at the value it had when the estimate settled.
+	 * Single threaded, used by the audio capture thread.
+	 */
+	class FAudioDriftCompensator
+	{
+	public:
+		/** Capture clock of the next buffer in seconds, e.g. the submix audio clock. Without it the clock is counted from the samples. */
+		void SetCaptureClock(double InCaptureClock);
+
+		/** Measures the capture clock at SystemTime, rtc::TimeMicros in seconds. The input is at SampleRate before any rate conversion. */
+		void Update(int32 InNumFrames, int32 InSampleRate, double SystemTime);
+
+		/** Removes the drift from interleaved frames, OnOutput(const float* Data, int32 NumFrames) receives the corrected audio */
+		template<typename OutputFunc>
+		void Process(const float* InAudioData, int32 InNumFrames, int32 InNumChannels, OutputFunc&& OnOutput)
+		{
+			const int32 NumOutputFrames = Resample(InAudioData, InNumFrames, InNumChannels);
+			OutputFrames += NumOutputFrames;
+
+			if (NumOutputFrames > 0)
+			{
+				OnOutput(OutputBuffer.GetData(), NumOutputFrames);
+			}
+		}
+
+		/** Estimated capture time on the system clock of an output frame, counted from the first frame ever output */
+		TOptional<int64> GetCaptureTimeUs(int64 OutputFrame) const;
+
+		/** Whether the drift is measured and removed, from MinFitSeconds after the start or a discontinuity */
+		bool IsCompensating() const { return TargetFill.IsSet(); }
+		FAudioDriftStats GetStats() const { return { DriftPpm, GetCorrectionPpm(), GetFillMs() }; }
+
+		double GetDriftPpm() const { return DriftPpm; }
+		double GetCorrectionPpm() const { return (1.0 / Ratio - 1.0) * 1e6; }
+		double GetFillMs() const { return FilteredFill * 1000.0; }
+
+	private:
+		void Restart(double SystemTime, double Capture);
+		int32 Resample(const float* InAudioData, int32 InNumFrames, int32 InNumChannels);
+
+		static constexpr double OutputRate = 48000.0;
+
+		// Capture clock and system clock at the start of the measure, in seconds
+		double CaptureStart = 0.0;
+		double SystemStart = 0.0;
+		double LastSystemTime = 0.0;
+		bool bStarted = false;
+
+		TOptional<double> CaptureClock;
+		double CountedClock = 0.0;
+
+		// Exponentially weighted sums of the fit of the capture clock offset against the system time
+		double SumWeight = 0.0;
+		double SumX = 0.0;
+		double SumY = 0.0;
+		double SumXX = 0.0;
+		double SumXY = 0.0;
+		double LastOffset = 0.0;
+
+		double DriftPpm = 0.0;
+
+		// Frames output since the first buffer and at the start of the measure
+		int64 OutputFrames = 0;
+		int64 StartOutputFrames = 0;
+		double InputBufferSeconds = 0.0;
+
+		// Lead of the audio output since the start of the measure over the system clock
+		double FilteredFill = 0.0;
+		TOptional<double> TargetFill;
+
+		// Output frames per input frame
+		double Ratio = 1.0;
+
+		// Read position in the input, relative to the history frames kept from the previous buffer
+		double Position = 1.0;
+		int32 NumChannels = 0;
+		TArray<float> History;
+		TArray<float> WorkBuffer;
+		TArray<float> OutputBuffer;
+	};
+}
@@ -0,0 +1,147 @@
+// Copyright Dolby.io 2023. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+namespace Millicast::Publisher
+{
+	/*
+	 * Lock free queue of 10 ms audio frames between the capture thread, the only producer, and the delivery thread,
+	 * the only consumer. The slots are allocated once, large enough for any channel layout, so the layout can change
+	 * while both threads run. The consumer may drop the oldest frames, the producer never waits and drops the frame
+	 * it pushes when the queue is full. Both count as overruns.
+	 */
+	class FAudioFrameQueue
+	{
+	public:
+		using FSample = int16;
+
+		static constexpr int32 MaxChannels = 8;
+		static constexpr int32 MaxFrameSamples = 48000 / 100 * MaxChannels;
+
+		struct FFrame
+		{
+			int64 CaptureTimeUs = 0; // 0 when unknown
+			int32 NumChannels = 0;
+			int32 NumSamples = 0;
+			FSample Samples[MaxFrameSamples];
+		};
+
+		explicit FAudioFrameQueue(int32 InCapacity)
+		{
+			Frames.SetNum(InCapacity);
+		}
+
+		int32 GetCapacity() const { return Frames.Num(); }
+
+		/** Number of frames queued, frames may be pushed meanwhile for the consumer and popped for the producer */
+		int32 Num() const { return static_cast<int32>(WriteCount.Load() - ReadCount.Load()); }
+
+		/** Producer side, false if the queue is full and the frame was dropped */
+		bool Push(const FSample* InSamples, int32 InNumSamples, int32 InNumChannels, int64 InCaptureTimeUs)
+		{
+			check(InNumSamples <= MaxFrameSamples);
+
+			const uint64 Write = WriteCount.Load();
+			if (Write - ReadCount.Load() >= static_cast<uint64>(Frames.Num()))
+			{
+				++NumOverruns;
+				return false;
+			}
+
+			FFrame& Frame = Frames[Write % Frames.Num()];
+			Frame.CaptureTimeUs = InCaptureTimeUs;
+			Frame.NumChannels = InNumChannels;
+			Frame.NumSamples = InNumSamples;
+			FMemory::Memcpy(Frame.Samples, InSamples, InNumSamples * sizeof(FSample));
+
+			// Publishes the frame to the consumer
+			WriteCount.Store(Write + 1);
+			return true;
+		}
+
+		/** Consumer side, the oldest frame or null if the queue is empty. It stays valid until Pop. */
+		const FFrame* Peek() const
+		{
+			const uint64 Read = ReadCount.Load();
+			return Read != WriteCount.Load() ? &Frames[Read % Frames.Num()] : nullptr;
+		}
+
+		void Pop()
+		{
+			ReadCount.Store(ReadCount.Load() + 1);
+		}
+
+		/**
+		 * Consumer side, the frame due now, or null when silence must be sent instead because the queue is empty or filling
+		 * up to TargetFrames after an underrun. A frame returned is popped once sent.
+		 */
+		const FFrame* Pull(int32 TargetFrames)
+		{
+			// Twice the target latency is brought back to the target, the oldest frames are dropped
+			if (Num() > 2 * TargetFrames)
+			{
+				while (Num() > TargetFrames)
+				{
+					Pop();
+					++NumOverruns;
+				}
+			}
+
+			// After an underrun the queue fills up to the target again before it is read
+			if (bBuffering && Num() >= TargetFrames)
+			{
+				bBuffering = false;
+			}
+
+			const FFrame* Frame = bBuffering ? nullptr : Peek();
+			if (Frame)
+			{
+				bDelivered = true;
+			}
+			else
+			{
+				// The first frames are not an underrun
+				bBuffering = true;
+				NumUnderruns += bDelivered ? 1 : 0;
+			}
+
+			return Frame;
+		}
+
+		/** Consumer side, empties the queue and starts over from buffering with no overrun or underrun */
+		void Reset()
+		{
+			while (Peek())
+			{
+				Pop();
+			}
+
+			bBuffering = true;
+			bDelivered = false;
+			NumOverruns = 0;
+			NumUnderruns = 0;
+		}
+
+		/** Frames dropped, the delivery didn't keep up with the capture */
+		int32 GetNumOverruns() const { return NumOverruns; }
+
+		/** Silent frames sent, the capture didn't keep up with the delivery */
+		int32 GetNumUnderruns() const { return NumUnderruns; }
+
+	private:
+		TArray<FFrame> Frames;
+
+		// Frames pushed and popped since the start, each written by one side only
+		TAtomic<uint64> WriteCount { 0 };
+		TAtomic<uint64> ReadCount { 0 };
+
+		TAtomic<int32> NumOverruns { 0 };
+
+		// Consumer side
+		bool bBuffering = true;
+		bool bDelivered = false;
+		int32 NumUnderruns = 0;
+	};
+}
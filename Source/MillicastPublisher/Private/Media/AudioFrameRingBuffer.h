@@ -0,0 +1,77 @@
+// Copyright Dolby.io 2023. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+namespace Millicast::Publisher
+{
+	/*
+	 * Fixed capacity buffer cutting the captured audio into the 10 ms frames webrtc expects.
+	 * The capacity is a whole number of frames and frames are always read whole, so a frame never wraps around the end
+	 * of the buffer and is handed to the sinks in place. Nothing is moved or allocated once initialized.
+	 * Single threaded, written and read by the audio capture thread.
+	 */
+	class FAudioFrameRingBuffer
+	{
+	public:
+		using FSample = int16;
+
+		/** Allocates room for NumFrames frames of FrameSamples interleaved samples and empties the buffer */
+		void Init(int32 InFrameSamples, int32 NumFrames = 4)
+		{
+			check(InFrameSamples > 0 && NumFrames >= 2);
+
+			FrameSamples = InFrameSamples;
+			Buffer.SetNumZeroed(FrameSamples * NumFrames);
+			Reset();
+		}
+
+		void Reset()
+		{
+			ReadPos = 0;
+			WritePos = 0;
+			NumSamples = 0;
+		}
+
+		/** Free space after the write position that can be filled in one go, fill it then Commit what was written */
+		FSample* GetWriteSpan(int32& OutNumSamples)
+		{
+			OutNumSamples = FMath::Min(Buffer.Num() - NumSamples, Buffer.Num() - WritePos);
+			return Buffer.GetData() + WritePos;
+		}
+
+		void Commit(int32 InNumSamples)
+		{
+			check(InNumSamples <= Buffer.Num() - NumSamples);
+
+			WritePos = (WritePos + InNumSamples) % Buffer.Num();
+			NumSamples += InNumSamples;
+		}
+
+		/** The oldest complete frame, null if there is none */
+		const FSample* PeekFrame() const
+		{
+			return NumSamples >= FrameSamples ? Buffer.GetData() + ReadPos : nullptr;
+		}
+
+		void PopFrame()
+		{
+			check(NumSamples >= FrameSamples);
+
+			ReadPos = (ReadPos + FrameSamples) % Buffer.Num();
+			NumSamples -= FrameSamples;
+		}
+
+		int32 GetFrameSamples() const { return FrameSamples; }
+		int32 GetNumSamples() const { return NumSamples; }
+
+	private:
+		TArray<FSample, TAlignedHeapAllocator<PLATFORM_CACHE_LINE_SIZE>> Buffer;
+
+		int32 FrameSamples = 0;
+		int32 ReadPos = 0;
+		int32 WritePos = 0;
+		int32 NumSamples = 0;
+	};
+}
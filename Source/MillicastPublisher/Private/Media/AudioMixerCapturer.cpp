@@ -0,0 +1,284 @@
+// Copyright Dolby.io 2023. All Rights Reserved.
+
+#include "AudioMixerCapturer.h"
+
+#include "AudioDeviceCapturer.h"
+#include "AudioSampleConversion.h"
+#include "AudioSubmixCapturer.h"
+#include "MillicastPublisherPrivate.h"
+#include "WebRTC/Stats.h"
+
+#include "rtc_base/time_utils.h"
+
+namespace Millicast::Publisher
+{
+
+AudioMixerCapturer::~AudioMixerCapturer()
+{
+	StopCapture();
+}
+
+IMillicastSource::FStreamTrackInterface AudioMixerCapturer::StartCapture(UWorld* InWorld)
+{
+	for (int32 Index = 0; Index < Inputs.Num(); ++Index)
+	{
+		FInput& Input = Inputs[Index];
+		if (!Input.Capturer)
+		{
+			continue;
+		}
+
+		// The inputs only queue their frames, they are all pulled by the delivery thread of the mixer
+		Input.Capturer->SetMixed(true);
+		Input.Capturer->SetTargetLatency(GetTargetLatency());
+		Input.bStarted = Input.Capturer->StartCapture(InWorld) != nullptr;
+
+		if (!Input.bStarted)
+		{
+			UE_LOG(LogMillicastPublisher, Warning, TEXT("Could not start the capture of the audio mixer input %d, it is left out of the mix"), Index);
+		}
+	}
+
+	CreateRtcSourceTrack();
+
+	return RtcAudioTrack;
+}
+
+void AudioMixerCapturer::StopCapture()
+{
+	if (!RtcAudioTrack)
+	{
+		return;
+	}
+
+	// Nothing pulls from the inputs anymore once the delivery thread is stopped
+	ReleaseRtcSourceTrack();
+
+	for (FInput& Input : Inputs)
+	{
+		if (Input.bStarted)
+		{
+			Input.Capturer->StopCapture();
+			Input.bStarted = false;
+		}
+	}
+}
+
+void AudioMixerCapturer::SetInputs(const TArray<FMillicastAudioMixerInput>& InInputs)
+{
+	if (RtcAudioTrack)
+	{
+		UE_LOG(LogMillicastPublisher, Warning, TEXT("You can't change the audio mixer inputs while capturing"));
+		return;
+	}
+
+	Inputs.Empty(InInputs.Num());
+
+	// An input that can't be captured keeps its place without a capturer, the indices stay those of the settings
+	for (const FMillicastAudioMixerInput& InInput : InInputs)
+	{
+		FInput& Input = Inputs.AddDefaulted_GetRef();
+		Input.Settings.Gain = DbToGain(InInput.GainDb);
+		Input.Settings.bMuted = InInput.bMuted;
+		Input.Settings.DelayMs = FMath::Max(InInput.DelayMs, 0);
+
+		if (InInput.Type == EAudioCapturerType::Submix)
+		{
+			TUniquePtr<AudioSubmixCapturer> SubmixCapturer = MakeUnique<AudioSubmixCapturer>();
+			SubmixCapturer->SetAudioSubmix(InInput.Submix);
+
+			Input.Capturer = MoveTemp(SubmixCapturer);
+		}
+		else if (InInput.Type == EAudioCapturerType::Device)
+		{
+			auto* Subsystem = GEngine->GetEngineSubsystem<UMillicastAudioDeviceCaptureSubsystem>();
+			if (!Subsystem)
+			{
+				UE_LOG(LogMillicastPublisher, Warning, TEXT("[AudioMixerCapturer::SetInputs] UMillicastAudioDeviceCaptureSubsystem not found"));
+				continue;
+			}
+
+			const auto* Device = Subsystem->Devices.FindByPredicate([&InInput](const auto& e) { return InInput.DeviceName == e.DeviceName; });
+			if (!Device)
+			{
+				UE_LOG(LogMillicastPublisher, Warning, TEXT("[AudioMixerCapturer::SetInputs] Device not found: %s"), *InInput.DeviceName);
+				continue;
+			}
+
+			TUniquePtr<AudioDeviceCapturer> DeviceCapturer = MakeUnique<AudioDeviceCapturer>();
+			DeviceCapturer->SetAudioCaptureDevice(*Device);
+
+			Input.Capturer = MoveTemp(DeviceCapturer);
+		}
+		else
+		{
+			UE_LOG(LogMillicastPublisher, Warning, TEXT("An audio mixer input can't be a mixer"));
+		}
+	}
+}
+
+void AudioMixerCapturer::SetInputGain(int32 Index, float GainDb)
+{
+	FScopeLock Lock(&SettingsSection);
+
+	if (Inputs.IsValidIndex(Index))
+	{
+		Inputs[Index].Settings.Gain = DbToGain(GainDb);
+	}
+}
+
+void AudioMixerCapturer::SetInputMuted(int32 Index, bool bMuted)
+{
+	FScopeLock Lock(&SettingsSection);
+
+	if (Inputs.IsValidIndex(Index))
+	{
+		Inputs[Index].Settings.bMuted = bMuted;
+	}
+}
+
+void AudioMixerCapturer::SetInputDelay(int32 Index, int32 DelayMs)
+{
+	FScopeLock Lock(&SettingsSection);
+
+	if (Inputs.IsValidIndex(Index))
+	{
+		Inputs[Index].Settings.DelayMs = FMath::Max(DelayMs, 0);
+	}
+}
+
+void AudioMixerCapturer::DeliverFrame()
+{
+	constexpr int32 NumFrameSamples = SamplePerSecond * TimePerFrameMs / 1000;
+	const int32 OutputChannels = GetNumChannel();
+
+	{
+		FScopeLock Lock(&SettingsSection);
+
+		for (FInput& Input : Inputs)
+		{
+			Input.Applied = Input.Settings;
+		}
+	}
+
+	MixBuffer.SetNumUninitialized(NumFrameSamples * OutputChannels, false);
+	FMemory::Memzero(MixBuffer.GetData(), MixBuffer.Num() * sizeof(float));
+
+	int64 CaptureTimeUs = 0;
+	int32 QueuedMs = 0;
+	int32 TotalUnderruns = 0;
+	int32 TotalOverruns = 0;
+
+	// Each input has its own capture clock, the one drifting the most is reported
+	TOptional<FAudioDriftStats> WorstDrift;
+	int32 NumDriftInputs = 0;
+
+	for (FInput& Input : Inputs)
+	{
+		AudioCapturerBase* Source = Input.bStarted ? Input.Capturer->GetFrameSource() : nullptr;
+		if (!Source)
+		{
+			continue;
+		}
+
+		// A missing frame is silence, it still goes through the delay line so the input stays in time
+		const FAudioFrameQueue::FFrame* Frame = Source->PullFrame();
+		const int32 InputChannels = Frame ? Frame->NumChannels : Source->GetNumChannel();
+
+		Input.Samples.SetNumUninitialized(NumFrameSamples * InputChannels, false);
+
+		if (Frame)
+		{
+			S16ToFloat(Frame->Samples, Frame->NumSamples, Input.Samples.GetData());
+
+			// The first input with a capture time stamps the mix, its delayed audio was captured that much earlier
+			if (CaptureTimeUs == 0 && Frame->CaptureTimeUs != 0)
+			{
+				CaptureTimeUs = Frame->CaptureTimeUs - Input.Applied.DelayMs * rtc::kNumMicrosecsPerMillisec;
+			}
+
+			Source->PopFrame();
+		}
+		else
+		{
+			FMemory::Memzero(Input.Samples.GetData(), Input.Samples.Num() * sizeof(float));
+		}
+
+		ApplyDelay(Input, InputChannels);
+
+		if (!CanRemixChannels(InputChannels, OutputChannels))
+		{
+			if (!Input.bWarnedLayout)
+			{
+				UE_LOG(LogMillicastPublisher, Warning, TEXT("Can't mix an audio input of %d channels into %d channels, it is left out of the mix"), InputChannels, OutputChannels);
+				Input.bWarnedLayout = true;
+			}
+		}
+		else if (!Input.Applied.bMuted)
+		{
+			MixFloat(Input.Samples.GetData(), NumFrameSamples, InputChannels, OutputChannels, Input.Applied.Gain, MixBuffer.GetData());
+		}
+
+		QueuedMs = FMath::Max(QueuedMs, Source->GetQueuedMs());
+		TotalUnderruns += Source->GetNumUnderruns();
+		TotalOverruns += Source->GetNumOverruns();
+
+		const TOptional<FAudioDriftStats> Drift = Source->GetDriftStats();
+		if (Drift.IsSet())
+		{
+			++NumDriftInputs;
+			if (!WorstDrift.IsSet() || FMath::Abs(Drift->DriftPpm) > FMath::Abs(WorstDrift->DriftPpm))
+			{
+				WorstDrift = Drift;
+			}
+		}
+	}
+
+	// The sum is clamped by the conversion
+	OutputFrame.SetNumUninitialized(NumFrameSamples * OutputChannels, false);
+	FloatToS16(MixBuffer.GetData(), NumFrameSamples, OutputChannels, OutputChannels, 1.f, OutputFrame.GetData());
+
+	SendFrame(OutputFrame.GetData(), OutputChannels, CaptureTimeUs);
+
+	FPublisherStats::Get().SetAudioDeliveryStats(QueuedMs, GetTargetLatency(), TotalUnderruns, TotalOverruns);
+
+	if (WorstDrift.IsSet())
+	{
+		FPublisherStats::Get().SetAudioDriftStats(WorstDrift->DriftPpm, WorstDrift->CorrectionPpm, WorstDrift->FillMs, NumDriftInputs);
+	}
+}
+
+void AudioMixerCapturer::ApplyDelay(FInput& Input, int32 InNumChannels)
+{
+	const int32 DelaySamples = Input.Applied.DelayMs * (SamplePerSecond / 1000) * InNumChannels;
+	if (DelaySamples == 0)
+	{
+		Input.DelayLine.Empty();
+		return;
+	}
+
+	// A new delay or layout starts over from silence
+	if (Input.DelayLine.Num() != DelaySamples)
+	{
+		Input.DelayLine.Init(0.f, DelaySamples);
+		Input.DelayPosition = 0;
+	}
+
+	float* Samples = Input.Samples.GetData();
+	float* Line = Input.DelayLine.GetData();
+	const int32 InputSamples = Input.Samples.Num();
+
+	for (int32 Done = 0; Done < InputSamples;)
+	{
+		const int32 Count = FMath::Min(InputSamples - Done, DelaySamples - Input.DelayPosition);
+		for (int32 i = 0; i < Count; ++i)
+		{
+			Swap(Samples[Done + i], Line[Input.DelayPosition + i]);
+		}
+
+		Done += Count;
+		Input.DelayPosition = (Input.DelayPosition + Count) % DelaySamples;
+	}
+}
+
+}
@@ -0,0 +1,66 @@
+// Copyright Dolby.io 2023. All Rights Reserved.
+
+#pragma once
+
+#include "AudioCapturerBase.h"
+#include "MillicastAudioMixerInput.h"
+
+namespace Millicast::Publisher
+{
+	/*
+	 * Captures several inputs, submixes and devices, and publishes their mix as one track.
+	 * Each input is captured by its own capturer into its queue, the delivery thread of the mixer pulls a frame from every
+	 * queue each 10 ms, delays it, applies its gain and mixes it at 48 kHz.
+	 */
+	class AudioMixerCapturer : public AudioCapturerBase
+	{
+	public:
+		virtual ~AudioMixerCapturer() override;
+
+		FStreamTrackInterface StartCapture(UWorld* InWorld) override;
+		void StopCapture() override;
+
+		/** Set the inputs to mix, before the capture starts. Index i of the input settings below is InInputs[i], captured or not. */
+		void SetInputs(const TArray<FMillicastAudioMixerInput>& InInputs);
+
+		/** Change the settings of an input while capturing, applied from the next frame */
+		void SetInputGain(int32 Index, float GainDb);
+		void SetInputMuted(int32 Index, bool bMuted);
+		void SetInputDelay(int32 Index, int32 DelayMs);
+
+	protected:
+		void DeliverFrame() override;
+
+	private:
+		struct FInputSettings
+		{
+			float Gain = 1.f;
+			bool bMuted = false;
+			int32 DelayMs = 0;
+		};
+
+		struct FInput
+		{
+			TUniquePtr<AudioCapturerBase> Capturer; // Null when the input can't be captured, it is silent
+			bool bStarted = false;
+
+			FInputSettings Settings; // Guarded by SettingsSection
+
+			// Mixing thread only
+			FInputSettings Applied;
+			TArray<float> Samples;
+			TArray<float> DelayLine;
+			int32 DelayPosition = 0;
+			bool bWarnedLayout = false;
+		};
+
+		/** Delays the samples of the input by its delay line, the samples in the line are swapped with the new ones */
+		static void ApplyDelay(FInput& Input, int32 InNumChannels);
+
+		TArray<FInput> Inputs;
+		FCriticalSection SettingsSection;
+
+		TArray<float> MixBuffer;
+		TArray<FSample> OutputFrame;
+	};
+}
@@ -0,0 +1,369 @@
+// Copyright Dolby.io 2023. All Rights Reserved.
+
+#include "AudioSampleConversion.h"
+
+#include <cmath>
+
+#if PLATFORM_ENABLE_VECTORINTRINSICS_NEON
+#include <arm_neon.h>
+#elif PLATFORM_ENABLE_VECTORINTRINSICS
+#include <emmintrin.h>
+#endif
+
+namespace Millicast::Publisher
+{
+
+namespace
+{
+	constexpr float S16Scale = 32768.f;
+	constexpr float S16Max = 32767.f;
+
+	/**
+	 * Reference conversion of a single sample, the vector code below must match it bit for bit.
+	 * FMath::Clamp fails both of its comparisons for NaN and returns the upper bound, NaN becomes full scale positive.
+	 */
+	FORCEINLINE int16 ConvertSample(float Value, float Gain)
+	{
+		float Sample = FMath::Clamp(Value * Gain, -1.f, 1.f) * S16Scale;
+		Sample = FMath::Min(Sample, S16Max);
+		return static_cast<int16>(Sample + std::copysign(0.5f, Sample));
+	}
+
+#if PLATFORM_ENABLE_VECTORINTRINSICS_NEON
+	FORCEINLINE int32x4_t ConvertVector(float32x4_t Value, float32x4_t Gain)
+	{
+		// vminq and vmaxq propagate NaN, replace it with the upper bound first like FMath::Clamp
+		const float32x4_t Scaled = vmulq_f32(Value, Gain);
+		const float32x4_t Clean = vbslq_f32(vceqq_f32(Scaled, Scaled), Scaled, vdupq_n_f32(1.f));
+
+		float32x4_t Sample = vmulq_f32(vminq_f32(vmaxq_f32(Clean, vdupq_n_f32(-1.f)), vdupq_n_f32(1.f)), vdupq_n_f32(S16Scale));
+		Sample = vminq_f32(Sample, vdupq_n_f32(S16Max));
+
+		// Round half away from zero, copysign(0.5, Sample)
+		const uint32x4_t Sign = vandq_u32(vreinterpretq_u32_f32(Sample), vdupq_n_u32(0x80000000u));
+		const float32x4_t Half = vreinterpretq_f32_u32(vorrq_u32(vreinterpretq_u32_f32(vdupq_n_f32(0.5f)), Sign));
+
+		return vcvtq_s32_f32(vaddq_f32(Sample, Half));
+	}
+#elif PLATFORM_ENABLE_VECTORINTRINSICS
+	FORCEINLINE __m128i ConvertVector(__m128 Value, __m128 Gain)
+	{
+		// minps returns its second operand when either is NaN, taking the upper bound first turns NaN into it like FMath::Clamp
+		__m128 Sample = _mm_mul_ps(_mm_max_ps(_mm_min_ps(_mm_mul_ps(Value, Gain), _mm_set1_ps(1.f)), _mm_set1_ps(-1.f)), _mm_set1_ps(S16Scale));
+		Sample = _mm_min_ps(Sample, _mm_set1_ps(S16Max));
+
+		// Round half away from zero, copysign(0.5, Sample)
+		const __m128 Half = _mm_or_ps(_mm_set1_ps(0.5f), _mm_and_ps(Sample, _mm_set1_ps(-0.f)));
+
+		return _mm_cvttps_epi32(_mm_add_ps(Sample, Half));
+	}
+#endif
+
+	void ConvertSameLayout(const float* Source, int32 NumSamples, float Gain, int16* Destination)
+	{
+		int32 i = 0;
+
+#if PLATFORM_ENABLE_VECTORINTRINSICS_NEON
+		const float32x4_t GainVector = vdupq_n_f32(Gain);
+		for (; i + 8 <= NumSamples; i += 8)
+		{
+			const int32x4_t Low = ConvertVector(vld1q_f32(Source + i), GainVector);
+			const int32x4_t High = ConvertVector(vld1q_f32(Source + i + 4), GainVector);
+			vst1q_s16(Destination + i, vcombine_s16(vqmovn_s32(Low), vqmovn_s32(High)));
+		}
+#elif PLATFORM_ENABLE_VECTORINTRINSICS
+		const __m128 GainVector = _mm_set1_ps(Gain);
+		for (; i + 8 <= NumSamples; i += 8)
+		{
+			const __m128i Low = ConvertVector(_mm_loadu_ps(Source + i), GainVector);
+			const __m128i High = ConvertVector(_mm_loadu_ps(Source + i + 4), GainVector);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(Destination + i), _mm_packs_epi32(Low, High));
+		}
+#endif
+
+		for (; i < NumSamples; ++i)
+		{
+			Destination[i] = ConvertSample(Source[i], Gain);
+		}
+	}
+
+	void ConvertMonoToStereo(const float* Source, int32 NumFrames, float Gain, int16* Destination)
+	{
+		int32 i = 0;
+
+#if PLATFORM_ENABLE_VECTORINTRINSICS_NEON
+		const float32x4_t GainVector = vdupq_n_f32(Gain);
+		for (; i + 4 <= NumFrames; i += 4)
+		{
+			const int16x4_t Mono = vqmovn_s32(ConvertVector(vld1q_f32(Source + i), GainVector));
+			vst2_s16(Destination + i * 2, { Mono, Mono });
+		}
+#elif PLATFORM_ENABLE_VECTORINTRINSICS
+		const __m128 GainVector = _mm_set1_ps(Gain);
+		for (; i + 4 <= NumFrames; i += 4)
+		{
+			const __m128i Mono = ConvertVector(_mm_loadu_ps(Source + i), GainVector);
+			const __m128i Packed = _mm_packs_epi32(Mono, Mono);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(Destination + i * 2), _mm_unpacklo_epi16(Packed, Packed));
+		}
+#endif
+
+		for (; i < NumFrames; ++i)
+		{
+			Destination[i * 2] = Destination[i * 2 + 1] = ConvertSample(Source[i], Gain);
+		}
+	}
+
+	void ConvertStereoToMono(const float* Source, int32 NumFrames, float Gain, int16* Destination)
+	{
+		int32 i = 0;
+
+#if PLATFORM_ENABLE_VECTORINTRINSICS_NEON
+		const float32x4_t GainVector = vdupq_n_f32(Gain);
+		for (; i + 4 <= NumFrames; i += 4)
+		{
+			const float32x4x2_t Stereo = vld2q_f32(Source + i * 2);
+			const float32x4_t Mono = vmulq_f32(vaddq_f32(Stereo.val[0], Stereo.val[1]), vdupq_n_f32(0.5f));
+			vst1_s16(Destination + i, vqmovn_s32(ConvertVector(Mono, GainVector)));
+		}
+#elif PLATFORM_ENABLE_VECTORINTRINSICS
+		const __m128 GainVector = _mm_set1_ps(Gain);
+		for (; i + 4 <= NumFrames; i += 4)
+		{
+			const __m128 First = _mm_loadu_ps(Source + i * 2);
+			const __m128 Second = _mm_loadu_ps(Source + i * 2 + 4);
+			const __m128 Left = _mm_shuffle_ps(First, Second, _MM_SHUFFLE(2, 0, 2, 0));
+			const __m128 Right = _mm_shuffle_ps(First, Second, _MM_SHUFFLE(3, 1, 3, 1));
+			const __m128 Mono = _mm_mul_ps(_mm_add_ps(Left, Right), _mm_set1_ps(0.5f));
+			_mm_storel_epi64(reinterpret_cast<__m128i*>(Destination + i), _mm_packs_epi32(ConvertVector(Mono, GainVector), _mm_setzero_si128()));
+		}
+#endif
+
+		for (; i < NumFrames; ++i)
+		{
+			Destination[i] = ConvertSample((Source[i * 2] + Source[i * 2 + 1]) * 0.5f, Gain);
+		}
+	}
+
+	void MixSameLayout(const float* Source, int32 NumSamples, float Gain, float* Destination)
+	{
+		int32 i = 0;
+
+#if PLATFORM_ENABLE_VECTORINTRINSICS_NEON
+		const float32x4_t GainVector = vdupq_n_f32(Gain);
+		for (; i + 4 <= NumSamples; i += 4)
+		{
+			vst1q_f32(Destination + i, vaddq_f32(vld1q_f32(Destination + i), vmulq_f32(vld1q_f32(Source + i), GainVector)));
+		}
+#elif PLATFORM_ENABLE_VECTORINTRINSICS
+		const __m128 GainVector = _mm_set1_ps(Gain);
+		for (; i + 4 <= NumSamples; i += 4)
+		{
+			_mm_storeu_ps(Destination + i, _mm_add_ps(_mm_loadu_ps(Destination + i), _mm_mul_ps(_mm_loadu_ps(Source + i), GainVector)));
+		}
+#endif
+
+		// The product in its own statement keeps the compiler from fusing it into a multiply-add the vector code doesn't do
+		for (; i < NumSamples; ++i)
+		{
+			const float Sample = Source[i] * Gain;
+			Destination[i] += Sample;
+		}
+	}
+
+	void MixMonoToStereo(const float* Source, int32 NumFrames, float Gain, float* Destination)
+	{
+		int32 i = 0;
+
+#if PLATFORM_ENABLE_VECTORINTRINSICS_NEON
+		const float32x4_t GainVector = vdupq_n_f32(Gain);
+		for (; i + 4 <= NumFrames; i += 4)
+		{
+			const float32x4_t Mono = vmulq_f32(vld1q_f32(Source + i), GainVector);
+			float32x4x2_t Stereo = vld2q_f32(Destination + i * 2);
+			Stereo.val[0] = vaddq_f32(Stereo.val[0], Mono);
+			Stereo.val[1] = vaddq_f32(Stereo.val[1], Mono);
+			vst2q_f32(Destination + i * 2, Stereo);
+		}
+#elif PLATFORM_ENABLE_VECTORINTRINSICS
+		const __m128 GainVector = _mm_set1_ps(Gain);
+		for (; i + 4 <= NumFrames; i += 4)
+		{
+			const __m128 Mono = _mm_mul_ps(_mm_loadu_ps(Source + i), GainVector);
+			_mm_storeu_ps(Destination + i * 2, _mm_add_ps(_mm_loadu_ps(Destination + i * 2), _mm_unpacklo_ps(Mono, Mono)));
+			_mm_storeu_ps(Destination + i * 2 + 4, _mm_add_ps(_mm_loadu_ps(Destination + i * 2 + 4), _mm_unpackhi_ps(Mono, Mono)));
+		}
+#endif
+
+		for (; i < NumFrames; ++i)
+		{
+			const float Mono = Source[i] * Gain;
+			Destination[i * 2] += Mono;
+			Destination[i * 2 + 1] += Mono;
+		}
+	}
+
+	void MixStereoToMono(const float* Source, int32 NumFrames, float Gain, float* Destination)
+	{
+		int32 i = 0;
+
+#if PLATFORM_ENABLE_VECTORINTRINSICS_NEON
+		const float32x4_t GainVector = vdupq_n_f32(Gain);
+		for (; i + 4 <= NumFrames; i += 4)
+		{
+			const float32x4x2_t Stereo = vld2q_f32(Source + i * 2);
+			const float32x4_t Mono = vmulq_f32(vaddq_f32(Stereo.val[0], Stereo.val[1]), vdupq_n_f32(0.5f));
+			vst1q_f32(Destination + i, vaddq_f32(vld1q_f32(Destination + i), vmulq_f32(Mono, GainVector)));
+		}
+#elif PLATFORM_ENABLE_VECTORINTRINSICS
+		const __m128 GainVector = _mm_set1_ps(Gain);
+		for (; i + 4 <= NumFrames; i += 4)
+		{
+			const __m128 First = _mm_loadu_ps(Source + i * 2);
+			const __m128 Second = _mm_loadu_ps(Source + i * 2 + 4);
+			const __m128 Left = _mm_shuffle_ps(First, Second, _MM_SHUFFLE(2, 0, 2, 0));
+			const __m128 Right = _mm_shuffle_ps(First, Second, _MM_SHUFFLE(3, 1, 3, 1));
+			const __m128 Mono = _mm_mul_ps(_mm_add_ps(Left, Right), _mm_set1_ps(0.5f));
+			_mm_storeu_ps(Destination + i, _mm_add_ps(_mm_loadu_ps(Destination + i), _mm_mul_ps(Mono, GainVector)));
+		}
+#endif
+
+		for (; i < NumFrames; ++i)
+		{
+			const float Mono = (Source[i * 2] + Source[i * 2 + 1]) * 0.5f * Gain;
+			Destination[i] += Mono;
+		}
+	}
+}
+
+float DbToGain(float Db)
+{
+	return FMath::Pow(10.f, Db / 20.f);
+}
+
+bool CanRemixChannels(int32 SourceChannels, int32 DestinationChannels)
+{
+	return SourceChannels == DestinationChannels
+		|| (SourceChannels == 1 && DestinationChannels == 2)
+		|| (SourceChannels == 2 && DestinationChannels == 1);
+}
+
+void FloatToS16(const float* Source, int32 NumFrames, int32 SourceChannels, int32 DestinationChannels, float Gain, int16* Destination)
+{
+	check(CanRemixChannels(SourceChannels, DestinationChannels));
+
+	if (SourceChannels == DestinationChannels)
+	{
+		ConvertSameLayout(Source, NumFrames * SourceChannels, Gain, Destination);
+	}
+	else if (SourceChannels == 1)
+	{
+		ConvertMonoToStereo(Source, NumFrames, Gain, Destination);
+	}
+	else
+	{
+		ConvertStereoToMono(Source, NumFrames, Gain, Destination);
+	}
+}
+
+void MixFloat(const float* Source, int32 NumFrames, int32 SourceChannels, int32 DestinationChannels, float Gain, float* Destination)
+{
+	check(CanRemixChannels(SourceChannels, DestinationChannels));
+
+	if (SourceChannels == DestinationChannels)
+	{
+		MixSameLayout(Source, NumFrames * SourceChannels, Gain, Destination);
+	}
+	else if (SourceChannels == 1)
+	{
+		MixMonoToStereo(Source, NumFrames, Gain, Destination);
+	}
+	else
+	{
+		MixStereoToMono(Source, NumFrames, Gain, Destination);
+	}
+}
+
+void ReorderChannels(int16* Samples, int32 NumFrames, int32 NumChannels, const int32* SourceChannels)
+{
+	constexpr int32 MaxChannels = 8;
+	check(NumChannels <= MaxChannels);
+
+	int16 Frame[MaxChannels];
+	for (int32 i = 0; i < NumFrames; ++i, Samples += NumChannels)
+	{
+		FMemory::Memcpy(Frame, Samples, NumChannels * sizeof(int16));
+		for (int32 Channel = 0; Channel < NumChannels; ++Channel)
+		{
+			Samples[Channel] = Frame[SourceChannels[Channel]];
+		}
+	}
+}
+
+void S16ToFloat(const int16* Source, int32 NumSamples, float* Destination)
+{
+	constexpr float Scale = 1.f / 32768.f; // A power of two, multiplying is exact like dividing
+	int32 i = 0;
+
+#if PLATFORM_ENABLE_VECTORINTRINSICS_NEON
+	for (; i + 8 <= NumSamples; i += 8)
+	{
+		const int16x8_t Samples = vld1q_s16(Source + i);
+		vst1q_f32(Destination + i, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(Samples))), Scale));
+		vst1q_f32(Destination + i + 4, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(Samples))), Scale));
+	}
+#elif PLATFORM_ENABLE_VECTORINTRINSICS
+	for (; i + 8 <= NumSamples; i += 8)
+	{
+		const __m128i Samples = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Source + i));
+		// Sign extend to 32 bits by placing the samples in the high halves and shifting them down
+		const __m128i Low = _mm_srai_epi32(_mm_unpacklo_epi16(Samples, Samples), 16);
+		const __m128i High = _mm_srai_epi32(_mm_unpackhi_epi16(Samples, Samples), 16);
+		_mm_storeu_ps(Destination + i, _mm_mul_ps(_mm_cvtepi32_ps(Low), _mm_set1_ps(Scale)));
+		_mm_storeu_ps(Destination + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(High), _mm_set1_ps(Scale)));
+	}
+#endif
+
+	for (; i < NumSamples; ++i)
+	{
+		Destination[i] = float(Source[i]) * Scale;
+	}
+}
+
+void S24ToFloat(const uint8* Source, int32 NumSamples, float* Destination)
+{
+	constexpr float Scale = 1.f / 8388608.f;
+
+	for (int32 i = 0; i < NumSamples; ++i, Source += 3)
+	{
+		// Assemble the sample in the high bytes so that the shift extends its sign
+		const int32 Sample = static_cast<int32>(uint32(Source[0]) << 8 | uint32(Source[1]) << 16 | uint32(Source[2]) << 24) >> 8;
+		Destination[i] = float(Sample) * Scale;
+	}
+}
+
+void S32ToFloat(const int32* Source, int32 NumSamples, float* Destination)
+{
+	constexpr float Scale = 1.f / 2147483648.f;
+	int32 i = 0;
+
+#if PLATFORM_ENABLE_VECTORINTRINSICS_NEON
+	for (; i + 4 <= NumSamples; i += 4)
+	{
+		vst1q_f32(Destination + i, vmulq_n_f32(vcvtq_f32_s32(vld1q_s32(Source + i)), Scale));
+	}
+#elif PLATFORM_ENABLE_VECTORINTRINSICS
+	for (; i + 4 <= NumSamples; i += 4)
+	{
+		const __m128i Samples = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Source + i));
+		_mm_storeu_ps(Destination + i, _mm_mul_ps(_mm_cvtepi32_ps(Samples), _mm_set1_ps(Scale)));
+	}
+#endif
+
+	for (; i < NumSamples; ++i)
+	{
+		Destination[i] = float(Source[i]) * Scale;
+	}
+}
+
+}
@@ -0,0 +1,40 @@
+// Copyright Dolby.io 2023. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+namespace Millicast::Publisher
+{
+	/*
+	 * Sample conversions and mixing of the audio capture paths, 4 samples at a time with SSE2 or NEON when available.
+	 * The vector and scalar versions perform the same float operations in the same order, their output is identical,
+	 * NaN and infinities included.
+	 */
+
+	/** Linear factor of a volume change in dB, computed when the volume changes rather than per sample */
+	float DbToGain(float Db);
+
+	/** Whether FloatToS16 can convert between these channel counts, only mono and stereo are remixed */
+	bool CanRemixChannels(int32 SourceChannels, int32 DestinationChannels);
+
+	/**
+	 * Apply the gain, clamp to [-1, 1] and convert interleaved float samples to S16 with the rounding of webrtc::FloatToS16, NaN converts to 32767.
+	 * Mono is duplicated to stereo and stereo averaged to mono on the way, Destination holds NumFrames * DestinationChannels samples.
+	 */
+	void FloatToS16(const float* Source, int32 NumFrames, int32 SourceChannels, int32 DestinationChannels, float Gain, int16* Destination);
+
+	/**
+	 * Add the samples times the gain to Destination, the mixing of several inputs into one.
+	 * The channels are remixed like FloatToS16, Destination holds NumFrames * DestinationChannels samples.
+	 */
+	void MixFloat(const float* Source, int32 NumFrames, int32 SourceChannels, int32 DestinationChannels, float Gain, float* Destination);
+
+	/** Reorders the channels of interleaved S16 frames in place, channel i of a frame becomes its channel SourceChannels[i] */
+	void ReorderChannels(int16* Samples, int32 NumFrames, int32 NumChannels, const int32* SourceChannels);
+
+	/** Integer PCM to float in [-1, 1), Source and Destination must not overlap */
+	void S16ToFloat(const int16* Source, int32 NumSamples, float* Destination);
+	void S24ToFloat(const uint8* Source, int32 NumSamples, float* Destination); // Packed 3 bytes little endian samples
+	void S32ToFloat(const int32* Source, int32 NumSamples, float* Destination);
+}
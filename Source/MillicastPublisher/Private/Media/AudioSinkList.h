@@ -0,0 +1,93 @@
+// Copyright Dolby.io 2023. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include <api/media_stream_interface.h>
+
+namespace Millicast::Publisher
+{
+	/*
+	 * Sinks of an audio track, added and removed by the webrtc threads while the delivery thread hands them frames.
+	 * A change publishes a new copy of the list, the delivery thread reads the current copy without lock or allocation.
+	 * The copy it reads is marked in use and only freed once it lets go of it, so once Remove returns the sink is never
+	 * called again and webrtc may destroy it.
+	 */
+	class FAudioSinkList
+	{
+	public:
+		using FSink = webrtc::AudioTrackSinkInterface;
+
+		FAudioSinkList() = default;
+		FAudioSinkList(const FAudioSinkList&) = delete;
+		FAudioSinkList& operator=(const FAudioSinkList&) = delete;
+
+		~FAudioSinkList()
+		{
+			delete Current.Load();
+		}
+
+		void Add(FSink* Sink)
+		{
+			Edit([Sink](TArray<FSink*>& Sinks) { Sinks.AddUnique(Sink); });
+		}
+
+		void Remove(FSink* Sink)
+		{
+			Edit([Sink](TArray<FSink*>& Sinks) { Sinks.Remove(Sink); });
+		}
+
+		/** Calls Func on every sink, from a single thread at a time */
+		template<typename FuncType>
+		void ForEach(FuncType&& Func)
+		{
+			// Marks the copy in use and checks it is still the current one, a writer won't free it from then on
+			FSnapshot* Snapshot = nullptr;
+			do
+			{
+				Snapshot = Current.Load();
+				InUse.Store(Snapshot);
+			} while (Snapshot != Current.Load());
+
+			if (Snapshot)
+			{
+				for (FSink* Sink : Snapshot->Sinks)
+				{
+					Func(Sink);
+				}
+			}
+
+			InUse.Store(nullptr);
+		}
+
+	private:
+		struct FSnapshot
+		{
+			TArray<FSink*> Sinks;
+		};
+
+		template<typename EditFunc>
+		void Edit(EditFunc&& Func)
+		{
+			FScopeLock Lock(&WriteSection);
+
+			FSnapshot* Previous = Current.Load();
+			FSnapshot* Next = Previous ? new FSnapshot(*Previous) : new FSnapshot();
+			Func(Next->Sinks);
+			Current.Store(Next);
+
+			// The reader is in the middle of a frame at most, a few microseconds
+			while (Previous && InUse.Load() == Previous)
+			{
+				FPlatformProcess::Yield();
+			}
+
+			delete Previous;
+		}
+
+		FCriticalSection WriteSection;
+		TAtomic<FSnapshot*> Current { nullptr };
+		TAtomic<FSnapshot*> InUse { nullptr };
+	};
+}
@@ -0,0 +1,67 @@
+// Copyright Dolby.io 2023. All Rights Reserved.
+
+#include "AudioStreamResampler.h"
+
+#include "MillicastPublisherPrivate.h"
+#include "common_audio/resampler/include/push_resampler.h"
+
+namespace Millicast::Publisher
+{
+
+FAudioStreamResampler::FAudioStreamResampler(int32 InTargetRate)
+	: TargetRate(InTargetRate)
+	, Resampler(MakeUnique<webrtc::PushResampler<float>>())
+{
+}
+
+FAudioStreamResampler::~FAudioStreamResampler() = default;
+
+bool FAudioStreamResampler::Configure(int32 InSourceRate, int32 InNumChannels)
+{
+	if (InSourceRate == SourceRate && InNumChannels == NumChannels)
+	{
+		return bSupported;
+	}
+
+	SourceRate = InSourceRate;
+	NumChannels = InNumChannels;
+	NumChunkFrames = 0;
+
+	// The shortest chunk, in multiples of 10 ms, with a whole number of frames at both rates
+	int32 ChunkMs = 0;
+	for (int32 Ms = 10; Ms <= 100 && ChunkMs == 0 && SourceRate > 0; Ms += 10)
+	{
+		if (static_cast<int64>(SourceRate) * Ms % 1000 == 0 && static_cast<int64>(TargetRate) * Ms % 1000 == 0)
+		{
+			ChunkMs = Ms;
+		}
+	}
+
+	// The resampler takes 10 ms at a time but only depends on the ratio of the rates and the size of the chunks.
+	// Scaling both rates converts a longer chunk as if it were 10 ms, at the same ratio.
+	const int32 ChunkScale = ChunkMs / 10;
+	bSupported = ChunkMs > 0 && NumChannels > 0
+		&& Resampler->InitializeIfNeeded(SourceRate * ChunkScale, TargetRate * ChunkScale, NumChannels) == 0;
+
+	if (!bSupported)
+	{
+		UE_LOG(LogMillicastPublisher, Warning, TEXT("Can't resample %d channels audio from %d Hz to %d Hz, the audio is dropped"), NumChannels, SourceRate, TargetRate);
+		return false;
+	}
+
+	SourceChunkFrames = SourceRate * ChunkScale / 100;
+	SourceChunk.SetNumUninitialized(SourceChunkFrames * NumChannels);
+	TargetChunk.SetNumUninitialized(TargetRate * ChunkScale / 100 * NumChannels);
+
+	UE_LOG(LogMillicastPublisher, Log, TEXT("Resampling %d channels audio from %d Hz to %d Hz"), NumChannels, SourceRate, TargetRate);
+
+	return true;
+}
+
+bool FAudioStreamResampler::ResampleChunk()
+{
+	const int Result = Resampler->Resample(SourceChunk.GetData(), SourceChunk.Num(), TargetChunk.GetData(), TargetChunk.Num());
+	return Result == TargetChunk.Num();
+}
+
+}
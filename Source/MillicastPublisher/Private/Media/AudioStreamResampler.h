@@ -0,0 +1,76 @@
+// Copyright Dolby.io 2023. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+namespace webrtc
+{
+	template <typename T> class PushResampler;
+}
+
+namespace Millicast::Publisher
+{
+	/*
+	 * Streaming conversion of captured audio to the rate published to webrtc.
+	 * Wraps webrtc's sinc resampler, vectorized with SSE or NEON and stateful across callbacks, so consecutive buffers join
+	 * without discontinuity. It converts a chunk of input at a time, gathered here: 10 ms, or the shortest multiple of it with
+	 * a whole number of frames, 20 ms at 22050 Hz and 40 ms at 11025 Hz. Rates that need more than 100 ms are refused.
+	 * The latency is up to one chunk of gathering plus the delay of the filter, 16 source frames.
+	 * Single threaded, used by the audio capture thread. Nothing is allocated unless the format changes.
+	 */
+	class FAudioStreamResampler
+	{
+	public:
+		explicit FAudioStreamResampler(int32 InTargetRate);
+		~FAudioStreamResampler();
+
+		/** Prepares the conversion, resets the state when the format changes. False if the source rate can't be converted. */
+		bool Configure(int32 InSourceRate, int32 InNumChannels);
+
+		/** Converts interleaved frames, OnOutput(const float* Data, int32 NumFrames) receives every 10 ms of output */
+		template<typename OutputFunc>
+		void Process(const float* InAudioData, int32 InNumFrames, OutputFunc&& OnOutput)
+		{
+			while (InNumFrames > 0)
+			{
+				const int32 Count = FMath::Min(SourceChunkFrames - NumChunkFrames, InNumFrames);
+				FMemory::Memcpy(SourceChunk.GetData() + NumChunkFrames * NumChannels, InAudioData, Count * NumChannels * sizeof(float));
+
+				NumChunkFrames += Count;
+				InAudioData += Count * NumChannels;
+				InNumFrames -= Count;
+
+				if (NumChunkFrames == SourceChunkFrames)
+				{
+					NumChunkFrames = 0;
+					if (ResampleChunk())
+					{
+						for (int32 Offset = 0; Offset < TargetChunk.Num(); Offset += TargetRate / 100 * NumChannels)
+						{
+							OnOutput(TargetChunk.GetData() + Offset, TargetRate / 100);
+						}
+					}
+				}
+			}
+		}
+
+		int32 GetSourceRate() const { return SourceRate; }
+
+	private:
+		bool ResampleChunk();
+
+		const int32 TargetRate;
+		int32 SourceRate = 0;
+		int32 NumChannels = 0;
+		bool bSupported = false;
+
+		TUniquePtr<webrtc::PushResampler<float>> Resampler;
+
+		// A chunk of interleaved input being gathered, and its conversion
+		TArray<float> SourceChunk;
+		int32 SourceChunkFrames = 0;
+		int32 NumChunkFrames = 0;
+		TArray<float> TargetChunk;
+	};
+}
@@ -3,6 +3,7 @@
 #include "AudioSubmixCapturer.h"
 
 #include <AudioDevice.h>
+#include <AudioMixerDevice.h>
 
 #include "MillicastPublisherPrivate.h"
 
@@ -60,6 +61,24 @@ namespace Millicast::Publisher
 			return nullptr;
 		}
 
+		// The submix buffers come in the channel count of the device
+#if ENGINE_MAJOR_VERSION < 5
+		if (bMultichannel && AudioDevice->IsAudioMixerEnabled())
+#else
+		if (bMultichannel)
+#endif
+		{
+			const int32 DeviceChannels = static_cast<Audio::FMixerDevice*>(AudioDevice)->GetNumDeviceChannels();
+			if (FindMultiOpusLayout(DeviceChannels))
+			{
+				SetNumChannel(DeviceChannels);
+			}
+			else
+			{
+				UE_LOG(LogMillicastPublisher, Log, TEXT("No surround layout for %d channels, the audio is published in stereo"), DeviceChannels);
+			}
+		}
+
 		AudioDevice->RegisterSubmixBufferListener(this, Submix);
 
 		CreateRtcSourceTrack();
@@ -80,7 +99,7 @@ namespace Millicast::Publisher
 			AudioDevice->UnregisterSubmixBufferListener(this, Submix);
 		}
 
-		RtcAudioTrack = nullptr;
+		ReleaseRtcSourceTrack();
 	}
 
 	AudioSubmixCapturer::~AudioSubmixCapturer()
@@ -100,10 +119,8 @@ namespace Millicast::Publisher
 
 	void AudioSubmixCapturer::OnNewSubmixBuffer(const USoundSubmix* /*OwningSubmix*/, float* InAudioData, int32 InNumSamples, int32 InNumChannels, const int32 SampleRate, double AudioClock)
 	{
-		if (SamplePerSecond == SampleRate)
-		{
-			SendAudio(InAudioData, InNumSamples, InNumChannels);
-		}
+		SetCaptureClock(AudioClock);
+		SendAudio(InAudioData, InNumSamples, InNumChannels, SampleRate);
 	}
 
 }
\ No newline at end of file
@@ -23,6 +23,9 @@ namespace Millicast::Publisher
 		/** Set the device id to use */
 		void SetAudioDeviceId(Audio::FDeviceId Id);
 
+		/** Publish in the channel layout of the audio device when it is 5.1 or 7.1 rather than downmixing to stereo */
+		void SetMultichannel(bool bInMultichannel) { bMultichannel = bInMultichannel; }
+
 		/** Called by the main audio device when a new audio data buffer is ready */
 		void OnNewSubmixBuffer(const USoundSubmix* OwningSubmix, float* AudioData,
 			int32 NumSamples, int32 NumChannels, const int32 SampleRate, double AudioClock) override;
@@ -31,6 +34,7 @@ namespace Millicast::Publisher
 		FAudioDevice* AudioDevice = nullptr;
 		USoundSubmix* Submix = nullptr;
 		TOptional<Audio::FDeviceId> DeviceId;
+		bool bMultichannel = false;
 	};
 
 }
\ No newline at end of file
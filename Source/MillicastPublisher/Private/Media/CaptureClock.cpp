@@ -0,0 +1,59 @@
+// Copyright Dolby.io 2023. All Rights Reserved.
+
+#include "CaptureClock.h"
+
+#include "Misc/CoreDelegates.h"
+
+#include "rtc_base/time_utils.h"
+
+namespace Millicast::Publisher
+{
+
+FCaptureClock& FCaptureClock::Get()
+{
+	static FCaptureClock Instance;
+	return Instance;
+}
+
+void FCaptureClock::Register()
+{
+	BeginFrameHandle = FCoreDelegates::OnBeginFrame.AddRaw(this, &FCaptureClock::OnBeginFrame);
+}
+
+void FCaptureClock::Unregister()
+{
+	FCoreDelegates::OnBeginFrame.Remove(BeginFrameHandle);
+}
+
+int64 FCaptureClock::GetFrameTimeUs(uint32 FrameNumber) const
+{
+	{
+		FScopeLock Lock(&CriticalSection);
+
+		const FFrameTime& FrameTime = FrameTimes[FrameNumber % NumFrames];
+		if (FrameTime.FrameNumber == FrameNumber && FrameTime.TimeUs != 0)
+		{
+			return FrameTime.TimeUs;
+		}
+	}
+
+	return NowUs();
+}
+
+int64 FCaptureClock::NowUs()
+{
+	return rtc::TimeMicros();
+}
+
+void FCaptureClock::OnBeginFrame()
+{
+	const int64 TimeUs = NowUs();
+
+	FScopeLock Lock(&CriticalSection);
+
+	FFrameTime& FrameTime = FrameTimes[GFrameNumber % NumFrames];
+	FrameTime.FrameNumber = GFrameNumber;
+	FrameTime.TimeUs = TimeUs;
+}
+
+}
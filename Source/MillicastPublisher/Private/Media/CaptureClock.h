@@ -0,0 +1,43 @@
+// Copyright Dolby.io 2023. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+namespace Millicast::Publisher
+{
+	/*
+	 * Capture time of the engine frames on the system clock webrtc timestamps media with (rtc::TimeMicros).
+	 * The time is taken when the game thread begins a frame, so a video frame is stamped with the moment it was simulated
+	 * rather than the moment the render thread copies it, which depends on the render thread latency.
+	 */
+	class FCaptureClock
+	{
+	public:
+		static FCaptureClock& Get();
+
+		/** Starts recording the frame times, on the game thread */
+		void Register();
+		void Unregister();
+
+		/** Capture time of an engine frame, e.g. GFrameNumberRenderThread on the render thread. Now if the frame is too old. */
+		int64 GetFrameTimeUs(uint32 FrameNumber) const;
+
+		static int64 NowUs();
+
+	private:
+		void OnBeginFrame();
+
+		static constexpr int32 NumFrames = 8;
+
+		struct FFrameTime
+		{
+			uint32 FrameNumber = 0;
+			int64 TimeUs = 0;
+		};
+
+		mutable FCriticalSection CriticalSection;
+		FFrameTime FrameTimes[NumFrames];
+		FDelegateHandle BeginFrameHandle;
+	};
+}
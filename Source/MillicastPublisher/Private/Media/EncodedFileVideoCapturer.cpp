@@ -0,0 +1,75 @@
+// Copyright Dolby.io 2023. All Rights Reserved.
+
+#include "EncodedFileVideoCapturer.h"
+
+#include "MillicastPublisherPrivate.h"
+#include "Util.h"
+
+#include "WebRTC/PeerConnection.h"
+
+TSharedPtr<IMillicastVideoSource> IMillicastVideoSource::CreateForEncodedFile(const FString& Path)
+{
+	return MakeShared<Millicast::Publisher::EncodedFileVideoCapturer>(Path);
+}
+
+namespace Millicast::Publisher
+{
+	EncodedFileVideoCapturer::~EncodedFileVideoCapturer() noexcept
+	{
+		StopCapture();
+	}
+
+	EncodedFileVideoCapturer::FStreamTrackInterface EncodedFileVideoCapturer::StartCapture(UWorld* InWorld)
+	{
+		// Several sources replaying the same file each load their own copy, the files are expected to be short
+		TSharedPtr<const FEncodedVideoFile, ESPMode::ThreadSafe> File = FEncodedVideoFile::Load(Path);
+		if (!File)
+		{
+			UE_LOG(LogMillicastPublisher, Warning, TEXT("Could not start capture, the encoded video file could not be loaded"));
+			return nullptr;
+		}
+
+		RtcVideoSource = rtc::make_ref_counted<FEncodedVideoSourceAdapter>(File);
+		RtcVideoSource->SetContentHint(ContentHint);
+		RtcVideoSource->SetFanOut(FanOut);
+		RtcVideoSource->SetKeyFrameSettings(KeyFrameSettings);
+
+		auto PeerConnectionFactory = FWebRTCPeerConnection::GetPeerConnectionFactory();
+
+		RtcVideoTrack = PeerConnectionFactory->CreateVideoTrack(to_string(TrackId.Get("encoded-file-track")), RtcVideoSource);
+
+		if (!RtcVideoTrack)
+		{
+			UE_LOG(LogMillicastPublisher, Warning, TEXT("Could not create video track"));
+			RtcVideoSource = nullptr;
+			return nullptr;
+		}
+
+		RtcVideoTrack->set_content_hint(ContentHint == EMillicastVideoContentHint::Detail
+			? webrtc::VideoTrackInterface::ContentHint::kDetailed
+			: webrtc::VideoTrackInterface::ContentHint::kFluid);
+		UE_LOG(LogMillicastPublisher, Log, TEXT("Created video track"));
+
+		RtcVideoSource->StartPlayback();
+
+		return RtcVideoTrack;
+	}
+
+	void EncodedFileVideoCapturer::StopCapture()
+	{
+		if (!RtcVideoSource)
+		{
+			return;
+		}
+
+		RtcVideoSource->StopPlayback();
+
+		RtcVideoTrack = nullptr;
+		RtcVideoSource = nullptr;
+	}
+
+	EncodedFileVideoCapturer::FStreamTrackInterface EncodedFileVideoCapturer::GetTrack()
+	{
+		return RtcVideoTrack;
+	}
+}
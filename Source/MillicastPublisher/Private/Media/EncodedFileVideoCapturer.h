@@ -0,0 +1,46 @@
+// Copyright Dolby.io 2023. All Rights Reserved.
+
+#pragma once
+
+#include "IMillicastSource.h"
+#include "WebRTC/EncodedVideoSourceAdapter.h"
+
+namespace Millicast::Publisher
+{
+	/**
+	* Video source publishing a pre-encoded IVF (VP8, VP9) or Annex B (H264) file in a loop through the passthrough encoder.
+	* Nothing is rendered or encoded, which allows a single process to publish many streams, e.g. for load tests.
+	* The codec selected on the publisher must be the one of the file.
+	*/
+	class EncodedFileVideoCapturer : public IMillicastVideoSource
+	{
+	public:
+		explicit EncodedFileVideoCapturer(const FString& InPath) : Path(InPath) {}
+		~EncodedFileVideoCapturer() noexcept;
+
+		/* Begin IMillicastVideoSource */
+		FStreamTrackInterface StartCapture(UWorld* InWorld) override;
+		void StopCapture() override;
+		FStreamTrackInterface GetTrack() override;
+		// The file has a single layer, in its own resolution
+		void SetSimulcast(bool InSimulcast) override {}
+		void SetSimulcastLayers(const TArray<FMillicastSimulcastLayer>& InSimulcastLayers) override {}
+		void SetRenderTarget(UTextureRenderTarget2D* InRenderTarget) override {}
+		void SetContentHint(EMillicastVideoContentHint InContentHint) override { ContentHint = InContentHint; }
+		void SetImportanceMap(TSharedPtr<const FMillicastImportanceMap, ESPMode::ThreadSafe> InImportanceMap) override {}
+		void SetFanOut(TSharedPtr<FEncodedFrameFanOut, ESPMode::ThreadSafe> InFanOut) override { FanOut = InFanOut; }
+		// Frames are read at the pace of the file and never wait for an encoder
+		void SetEncoderQueue(int32 InDepth, EMillicastEncoderQueuePolicy InPolicy) override {}
+		void SetKeyFrameSettings(TSharedPtr<const FKeyFrameGovernorSettings, ESPMode::ThreadSafe> InSettings) override { KeyFrameSettings = InSettings; }
+		/* End IMillicastVideoSource */
+
+	private:
+		FString Path;
+		EMillicastVideoContentHint ContentHint = EMillicastVideoContentHint::Motion;
+		TSharedPtr<FEncodedFrameFanOut, ESPMode::ThreadSafe> FanOut;
+		TSharedPtr<const FKeyFrameGovernorSettings, ESPMode::ThreadSafe> KeyFrameSettings;
+
+		FVideoTrackInterface RtcVideoTrack;
+		rtc::scoped_refptr<FEncodedVideoSourceAdapter> RtcVideoSource;
+	};
+}
@@ -0,0 +1,69 @@
+// Copyright Dolby.io 2023. All Rights Reserved.
+
+#include "FanOutVideoCapturer.h"
+
+#include "MillicastPublisherPrivate.h"
+#include "Util.h"
+
+#include "WebRTC/PeerConnection.h"
+
+TSharedPtr<IMillicastVideoSource> IMillicastVideoSource::CreateForFanOut(TSharedPtr<Millicast::Publisher::FEncodedFrameFanOut, ESPMode::ThreadSafe> FanOut, int32 StreamIndex)
+{
+	return MakeShared<Millicast::Publisher::FanOutVideoCapturer>(MoveTemp(FanOut), StreamIndex);
+}
+
+namespace Millicast::Publisher
+{
+	FanOutVideoCapturer::~FanOutVideoCapturer() noexcept
+	{
+		StopCapture();
+	}
+
+	FanOutVideoCapturer::FStreamTrackInterface FanOutVideoCapturer::StartCapture(UWorld* InWorld)
+	{
+		if (!SourceFanOut)
+		{
+			UE_LOG(LogMillicastPublisher, Warning, TEXT("Could not start capture, there is no source to relay"));
+			return nullptr;
+		}
+
+		Destination = SourceFanOut->AddDestination(StreamIndex);
+		Destination->GetVideoSource()->SetScreencast(ContentHint == EMillicastVideoContentHint::Detail);
+
+		auto PeerConnectionFactory = FWebRTCPeerConnection::GetPeerConnectionFactory();
+
+		RtcVideoTrack = PeerConnectionFactory->CreateVideoTrack(to_string(TrackId.Get("fan-out-track")), Destination->GetVideoSource());
+
+		if (!RtcVideoTrack)
+		{
+			UE_LOG(LogMillicastPublisher, Warning, TEXT("Could not create video track"));
+			StopCapture();
+			return nullptr;
+		}
+
+		RtcVideoTrack->set_content_hint(ContentHint == EMillicastVideoContentHint::Detail
+			? webrtc::VideoTrackInterface::ContentHint::kDetailed
+			: webrtc::VideoTrackInterface::ContentHint::kFluid);
+		UE_LOG(LogMillicastPublisher, Log, TEXT("Created video track"));
+
+		return RtcVideoTrack;
+	}
+
+	void FanOutVideoCapturer::StopCapture()
+	{
+		if (!Destination)
+		{
+			return;
+		}
+
+		SourceFanOut->RemoveDestination(Destination);
+
+		RtcVideoTrack = nullptr;
+		Destination = nullptr;
+	}
+
+	FanOutVideoCapturer::FStreamTrackInterface FanOutVideoCapturer::GetTrack()
+	{
+		return RtcVideoTrack;
+	}
+}
@@ -0,0 +1,47 @@
+// Copyright Dolby.io 2023. All Rights Reserved.
+
+#pragma once
+
+#include "IMillicastSource.h"
+#include "WebRTC/EncodedFrameFanOut.h"
+
+namespace Millicast::Publisher
+{
+	/**
+	* Video source relaying the frames encoded for another publisher through the passthrough encoder.
+	* Publishing the same content to several streams this way captures and encodes it only once.
+	* The codec selected on this publisher must be the one of the other publisher.
+	*/
+	class FanOutVideoCapturer : public IMillicastVideoSource
+	{
+	public:
+		FanOutVideoCapturer(TSharedPtr<FEncodedFrameFanOut, ESPMode::ThreadSafe> InFanOut, int32 InStreamIndex)
+			: SourceFanOut(MoveTemp(InFanOut))
+			, StreamIndex(InStreamIndex)
+		{}
+		~FanOutVideoCapturer() noexcept;
+
+		/* Begin IMillicastVideoSource */
+		FStreamTrackInterface StartCapture(UWorld* InWorld) override;
+		void StopCapture() override;
+		FStreamTrackInterface GetTrack() override;
+		// The layers, content and encoding are those of the other publisher
+		void SetSimulcast(bool InSimulcast) override {}
+		void SetSimulcastLayers(const TArray<FMillicastSimulcastLayer>& InSimulcastLayers) override {}
+		void SetRenderTarget(UTextureRenderTarget2D* InRenderTarget) override {}
+		void SetContentHint(EMillicastVideoContentHint InContentHint) override { ContentHint = InContentHint; }
+		void SetImportanceMap(TSharedPtr<const FMillicastImportanceMap, ESPMode::ThreadSafe> InImportanceMap) override {}
+		void SetFanOut(TSharedPtr<FEncodedFrameFanOut, ESPMode::ThreadSafe> InFanOut) override {}
+		void SetEncoderQueue(int32 InDepth, EMillicastEncoderQueuePolicy InPolicy) override {}
+		void SetKeyFrameSettings(TSharedPtr<const FKeyFrameGovernorSettings, ESPMode::ThreadSafe> InSettings) override {}
+		/* End IMillicastVideoSource */
+
+	private:
+		TSharedPtr<FEncodedFrameFanOut, ESPMode::ThreadSafe> SourceFanOut;
+		int32 StreamIndex;
+		EMillicastVideoContentHint ContentHint = EMillicastVideoContentHint::Motion;
+
+		FVideoTrackInterface RtcVideoTrack;
+		FEncodedFrameFanOut::FDestinationPtr Destination;
+	};
+}
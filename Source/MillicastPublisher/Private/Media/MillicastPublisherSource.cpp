@@ -3,15 +3,19 @@
 #include "MillicastPublisherSource.h"
 
 #include "AudioDeviceCapturer.h"
+#include "AudioMixerCapturer.h"
 #include "AudioSubmixCapturer.h"
 
 #include "MillicastPublisherPrivate.h"
 #include "RenderTargetCapturer.h"
 
 #include "Engine/Canvas.h"
+#include "Misc/Paths.h"
 #include "Subsystems/MillicastAudioDeviceCaptureSubsystem.h"
 #include "Subsystems/MillicastPublisherSourceRegistrySubsystem.h"
+#include "WebRTC/EncodedFrameFanOut.h"
 #include "WebRTC/PeerConnection.h"
+#include "WebRTC/Stats.h"
 
 UMillicastPublisherSource::UMillicastPublisherSource(const FObjectInitializer& ObjectInitializer)
 	: Super(ObjectInitializer)
@@ -141,13 +145,66 @@ void UMillicastPublisherSource::SetAudioDeviceByName(const FString& Name)
 void UMillicastPublisherSource::SetVolumeMultiplier(float Multiplier)
 {
 	VolumeMultiplier = Multiplier;
-	if (AudioSource) 
+	if (AudioSource && AudioCaptureType == EAudioCapturerType::Device)
 	{
 		auto* Source = static_cast<Millicast::Publisher::AudioDeviceCapturer*>(AudioSource.Get());
 		Source->SetVolumeMultiplier(Multiplier);
 	}
 }
 
+void UMillicastPublisherSource::SetAudioMixerInputGain(int32 Index, float GainDb)
+{
+	if (!AudioMixerInputs.IsValidIndex(Index))
+	{
+		UE_LOG(LogMillicastPublisher, Warning, TEXT("Invalid audio mixer input %d"), Index);
+		return;
+	}
+
+	AudioMixerInputs[Index].GainDb = GainDb;
+	if (AudioSource && AudioCaptureType == EAudioCapturerType::Mixer)
+	{
+		auto* Source = static_cast<Millicast::Publisher::AudioMixerCapturer*>(AudioSource.Get());
+		Source->SetInputGain(Index, GainDb);
+	}
+}
+
+void UMillicastPublisherSource::MuteAudioMixerInput(int32 Index, bool Muted)
+{
+	if (!AudioMixerInputs.IsValidIndex(Index))
+	{
+		UE_LOG(LogMillicastPublisher, Warning, TEXT("Invalid audio mixer input %d"), Index);
+		return;
+	}
+
+	AudioMixerInputs[Index].bMuted = Muted;
+	if (AudioSource && AudioCaptureType == EAudioCapturerType::Mixer)
+	{
+		auto* Source = static_cast<Millicast::Publisher::AudioMixerCapturer*>(AudioSource.Get());
+		Source->SetInputMuted(Index, Muted);
+	}
+}
+
+void UMillicastPublisherSource::SetAudioMixerInputDelay(int32 Index, int32 DelayMs)
+{
+	if (!AudioMixerInputs.IsValidIndex(Index))
+	{
+		UE_LOG(LogMillicastPublisher, Warning, TEXT("Invalid audio mixer input %d"), Index);
+		return;
+	}
+
+	AudioMixerInputs[Index].DelayMs = DelayMs;
+	if (AudioSource && AudioCaptureType == EAudioCapturerType::Mixer)
+	{
+		auto* Source = static_cast<Millicast::Publisher::AudioMixerCapturer*>(AudioSource.Get());
+		Source->SetInputDelay(Index, DelayMs);
+	}
+}
+
+int32 UMillicastPublisherSource::GetAudioChannels() const
+{
+	return AudioSource ? static_cast<Millicast::Publisher::AudioCapturerBase*>(AudioSource.Get())->GetNumChannel() : 0;
+}
+
 FString UMillicastPublisherSource::GetMediaOption(const FName& Key, const FString& DefaultValue) const
 {
 	if (Key == MillicastPublisherOption::StreamName)
@@ -189,6 +246,11 @@ bool UMillicastPublisherSource::Validate() const
 }
 
 void UMillicastPublisherSource::StartCapture(UWorld* InWorld, bool InSimulcast, TFunction<void(IMillicastSource::FStreamTrackInterface)> Callback)
+{
+	StartCapture(InWorld, InSimulcast ? FMillicastSimulcastLayer::GetDefaultLayers() : TArray<FMillicastSimulcastLayer>(), MoveTemp(Callback));
+}
+
+void UMillicastPublisherSource::StartCapture(UWorld* InWorld, const TArray<FMillicastSimulcastLayer>& InSimulcastLayers, TFunction<void(IMillicastSource::FStreamTrackInterface)> Callback)
 {
 	if (IsCapturing())
 	{
@@ -196,15 +258,29 @@ void UMillicastPublisherSource::StartCapture(UWorld* InWorld, bool InSimulcast,
 		return;
 	}
 	World = InWorld;
-	Simulcast = InSimulcast;
+	Simulcast = !Millicast::Publisher::IsEmpty(InSimulcastLayers);
+	SimulcastLayers = InSimulcastLayers;
 
 	UE_LOG(LogMillicastPublisher, Log, TEXT("Start capture"));
 
+	Millicast::Publisher::FPublisherStats::Get().SetMeasureAVOffset(bMeasureAVOffset);
+
 	// If video is enabled, create video capturer
 	if (CaptureVideo)
 	{
+		// Relaying the video of another source takes precedence, nothing is captured or encoded
+		if (IsRelayingVideo())
+		{
+			UE_CLOG(!VideoFanOutSource->GetVideoFanOut(), LogMillicastPublisher, Warning, TEXT("The video fan out source is not capturing, it must be published first"));
+			VideoSource = IMillicastVideoSource::CreateForFanOut(VideoFanOutSource->GetVideoFanOut(), VideoFanOutLayer);
+		}
+		// A pre-encoded file takes precedence over the capture
+		else if (IsReplayingEncodedFile())
+		{
+			VideoSource = IMillicastVideoSource::CreateForEncodedFile(FPaths::ConvertRelativePathToFull(FPaths::ProjectDir(), EncodedVideoFilePath));
+		}
 		// If a render target has been set, create a Render Target capturer
-		if (RenderTarget != nullptr)
+		else if (RenderTarget != nullptr)
 		{
 			VideoSource = TSharedPtr<IMillicastVideoSource>(IMillicastVideoSource::Create());
 		}
@@ -215,10 +291,22 @@ void UMillicastPublisherSource::StartCapture(UWorld* InWorld, bool InSimulcast,
 
 		// Make sure we propagate the Simulcast setting
 		VideoSource->SetSimulcast(Simulcast);
+		VideoSource->SetSimulcastLayers(SimulcastLayers);
 		VideoSource->SetRenderTarget(RenderTarget);
+		VideoSource->SetContentHint(VideoContentHint);
+		VideoSource->SetImportanceMap(ImportanceMap);
+		VideoSource->SetEncoderQueue(EncoderQueueDepth, EncoderQueuePolicy);
+		VideoSource->SetKeyFrameSettings(KeyFrameSettings);
+
+		// Other sources may relay the encoded video at any time while capturing
+		if (!IsRelayingVideo())
+		{
+			VideoFanOut = MakeShared<Millicast::Publisher::FEncodedFrameFanOut, ESPMode::ThreadSafe>();
+			VideoSource->SetFanOut(VideoFanOut);
+		}
 
 		//
-		if (VideoSource && RenderTarget)
+		if (VideoSource && RenderTarget && !IsReplayingEncodedFile() && !IsRelayingVideo())
 		{
 			if (!Millicast::Publisher::IsEmpty(LayeredTextures) || bSupportCustomDrawCanvas)
 			{
@@ -242,6 +330,7 @@ void UMillicastPublisherSource::StartCapture(UWorld* InWorld, bool InSimulcast,
 		using namespace Millicast::Publisher;
 
 		AudioSource = TSharedPtr<IMillicastAudioSource>(IMillicastAudioSource::Create(AudioCaptureType));
+		static_cast<AudioCapturerBase*>(AudioSource.Get())->SetTargetLatency(AudioTargetLatencyMs);
 
 		if (AudioCaptureType == EAudioCapturerType::Device)
 		{
@@ -256,6 +345,12 @@ void UMillicastPublisherSource::StartCapture(UWorld* InWorld, bool InSimulcast,
 		{
 			auto Source = static_cast<AudioSubmixCapturer*>(AudioSource.Get());
 			Source->SetAudioSubmix(Submix);
+			Source->SetMultichannel(bMultichannelAudio);
+		}
+		else if (AudioCaptureType == EAudioCapturerType::Mixer)
+		{
+			auto Source = static_cast<AudioMixerCapturer*>(AudioSource.Get());
+			Source->SetInputs(AudioMixerInputs);
 		}
 
 		// Start the capture and notify observers
@@ -283,6 +378,8 @@ void UMillicastPublisherSource::StopCapture(bool bDestroyLayeredTexturesCanvas)
 		VideoSource = nullptr;
 	}
 
+	VideoFanOut = nullptr;
+
 	// Stop audio capturer
 	if (AudioSource)
 	{
@@ -345,7 +442,7 @@ void UMillicastPublisherSource::ChangeRenderTarget(UTextureRenderTarget2D* InRen
 	}
 	
 	// This is allowed only when a capture has been starts with the Render Target capturer
-	if (InRenderTarget != nullptr && RenderTarget != nullptr && VideoSource != nullptr)
+	if (InRenderTarget != nullptr && RenderTarget != nullptr && VideoSource != nullptr && !IsReplayingEncodedFile() && !IsRelayingVideo())
 	{
 		UE_LOG(LogMillicastPublisher, Log, TEXT("Changing render target"));
 		RenderTarget = InRenderTarget;
@@ -354,6 +451,71 @@ void UMillicastPublisherSource::ChangeRenderTarget(UTextureRenderTarget2D* InRen
 	}
 }
 
+void UMillicastPublisherSource::SetRegionsOfInterest(const TArray<FMillicastRegionOfInterest>& Regions, float BackgroundImportance)
+{
+	// Fine enough to follow small HUD elements, coarse enough to rasterize every frame
+	constexpr int32 GridSize = 64;
+
+	auto Map = MakeShared<FMillicastImportanceMap, ESPMode::ThreadSafe>();
+	Map->Width = GridSize;
+	Map->Height = GridSize;
+	Map->Values.Init(static_cast<uint8>(FMath::Clamp(BackgroundImportance, 0.f, 1.f) * 255.f), GridSize * GridSize);
+
+	for (const FMillicastRegionOfInterest& Region : Regions)
+	{
+		const uint8 Importance = static_cast<uint8>(FMath::Clamp(Region.Importance, 0.f, 1.f) * 255.f);
+
+		// Every cell the region touches takes its importance
+		const int32 X0 = FMath::Clamp(FMath::FloorToInt(Region.Position.X * GridSize), 0, GridSize);
+		const int32 Y0 = FMath::Clamp(FMath::FloorToInt(Region.Position.Y * GridSize), 0, GridSize);
+		const int32 X1 = FMath::Clamp(FMath::CeilToInt((Region.Position.X + Region.Size.X) * GridSize), 0, GridSize);
+		const int32 Y1 = FMath::Clamp(FMath::CeilToInt((Region.Position.Y + Region.Size.Y) * GridSize), 0, GridSize);
+
+		for (int32 y = Y0; y < Y1; ++y)
+		{
+			for (int32 x = X0; x < X1; ++x)
+			{
+				uint8& Value = Map->Values[y * GridSize + x];
+				Value = FMath::Max(Value, Importance);
+			}
+		}
+	}
+
+	UpdateImportanceMap(MoveTemp(Map));
+}
+
+bool UMillicastPublisherSource::SetImportanceMap(int32 Width, int32 Height, const TArray<uint8>& Values)
+{
+	auto Map = MakeShared<FMillicastImportanceMap, ESPMode::ThreadSafe>();
+	Map->Width = Width;
+	Map->Height = Height;
+	Map->Values = Values;
+
+	if (!Map->IsValid())
+	{
+		UE_LOG(LogMillicastPublisher, Error, TEXT("Invalid importance map, expected %d x %d values and got %d"), Width, Height, Values.Num());
+		return false;
+	}
+
+	UpdateImportanceMap(MoveTemp(Map));
+	return true;
+}
+
+void UMillicastPublisherSource::ClearRegionsOfInterest()
+{
+	UpdateImportanceMap(nullptr);
+}
+
+void UMillicastPublisherSource::UpdateImportanceMap(TSharedPtr<const FMillicastImportanceMap, ESPMode::ThreadSafe> InImportanceMap)
+{
+	ImportanceMap = MoveTemp(InImportanceMap);
+
+	if (VideoSource)
+	{
+		VideoSource->SetImportanceMap(ImportanceMap);
+	}
+}
+
 #if WITH_EDITOR
 bool UMillicastPublisherSource::CanEditChange(const FProperty* InProperty) const
 {
@@ -386,6 +548,16 @@ bool UMillicastPublisherSource::CanEditChange(const FProperty* InProperty) const
 		return  CaptureAudio && AudioCaptureType == EAudioCapturerType::Device;
 	}
 
+	if (Name == MillicastPublisherOption::MultichannelAudio.ToString())
+	{
+		return CaptureAudio && AudioCaptureType == EAudioCapturerType::Submix;
+	}
+
+	if (Name == MillicastPublisherOption::AudioMixerInputs.ToString())
+	{
+		return CaptureAudio && AudioCaptureType == EAudioCapturerType::Mixer;
+	}
+
 	return Super::CanEditChange(InProperty);
 }
 
@@ -32,6 +32,12 @@ namespace Millicast::Publisher
 		// Create WebRTC Video source
 		RtcVideoSource = new rtc::RefCountedObject<Millicast::Publisher::FTexture2DVideoSourceAdapter>();
 		RtcVideoSource->SetSimulcast(Simulcast);
+		RtcVideoSource->SetSimulcastLayers(SimulcastLayers);
+		RtcVideoSource->SetContentHint(ContentHint);
+		RtcVideoSource->SetImportanceMap(ImportanceMap);
+		RtcVideoSource->SetFanOut(FanOut);
+		RtcVideoSource->SetEncoderQueue(EncoderQueueDepth, EncoderQueuePolicy);
+		RtcVideoSource->SetKeyFrameSettings(KeyFrameSettings);
 		//RtcVideoSource->SetRenderTarget(RenderTarget);
 		//RtcVideoSource->SetWorld(InWorld);
 
@@ -42,6 +48,7 @@ namespace Millicast::Publisher
 
 		if (RtcVideoTrack)
 		{
+			RtcVideoTrack->set_content_hint(RtcVideoSource->GetTrackContentHint());
 			UE_LOG(LogMillicastPublisher, Log, TEXT("Created video track"));
 		}
 		else
@@ -72,6 +79,16 @@ namespace Millicast::Publisher
 		FCoreDelegates::OnEndFrameRT.RemoveAll(this);
 	}
 
+	void RenderTargetCapturer::SetImportanceMap(TSharedPtr<const FMillicastImportanceMap, ESPMode::ThreadSafe> InImportanceMap)
+	{
+		ImportanceMap = InImportanceMap;
+
+		if (RtcVideoSource)
+		{
+			RtcVideoSource->SetImportanceMap(MoveTemp(InImportanceMap));
+		}
+	}
+
 	RenderTargetCapturer::FStreamTrackInterface RenderTargetCapturer::GetTrack()
 	{
 		return RtcVideoTrack;
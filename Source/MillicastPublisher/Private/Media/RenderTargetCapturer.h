@@ -20,7 +20,13 @@ namespace Millicast::Publisher
 		FStreamTrackInterface StartCapture(UWorld* InWorld) override;
 		void StopCapture() override;
 		void SetSimulcast(bool InSimulcast) override { Simulcast = InSimulcast; }
+		void SetSimulcastLayers(const TArray<FMillicastSimulcastLayer>& InSimulcastLayers) override { SimulcastLayers = InSimulcastLayers; }
 		void SetRenderTarget(UTextureRenderTarget2D* InRenderTarget) override { RenderTarget = InRenderTarget; }
+		void SetContentHint(EMillicastVideoContentHint InContentHint) override { ContentHint = InContentHint; }
+		void SetImportanceMap(TSharedPtr<const FMillicastImportanceMap, ESPMode::ThreadSafe> InImportanceMap) override;
+		void SetFanOut(TSharedPtr<FEncodedFrameFanOut, ESPMode::ThreadSafe> InFanOut) override { FanOut = InFanOut; }
+		void SetEncoderQueue(int32 InDepth, EMillicastEncoderQueuePolicy InPolicy) override { EncoderQueueDepth = InDepth; EncoderQueuePolicy = InPolicy; }
+		void SetKeyFrameSettings(TSharedPtr<const FKeyFrameGovernorSettings, ESPMode::ThreadSafe> InSettings) override { KeyFrameSettings = InSettings; }
 
 		FStreamTrackInterface GetTrack() override;
 
@@ -34,6 +40,13 @@ namespace Millicast::Publisher
 		UWorld* World = nullptr;
 		UTextureRenderTarget2D* RenderTarget = nullptr;
 		bool Simulcast = false;
+		TArray<FMillicastSimulcastLayer> SimulcastLayers;
+		EMillicastVideoContentHint ContentHint = EMillicastVideoContentHint::Motion;
+		TSharedPtr<const FMillicastImportanceMap, ESPMode::ThreadSafe> ImportanceMap;
+		TSharedPtr<FEncodedFrameFanOut, ESPMode::ThreadSafe> FanOut;
+		int32 EncoderQueueDepth = 1;
+		EMillicastEncoderQueuePolicy EncoderQueuePolicy = EMillicastEncoderQueuePolicy::DropOldest;
+		TSharedPtr<const FKeyFrameGovernorSettings, ESPMode::ThreadSafe> KeyFrameSettings;
 		
 		FVideoTrackInterface RtcVideoTrack;
 		rtc::scoped_refptr<FTexture2DVideoSourceAdapter> RtcVideoSource;
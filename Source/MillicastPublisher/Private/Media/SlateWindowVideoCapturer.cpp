@@ -52,6 +52,12 @@ IMillicastSource::FStreamTrackInterface SlateWindowVideoCapturer::StartCapture(U
 	// Create WebRTC video source
 	RtcVideoSource = new rtc::RefCountedObject<Millicast::Publisher::FTexture2DVideoSourceAdapter>();
 	RtcVideoSource->SetSimulcast(Simulcast);
+	RtcVideoSource->SetSimulcastLayers(SimulcastLayers);
+	RtcVideoSource->SetContentHint(ContentHint);
+	RtcVideoSource->SetImportanceMap(ImportanceMap);
+	RtcVideoSource->SetFanOut(FanOut);
+	RtcVideoSource->SetEncoderQueue(EncoderQueueDepth, EncoderQueuePolicy);
+	RtcVideoSource->SetKeyFrameSettings(KeyFrameSettings);
 	//RtcVideoSource->SetRenderTarget(RenderTarget);
 	//RtcVideoSource->SetWorld(InWorld);
 	
@@ -67,6 +73,7 @@ IMillicastSource::FStreamTrackInterface SlateWindowVideoCapturer::StartCapture(U
 	// Check
 	if (RtcVideoTrack) 
 	{
+		RtcVideoTrack->set_content_hint(RtcVideoSource->GetTrackContentHint());
 		UE_LOG(LogMillicastPublisher, Log, TEXT("Created video track"));
 	}
 	else
@@ -93,6 +100,18 @@ void SlateWindowVideoCapturer::StopCapture()
 	RtcVideoTrack = nullptr;
 }
 
+void SlateWindowVideoCapturer::SetImportanceMap(TSharedPtr<const FMillicastImportanceMap, ESPMode::ThreadSafe> InImportanceMap)
+{
+	FScopeLock Lock(&CriticalSection);
+
+	ImportanceMap = InImportanceMap;
+
+	if (RtcVideoSource)
+	{
+		RtcVideoSource->SetImportanceMap(MoveTemp(InImportanceMap));
+	}
+}
+
 SlateWindowVideoCapturer::FStreamTrackInterface SlateWindowVideoCapturer::GetTrack()
 {
 	return RtcVideoTrack;
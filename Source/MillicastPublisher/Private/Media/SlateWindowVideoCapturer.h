@@ -21,7 +21,13 @@ namespace Millicast::Publisher
 		void StopCapture() override;
 		FStreamTrackInterface GetTrack() override;
 		void SetSimulcast(bool InSimulcast) override { Simulcast = InSimulcast; }
+		void SetSimulcastLayers(const TArray<FMillicastSimulcastLayer>& InSimulcastLayers) override { SimulcastLayers = InSimulcastLayers; }
 		void SetRenderTarget(UTextureRenderTarget2D* InRenderTarget) override { /*TODO [RW]*/ }
+		void SetContentHint(EMillicastVideoContentHint InContentHint) override { ContentHint = InContentHint; }
+		void SetImportanceMap(TSharedPtr<const FMillicastImportanceMap, ESPMode::ThreadSafe> InImportanceMap) override;
+		void SetFanOut(TSharedPtr<FEncodedFrameFanOut, ESPMode::ThreadSafe> InFanOut) override { FanOut = InFanOut; }
+		void SetEncoderQueue(int32 InDepth, EMillicastEncoderQueuePolicy InPolicy) override { EncoderQueueDepth = InDepth; EncoderQueuePolicy = InPolicy; }
+		void SetKeyFrameSettings(TSharedPtr<const FKeyFrameGovernorSettings, ESPMode::ThreadSafe> InSettings) override { KeyFrameSettings = InSettings; }
 		/* End IMillicastVideoSource */
 
 		/**
@@ -45,6 +51,13 @@ namespace Millicast::Publisher
 		FDelegateHandle OnBackBufferHandle;
 		
 		bool Simulcast = false;
+		TArray<FMillicastSimulcastLayer> SimulcastLayers;
+		EMillicastVideoContentHint ContentHint = EMillicastVideoContentHint::Motion;
+		TSharedPtr<const FMillicastImportanceMap, ESPMode::ThreadSafe> ImportanceMap;
+		TSharedPtr<FEncodedFrameFanOut, ESPMode::ThreadSafe> FanOut;
+		int32 EncoderQueueDepth = 1;
+		EMillicastEncoderQueuePolicy EncoderQueuePolicy = EMillicastEncoderQueuePolicy::DropOldest;
+		TSharedPtr<const FKeyFrameGovernorSettings, ESPMode::ThreadSafe> KeyFrameSettings;
 		UTextureRenderTarget2D* RenderTarget = nullptr;
 	};
 
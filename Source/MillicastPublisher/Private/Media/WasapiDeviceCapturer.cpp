@@ -1,6 +1,7 @@
 // Copyright Dolby.io 2023. All Rights Reserved.
 
 #include "WasapiDeviceCapturer.h"
+#include "AudioSampleConversion.h"
 
 #include "MillicastPublisherPrivate.h"
 
@@ -583,11 +584,6 @@ namespace Millicast::Publisher
 		pfmt = format_;
 		devBitsPerSample_ = pfmt->wBitsPerSample;
 
-		ResamplingParameters.ResamplerMethod = Audio::EResamplingMethod::FastSinc;
-		ResamplingParameters.NumChannels = format_->nChannels;
-		ResamplingParameters.SourceSampleRate = format_->nSamplesPerSec;
-		ResamplingParameters.DestinationSampleRate = kOpusSampleRate;
-
 		if (pfmt->wBitsPerSample == 32 && ((WAVEFORMATEXTENSIBLE*)pfmt)->SubFormat == KSDATAFORMAT_SUBTYPE_IEEE_FLOAT || pfmt->wFormatTag == WAVE_FORMAT_IEEE_FLOAT)
 		{
 			devBitsPerSample_ = kSampleBitsFloat;
@@ -679,7 +675,7 @@ namespace Millicast::Publisher
 			client_->Stop();
 		}
 
-		RtcAudioTrack = nullptr;
+		ReleaseRtcSourceTrack();
 		// we keep ticking the stream until it is released in the callback but tick will do nothing
 	}
 
@@ -713,63 +709,38 @@ namespace Millicast::Publisher
 
 	float* WasapiDeviceCapturer::ConvertToFloatSample(void* pData, size_t numFramesAvailable, size_t numCaptureChannels)
 	{
-		float* pinf = reinterpret_cast<float*>(pData);
+		const int32 NumSamples = static_cast<int32>(numFramesAvailable * numCaptureChannels);
+
+		// Float samples are sent as they are
+		if (devBitsPerSample_ != 32 && devBitsPerSample_ != 24 && devBitsPerSample_ != 16)
+		{
+			return reinterpret_cast<float*>(pData);
+		}
+
+		// Integer samples are smaller than floats or the same size, converting them in place would overwrite the ones not read yet
+		ConvertBuffer.SetNumUninitialized(NumSamples, false);
 
 		// sample type conversion
 		if (devBitsPerSample_ == 32)
 		{
-			int32_t* pin32 = reinterpret_cast<int32_t*>(pData);
-
-			for (size_t i = 0; i < size_t(numFramesAvailable) * numCaptureChannels; i++)
-			{
-				pinf[i] = float(pin32[i]) / 2147483648.f;
-			}
+			S32ToFloat(reinterpret_cast<const int32*>(pData), NumSamples, ConvertBuffer.GetData());
 		}
 		else if (devBitsPerSample_ == 24)
 		{
-			int32_t* pin24 = reinterpret_cast<int32_t*>(pData);
-
-			for (size_t i = 0; i < size_t(numFramesAvailable) * numCaptureChannels; i++)
-			{
-				pinf[i] = float(pin24[i] >> 8) / 8388608.f;
-			}
+			S24ToFloat(reinterpret_cast<const uint8*>(pData), NumSamples, ConvertBuffer.GetData());
 		}
-		else if (devBitsPerSample_ == 16)
+		else
 		{
-			int16_t* pin16 = reinterpret_cast<int16_t*>(pData);
-
-			for (size_t i = 0; i < size_t(numFramesAvailable) * numCaptureChannels; i++)
-			{
-				pinf[i] = float(pin16[i]) / 32768.f;
-			}
+			S16ToFloat(reinterpret_cast<const int16*>(pData), NumSamples, ConvertBuffer.GetData());
 		}
 
-		return pinf;
+		return ConvertBuffer.GetData();
 	}
 
 	void WasapiDeviceCapturer::SendAudioData(const float* pinf, size_t numFramesAvailable, size_t numCaptureChannels)
 	{
-		if (kOpusSampleRate != format_->nSamplesPerSec)
-		{
-			ResamplingParameters.InputBuffer.Append(pinf, numFramesAvailable * numCaptureChannels);
-
-			Audio::FResamplerResults results;
-			Audio::AlignedFloatBuffer OutBuffer;
-
-			results.OutBuffer = &OutBuffer;
-			results.OutBuffer->AddUninitialized(numFramesAvailable * numCaptureChannels * kOpusSampleRate / format_->nSamplesPerSec);
-
-			auto r = Audio::Resample(ResamplingParameters, results);
-
-			if (results.OutputFramesGenerated > 0)
-			{
-				SendAudio(results.OutBuffer->GetData(), results.OutputFramesGenerated * numCaptureChannels, numCaptureChannels);
-			}
-		}
-		else
-		{
-			SendAudio(pinf, numFramesAvailable * numCaptureChannels, numCaptureChannels);
-		}
+		// Resampled to kOpusSampleRate by the base class when the device runs at another rate
+		SendAudio(pinf, numFramesAvailable * numCaptureChannels, numCaptureChannels, format_->nSamplesPerSec);
 	}
 
 	//-------------------------------------------------------------------------------------------------------------------------------------------------------------
@@ -791,7 +762,9 @@ namespace Millicast::Publisher
 			BYTE* pData;
 			DWORD flags;
 
-			HRESULT getBufferRet = capture_->GetBuffer(&pData, &numFramesAvailable, &flags, nullptr, nullptr);
+			UINT64 devicePosition = 0;
+
+			HRESULT getBufferRet = capture_->GetBuffer(&pData, &numFramesAvailable, &flags, &devicePosition, nullptr);
 			if (FAILED(getBufferRet))
 			{
 				FString ErrorMsg;
@@ -817,9 +790,9 @@ namespace Millicast::Publisher
 
 			float* pinf = ConvertToFloatSample(pData, numFramesAvailable, numCaptureChannels);
 
+			SetCaptureClock(double(devicePosition) / format_->nSamplesPerSec);
 			SendAudioData(pinf, numFramesAvailable, numCaptureChannels);
 
-			AudioBuffer.Empty();
 			capture_->ReleaseBuffer(numFramesAvailable);
 			capture_->GetNextPacketSize(&packetLength);
 		}
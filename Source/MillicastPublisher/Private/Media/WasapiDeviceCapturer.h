@@ -80,15 +80,13 @@ namespace Millicast::Publisher
 		size_t                  tickRate_ = 100;
 
 		float resamplingFactor_ = 0.f;				//!< if needed
-		Audio::AlignedFloatBuffer    AudioBuffer;
-		Audio::FResamplingParameters ResamplingParameters;
+		Audio::AlignedFloatBuffer    ConvertBuffer;					//!< integer samples converted to float, reused between packets
 
 		float* ConvertToFloatSample(void* pData, size_t numFramesAvailable, size_t numCaptureChannels);
 		void SendAudioData(const float* pinf, size_t numFramesAvailable, size_t numCaptureChannels);
 
 	public:
 		WasapiDeviceCapturer(size_t tickRate, bool loopback) noexcept
-			: ResamplingParameters{ Audio::EResamplingMethod::FastSinc, 0, 0, 0, AudioBuffer }
 		{
 			Initialize(tickRate, loopback);
 		}
@@ -1,6 +1,7 @@
 // Copyright Dolby.io 2023. All Rights Reserved.
 
 #include "IMillicastPublisherModule.h"
+#include "Media/CaptureClock.h"
 
 #include "Brushes/SlateImageBrush.h"
 #include "Interfaces/IPluginManager.h"
@@ -30,6 +31,13 @@ public:
 	void StartupModule() override
 	{
 		CreateStyle();
+
+		Millicast::Publisher::FCaptureClock::Get().Register();
+	}
+
+	void ShutdownModule() override
+	{
+		Millicast::Publisher::FCaptureClock::Get().Unregister();
 	}
 
 private:
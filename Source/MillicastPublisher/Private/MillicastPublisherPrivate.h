@@ -17,4 +17,6 @@ namespace MillicastPublisherOption
 	static const FName CaptureDeviceIndex("CaptureDeviceIndex");
 	static const FName AudioCaptureType("AudioCaptureType");
 	static const FName VolumeMultiplier("VolumeMultiplier");
+	static const FName AudioMixerInputs("AudioMixerInputs");
+	static const FName MultichannelAudio("bMultichannelAudio");
 }
@@ -0,0 +1,149 @@
+// Copyright Dolby.io 2023. All Rights Reserved.
+
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "Media/AudioDriftCompensator.h"
+
+#include "Math/RandomStream.h"
+
+namespace Millicast::Publisher
+{
+
+namespace
+{
+	constexpr int32 SampleRate = 48000;
+	constexpr int32 NumChannels = 2;
+	constexpr int32 BufferFrames = 480;
+	constexpr double BufferSeconds = double(BufferFrames) / SampleRate;
+
+	struct FDriftRun
+	{
+		double DriftPpm = 0.0;
+		double CorrectionPpm = 0.0;
+		double SettledFillMs = 0.0;
+		double MaxFillErrorMs = 0.0;
+		double OutputPpm = 0.0;
+		bool bCompensating = false;
+	};
+
+	/**
+	 * A capture device whose clock runs SkewPpm fast, delivering a buffer every 10 ms of its clock. Each callback reaches
+	 * the compensator up to JitterMs late on the system clock, as the scheduling of the capture thread does.
+	 * With bCaptureClock the device reports its clock, as the submix capture does, otherwise it is counted from the samples.
+	 */
+	FDriftRun RunDrift(double SkewPpm, double JitterMs, bool bCaptureClock, double Seconds, FRandomStream& Random)
+	{
+		FAudioDriftCompensator Compensator;
+		TArray<float> Buffer;
+		Buffer.SetNumZeroed(BufferFrames * NumChannels);
+
+		FDriftRun Run;
+		const double SystemStart = 1000.0;
+		const int32 NumBuffers = static_cast<int32>(Seconds / BufferSeconds);
+
+		// The output rate is measured over the second half, once the compensation settled, against the system time without jitter
+		int64 OutputFrames = 0;
+		int64 HalfOutputFrames = 0;
+		double HalfSystemTime = 0.0;
+		double NominalTime = SystemStart;
+
+		for (int32 i = 0; i < NumBuffers; ++i)
+		{
+			const double DeviceTime = i * BufferSeconds;
+			NominalTime = SystemStart + DeviceTime / (1.0 + SkewPpm * 1e-6);
+			const double SystemTime = NominalTime + Random.FRandRange(0.f, static_cast<float>(JitterMs)) / 1000.0;
+
+			if (bCaptureClock)
+			{
+				Compensator.SetCaptureClock(DeviceTime);
+			}
+			Compensator.Update(BufferFrames, SampleRate, SystemTime);
+			Compensator.Process(Buffer.GetData(), BufferFrames, NumChannels, [&OutputFrames](const float*, int32 NumFrames) { OutputFrames += NumFrames; });
+
+			if (i == NumBuffers / 2)
+			{
+				HalfOutputFrames = OutputFrames;
+				HalfSystemTime = NominalTime;
+				Run.SettledFillMs = Compensator.GetFillMs();
+			}
+			else if (i > NumBuffers / 2)
+			{
+				Run.MaxFillErrorMs = FMath::Max(Run.MaxFillErrorMs, FMath::Abs(Compensator.GetFillMs() - Run.SettledFillMs));
+			}
+		}
+
+		Run.DriftPpm = Compensator.GetDriftPpm();
+		Run.CorrectionPpm = Compensator.GetCorrectionPpm();
+		Run.bCompensating = Compensator.IsCompensating();
+
+		const double OutputRate = (OutputFrames - HalfOutputFrames) / (NominalTime - HalfSystemTime);
+		Run.OutputPpm = (OutputRate / SampleRate - 1.0) * 1e6;
+		return Run;
+	}
+}
+
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FMillicastAudioDriftCompensatorTest, "Millicast.Publisher.Media.AudioDriftCompensator",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FMillicastAudioDriftCompensatorTest::RunTest(const FString& Parameters)
+{
+	using namespace Millicast::Publisher;
+
+	FRandomStream Random(0x44);
+
+	// A device 200 ppm off drifts 24 ms in two minutes, the compensation keeps the output at the system rate and the fill steady
+	for (const double SkewPpm : { 200.0, -200.0, 0.0 })
+	{
+		for (const bool bCaptureClock : { false, true })
+		{
+			const FString What = FString::Printf(TEXT("%+.0f ppm, %s clock"), SkewPpm, bCaptureClock ? TEXT("reported") : TEXT("counted"));
+			const FDriftRun Run = RunDrift(SkewPpm, 4.0, bCaptureClock, 120.0, Random);
+
+			TestTrue(What + TEXT(", compensating"), Run.bCompensating);
+			TestTrue(What + TEXT(", drift estimated within 5 ppm"), FMath::Abs(Run.DriftPpm - SkewPpm) < 5.0);
+			TestTrue(What + TEXT(", corrected within 10 ppm"), FMath::Abs(Run.CorrectionPpm - SkewPpm) < 10.0);
+			TestTrue(What + TEXT(", output at the system rate within 10 ppm"), FMath::Abs(Run.OutputPpm) < 10.0);
+			TestTrue(What + TEXT(", fill within 1 ms"), Run.MaxFillErrorMs < 1.0);
+
+			AddInfo(FString::Printf(TEXT("%s: drift %.2f ppm, correction %.2f ppm, output %+.2f ppm, fill %.2f ms +- %.3f ms"),
+				*What, Run.DriftPpm, Run.CorrectionPpm, Run.OutputPpm, Run.SettledFillMs, Run.MaxFillErrorMs));
+		}
+	}
+
+	// Nothing is corrected before the measure settled, a gap in the capture starts it over
+	{
+		FAudioDriftCompensator Compensator;
+		TArray<float> Buffer;
+		Buffer.SetNumZeroed(BufferFrames * NumChannels);
+
+		double SystemTime = 0.0;
+		int64 OutputFrames = 0;
+		for (int32 i = 0; i < 300; ++i, SystemTime += BufferSeconds)
+		{
+			Compensator.Update(BufferFrames, SampleRate, SystemTime * (1.0 - 200e-6));
+			Compensator.Process(Buffer.GetData(), BufferFrames, NumChannels, [&OutputFrames](const float*, int32 NumFrames) { OutputFrames += NumFrames; });
+		}
+
+		TestFalse(TEXT("Not compensating before the measure settled"), Compensator.IsCompensating());
+		TestTrue(TEXT("Audio passed through unchanged"), FMath::Abs(OutputFrames - 300 * BufferFrames) <= 4);
+
+		for (int32 i = 0; i < 1000; ++i, SystemTime += BufferSeconds)
+		{
+			Compensator.Update(BufferFrames, SampleRate, SystemTime * (1.0 - 200e-6));
+		}
+		TestTrue(TEXT("Compensating once settled"), Compensator.IsCompensating());
+
+		SystemTime += 2.0;
+		Compensator.Update(BufferFrames, SampleRate, SystemTime);
+		TestFalse(TEXT("Gap restarts the measure"), Compensator.IsCompensating());
+		TestEqual(TEXT("No drift after a restart"), Compensator.GetDriftPpm(), 0.0);
+	}
+
+	return true;
+}
+
+#endif
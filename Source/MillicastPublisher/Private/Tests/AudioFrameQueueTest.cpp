@@ -0,0 +1,183 @@
+// Copyright Dolby.io 2023. All Rights Reserved.
+
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "Media/AudioFrameQueue.h"
+
+namespace Millicast::Publisher
+{
+
+namespace
+{
+	using FSample = FAudioFrameQueue::FSample;
+
+	constexpr int32 NumChannels = 2;
+	constexpr int32 NumSamples = 480 * NumChannels;
+
+	/** A 10 ms stereo frame whose samples all carry its index, captured 10 ms after the previous one */
+	bool PushFrame(FAudioFrameQueue& Queue, int32 Index)
+	{
+		FSample Samples[NumSamples];
+		for (FSample& Sample : Samples)
+		{
+			Sample = static_cast<FSample>(Index);
+		}
+		return Queue.Push(Samples, NumSamples, NumChannels, 1'000'000 + Index * 10'000);
+	}
+
+	/** The index the frame was pushed with, or -1 if the frame doesn't match what PushFrame wrote */
+	int32 GetFrameIndex(const FAudioFrameQueue::FFrame* Frame)
+	{
+		if (!Frame || Frame->NumChannels != NumChannels || Frame->NumSamples != NumSamples)
+		{
+			return -1;
+		}
+
+		const int32 Index = Frame->Samples[0];
+		for (int32 i = 0; i < NumSamples; ++i)
+		{
+			if (Frame->Samples[i] != Index)
+			{
+				return -1;
+			}
+		}
+		return Frame->CaptureTimeUs == 1'000'000 + Index * 10'000 ? Index : -1;
+	}
+}
+
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FMillicastAudioFrameQueueTest, "Millicast.Publisher.Media.AudioFrameQueue",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FMillicastAudioFrameQueueTest::RunTest(const FString& Parameters)
+{
+	using namespace Millicast::Publisher;
+
+	// Frames come out in order and intact as the slots are reused, whatever the fill level when the counters wrap the slots
+	{
+		FAudioFrameQueue Queue(4);
+		int32 NextPush = 0;
+		int32 NextPop = 0;
+		bool bInOrder = true;
+		for (int32 Cycle = 0; Cycle < 50; ++Cycle)
+		{
+			const int32 NumPushes = 1 + Cycle % Queue.GetCapacity();
+			for (int32 i = 0; i < NumPushes; ++i)
+			{
+				bInOrder &= PushFrame(Queue, NextPush++);
+			}
+			bInOrder &= Queue.Num() == NumPushes;
+
+			while (const FAudioFrameQueue::FFrame* Frame = Queue.Peek())
+			{
+				bInOrder &= GetFrameIndex(Frame) == NextPop++;
+				Queue.Pop();
+			}
+		}
+		TestTrue(TEXT("Wraparound, every frame popped in order with its samples, channels and capture time"), bInOrder);
+		TestEqual(TEXT("Wraparound, every frame popped"), NextPop, NextPush);
+		TestTrue(TEXT("Wraparound, many times round the slots"), NextPush > 10 * Queue.GetCapacity());
+		TestEqual(TEXT("Wraparound, empty"), Queue.Num(), 0);
+		TestEqual(TEXT("Wraparound, nothing dropped"), Queue.GetNumOverruns(), 0);
+	}
+
+	// The producer drops the frame it pushes to a full queue, the queued ones are kept
+	{
+		FAudioFrameQueue Queue(4);
+		for (int32 i = 0; i < Queue.GetCapacity(); ++i)
+		{
+			PushFrame(Queue, i);
+		}
+		TestFalse(TEXT("Full, frame dropped"), PushFrame(Queue, 4));
+		TestEqual(TEXT("Full, dropped frame counted as an overrun"), Queue.GetNumOverruns(), 1);
+		TestEqual(TEXT("Full, oldest frame kept"), GetFrameIndex(Queue.Peek()), 0);
+		TestEqual(TEXT("Full, size unchanged"), Queue.Num(), Queue.GetCapacity());
+	}
+
+	// Silence until the target is buffered, then silence again on an underrun, counted only once a frame was delivered
+	{
+		constexpr int32 TargetFrames = 3;
+		FAudioFrameQueue Queue(32);
+
+		TestNull(TEXT("Start, silence while empty"), Queue.Pull(TargetFrames));
+		PushFrame(Queue, 0);
+		PushFrame(Queue, 1);
+		TestNull(TEXT("Start, silence below the target"), Queue.Pull(TargetFrames));
+		TestEqual(TEXT("Start, silence before the first frame isn't an underrun"), Queue.GetNumUnderruns(), 0);
+
+		PushFrame(Queue, 2);
+		for (int32 i = 0; i < TargetFrames; ++i)
+		{
+			TestEqual(FString::Printf(TEXT("Buffered, frame %d delivered"), i), GetFrameIndex(Queue.Pull(TargetFrames)), i);
+			Queue.Pop();
+		}
+
+		TestNull(TEXT("Underrun, silence"), Queue.Pull(TargetFrames));
+		TestEqual(TEXT("Underrun, counted"), Queue.GetNumUnderruns(), 1);
+
+		// Refilling to the target again, every frame of silence meanwhile is an underrun
+		PushFrame(Queue, 3);
+		TestNull(TEXT("Refilling, silence below the target"), Queue.Pull(TargetFrames));
+		PushFrame(Queue, 4);
+		TestNull(TEXT("Refilling, silence below the target again"), Queue.Pull(TargetFrames));
+		TestEqual(TEXT("Refilling, each silent frame counted"), Queue.GetNumUnderruns(), 3);
+
+		PushFrame(Queue, 5);
+		TestEqual(TEXT("Refilled, oldest frame delivered"), GetFrameIndex(Queue.Pull(TargetFrames)), 3);
+		Queue.Pop();
+
+		// Under the target but not empty, the delivery goes on
+		TestEqual(TEXT("Draining, next frame delivered"), GetFrameIndex(Queue.Pull(TargetFrames)), 4);
+		Queue.Pop();
+		TestEqual(TEXT("Draining, no underrun"), Queue.GetNumUnderruns(), 3);
+		TestEqual(TEXT("Draining, no overrun"), Queue.GetNumOverruns(), 0);
+
+		Queue.Reset();
+		TestEqual(TEXT("Reset, empty"), Queue.Num(), 0);
+		TestEqual(TEXT("Reset, underruns cleared"), Queue.GetNumUnderruns(), 0);
+		TestNull(TEXT("Reset, buffering again"), Queue.Pull(TargetFrames));
+		TestEqual(TEXT("Reset, silence before the first frame isn't an underrun"), Queue.GetNumUnderruns(), 0);
+	}
+
+	// More than twice the target queued is trimmed to the target, the oldest frames dropped
+	{
+		constexpr int32 TargetFrames = 3;
+		FAudioFrameQueue Queue(32);
+
+		for (int32 i = 0; i < 2 * TargetFrames; ++i)
+		{
+			PushFrame(Queue, i);
+		}
+		TestEqual(TEXT("Twice the target, oldest frame delivered"), GetFrameIndex(Queue.Pull(TargetFrames)), 0);
+		TestEqual(TEXT("Twice the target, nothing dropped"), Queue.GetNumOverruns(), 0);
+		TestEqual(TEXT("Twice the target, size unchanged"), Queue.Num(), 2 * TargetFrames);
+		Queue.Pop();
+
+		// 5 queued, 3 more is 8, above the 6 allowed
+		for (int32 i = 2 * TargetFrames; i < 2 * TargetFrames + 3; ++i)
+		{
+			PushFrame(Queue, i);
+		}
+		TestEqual(TEXT("Overrun, newest frames kept"), GetFrameIndex(Queue.Pull(TargetFrames)), 6);
+		TestEqual(TEXT("Overrun, trimmed to the target"), Queue.Num(), TargetFrames);
+		TestEqual(TEXT("Overrun, each dropped frame counted"), Queue.GetNumOverruns(), 5);
+		TestEqual(TEXT("Overrun, no underrun"), Queue.GetNumUnderruns(), 0);
+		Queue.Pop();
+
+		TestEqual(TEXT("Overrun, delivery goes on in order"), GetFrameIndex(Queue.Pull(TargetFrames)), 7);
+		Queue.Pop();
+		TestEqual(TEXT("Overrun, last frame"), GetFrameIndex(Queue.Pull(TargetFrames)), 8);
+		Queue.Pop();
+		TestEqual(TEXT("Overrun, nothing more dropped"), Queue.GetNumOverruns(), 5);
+
+		Queue.Reset();
+		TestEqual(TEXT("Reset, overruns cleared"), Queue.GetNumOverruns(), 0);
+	}
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,214 @@
+// Copyright Dolby.io 2023. All Rights Reserved.
+
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "Media/AudioFrameRingBuffer.h"
+
+#include "Math/RandomStream.h"
+
+namespace Millicast::Publisher
+{
+
+namespace
+{
+	using FSample = FAudioFrameRingBuffer::FSample;
+
+	constexpr int32 SampleRate = 48000;
+	constexpr int32 FrameMs = 10;
+
+	/** Writes a capture callback as AudioCapturerBase::WriteFrames does, handing every complete frame to OnFrame as soon as it is */
+	template<typename FrameFunc>
+	void WriteCallback(FAudioFrameRingBuffer& Ring, const FSample* Audio, int32 NumFrames, int32 NumChannels, FrameFunc&& OnFrame)
+	{
+		while (NumFrames > 0)
+		{
+			int32 SpanSamples = 0;
+			FSample* Span = Ring.GetWriteSpan(SpanSamples);
+
+			const int32 Count = FMath::Min(SpanSamples / NumChannels, NumFrames);
+			FMemory::Memcpy(Span, Audio, Count * NumChannels * sizeof(FSample));
+			Ring.Commit(Count * NumChannels);
+
+			Audio += Count * NumChannels;
+			NumFrames -= Count;
+
+			while (const FSample* Frame = Ring.PeekFrame())
+			{
+				OnFrame(Frame);
+				Ring.PopFrame();
+			}
+		}
+	}
+
+	/** The previous framing: append the callback to an array and shift it down after each frame */
+	template<typename FrameFunc>
+	void WriteCallbackShifting(TArray<FSample>& Buffer, int32 FrameSamples, const FSample* Audio, int32 NumSamples, FrameFunc&& OnFrame)
+	{
+		Buffer.Append(Audio, NumSamples);
+		while (Buffer.Num() >= FrameSamples)
+		{
+			OnFrame(Buffer.GetData());
+			Buffer.RemoveAt(0, FrameSamples, false);
+		}
+	}
+
+	/** A counter as audio, wrapping at the int16 range, so that any lost, duplicated or reordered sample shows */
+	TArray<FSample> MakeRamp(int32 NumSamples, int32 Start = 0)
+	{
+		TArray<FSample> Ramp;
+		Ramp.SetNumUninitialized(NumSamples);
+		for (int32 i = 0; i < NumSamples; ++i)
+		{
+			Ramp[i] = static_cast<FSample>(static_cast<uint16>(Start + i));
+		}
+		return Ramp;
+	}
+}
+
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FMillicastAudioFrameRingBufferTest, "Millicast.Publisher.Media.AudioFrameRingBuffer",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FMillicastAudioFrameRingBufferTest::RunTest(const FString& Parameters)
+{
+	using namespace Millicast::Publisher;
+
+	FRandomStream Random(0x41);
+
+	for (const int32 NumChannels : { 1, 2, 6, 8 })
+	{
+		const int32 FrameSamples = SampleRate * FrameMs / 1000 * NumChannels;
+		const TArray<FSample> Input = MakeRamp(FrameSamples * 200 + 123 * NumChannels);
+
+		for (const int32 NumRingFrames : { 2, 3, 4 })
+		{
+			FAudioFrameRingBuffer Ring;
+			Ring.Init(FrameSamples, NumRingFrames);
+			TestEqual(TEXT("Empty after Init"), Ring.GetNumSamples(), 0);
+			TestNull(TEXT("No frame after Init"), Ring.PeekFrame());
+
+			// Callbacks of any size, from a single sample frame to several audio frames at once
+			int32 Written = 0;
+			int32 Read = 0;
+			bool bInOrder = true;
+
+			while (Written < Input.Num())
+			{
+				const int32 MaxCallbackFrames = Random.RandHelper(3) == 0 ? 8 : 4 * SampleRate * FrameMs / 1000;
+				const int32 CallbackFrames = FMath::Min(1 + Random.RandHelper(MaxCallbackFrames), (Input.Num() - Written) / NumChannels);
+
+				WriteCallback(Ring, Input.GetData() + Written, CallbackFrames, NumChannels, [&](const FSample* Frame)
+				{
+					bInOrder &= FMemory::Memcmp(Frame, Input.GetData() + Read, FrameSamples * sizeof(FSample)) == 0;
+					Read += FrameSamples;
+				});
+
+				Written += CallbackFrames * NumChannels;
+			}
+
+			const FString What = FString::Printf(TEXT("%d channels in %d frames"), NumChannels, NumRingFrames);
+			TestTrue(What + TEXT(", frames read in order"), bInOrder);
+			TestEqual(What + TEXT(", every complete frame read"), Read, Input.Num() / FrameSamples * FrameSamples);
+			TestEqual(What + TEXT(", incomplete frame left"), Ring.GetNumSamples(), Input.Num() - Read);
+			TestNull(What + TEXT(", no complete frame left"), Ring.PeekFrame());
+		}
+	}
+
+	// The write span never overlaps a frame not read yet, and stops at the end of the buffer
+	{
+		constexpr int32 FrameSamples = 8;
+		FAudioFrameRingBuffer Ring;
+		Ring.Init(FrameSamples, 2);
+
+		int32 SpanSamples = 0;
+		FSample* Start = Ring.GetWriteSpan(SpanSamples);
+		TestEqual(TEXT("Whole buffer free"), SpanSamples, 2 * FrameSamples);
+
+		Ring.Commit(2 * FrameSamples);
+		Ring.GetWriteSpan(SpanSamples);
+		TestEqual(TEXT("Full buffer"), SpanSamples, 0);
+
+		const FSample* Frame = Ring.PeekFrame();
+		TestTrue(TEXT("First frame at the start"), Frame == Start);
+		Ring.PopFrame();
+		FSample* Span = Ring.GetWriteSpan(SpanSamples);
+		TestTrue(TEXT("Free frame reused at the start"), Span == Start && SpanSamples == FrameSamples);
+
+		Ring.Commit(3);
+		Ring.PopFrame();
+		Span = Ring.GetWriteSpan(SpanSamples);
+		TestTrue(TEXT("Span runs to the end after a partial write"), Span == Start + 3 && SpanSamples == 2 * FrameSamples - 3);
+
+		Ring.Commit(FrameSamples);
+		TestTrue(TEXT("Frame straddling the write spans"), Ring.PeekFrame() == Start);
+		Ring.PopFrame();
+		Span = Ring.GetWriteSpan(SpanSamples);
+		TestTrue(TEXT("Span stops at the end of the buffer"), Span == Start + FrameSamples + 3 && SpanSamples == FrameSamples - 3);
+
+		Ring.Commit(FrameSamples - 3);
+		TestTrue(TEXT("Last frame read in place"), Ring.PeekFrame() == Start + FrameSamples);
+		Ring.PopFrame();
+
+		Ring.Reset();
+		Span = Ring.GetWriteSpan(SpanSamples);
+		TestTrue(TEXT("Reset empties the buffer"), Span == Start && SpanSamples == 2 * FrameSamples && Ring.PeekFrame() == nullptr);
+	}
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FMillicastAudioFrameRingBufferBenchmark, "Millicast.Publisher.Benchmark.AudioFrameRingBuffer",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+
+bool FMillicastAudioFrameRingBufferBenchmark::RunTest(const FString& Parameters)
+{
+	using namespace Millicast::Publisher;
+
+	// Ten minutes of audio per callback size
+	constexpr int32 NumSeconds = 600;
+
+	for (const int32 NumChannels : { 2, 8 })
+	{
+		const int32 FrameSamples = SampleRate * FrameMs / 1000 * NumChannels;
+
+		// Common device and engine buffer sizes, 441 and 480 being 10 ms at 44.1 and 48 kHz
+		for (const int32 CallbackFrames : { 256, 441, 480, 512, 1024, 2048 })
+		{
+			const TArray<FSample> Callback = MakeRamp(CallbackFrames * NumChannels);
+			const int32 NumCallbacks = NumSeconds * SampleRate / CallbackFrames;
+
+			int64 Checksum = 0;
+			int64 ShiftingChecksum = 0;
+
+			FAudioFrameRingBuffer Ring;
+			Ring.Init(FrameSamples);
+
+			uint64 StartCycles = FPlatformTime::Cycles64();
+			for (int32 i = 0; i < NumCallbacks; ++i)
+			{
+				WriteCallback(Ring, Callback.GetData(), CallbackFrames, NumChannels, [&Checksum](const FSample* Frame) { Checksum += Frame[0]; });
+			}
+			const double RingMs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles);
+
+			TArray<FSample> Buffer;
+			StartCycles = FPlatformTime::Cycles64();
+			for (int32 i = 0; i < NumCallbacks; ++i)
+			{
+				WriteCallbackShifting(Buffer, FrameSamples, Callback.GetData(), Callback.Num(), [&ShiftingChecksum](const FSample* Frame) { ShiftingChecksum += Frame[0]; });
+			}
+			const double ShiftingMs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles);
+
+			TestEqual(FString::Printf(TEXT("%d channels, %d frames per callback, same frames"), NumChannels, CallbackFrames), Checksum, ShiftingChecksum);
+
+			AddInfo(FString::Printf(TEXT("%d channels, %d frames per callback: ring %.1f ns per callback, shifting array %.1f ns (x%.1f)"),
+				NumChannels, CallbackFrames, RingMs * 1e6 / NumCallbacks, ShiftingMs * 1e6 / NumCallbacks, ShiftingMs / FMath::Max(RingMs, 0.001)));
+		}
+	}
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,299 @@
+// Copyright Dolby.io 2023. All Rights Reserved.
+
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "Media/AudioSampleConversion.h"
+
+#include "Math/RandomStream.h"
+
+#include <cmath>
+#include <limits>
+
+namespace Millicast::Publisher
+{
+
+namespace
+{
+	// Not a multiple of the vector width, the scalar tail runs too
+	constexpr int32 NumFrames = 480 + 7;
+
+	/** What a sample converts to, as documented */
+	int16 ExpectedS16(float Value)
+	{
+		float Sample = FMath::Clamp(Value, -1.f, 1.f) * 32768.f;
+		Sample = FMath::Min(Sample, 32767.f);
+		return static_cast<int16>(Sample + std::copysign(0.5f, Sample));
+	}
+
+	/** Random audio overshooting full scale, with the values where the clamp, rounding and sign handling could differ */
+	TArray<float> MakeSamples(FRandomStream& Random, int32 NumSamples)
+	{
+		const float Specials[] = {
+			0.f, -0.f, 1.f, -1.f, std::nextafter(1.f, 2.f), std::nextafter(-1.f, -2.f),
+			0.5f / 32768.f, -0.5f / 32768.f, 1.5f / 32768.f, -1.5f / 32768.f, 32767.5f / 32768.f,
+			std::numeric_limits<float>::quiet_NaN(), -std::numeric_limits<float>::quiet_NaN(),
+			std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::infinity(),
+			std::numeric_limits<float>::denorm_min(), -std::numeric_limits<float>::denorm_min(),
+			std::numeric_limits<float>::max(), std::numeric_limits<float>::lowest()
+		};
+
+		TArray<float> Samples;
+		Samples.SetNumUninitialized(NumSamples);
+		for (float& Sample : Samples)
+		{
+			Sample = Random.RandHelper(8) == 0 ? Specials[Random.RandHelper(UE_ARRAY_COUNT(Specials))] : Random.FRandRange(-1.5f, 1.5f);
+		}
+		return Samples;
+	}
+
+	/** The scalar path: single frames are too short for the vector loops */
+	void FloatToS16Scalar(const float* Source, int32 Frames, int32 SourceChannels, int32 DestinationChannels, float Gain, int16* Destination)
+	{
+		for (int32 i = 0; i < Frames; ++i)
+		{
+			FloatToS16(Source + i * SourceChannels, 1, SourceChannels, DestinationChannels, Gain, Destination + i * DestinationChannels);
+		}
+	}
+
+	void MixFloatScalar(const float* Source, int32 Frames, int32 SourceChannels, int32 DestinationChannels, float Gain, float* Destination)
+	{
+		for (int32 i = 0; i < Frames; ++i)
+		{
+			MixFloat(Source + i * SourceChannels, 1, SourceChannels, DestinationChannels, Gain, Destination + i * DestinationChannels);
+		}
+	}
+
+	struct FLayout
+	{
+		int32 SourceChannels;
+		int32 DestinationChannels;
+	};
+
+	template<typename T>
+	bool IsBitExact(const TArray<T>& A, const TArray<T>& B)
+	{
+		return A.Num() == B.Num() && FMemory::Memcmp(A.GetData(), B.GetData(), A.Num() * sizeof(T)) == 0;
+	}
+
+	/** Same bits, or NaN on both sides: the payload of a NaN depends on operand order, which the compiler may swap */
+	bool IsBitExactOrNaN(const TArray<float>& A, const TArray<float>& B)
+	{
+		if (A.Num() != B.Num())
+		{
+			return false;
+		}
+
+		for (int32 i = 0; i < A.Num(); ++i)
+		{
+			const bool bBothNaN = FMath::IsNaN(A[i]) && FMath::IsNaN(B[i]);
+			if (!bBothNaN && FMemory::Memcmp(&A[i], &B[i], sizeof(float)) != 0)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FMillicastAudioSampleConversionTest, "Millicast.Publisher.Media.AudioSampleConversion",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FMillicastAudioSampleConversionTest::RunTest(const FString& Parameters)
+{
+	using namespace Millicast::Publisher;
+
+	// Conversion of single values, NaN takes the upper bound like FMath::Clamp
+	{
+		struct FCase
+		{
+			float Value;
+			int16 Expected;
+		};
+
+		const FCase Cases[] = {
+			{ 0.f, 0 }, { -0.f, 0 }, { 1.f, 32767 }, { -1.f, -32768 }, { 2.f, 32767 }, { -2.f, -32768 },
+			{ 0.5f / 32768.f, 1 }, { -0.5f / 32768.f, -1 }, { 0.49f / 32768.f, 0 }, { -0.49f / 32768.f, 0 },
+			{ std::numeric_limits<float>::quiet_NaN(), 32767 }, { -std::numeric_limits<float>::quiet_NaN(), 32767 },
+			{ std::numeric_limits<float>::infinity(), 32767 }, { -std::numeric_limits<float>::infinity(), -32768 }
+		};
+
+		TArray<float> Source;
+		for (const FCase& Case : Cases)
+		{
+			Source.Add(Case.Value);
+		}
+
+		TArray<int16> Vector;
+		Vector.SetNumZeroed(Source.Num());
+		FloatToS16(Source.GetData(), Source.Num(), 1, 1, 1.f, Vector.GetData());
+
+		for (int32 i = 0; i < Source.Num(); ++i)
+		{
+			TArray<int16> Scalar;
+			Scalar.SetNumZeroed(1);
+			FloatToS16Scalar(&Source[i], 1, 1, 1, 1.f, Scalar.GetData());
+
+			const FString What = FString::Printf(TEXT("%g"), Source[i]);
+			TestEqual(What + TEXT(" documented conversion"), static_cast<int32>(ExpectedS16(Source[i])), static_cast<int32>(Cases[i].Expected));
+			TestEqual(What + TEXT(" scalar conversion"), static_cast<int32>(Scalar[0]), static_cast<int32>(Cases[i].Expected));
+			TestEqual(What + TEXT(" vector conversion"), static_cast<int32>(Vector[i]), static_cast<int32>(Cases[i].Expected));
+		}
+	}
+
+	// The vector code matches the scalar one bit for bit, for every remix, gain and alignment
+	FRandomStream Random(0x42);
+	const FLayout Layouts[] = { { 1, 1 }, { 2, 2 }, { 6, 6 }, { 8, 8 }, { 1, 2 }, { 2, 1 } };
+	const float Gains[] = { 1.f, 0.f, DbToGain(-6.f), DbToGain(12.f), 3.f };
+
+	for (const FLayout& Layout : Layouts)
+	{
+		const int32 SourceChannels = Layout.SourceChannels;
+		const int32 DestinationChannels = Layout.DestinationChannels;
+
+		for (const float Gain : Gains)
+		{
+			for (int32 Offset = 0; Offset < 4; ++Offset)
+			{
+				// Offsetting the start misaligns the vector loads and stores
+				const TArray<float> Samples = MakeSamples(Random, (NumFrames + Offset) * SourceChannels);
+				const float* Source = Samples.GetData() + Offset * SourceChannels;
+				const FString What = FString::Printf(TEXT("%d to %d channels, gain %g, offset %d"), SourceChannels, DestinationChannels, Gain, Offset);
+
+				TArray<int16> Vector, Scalar;
+				Vector.SetNumZeroed(NumFrames * DestinationChannels + Offset);
+				Scalar.SetNumZeroed(NumFrames * DestinationChannels + Offset);
+				FloatToS16(Source, NumFrames, SourceChannels, DestinationChannels, Gain, Vector.GetData() + Offset);
+				FloatToS16Scalar(Source, NumFrames, SourceChannels, DestinationChannels, Gain, Scalar.GetData() + Offset);
+				TestTrue(What + TEXT(", FloatToS16 bit exact"), IsBitExact(Vector, Scalar));
+
+				TArray<float> VectorMix;
+				VectorMix.SetNumUninitialized(NumFrames * DestinationChannels + Offset);
+				for (float& Sample : VectorMix)
+				{
+					Sample = Random.FRandRange(-1.f, 1.f);
+				}
+				TArray<float> ScalarMix = VectorMix;
+				MixFloat(Source, NumFrames, SourceChannels, DestinationChannels, Gain, VectorMix.GetData() + Offset);
+				MixFloatScalar(Source, NumFrames, SourceChannels, DestinationChannels, Gain, ScalarMix.GetData() + Offset);
+				TestTrue(What + TEXT(", MixFloat bit exact"), IsBitExactOrNaN(VectorMix, ScalarMix));
+			}
+		}
+	}
+
+	// Integer PCM to float, every S16 value and random S32 ones
+	{
+		TArray<int16> S16;
+		for (int32 Value = -32768; Value <= 32767; ++Value)
+		{
+			S16.Add(static_cast<int16>(Value));
+		}
+
+		TArray<float> Vector, Scalar;
+		Vector.SetNumZeroed(S16.Num());
+		Scalar.SetNumZeroed(S16.Num());
+		S16ToFloat(S16.GetData(), S16.Num(), Vector.GetData());
+		for (int32 i = 0; i < S16.Num(); ++i)
+		{
+			S16ToFloat(&S16[i], 1, &Scalar[i]);
+		}
+		TestTrue(TEXT("S16ToFloat bit exact"), IsBitExact(Vector, Scalar));
+		TestEqual(TEXT("S16 lowest"), Vector[0], -1.f);
+
+		TArray<int32> S32;
+		for (int32 i = 0; i < NumFrames; ++i)
+		{
+			S32.Add(i < 2 ? (i == 0 ? MIN_int32 : MAX_int32) : static_cast<int32>(Random.GetUnsignedInt()));
+		}
+
+		Vector.SetNumZeroed(S32.Num());
+		Scalar.SetNumZeroed(S32.Num());
+		S32ToFloat(S32.GetData(), S32.Num(), Vector.GetData());
+		for (int32 i = 0; i < S32.Num(); ++i)
+		{
+			S32ToFloat(&S32[i], 1, &Scalar[i]);
+		}
+		TestTrue(TEXT("S32ToFloat bit exact"), IsBitExact(Vector, Scalar));
+
+		// Back to S16 unchanged
+		TArray<int16> RoundTrip;
+		RoundTrip.SetNumZeroed(S16.Num());
+		Vector.SetNumZeroed(S16.Num());
+		S16ToFloat(S16.GetData(), S16.Num(), Vector.GetData());
+		FloatToS16(Vector.GetData(), S16.Num(), 1, 1, 1.f, RoundTrip.GetData());
+		TestTrue(TEXT("S16 round trip"), IsBitExact(RoundTrip, S16));
+	}
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FMillicastAudioSampleConversionBenchmark, "Millicast.Publisher.Benchmark.AudioSampleConversion",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+
+bool FMillicastAudioSampleConversionBenchmark::RunTest(const FString& Parameters)
+{
+	using namespace Millicast::Publisher;
+
+	// Ten minutes of 10 ms frames
+	constexpr int32 NumIterations = 60000;
+	constexpr int32 FrameFrames = 480;
+
+	FRandomStream Random(0x42);
+	const FLayout Layouts[] = { { 2, 2 }, { 1, 2 }, { 2, 1 }, { 8, 8 } };
+
+	for (const FLayout& Layout : Layouts)
+	{
+		const int32 SourceChannels = Layout.SourceChannels;
+		const int32 DestinationChannels = Layout.DestinationChannels;
+
+		TArray<float> Source;
+		Source.SetNumUninitialized(FrameFrames * SourceChannels);
+		for (float& Sample : Source)
+		{
+			Sample = Random.FRandRange(-1.2f, 1.2f);
+		}
+
+		TArray<int16> Destination;
+		Destination.SetNumZeroed(FrameFrames * DestinationChannels);
+		TArray<float> MixDestination;
+		MixDestination.SetNumZeroed(FrameFrames * DestinationChannels);
+		const float Gain = DbToGain(-3.f);
+		int64 Checksum = 0;
+
+		uint64 StartCycles = FPlatformTime::Cycles64();
+		for (int32 i = 0; i < NumIterations; ++i)
+		{
+			FloatToS16(Source.GetData(), FrameFrames, SourceChannels, DestinationChannels, Gain, Destination.GetData());
+			Checksum += Destination[i % Destination.Num()];
+		}
+		const double VectorMs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles);
+
+		StartCycles = FPlatformTime::Cycles64();
+		for (int32 i = 0; i < NumIterations; ++i)
+		{
+			FloatToS16Scalar(Source.GetData(), FrameFrames, SourceChannels, DestinationChannels, Gain, Destination.GetData());
+			Checksum -= Destination[i % Destination.Num()];
+		}
+		const double ScalarMs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles);
+
+		StartCycles = FPlatformTime::Cycles64();
+		for (int32 i = 0; i < NumIterations; ++i)
+		{
+			MixFloat(Source.GetData(), FrameFrames, SourceChannels, DestinationChannels, Gain, MixDestination.GetData());
+		}
+		const double MixMs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles);
+
+		TestEqual(FString::Printf(TEXT("%d to %d channels, same output"), SourceChannels, DestinationChannels), Checksum, static_cast<int64>(0));
+
+		AddInfo(FString::Printf(TEXT("%d to %d channels, 10 ms frame: FloatToS16 %.2f us, scalar %.2f us (x%.1f), MixFloat %.2f us"),
+			SourceChannels, DestinationChannels, VectorMs * 1000.0 / NumIterations, ScalarMs * 1000.0 / NumIterations,
+			ScalarMs / FMath::Max(VectorMs, 0.001), MixMs * 1000.0 / NumIterations));
+	}
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,186 @@
+// Copyright Dolby.io 2023. All Rights Reserved.
+
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "Media/AudioSinkList.h"
+
+#include "Async/Async.h"
+#include "Math/RandomStream.h"
+
+namespace Millicast::Publisher
+{
+
+namespace
+{
+	constexpr int32 NumWriters = 4;
+	constexpr int32 NumCycles = 2000;
+	constexpr int32 NumPermanentSinks = 3;
+
+	/** Counts its calls, and the calls it gets once its writer was told it is removed */
+	class FTestSink : public webrtc::AudioTrackSinkInterface
+	{
+	public:
+		void OnData(const void* AudioData, int BitsPerSample, int SampleRate, size_t NumberOfChannels, size_t NumberOfFrames) override
+		{
+			const bool bRemovedBefore = bRemoved;
+
+			// Some work, as a sink encoding the frame, widens the window a writer could free the list in
+			for (int32 i = 0; i < 64; ++i)
+			{
+				Work = Work * 31 + i;
+			}
+
+			if (bRemovedBefore || bRemoved)
+			{
+				++CallsAfterRemove;
+			}
+			++Calls;
+		}
+
+		TAtomic<bool> bRemoved { false };
+		TAtomic<int32> Calls { 0 };
+		TAtomic<int32> CallsAfterRemove { 0 };
+		uint32 Work = 0;
+	};
+}
+
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FMillicastAudioSinkListTest, "Millicast.Publisher.Media.AudioSinkList",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FMillicastAudioSinkListTest::RunTest(const FString& Parameters)
+{
+	using namespace Millicast::Publisher;
+
+	// Adding twice keeps a single entry, removing a sink not in the list does nothing
+	{
+		FAudioSinkList Sinks;
+		FTestSink Sink;
+		FTestSink Other;
+
+		int32 NumCalls = 0;
+		Sinks.ForEach([&NumCalls](FAudioSinkList::FSink*) { ++NumCalls; });
+		TestEqual(TEXT("Empty list"), NumCalls, 0);
+
+		Sinks.Add(&Sink);
+		Sinks.Add(&Sink);
+		Sinks.Remove(&Other);
+		Sinks.ForEach([&NumCalls](FAudioSinkList::FSink*) { ++NumCalls; });
+		TestEqual(TEXT("Added once"), NumCalls, 1);
+
+		Sinks.Remove(&Sink);
+		Sinks.ForEach([&NumCalls](FAudioSinkList::FSink*) { ++NumCalls; });
+		TestEqual(TEXT("Removed"), NumCalls, 1);
+	}
+
+	// One reader delivering frames as fast as it can while several writers add and remove sinks
+	FAudioSinkList Sinks;
+	FTestSink PermanentSinks[NumPermanentSinks];
+	for (FTestSink& Sink : PermanentSinks)
+	{
+		Sinks.Add(&Sink);
+	}
+
+	TAtomic<bool> bStop { false };
+	TAtomic<int32> NumPasses { 0 };
+	TAtomic<int32> NumBadPasses { 0 };
+
+	TFuture<void> Reader = Async(EAsyncExecution::Thread, [&Sinks, &bStop, &NumPasses, &NumBadPasses, &PermanentSinks]()
+	{
+		const int16 Frame[480 * 2] = {};
+		while (!bStop)
+		{
+			int32 NumPermanentCalls = 0;
+			Sinks.ForEach([&Frame, &NumPermanentCalls, &PermanentSinks](FAudioSinkList::FSink* Sink)
+			{
+				Sink->OnData(Frame, 16, 48000, 2, 480);
+				NumPermanentCalls += Sink >= &PermanentSinks[0] && Sink < &PermanentSinks[NumPermanentSinks];
+			});
+
+			// The sinks present throughout are called once on every frame, whatever the writers do
+			if (NumPermanentCalls != NumPermanentSinks)
+			{
+				++NumBadPasses;
+			}
+			++NumPasses;
+		}
+	});
+
+	TArray<TUniquePtr<FTestSink>> WriterSinks[NumWriters];
+	TArray<TFuture<double>> Writers;
+	for (int32 Writer = 0; Writer < NumWriters; ++Writer)
+	{
+		TArray<TUniquePtr<FTestSink>>& Owned = WriterSinks[Writer];
+		Writers.Add(Async(EAsyncExecution::Thread, [&Sinks, &Owned, Writer]()
+		{
+			FRandomStream Random(0x50 + Writer);
+			double MaxRemoveMs = 0.0;
+
+			for (int32 Cycle = 0; Cycle < NumCycles; ++Cycle)
+			{
+				FTestSink* Sink = Owned.Add_GetRef(MakeUnique<FTestSink>()).Get();
+				Sinks.Add(Sink);
+
+				// Give the reader a chance to call it, or not
+				if (Random.RandHelper(4) == 0)
+				{
+					FPlatformProcess::Sleep(0.0f);
+				}
+				else
+				{
+					for (int32 i = Random.RandHelper(100); i > 0; --i)
+					{
+						FPlatformProcess::Yield();
+					}
+				}
+
+				const uint64 StartCycles = FPlatformTime::Cycles64();
+				Sinks.Remove(Sink);
+				MaxRemoveMs = FMath::Max(MaxRemoveMs, FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles));
+
+				// From here on webrtc may destroy the sink
+				Sink->bRemoved = true;
+			}
+
+			return MaxRemoveMs;
+		}));
+	}
+
+	double MaxRemoveMs = 0.0;
+	for (TFuture<double>& Writer : Writers)
+	{
+		MaxRemoveMs = FMath::Max(MaxRemoveMs, Writer.Get());
+	}
+
+	bStop = true;
+	Reader.Wait();
+
+	int32 CallsAfterRemove = 0;
+	int32 CalledSinks = 0;
+	for (const TArray<TUniquePtr<FTestSink>>& Owned : WriterSinks)
+	{
+		for (const TUniquePtr<FTestSink>& Sink : Owned)
+		{
+			CallsAfterRemove += Sink->CallsAfterRemove;
+			CalledSinks += Sink->Calls > 0;
+		}
+	}
+
+	TestEqual(TEXT("No sink called once removed"), CallsAfterRemove, 0);
+	TestEqual(TEXT("Permanent sinks called once per frame"), NumBadPasses.Load(), 0);
+	TestTrue(TEXT("Added sinks called"), CalledSinks > 0);
+	for (const FTestSink& Sink : PermanentSinks)
+	{
+		TestEqual(TEXT("Permanent sink called on every frame"), Sink.Calls.Load(), NumPasses.Load());
+	}
+
+	AddInfo(FString::Printf(TEXT("%d frames delivered, %d of %d added sinks called, Remove took %.3f ms at most"),
+		NumPasses.Load(), CalledSinks, NumWriters * NumCycles, MaxRemoveMs));
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,223 @@
+// Copyright Dolby.io 2023. All Rights Reserved.
+
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "Media/AudioStreamResampler.h"
+
+#include "Math/RandomStream.h"
+
+#include <cmath>
+
+namespace Millicast::Publisher
+{
+
+namespace
+{
+	constexpr int32 TargetRate = 48000;
+	constexpr int32 NumChannels = 2;
+	constexpr double Amplitude = 0.5;
+	constexpr double TwoPi = 6.283185307179586;
+
+	// The start holds the latency of the resampler and the fade in of its filter
+	constexpr int32 SettleFrames = TargetRate / 50;
+
+	/** A tone per channel, interleaved */
+	TArray<float> MakeTones(int32 Rate, int32 NumFrames, const double* Frequencies)
+	{
+		TArray<float> Audio;
+		Audio.SetNumUninitialized(NumFrames * NumChannels);
+		for (int32 i = 0; i < NumFrames; ++i)
+		{
+			for (int32 Channel = 0; Channel < NumChannels; ++Channel)
+			{
+				Audio[i * NumChannels + Channel] = static_cast<float>(Amplitude * std::sin(TwoPi * Frequencies[Channel] * i / Rate));
+			}
+		}
+		return Audio;
+	}
+
+	/** Feeds the audio in callbacks of random sizes, as the capture paths do, and gathers the output */
+	TArray<float> Resample(FAudioStreamResampler& Resampler, const TArray<float>& Audio, FRandomStream* Random)
+	{
+		TArray<float> Output;
+		const int32 NumFrames = Audio.Num() / NumChannels;
+
+		for (int32 Frame = 0; Frame < NumFrames;)
+		{
+			const int32 Count = Random ? FMath::Min(1 + Random->RandHelper(2048), NumFrames - Frame) : NumFrames;
+			Resampler.Process(Audio.GetData() + Frame * NumChannels, Count, [&Output](const float* Data, int32 OutputFrames)
+			{
+				Output.Append(Data, OutputFrames * NumChannels);
+			});
+			Frame += Count;
+		}
+
+		return Output;
+	}
+
+	struct FToneFit
+	{
+		double Amplitude = 0.0;
+		double SnrDb = 0.0;
+	};
+
+	/** Least squares fit of a tone of known frequency to a channel after the settling time, the rest is noise and distortion */
+	FToneFit FitTone(const TArray<float>& Audio, int32 Channel, double Frequency)
+	{
+		double SS = 0.0, CC = 0.0, SC = 0.0, XS = 0.0, XC = 0.0, XX = 0.0;
+		const int32 NumFrames = Audio.Num() / NumChannels;
+		for (int32 i = SettleFrames; i < NumFrames; ++i)
+		{
+			const double Phase = TwoPi * Frequency * i / TargetRate;
+			const double S = std::sin(Phase);
+			const double C = std::cos(Phase);
+			const double X = Audio[i * NumChannels + Channel];
+			SS += S * S; CC += C * C; SC += S * C;
+			XS += X * S; XC += X * C; XX += X * X;
+		}
+
+		const double Determinant = SS * CC - SC * SC;
+		const double A = (XS * CC - XC * SC) / Determinant;
+		const double B = (XC * SS - XS * SC) / Determinant;
+
+		// Residual energy of the fit, what the tone doesn't explain
+		const double Signal = A * XS + B * XC;
+		const double Noise = FMath::Max(XX - Signal, 1e-20);
+
+		FToneFit Fit;
+		Fit.Amplitude = FMath::Sqrt(A * A + B * B);
+		Fit.SnrDb = 10.0 * std::log10(Signal / Noise);
+		return Fit;
+	}
+}
+
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FMillicastAudioStreamResamplerTest, "Millicast.Publisher.Media.AudioStreamResampler",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FMillicastAudioStreamResamplerTest::RunTest(const FString& Parameters)
+{
+	using namespace Millicast::Publisher;
+
+	FRandomStream Random(0x43);
+
+	// Tones within the band of both rates, a different one per channel so that a channel mixup shows.
+	// The filter rolls off towards the Nyquist frequency, the higher tone is held to a lower SNR.
+	const int32 SourceRates[] = { 8000, 11025, 16000, 22050, 32000, 44100, 48000, 88200, 96000 };
+	const double MinSnrDb[NumChannels] = { 60.0, 40.0 };
+	for (const int32 SourceRate : SourceRates)
+	{
+		const double MaxFrequency = 0.4 * FMath::Min(SourceRate, TargetRate);
+		const double Frequencies[NumChannels] = { MaxFrequency / 8.0, MaxFrequency * 0.9 };
+		const TArray<float> Input = MakeTones(SourceRate, SourceRate, Frequencies);
+
+		FAudioStreamResampler Resampler(TargetRate);
+		if (!TestTrue(FString::Printf(TEXT("%d Hz supported"), SourceRate), Resampler.Configure(SourceRate, NumChannels)))
+		{
+			continue;
+		}
+
+		const TArray<float> Output = Resample(Resampler, Input, &Random);
+		TestEqual(FString::Printf(TEXT("%d Hz, one second out"), SourceRate), Output.Num(), TargetRate * NumChannels);
+
+		for (int32 Channel = 0; Channel < NumChannels; ++Channel)
+		{
+			const FString What = FString::Printf(TEXT("%d Hz, %.0f Hz tone"), SourceRate, Frequencies[Channel]);
+			const FToneFit Fit = FitTone(Output, Channel, Frequencies[Channel]);
+
+			TestTrue(What + FString::Printf(TEXT(", SNR above %.0f dB"), MinSnrDb[Channel]), Fit.SnrDb > MinSnrDb[Channel]);
+			TestTrue(What + TEXT(", level within 0.5 dB"), FMath::Abs(20.0 * std::log10(Fit.Amplitude / Amplitude)) < 0.5);
+			AddInfo(FString::Printf(TEXT("%s: SNR %.1f dB"), *What, Fit.SnrDb));
+		}
+
+		// The state carries over between callbacks: any split of the input gives the same output as a single call
+		FAudioStreamResampler Reference(TargetRate);
+		Reference.Configure(SourceRate, NumChannels);
+		const TArray<float> ReferenceOutput = Resample(Reference, Input, nullptr);
+		TestTrue(FString::Printf(TEXT("%d Hz, independent of the callback sizes"), SourceRate),
+			ReferenceOutput.Num() == Output.Num() && FMemory::Memcmp(ReferenceOutput.GetData(), Output.GetData(), Output.Num() * sizeof(float)) == 0);
+	}
+
+	// Rates without a whole number of frames in 10 ms are converted by longer chunks, still output 10 ms at a time
+	{
+		FAudioStreamResampler Resampler(TargetRate);
+		TestTrue(TEXT("11025 Hz supported"), Resampler.Configure(11025, NumChannels));
+
+		const double Frequencies[NumChannels] = { 1000.0, 1000.0 };
+		const TArray<float> Input = MakeTones(11025, 441, Frequencies);
+		TArray<int32> OutputSizes;
+		Resampler.Process(Input.GetData(), 440, [&OutputSizes](const float*, int32 NumFrames) { OutputSizes.Add(NumFrames); });
+		TestEqual(TEXT("11025 Hz, nothing out before 40 ms are gathered"), OutputSizes.Num(), 0);
+		Resampler.Process(Input.GetData() + 440 * NumChannels, 1, [&OutputSizes](const float*, int32 NumFrames) { OutputSizes.Add(NumFrames); });
+		TestTrue(TEXT("11025 Hz, 40 ms out in 10 ms pieces"), OutputSizes == TArray<int32>({ TargetRate / 100, TargetRate / 100, TargetRate / 100, TargetRate / 100 }));
+	}
+
+	// Rates without a whole number of frames in 100 ms are refused, a new format starts over
+	{
+		FAudioStreamResampler Resampler(TargetRate);
+		AddExpectedError(TEXT("Can't resample"), EAutomationExpectedErrorFlags::Contains, 2);
+		TestFalse(TEXT("44056 Hz refused"), Resampler.Configure(44056, NumChannels));
+		TestFalse(TEXT("No rate refused"), Resampler.Configure(0, NumChannels));
+		TestTrue(TEXT("Supported after a refused rate"), Resampler.Configure(44100, NumChannels));
+
+		int32 NumOutputs = 0;
+		const double Frequencies[NumChannels] = { 1000.0, 1000.0 };
+		const TArray<float> Input = MakeTones(44100, 441, Frequencies);
+		Resampler.Process(Input.GetData(), 441 / 2, [&NumOutputs](const float*, int32) { ++NumOutputs; });
+
+		TestTrue(TEXT("Same format kept"), Resampler.Configure(44100, NumChannels));
+		TestTrue(TEXT("New format"), Resampler.Configure(32000, NumChannels));
+		Resampler.Process(Input.GetData(), 320 - 1, [&NumOutputs](const float*, int32) { ++NumOutputs; });
+		TestEqual(TEXT("Partial chunk dropped on a format change"), NumOutputs, 0);
+	}
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FMillicastAudioStreamResamplerBenchmark, "Millicast.Publisher.Benchmark.AudioStreamResampler",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+
+bool FMillicastAudioStreamResamplerBenchmark::RunTest(const FString& Parameters)
+{
+	using namespace Millicast::Publisher;
+
+	constexpr int32 NumSeconds = 60;
+
+	// 512 frames being a common device and submix buffer
+	constexpr int32 CallbackFrames = 512;
+
+	for (const int32 SourceRate : { 44100, 96000, 16000 })
+	{
+		const double Frequencies[NumChannels] = { 440.0, 1000.0 };
+		const TArray<float> Input = MakeTones(SourceRate, SourceRate, Frequencies);
+		const int32 InputFrames = Input.Num() / NumChannels;
+
+		FAudioStreamResampler Resampler(TargetRate);
+		Resampler.Configure(SourceRate, NumChannels);
+
+		int64 OutputFrames = 0;
+		const uint64 StartCycles = FPlatformTime::Cycles64();
+		for (int32 Second = 0; Second < NumSeconds; ++Second)
+		{
+			for (int32 Frame = 0; Frame + CallbackFrames <= InputFrames; Frame += CallbackFrames)
+			{
+				Resampler.Process(Input.GetData() + Frame * NumChannels, CallbackFrames, [&OutputFrames](const float*, int32 NumFrames) { OutputFrames += NumFrames; });
+			}
+		}
+		const double ElapsedMs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles);
+		const double AudioMs = OutputFrames * 1000.0 / TargetRate;
+
+		// The capture thread has 10 ms for each 10 ms, resampling must take a small part of it
+		TestTrue(FString::Printf(TEXT("%d Hz, faster than 20 times real time"), SourceRate), ElapsedMs * 20.0 < AudioMs);
+
+		AddInfo(FString::Printf(TEXT("%d Hz to %d Hz stereo: %.2f us per 10 ms, %.0f times real time"),
+			SourceRate, TargetRate, ElapsedMs * 1000.0 / (AudioMs / 10.0), AudioMs / FMath::Max(ElapsedMs, 0.001)));
+	}
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,143 @@
+// Copyright Dolby.io 2023. All Rights Reserved.
+
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "WebRTC/SimulcastEncoderFactory.h"
+#include "WebRTC/Texture2DVideoSourceAdapter.h"
+
+namespace Millicast::Publisher
+{
+
+namespace
+{
+	constexpr int32 Width = 1920;
+	constexpr int32 Height = 1080;
+	constexpr int32 MinBitrateBps = 300'000;
+	constexpr int32 MaxBitrateBps = 4'000'000;
+	constexpr int32 MaxFramerate = 60;
+
+	bool WaitForWarmUp(const FWarmEncoderPool& Pool, int32 NumEncoders)
+	{
+		const double Deadline = FPlatformTime::Seconds() + 10.0;
+		while (Pool.GetNumEncoders() < NumEncoders && FPlatformTime::Seconds() < Deadline)
+		{
+			FPlatformProcess::Sleep(0.01f);
+		}
+		return Pool.GetNumEncoders() == NumEncoders;
+	}
+
+	/** The VP8 codec webrtc hands to InitEncode for a track it encodes as screen content */
+	webrtc::VideoCodec MakeScreenCodec(int32 NumStreams, int32 NumTemporalLayers)
+	{
+		webrtc::VideoCodec Codec;
+		Codec.codecType = webrtc::kVideoCodecVP8;
+		Codec.width = Width;
+		Codec.height = Height;
+		Codec.startBitrate = 1500;
+		Codec.minBitrate = MinBitrateBps / 1000;
+		Codec.maxBitrate = MaxBitrateBps / 1000;
+		Codec.maxFramerate = MaxFramerate;
+		Codec.qpMax = 56;
+		Codec.active = true;
+		Codec.mode = webrtc::VideoCodecMode::kScreensharing;
+		Codec.expect_encode_from_texture = true;
+
+		Codec.numberOfSimulcastStreams = NumStreams;
+		for (int32 i = 0; i < NumStreams; ++i)
+		{
+			webrtc::SimulcastStream& Stream = Codec.simulcastStream[i];
+			Stream.width = Width >> i;
+			Stream.height = Height >> i;
+			Stream.maxFramerate = MaxFramerate;
+			Stream.numberOfTemporalLayers = NumTemporalLayers;
+			Stream.minBitrate = Codec.minBitrate;
+			Stream.targetBitrate = Stream.maxBitrate = Codec.maxBitrate >> i;
+			Stream.qpMax = Codec.qpMax;
+			Stream.active = true;
+		}
+
+		*Codec.VP8() = webrtc::VideoEncoder::GetDefaultVp8Settings();
+		Codec.VP8()->numberOfTemporalLayers = NumTemporalLayers;
+		return Codec;
+	}
+}
+
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FMillicastContentHintTest, "Millicast.Publisher.WebRTC.ContentHint",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FMillicastContentHintTest::RunTest(const FString& Parameters)
+{
+	using namespace Millicast::Publisher;
+
+	// Detail content is a screencast and a detailed track, which is what makes webrtc encode it in screensharing mode
+	{
+		rtc::scoped_refptr<FTexture2DVideoSourceAdapter> Source = new rtc::RefCountedObject<FTexture2DVideoSourceAdapter>();
+		TestFalse(TEXT("Motion by default"), Source->is_screencast());
+		TestTrue(TEXT("Fluid track by default"), Source->GetTrackContentHint() == webrtc::VideoTrackInterface::ContentHint::kFluid);
+
+		Source->SetContentHint(EMillicastVideoContentHint::Detail);
+		TestTrue(TEXT("Detail, screencast"), Source->is_screencast());
+		TestTrue(TEXT("Detail, detailed track"), Source->GetTrackContentHint() == webrtc::VideoTrackInterface::ContentHint::kDetailed);
+
+		Source->SetContentHint(EMillicastVideoContentHint::Motion);
+		TestFalse(TEXT("Back to motion, not a screencast"), Source->is_screencast());
+		TestTrue(TEXT("Back to motion, fluid track"), Source->GetTrackContentHint() == webrtc::VideoTrackInterface::ContentHint::kFluid);
+	}
+
+	FSimulcastEncoderFactory Factory;
+	const webrtc::VideoEncoder::Settings Settings(webrtc::VideoEncoder::Capabilities(false), 2, 1200);
+
+	// The encoders warmed up for detail content are the ones a screensharing InitEncode uses
+	{
+		TSharedPtr<FWarmEncoderPool, ESPMode::ThreadSafe> Pool = Factory.WarmUp(TEXT("VP8"), Width, Height, {}, MinBitrateBps, MaxBitrateBps, MaxFramerate, true);
+		if (!TestTrue(TEXT("Screen content warmed up"), Pool.IsValid() && WaitForWarmUp(*Pool, 1)))
+		{
+			return true;
+		}
+
+		std::unique_ptr<webrtc::VideoEncoder> Encoder = Factory.CreateVideoEncoder(webrtc::SdpVideoFormat("VP8"));
+		const webrtc::VideoCodec Codec = MakeScreenCodec(1, 1);
+		TestEqual(TEXT("Screensharing initialized"), Encoder->InitEncode(&Codec, Settings), WEBRTC_VIDEO_CODEC_OK);
+		TestEqual(TEXT("Screen content warm encoder used"), Pool->GetNumEncoders(), 0);
+		Encoder->Release();
+	}
+
+	// Screen content simulcast streams have the two temporal layers webrtc gives them
+	{
+		const TArray<FMillicastSimulcastLayer> Layers = { FMillicastSimulcastLayer(TEXT("h"), 1.f), FMillicastSimulcastLayer(TEXT("l"), 2.f) };
+		TSharedPtr<FWarmEncoderPool, ESPMode::ThreadSafe> Pool = Factory.WarmUp(TEXT("VP8"), Width, Height, Layers, MinBitrateBps, MaxBitrateBps, MaxFramerate, true);
+		if (!TestTrue(TEXT("Screen content simulcast warmed up"), Pool.IsValid() && WaitForWarmUp(*Pool, Layers.Num())))
+		{
+			return true;
+		}
+
+		std::unique_ptr<webrtc::VideoEncoder> Encoder = Factory.CreateVideoEncoder(webrtc::SdpVideoFormat("VP8"));
+		const webrtc::VideoCodec Codec = MakeScreenCodec(Layers.Num(), 2);
+		TestEqual(TEXT("Screensharing simulcast initialized"), Encoder->InitEncode(&Codec, Settings), WEBRTC_VIDEO_CODEC_OK);
+		TestEqual(TEXT("Screen content warm encoder of every layer used"), Pool->GetNumEncoders(), 0);
+		Encoder->Release();
+	}
+
+	// Motion content encoders aren't used for screen content
+	{
+		TSharedPtr<FWarmEncoderPool, ESPMode::ThreadSafe> Pool = Factory.WarmUp(TEXT("VP8"), Width, Height, {}, MinBitrateBps, MaxBitrateBps, MaxFramerate, false);
+		if (!TestTrue(TEXT("Motion content warmed up"), Pool.IsValid() && WaitForWarmUp(*Pool, 1)))
+		{
+			return true;
+		}
+
+		std::unique_ptr<webrtc::VideoEncoder> Encoder = Factory.CreateVideoEncoder(webrtc::SdpVideoFormat("VP8"));
+		const webrtc::VideoCodec Codec = MakeScreenCodec(1, 1);
+		TestEqual(TEXT("Screensharing initialized with a new encoder"), Encoder->InitEncode(&Codec, Settings), WEBRTC_VIDEO_CODEC_OK);
+		TestEqual(TEXT("Motion content warm encoder kept"), Pool->GetNumEncoders(), 1);
+		Encoder->Release();
+	}
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,197 @@
+// Copyright Dolby.io 2023. All Rights Reserved.
+
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "WebRTC/EncodedFrameFanOut.h"
+#include "WebRTC/VideoEncoderPassthrough.h"
+
+namespace Millicast::Publisher
+{
+
+namespace
+{
+	constexpr int32 Width = 1280;
+	constexpr int32 Height = 720;
+
+	struct FReceivedImage
+	{
+		rtc::scoped_refptr<webrtc::EncodedImageBufferInterface> Data;
+		bool bKeyFrame;
+		int32 Width;
+	};
+
+	/*
+	 * The sending side of a destination peer connection, connected back to back with the fan-out:
+	 * its relay source feeds a passthrough encoder whose output is kept instead of being packetized.
+	 */
+	class FLoopbackPeer : public rtc::VideoSinkInterface<webrtc::VideoFrame>, public webrtc::EncodedImageCallback
+	{
+	public:
+		explicit FLoopbackPeer(FEncodedFrameFanOut::FDestinationPtr InDestination)
+			: Destination(MoveTemp(InDestination))
+		{
+			webrtc::VideoCodec Codec;
+			memset(&Codec, 0, sizeof(Codec));
+			Codec.codecType = webrtc::kVideoCodecVP8;
+			Codec.width = Width;
+			Codec.height = Height;
+
+			Encoder.InitEncode(&Codec, webrtc::VideoEncoder::Settings(webrtc::VideoEncoder::Capabilities(false), 1, 1200));
+			Encoder.RegisterEncodeCompleteCallback(this);
+
+			Destination->GetVideoSource()->AddOrUpdateSink(this, rtc::VideoSinkWants());
+		}
+
+		~FLoopbackPeer()
+		{
+			Destination->GetVideoSource()->RemoveSink(this);
+			Encoder.Release();
+		}
+
+		/** What webrtc allocates to the stream of this peer */
+		void SetBitrate(uint32 Bps)
+		{
+			webrtc::VideoBitrateAllocation Allocation;
+			Allocation.SetBitrate(0, 0, Bps);
+			Encoder.SetRates(webrtc::VideoEncoder::RateControlParameters(Allocation, 30.0));
+		}
+
+		// rtc::VideoSinkInterface
+		void OnFrame(const webrtc::VideoFrame& Frame) override
+		{
+			const std::vector<webrtc::VideoFrameType> FrameTypes { webrtc::VideoFrameType::kVideoFrameDelta };
+			Encoder.Encode(Frame, &FrameTypes);
+		}
+		// ~rtc::VideoSinkInterface
+
+		// webrtc::EncodedImageCallback
+#if WEBRTC_VERSION == 84
+		Result OnEncodedImage(const webrtc::EncodedImage& Image, const webrtc::CodecSpecificInfo* CodecInfo, const webrtc::RTPFragmentationHeader* Fragmentation) override
+#else
+		Result OnEncodedImage(const webrtc::EncodedImage& Image, const webrtc::CodecSpecificInfo* CodecInfo) override
+#endif
+		{
+			Received.Add({ Image.GetEncodedData(), Image._frameType == webrtc::VideoFrameType::kVideoFrameKey, static_cast<int32>(Image._encodedWidth) });
+			return Result(Result::OK);
+		}
+		// ~webrtc::EncodedImageCallback
+
+		FEncodedFrameFanOut::FDestinationPtr Destination;
+		FVideoEncoderPassthrough Encoder;
+		TArray<FReceivedImage> Received;
+	};
+
+	/** An image as the encoder of the publisher produces it, the payload only needs to be recognizable */
+	webrtc::EncodedImage MakeImage(bool bKeyFrame, int32 ImageWidth, uint8 Tag)
+	{
+		const uint8 Payload[] = { Tag, 0x9D, 0x01, 0x2A, Tag };
+
+		webrtc::EncodedImage Image;
+		Image.SetEncodedData(webrtc::EncodedImageBuffer::Create(Payload, sizeof(Payload)));
+		Image._frameType = bKeyFrame ? webrtc::VideoFrameType::kVideoFrameKey : webrtc::VideoFrameType::kVideoFrameDelta;
+		Image._encodedWidth = ImageWidth;
+		Image._encodedHeight = ImageWidth * Height / Width;
+		Image.capture_time_ms_ = rtc::TimeMillis();
+		return Image;
+	}
+}
+
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FMillicastEncodedFrameFanOutTest, "Millicast.Publisher.WebRTC.EncodedFrameFanOut",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FMillicastEncodedFrameFanOutTest::RunTest(const FString& Parameters)
+{
+	using namespace Millicast::Publisher;
+
+	FEncodedFrameFanOut FanOut;
+	TestFalse(TEXT("No destination"), FanOut.HasDestinations());
+
+	auto PeerA = MakeUnique<FLoopbackPeer>(FanOut.AddDestination());
+	auto PeerB = MakeUnique<FLoopbackPeer>(FanOut.AddDestination());
+	TestTrue(TEXT("Destinations added"), FanOut.HasDestinations());
+
+	// New destinations start with a key frame, requested once
+	TestTrue(TEXT("Key frame requested by the new destinations"), FanOut.ConsumeKeyFrameRequest(0, 1));
+	TestFalse(TEXT("Key frame request consumed"), FanOut.ConsumeKeyFrameRequest(0, 1));
+
+	// A delta before the first key frame can't be decoded, the peers drop it and ask again
+	FanOut.OnEncodedImage(0, 1, webrtc::kVideoCodecVP8, MakeImage(false, Width, 0));
+	TestEqual(TEXT("Delta dropped by peer A"), PeerA->Received.Num(), 0);
+	TestEqual(TEXT("Delta dropped by peer B"), PeerB->Received.Num(), 0);
+	TestTrue(TEXT("Key frame requested by the peers"), FanOut.ConsumeKeyFrameRequest(0, 1));
+
+	// One encode reaches both peers, sharing the same encoded data
+	TArray<rtc::scoped_refptr<webrtc::EncodedImageBufferInterface>> Sent;
+	for (int32 i = 0; i < 10; ++i)
+	{
+		const webrtc::EncodedImage Image = MakeImage(i == 0, Width, static_cast<uint8>(i + 1));
+		Sent.Add(Image.GetEncodedData());
+		FanOut.OnEncodedImage(0, 1, webrtc::kVideoCodecVP8, Image);
+	}
+
+	for (const FLoopbackPeer* Peer : { PeerA.Get(), PeerB.Get() })
+	{
+		const TCHAR* Name = Peer == PeerA.Get() ? TEXT("Peer A") : TEXT("Peer B");
+		if (!TestEqual(FString::Printf(TEXT("%s receives every frame"), Name), Peer->Received.Num(), Sent.Num()))
+		{
+			continue;
+		}
+
+		for (int32 i = 0; i < Sent.Num(); ++i)
+		{
+			TestTrue(FString::Printf(TEXT("%s frame %d is not copied"), Name, i), Peer->Received[i].Data.get() == Sent[i].get());
+			TestTrue(FString::Printf(TEXT("%s frame %d type"), Name, i), Peer->Received[i].bKeyFrame == (i == 0));
+		}
+	}
+
+	TestFalse(TEXT("No key frame request once started"), FanOut.ConsumeKeyFrameRequest(0, 1));
+
+	// The shared encoder follows the lowest bitrate of the peers, it is reported with their next frame
+	PeerA->SetBitrate(2'500'000);
+	PeerB->SetBitrate(1'000'000);
+	FanOut.OnEncodedImage(0, 1, webrtc::kVideoCodecVP8, MakeImage(false, Width, 11));
+	TestEqual(TEXT("Lowest bitrate of the peers"), static_cast<int64>(FanOut.GetMinTargetBitrate()), static_cast<int64>(1'000'000));
+
+	// With simulcast the peers following the highest layer only get that one, a peer given a layer only gets that layer
+	auto PeerC = MakeUnique<FLoopbackPeer>(FanOut.AddDestination(0));
+	const int32 NumStreams = 3;
+	const int32 Widths[NumStreams] = { Width / 4, Width / 2, Width };
+
+	const int32 NumReceivedA = PeerA->Received.Num();
+	for (int32 Frame = 0; Frame < 4; ++Frame)
+	{
+		for (int32 Stream = 0; Stream < NumStreams; ++Stream)
+		{
+			FanOut.OnEncodedImage(Stream, NumStreams, webrtc::kVideoCodecVP8, MakeImage(Frame == 0, Widths[Stream], static_cast<uint8>(Stream)));
+		}
+	}
+
+	TestEqual(TEXT("Peer A gets the highest layer only"), PeerA->Received.Num() - NumReceivedA, 4);
+	TestTrue(TEXT("Peer A frames are of the highest layer"), PeerA->Received.Last().Width == Widths[NumStreams - 1]);
+	TestEqual(TEXT("Peer C gets its layer only"), PeerC->Received.Num(), 4);
+	TestTrue(TEXT("Peer C frames are of the lowest layer"), PeerC->Received.Num() > 0 && PeerC->Received.Last().Width == Widths[0]);
+
+	// A peer forwarding a lower layer doesn't constrain the highest one
+	PeerC->SetBitrate(100'000);
+	FanOut.OnEncodedImage(0, NumStreams, webrtc::kVideoCodecVP8, MakeImage(false, Widths[0], 0));
+	TestEqual(TEXT("Lower layer peers ignored for the bitrate"), static_cast<int64>(FanOut.GetMinTargetBitrate()), static_cast<int64>(1'000'000));
+
+	// A removed peer no longer gets frames, the others are not affected
+	const int32 NumReceivedB = PeerB->Received.Num();
+	FanOut.RemoveDestination(PeerB->Destination);
+	FanOut.OnEncodedImage(0, 1, webrtc::kVideoCodecVP8, MakeImage(false, Width, 12));
+	TestEqual(TEXT("Removed peer receives nothing"), PeerB->Received.Num(), NumReceivedB);
+	TestEqual(TEXT("Remaining peer receives the frame"), static_cast<int32>(PeerA->Received.Last().Data->data()[0]), 12);
+
+	FanOut.RemoveDestination(PeerA->Destination);
+	FanOut.RemoveDestination(PeerC->Destination);
+	TestFalse(TEXT("All destinations removed"), FanOut.HasDestinations());
+
+	return true;
+}
+
+#endif
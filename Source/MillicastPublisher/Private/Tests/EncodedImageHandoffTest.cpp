@@ -0,0 +1,151 @@
+// Copyright Dolby.io 2023. All Rights Reserved.
+
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "WebRTC/SimulcastEncoderFactory.h"
+#include "WebRTC/SimulcastVideoEncoder.h"
+#if WITH_AVENCODER
+#include "WebRTC/CodecPacketBuffer.h"
+#endif
+
+namespace Millicast::Publisher
+{
+
+namespace
+{
+	constexpr int32 Width = 640;
+	constexpr int32 Height = 360;
+	constexpr int32 KeyFrameSize = 300 * 1024;
+
+	/** Stands in for the RTP sender, keeps what the adapter forwards */
+	class FEncodedImageSink : public webrtc::EncodedImageCallback
+	{
+	public:
+#if WEBRTC_VERSION == 84
+		Result OnEncodedImage(const webrtc::EncodedImage& Image, const webrtc::CodecSpecificInfo* CodecInfo, const webrtc::RTPFragmentationHeader* Fragmentation) override
+#else
+		Result OnEncodedImage(const webrtc::EncodedImage& Image, const webrtc::CodecSpecificInfo* CodecInfo) override
+#endif
+		{
+			Data = Image.GetEncodedData();
+			ForwardedCodecInfo = CodecInfo;
+			SpatialIndex = Image.SpatialIndex().value_or(-1);
+			return Result(Result::OK);
+		}
+
+		rtc::scoped_refptr<webrtc::EncodedImageBufferInterface> Data;
+		const webrtc::CodecSpecificInfo* ForwardedCodecInfo = nullptr;
+		int32 SpatialIndex = -1;
+	};
+
+	webrtc::VideoCodec MakeCodec()
+	{
+		webrtc::VideoCodec Codec;
+		Codec.codecType = webrtc::kVideoCodecVP8;
+		Codec.width = Width;
+		Codec.height = Height;
+		Codec.startBitrate = 1000;
+		Codec.minBitrate = 30;
+		Codec.maxBitrate = 2000;
+		Codec.maxFramerate = 30;
+		Codec.qpMax = 56;
+		Codec.active = true;
+		Codec.numberOfSimulcastStreams = 1;
+		Codec.simulcastStream[0].width = Width;
+		Codec.simulcastStream[0].height = Height;
+		Codec.simulcastStream[0].maxFramerate = 30;
+		Codec.simulcastStream[0].numberOfTemporalLayers = 1;
+		Codec.simulcastStream[0].maxBitrate = Codec.maxBitrate;
+		Codec.simulcastStream[0].targetBitrate = Codec.maxBitrate;
+		Codec.simulcastStream[0].minBitrate = Codec.minBitrate;
+		Codec.simulcastStream[0].qpMax = Codec.qpMax;
+		Codec.simulcastStream[0].active = true;
+		*Codec.VP8() = webrtc::VideoEncoder::GetDefaultVp8Settings();
+		return Codec;
+	}
+}
+
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FMillicastEncodedImageHandoffTest, "Millicast.Publisher.WebRTC.EncodedImageHandoff",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FMillicastEncodedImageHandoffTest::RunTest(const FString& Parameters)
+{
+	using namespace Millicast::Publisher;
+
+	TArray<uint8> Payload;
+	Payload.SetNumUninitialized(KeyFrameSize);
+	for (int32 i = 0; i < Payload.Num(); ++i)
+	{
+		Payload[i] = static_cast<uint8>(i * 7);
+	}
+
+#if WITH_AVENCODER
+	// The encoded image holds the packet data, the packet can go once the callback returns
+	{
+		AVEncoder::FCodecPacket Packet;
+		Packet.DataSize = Payload.Num();
+#if ENGINE_MAJOR_VERSION < 5
+		Packet.Data = Payload.GetData();
+#else
+		uint8* PacketData = static_cast<uint8*>(FMemory::Malloc(Payload.Num()));
+		FMemory::Memcpy(PacketData, Payload.GetData(), Payload.Num());
+		Packet.Data = MakeShareable(PacketData, [](uint8* Data) { FMemory::Free(Data); });
+#endif
+
+		rtc::scoped_refptr<webrtc::EncodedImageBufferInterface> Buffer = FCodecPacketBuffer::Create(Packet);
+		TestEqual(TEXT("Packet size"), static_cast<int64>(Buffer->size()), static_cast<int64>(Payload.Num()));
+#if ENGINE_MAJOR_VERSION < 5
+		// The data of UE 4.27 packets is only valid during the callback, it is the one copy
+		TestTrue(TEXT("Packet copied once"), Buffer->data() != Packet.Data);
+#else
+		TestTrue(TEXT("Packet data not copied"), Buffer->data() == Packet.Data.Get());
+		Packet.Data.Reset();
+#endif
+		TestTrue(TEXT("Payload kept after the packet"), FMemory::Memcmp(Buffer->data(), Payload.GetData(), Payload.Num()) == 0);
+	}
+#endif
+
+	// The simulcast adapter hands the payload and codec specific info of its encoders to webrtc as they are
+	FSimulcastEncoderFactory Factory;
+	std::unique_ptr<webrtc::VideoEncoder> Encoder = Factory.CreateVideoEncoder(webrtc::SdpVideoFormat("VP8"));
+	FSimulcastVideoEncoder* Adapter = static_cast<FSimulcastVideoEncoder*>(Encoder.get());
+
+	const webrtc::VideoCodec Codec = MakeCodec();
+	if (!TestEqual(TEXT("Adapter initialized"), Adapter->InitEncode(&Codec, webrtc::VideoEncoder::Settings(webrtc::VideoEncoder::Capabilities(false), 1, 1200)), WEBRTC_VIDEO_CODEC_OK))
+	{
+		return true;
+	}
+
+	FEncodedImageSink Sink;
+	Adapter->RegisterEncodeCompleteCallback(&Sink);
+
+	webrtc::EncodedImage Image;
+	Image.SetEncodedData(webrtc::EncodedImageBuffer::Create(Payload.GetData(), Payload.Num()));
+	Image._frameType = webrtc::VideoFrameType::kVideoFrameKey;
+	Image._encodedWidth = Width;
+	Image._encodedHeight = Height;
+
+	webrtc::CodecSpecificInfo CodecInfo;
+	CodecInfo.codecType = webrtc::kVideoCodecVP8;
+
+	Adapter->OnEncodedImage(0, Image, &CodecInfo
+#if WEBRTC_VERSION == 84
+		, nullptr
+#endif
+	);
+
+	TestTrue(TEXT("Payload forwarded without a copy"), Sink.Data.get() == Image.GetEncodedData().get());
+	TestTrue(TEXT("Codec specific info forwarded as is"), Sink.ForwardedCodecInfo == &CodecInfo);
+	TestEqual(TEXT("Stream index set"), Sink.SpatialIndex, 0);
+
+	Adapter->RegisterEncodeCompleteCallback(nullptr);
+	Adapter->Release();
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,305 @@
+// Copyright Dolby.io 2023. All Rights Reserved.
+
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "WebRTC/EncodedVideoFile.h"
+
+#include "HAL/FileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+namespace Millicast::Publisher
+{
+
+namespace
+{
+	constexpr int32 IvfWidth = 320;
+	constexpr int32 IvfHeight = 240;
+
+	FString GetFileDir()
+	{
+		return FPaths::Combine(FPaths::AutomationTransientDir(), TEXT("MillicastEncodedVideoFile"));
+	}
+
+	/** Writes the data to a file of the test directory and loads it back */
+	TSharedPtr<const FEncodedVideoFile, ESPMode::ThreadSafe> SaveAndLoad(const FString& Name, const TArray<uint8>& Data)
+	{
+		const FString Path = FPaths::Combine(GetFileDir(), Name);
+		FFileHelper::SaveArrayToFile(Data, *Path);
+		return FEncodedVideoFile::Load(Path);
+	}
+
+	void AppendLE(TArray<uint8>& Out, uint64 Value, int32 NumBytes)
+	{
+		for (int32 i = 0; i < NumBytes; ++i)
+		{
+			Out.Add(static_cast<uint8>(Value >> (i * 8)));
+		}
+	}
+
+	/** VP8 IVF file at 30 fps, one frame per entry, the key frames where it is true */
+	TArray<uint8> MakeIvf(const TArray<bool>& KeyFrames)
+	{
+		TArray<uint8> Ivf = { 'D', 'K', 'I', 'F' };
+		AppendLE(Ivf, 0, 2); // Version
+		AppendLE(Ivf, 32, 2); // Header size
+		Ivf.Append({ 'V', 'P', '8', '0' });
+		AppendLE(Ivf, IvfWidth, 2);
+		AppendLE(Ivf, IvfHeight, 2);
+		AppendLE(Ivf, 30, 4); // Timebase denominator
+		AppendLE(Ivf, 1, 4); // Timebase numerator
+		AppendLE(Ivf, KeyFrames.Num(), 4);
+		AppendLE(Ivf, 0, 4);
+
+		for (int32 i = 0; i < KeyFrames.Num(); ++i)
+		{
+			AppendLE(Ivf, 4, 4);
+			AppendLE(Ivf, i, 8);
+			// The low bit of the first byte is 0 on a VP8 key frame
+			Ivf.Append({ static_cast<uint8>(KeyFrames[i] ? 0x10 : 0x11), 0x02, 0x00, 0x9D });
+		}
+		return Ivf;
+	}
+
+	/** Fields of an H264 SPS, the rest is filled with the usual values */
+	struct FSps
+	{
+		uint8 ProfileIdc;
+		int32 WidthInMbs;
+		int32 HeightInMapUnits;
+		int32 CropBottom;
+		bool bOverlongWidthCode; // An Exp-Golomb code longer than 32 bits in place of the width
+	};
+
+	/** Writes the RBSP of an SPS MSB first */
+	class FSpsWriter
+	{
+	public:
+		void WriteBits(uint32 Value, int32 NumBits)
+		{
+			for (int32 i = NumBits - 1; i >= 0; --i, ++NumWritten)
+			{
+				if ((NumWritten & 7) == 0)
+				{
+					Rbsp.Add(0);
+				}
+				Rbsp.Last() |= ((Value >> i) & 1) << (7 - (NumWritten & 7));
+			}
+		}
+
+		void WriteUE(uint32 Value)
+		{
+			const int32 NumBits = FMath::FloorLog2(Value + 1);
+			WriteBits(0, NumBits);
+			WriteBits(Value + 1, NumBits + 1);
+		}
+
+		/** The NAL payload: stop bit and emulation prevention bytes added */
+		TArray<uint8> Finish()
+		{
+			WriteBits(1, 1);
+
+			TArray<uint8> Payload;
+			int32 NumZeros = 0;
+			for (uint8 Byte : Rbsp)
+			{
+				if (NumZeros >= 2 && Byte <= 3)
+				{
+					Payload.Add(3);
+					NumZeros = 0;
+				}
+				Payload.Add(Byte);
+				NumZeros = Byte == 0 ? NumZeros + 1 : 0;
+			}
+			return Payload;
+		}
+
+	private:
+		TArray<uint8> Rbsp;
+		int32 NumWritten = 0;
+	};
+
+	TArray<uint8> MakeSps(const FSps& Sps)
+	{
+		FSpsWriter Writer;
+		Writer.WriteBits(Sps.ProfileIdc, 8);
+		Writer.WriteBits(0, 8); // Constraint flags
+		Writer.WriteBits(40, 8); // Level 4.0
+		Writer.WriteUE(0); // seq_parameter_set_id
+		if (Sps.ProfileIdc == 100)
+		{
+			Writer.WriteUE(1); // 4:2:0
+			Writer.WriteUE(0); // bit_depth_luma_minus8
+			Writer.WriteUE(0); // bit_depth_chroma_minus8
+			Writer.WriteBits(0, 1); // qpprime_y_zero_transform_bypass_flag
+			Writer.WriteBits(0, 1); // seq_scaling_matrix_present_flag
+		}
+		Writer.WriteUE(0); // log2_max_frame_num_minus4
+		Writer.WriteUE(0); // pic_order_cnt_type
+		Writer.WriteUE(0); // log2_max_pic_order_cnt_lsb_minus4
+		Writer.WriteUE(1); // max_num_ref_frames
+		Writer.WriteBits(0, 1); // gaps_in_frame_num_value_allowed_flag
+		if (Sps.bOverlongWidthCode)
+		{
+			Writer.WriteBits(0, 32);
+			Writer.WriteBits(0, 1);
+			Writer.WriteBits(1, 1);
+		}
+		else
+		{
+			Writer.WriteUE(Sps.WidthInMbs - 1);
+		}
+		Writer.WriteUE(Sps.HeightInMapUnits - 1);
+		Writer.WriteBits(1, 1); // frame_mbs_only_flag
+		Writer.WriteBits(1, 1); // direct_8x8_inference_flag
+		Writer.WriteBits(Sps.CropBottom != 0, 1); // frame_cropping_flag
+		if (Sps.CropBottom != 0)
+		{
+			Writer.WriteUE(0);
+			Writer.WriteUE(0);
+			Writer.WriteUE(0);
+			Writer.WriteUE(Sps.CropBottom);
+		}
+		Writer.WriteBits(0, 1); // vui_parameters_present_flag
+		return Writer.Finish();
+	}
+
+	void AddNalUnit(TArray<uint8>& Bitstream, uint8 Header, const TArray<uint8>& Payload)
+	{
+		Bitstream.Append({ 0, 0, 0, 1, Header });
+		Bitstream.Append(Payload);
+	}
+
+	/** An IDR access unit with the SPS, followed by P frames */
+	TArray<uint8> MakeAnnexB(const TArray<uint8>& SpsPayload, int32 NumFrames)
+	{
+		TArray<uint8> Bitstream;
+		AddNalUnit(Bitstream, 0x67, SpsPayload);
+		AddNalUnit(Bitstream, 0x68, { 0xCE, 0x38, 0x80 });
+		// first_mb_in_slice is 0 when the first bit of the slice header is set
+		AddNalUnit(Bitstream, 0x65, { 0x88, 0x84, 0x21 });
+		for (int32 i = 1; i < NumFrames; ++i)
+		{
+			AddNalUnit(Bitstream, 0x41, { 0x9A, 0x12, 0x34 });
+		}
+		return Bitstream;
+	}
+}
+
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FMillicastEncodedVideoFileTest, "Millicast.Publisher.WebRTC.EncodedVideoFile",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FMillicastEncodedVideoFileTest::RunTest(const FString& Parameters)
+{
+	using namespace Millicast::Publisher;
+
+	const FString Dir = GetFileDir();
+	IFileManager::Get().DeleteDirectory(*Dir, false, true);
+
+	AddExpectedError(TEXT("Could not parse encoded video file"), EAutomationExpectedErrorFlags::Contains, 6);
+
+	// Frames before the first key frame are dropped, the nearest key frame is before or after the frame
+	{
+		const TArray<bool> KeyFrames = { false, false, true, false, false, false, false, false, true, false, false, false };
+		TSharedPtr<const FEncodedVideoFile, ESPMode::ThreadSafe> File = SaveAndLoad(TEXT("KeyFrames.ivf"), MakeIvf(KeyFrames));
+		if (!TestTrue(TEXT("IVF loaded"), File.IsValid()))
+		{
+			return true;
+		}
+
+		TestTrue(TEXT("IVF size"), File->GetWidth() == IvfWidth && File->GetHeight() == IvfHeight);
+		TestEqual(TEXT("Leading inter frames dropped"), File->GetNumFrames(), 10);
+		TestTrue(TEXT("Starts at the key frame"), File->GetFrame(0).bKeyFrame && File->GetFrame(0).TimestampUs == 0);
+
+		TestEqual(TEXT("Key frame itself"), File->FindNearestKeyFrame(6), 6);
+		TestEqual(TEXT("Closer to the previous key frame"), File->FindNearestKeyFrame(2), 0);
+		TestEqual(TEXT("As close to both, the previous one"), File->FindNearestKeyFrame(3), 0);
+		TestEqual(TEXT("Closer to the next key frame"), File->FindNearestKeyFrame(4), 6);
+		TestEqual(TEXT("Closer to the loop, the first frame"), File->FindNearestKeyFrame(9), 0);
+		TestEqual(TEXT("Negative index clamped"), File->FindNearestKeyFrame(-3), 0);
+		TestEqual(TEXT("Index past the end clamped"), File->FindNearestKeyFrame(42), 0);
+	}
+
+	// A single key frame: every frame goes back to it or forward to the loop
+	{
+		TSharedPtr<const FEncodedVideoFile, ESPMode::ThreadSafe> File = SaveAndLoad(TEXT("SingleKeyFrame.ivf"), MakeIvf({ true, false, false, false, false }));
+		if (TestTrue(TEXT("Single key frame loaded"), File.IsValid()))
+		{
+			TestEqual(TEXT("Single key frame, start"), File->FindNearestKeyFrame(1), 0);
+			TestEqual(TEXT("Single key frame, end"), File->FindNearestKeyFrame(4), 0);
+		}
+	}
+
+	// A frame cut by the end of the file or with a size of 0 ends the file, the frames before it are kept
+	{
+		TArray<uint8> Truncated = MakeIvf({ true, false, false });
+		AppendLE(Truncated, 1000, 4);
+		AppendLE(Truncated, 3, 8);
+		Truncated.Append({ 0x11, 0x02 });
+		TSharedPtr<const FEncodedVideoFile, ESPMode::ThreadSafe> File = SaveAndLoad(TEXT("Truncated.ivf"), Truncated);
+		TestTrue(TEXT("Truncated frame dropped"), File.IsValid() && File->GetNumFrames() == 3);
+
+		TArray<uint8> EmptyFrame = MakeIvf({ true, false });
+		AppendLE(EmptyFrame, 0, 4);
+		AppendLE(EmptyFrame, 2, 8);
+		EmptyFrame.Append(MakeIvf({ false }).GetData() + 32, 16);
+		File = SaveAndLoad(TEXT("EmptyFrame.ivf"), EmptyFrame);
+		TestTrue(TEXT("Frames after an empty frame ignored"), File.IsValid() && File->GetNumFrames() == 2);
+	}
+
+	// IVF files that can't be played
+	{
+		TArray<uint8> ShortHeader = MakeIvf({ true });
+		ShortHeader.SetNum(20);
+		TestFalse(TEXT("Header cut short"), SaveAndLoad(TEXT("ShortHeader.ivf"), ShortHeader).IsValid());
+
+		TestFalse(TEXT("No key frame"), SaveAndLoad(TEXT("NoKeyFrame.ivf"), MakeIvf({ false, false, false })).IsValid());
+	}
+
+	// The resolution comes from the SPS, cropping included
+	{
+		TSharedPtr<const FEncodedVideoFile, ESPMode::ThreadSafe> File = SaveAndLoad(TEXT("Baseline.h264"), MakeAnnexB(MakeSps({ 66, 120, 68, 4, false }), 5));
+		if (TestTrue(TEXT("Baseline loaded"), File.IsValid()))
+		{
+			TestTrue(TEXT("Baseline 1080p"), File->GetWidth() == 1920 && File->GetHeight() == 1080);
+			TestEqual(TEXT("One frame per access unit"), File->GetNumFrames(), 5);
+			TestEqual(TEXT("IDR frame only"), File->FindNearestKeyFrame(3), 0);
+		}
+
+		File = SaveAndLoad(TEXT("High.h264"), MakeAnnexB(MakeSps({ 100, 40, 23, 4, false }), 2));
+		TestTrue(TEXT("High profile 360p"), File.IsValid() && File->GetWidth() == 640 && File->GetHeight() == 360);
+	}
+
+	// Malformed SPS: the file is refused rather than loaded with a made up resolution
+	{
+		const TArray<uint8> Sps = MakeSps({ 66, 120, 68, 4, false });
+
+		TArray<uint8> TruncatedSps(Sps.GetData(), 3);
+		TestFalse(TEXT("SPS cut after the level"), SaveAndLoad(TEXT("TruncatedSps.h264"), MakeAnnexB(TruncatedSps, 2)).IsValid());
+
+		TArray<uint8> TruncatedSize(Sps.GetData(), 5);
+		TestFalse(TEXT("SPS cut in the size"), SaveAndLoad(TEXT("TruncatedSize.h264"), MakeAnnexB(TruncatedSize, 2)).IsValid());
+
+		TestFalse(TEXT("Width code longer than 32 bits"),
+			SaveAndLoad(TEXT("OverlongWidth.h264"), MakeAnnexB(MakeSps({ 66, 120, 68, 0, true }), 2)).IsValid());
+
+		TestFalse(TEXT("Crop larger than the picture"),
+			SaveAndLoad(TEXT("CropTooLarge.h264"), MakeAnnexB(MakeSps({ 66, 40, 23, 100, false }), 2)).IsValid());
+
+		// A later SPS gives the resolution when the first one can't be parsed
+		TArray<uint8> Bitstream = MakeAnnexB(TruncatedSps, 2);
+		Bitstream.Append(MakeAnnexB(MakeSps({ 100, 40, 23, 4, false }), 2));
+		TSharedPtr<const FEncodedVideoFile, ESPMode::ThreadSafe> File = SaveAndLoad(TEXT("SecondSps.h264"), Bitstream);
+		TestTrue(TEXT("Resolution from the second SPS"), File.IsValid() && File->GetWidth() == 640 && File->GetHeight() == 360);
+	}
+
+	IFileManager::Get().DeleteDirectory(*Dir, false, true);
+
+	return true;
+}
+
+#endif
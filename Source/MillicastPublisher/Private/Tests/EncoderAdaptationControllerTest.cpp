@@ -0,0 +1,188 @@
+// Copyright Dolby.io 2023. All Rights Reserved.
+
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "WebRTC/EncoderAdaptationController.h"
+
+namespace Millicast::Publisher
+{
+
+namespace
+{
+	constexpr double CaptureFps = 60.0;
+	constexpr double CaptureIntervalSeconds = 1.0 / CaptureFps;
+
+	/** Encoder load, the time to encode a full resolution frame and the frames waiting in the encoder */
+	struct FLoad
+	{
+		double FullResolutionMs;
+		int32 QueueDepth = 0;
+	};
+
+	struct FLevelChange
+	{
+		double TimeSeconds;
+		FAdaptationLevel Level;
+	};
+
+	/**
+	 * Captures at 60 fps for the given time, encoding the frames the level lets through.
+	 * The encode time follows the pixel count of the level, as it does with a real encoder.
+	 */
+	class FSimulation
+	{
+	public:
+		void Run(FEncoderAdaptationController& Controller, double Seconds, const FLoad& Load)
+		{
+			for (const double End = TimeSeconds + Seconds; TimeSeconds < End; TimeSeconds += CaptureIntervalSeconds)
+			{
+				Controller.OnFrameCaptured(TimeSeconds);
+
+				const FAdaptationLevel Level = Controller.GetLevel();
+				if (Level.MaxFramerate > 0 && TimeSeconds - LastEncodeSeconds < 1.0 / Level.MaxFramerate - 0.001)
+				{
+					continue;
+				}
+				LastEncodeSeconds = TimeSeconds;
+
+				const double EncodeTimeMs = Load.FullResolutionMs * Level.ResolutionScale * Level.ResolutionScale;
+				Controller.OnFrameEncoded(EncodeTimeMs, Load.QueueDepth, TimeSeconds);
+
+				const FAdaptationLevel NewLevel = Controller.GetLevel();
+				if (NewLevel.ResolutionScale != Level.ResolutionScale || NewLevel.MaxFramerate != Level.MaxFramerate)
+				{
+					Changes.Add({ TimeSeconds, NewLevel });
+				}
+			}
+		}
+
+		// Not 0, which the controller takes as no capture yet
+		double TimeSeconds = 1000.0;
+		double LastEncodeSeconds = 0.0;
+		TArray<FLevelChange> Changes;
+	};
+
+	bool IsFullQuality(const FAdaptationLevel& Level)
+	{
+		return Level.ResolutionScale == 1.0f && Level.MaxFramerate == 0;
+	}
+}
+
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FMillicastEncoderAdaptationControllerTest, "Millicast.Publisher.WebRTC.EncoderAdaptationController",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FMillicastEncoderAdaptationControllerTest::RunTest(const FString& Parameters)
+{
+	using namespace Millicast::Publisher;
+
+	// The frame budget at 60 fps is 16.7 ms, overused above 15 ms
+
+	// An encoder within its budget is left alone
+	{
+		FEncoderAdaptationController Controller;
+		FSimulation Simulation;
+		Simulation.Run(Controller, 30.0, { 10.0 });
+		TestEqual(TEXT("Within budget, no change"), Simulation.Changes.Num(), 0);
+	}
+
+	// Over budget, the resolution goes down once the overuse held for a second, and stays there:
+	// back at full resolution the encoder would be over budget again
+	{
+		FEncoderAdaptationController Controller;
+		FSimulation Simulation;
+		Simulation.Run(Controller, 60.0, { 20.0 });
+
+		if (TestEqual(TEXT("Over budget, one change"), Simulation.Changes.Num(), 1))
+		{
+			const FLevelChange& Change = Simulation.Changes[0];
+			TestTrue(TEXT("Resolution reduced first"), Change.Level.ResolutionScale < 1.0f && Change.Level.MaxFramerate == 0);
+
+			// 30 frames to measure, the overuse held a second
+			const double ChangeAfter = Change.TimeSeconds - 1000.0;
+			TestTrue(FString::Printf(TEXT("Reduced after the hold time (%.2f s)"), ChangeAfter), ChangeAfter >= 1.0 && ChangeAfter < 2.0);
+		}
+	}
+
+	// Overuse shorter than the hold time, a hitch, changes nothing
+	{
+		FEncoderAdaptationController Controller;
+		FSimulation Simulation;
+		Simulation.Run(Controller, 2.0, { 5.0 });
+		Simulation.Run(Controller, 0.5, { 30.0 });
+		Simulation.Run(Controller, 10.0, { 5.0 });
+		TestEqual(TEXT("Hitch ignored"), Simulation.Changes.Num(), 0);
+	}
+
+	// Frames piling up in the encoder are an overuse even with a short encode time
+	{
+		FEncoderAdaptationController Controller;
+		FSimulation Simulation;
+		FLoad Load { 5.0 };
+		Load.QueueDepth = 4;
+		Simulation.Run(Controller, 3.0, Load);
+		TestTrue(TEXT("Queue growing, stepped down"), Simulation.Changes.Num() > 0 && !IsFullQuality(Controller.GetLevel()));
+	}
+
+	// Back up once the encoder has room: only after the underuse held for 5 seconds, and one level at a time
+	{
+		FEncoderAdaptationController Controller;
+		FSimulation Simulation;
+		Simulation.Run(Controller, 10.0, { 20.0 });
+		TestFalse(TEXT("Stepped down under load"), IsFullQuality(Controller.GetLevel()));
+
+		const double LoadDropSeconds = Simulation.TimeSeconds;
+		const int32 NumChangesUnderLoad = Simulation.Changes.Num();
+		Simulation.Run(Controller, 5.0, { 5.0 });
+		TestEqual(TEXT("Not back up before the hold time"), Simulation.Changes.Num(), NumChangesUnderLoad);
+
+		Simulation.Run(Controller, 30.0, { 5.0 });
+		TestTrue(TEXT("Back to full quality"), IsFullQuality(Controller.GetLevel()));
+		for (int32 i = NumChangesUnderLoad; i < Simulation.Changes.Num(); ++i)
+		{
+			const double PreviousSeconds = i > NumChangesUnderLoad ? Simulation.Changes[i - 1].TimeSeconds : LoadDropSeconds;
+			TestTrue(TEXT("Steps up 5 seconds apart at least"), Simulation.Changes[i].TimeSeconds - PreviousSeconds >= 5.0);
+		}
+	}
+
+	// A load right between two levels doesn't flip between them
+	for (const double FullResolutionMs : { 16.0, 18.0, 24.0, 28.0 })
+	{
+		FEncoderAdaptationController Controller;
+		FSimulation Simulation;
+		Simulation.Run(Controller, 120.0, { FullResolutionMs });
+
+		int32 NumStepsUp = 0;
+		for (int32 i = 1; i < Simulation.Changes.Num(); ++i)
+		{
+			NumStepsUp += Simulation.Changes[i].Level.ResolutionScale > Simulation.Changes[i - 1].Level.ResolutionScale
+				|| (Simulation.Changes[i].Level.MaxFramerate == 0 && Simulation.Changes[i - 1].Level.MaxFramerate > 0);
+		}
+		TestEqual(FString::Printf(TEXT("%.0f ms, never back up under the same load"), FullResolutionMs), NumStepsUp, 0);
+		TestTrue(FString::Printf(TEXT("%.0f ms, settled in the first 10 seconds"), FullResolutionMs),
+			Simulation.Changes.Num() == 0 || Simulation.Changes.Last().TimeSeconds - 1000.0 < 10.0);
+	}
+
+	// Detailed content keeps its resolution, the framerate goes down instead
+	{
+		FEncoderAdaptationController Controller;
+		Controller.SetMaintainResolution(true);
+		FSimulation Simulation;
+		Simulation.Run(Controller, 10.0, { 20.0 });
+
+		const FAdaptationLevel Level = Controller.GetLevel();
+		TestTrue(TEXT("Maintaining resolution, full resolution"), Level.ResolutionScale == 1.0f);
+		TestEqual(TEXT("Maintaining resolution, 30 fps"), Level.MaxFramerate, 30);
+
+		// Changing the content starts over from full quality
+		Controller.SetMaintainResolution(false);
+		TestTrue(TEXT("Content change resets the level"), IsFullQuality(Controller.GetLevel()));
+	}
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,198 @@
+// Copyright Dolby.io 2023. All Rights Reserved.
+
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "WebRTC/EncoderInputQueue.h"
+
+#include "Async/Async.h"
+#include "Containers/Queue.h"
+
+namespace Millicast::Publisher
+{
+
+namespace
+{
+	using FTicketPtr = FEncoderInputQueue::FTicketPtr;
+
+	constexpr int32 NumFrames = 40;
+
+	struct FEncodeResult
+	{
+		TArray<int32> EncodedFrames;
+		double MaxEnqueueMs = 0;
+		int32 NumRejected = 0;
+	};
+
+	/**
+	 * A capture at CaptureIntervalMs feeding an encoder taking EncodeTimeMs per frame, on its own thread like the webrtc encoder.
+	 * The frames travel to the encoder in order, as they do through webrtc.
+	 */
+	FEncodeResult RunSlowEncoder(const TSharedRef<FEncoderInputQueue, ESPMode::ThreadSafe>& Queue, float CaptureIntervalMs, float EncodeTimeMs)
+	{
+		FEncodeResult Result;
+		TQueue<TPair<int32, FTicketPtr>, EQueueMode::Spsc> InFlight;
+		TAtomic<bool> bCaptureDone { false };
+
+		TFuture<void> Encoder = Async(EAsyncExecution::Thread, [&InFlight, &bCaptureDone, &Result, EncodeTimeMs]()
+		{
+			for (;;)
+			{
+				TPair<int32, FTicketPtr> Frame;
+				if (!InFlight.Dequeue(Frame))
+				{
+					if (bCaptureDone)
+					{
+						break;
+					}
+					FPlatformProcess::Sleep(0.001f);
+					continue;
+				}
+
+				if (Frame.Value->Dequeue())
+				{
+					FPlatformProcess::Sleep(EncodeTimeMs / 1000.0f);
+					Result.EncodedFrames.Add(Frame.Key);
+				}
+			}
+		});
+
+		for (int32 i = 0; i < NumFrames; ++i)
+		{
+			const uint64 StartCycles = FPlatformTime::Cycles64();
+			FTicketPtr Ticket = Queue->Enqueue();
+			Result.MaxEnqueueMs = FMath::Max(Result.MaxEnqueueMs, FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles));
+
+			if (Ticket)
+			{
+				InFlight.Enqueue(TPair<int32, FTicketPtr>(i, MoveTemp(Ticket)));
+			}
+			else
+			{
+				++Result.NumRejected;
+			}
+
+			FPlatformProcess::Sleep(CaptureIntervalMs / 1000.0f);
+		}
+
+		bCaptureDone = true;
+		Encoder.Wait();
+
+		return Result;
+	}
+
+	bool IsIncreasing(const TArray<int32>& Frames)
+	{
+		for (int32 i = 1; i < Frames.Num(); ++i)
+		{
+			if (Frames[i] <= Frames[i - 1])
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FMillicastEncoderInputQueueTest, "Millicast.Publisher.WebRTC.EncoderInputQueue",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FMillicastEncoderInputQueueTest::RunTest(const FString& Parameters)
+{
+	using namespace Millicast::Publisher;
+
+	// Drop oldest: a frame waiting when the queue is full is not encoded anymore
+	{
+		auto Queue = MakeShared<FEncoderInputQueue, ESPMode::ThreadSafe>(2, EMillicastEncoderQueuePolicy::DropOldest);
+
+		FTicketPtr First = Queue->Enqueue();
+		FTicketPtr Second = Queue->Enqueue();
+		FTicketPtr Third = Queue->Enqueue();
+		TestTrue(TEXT("Never refuses a frame"), First && Second && Third);
+		TestFalse(TEXT("Oldest frame dropped"), First->Dequeue());
+		TestTrue(TEXT("Newer frames encoded"), Second->Dequeue() && Third->Dequeue());
+
+		const FEncoderInputQueue::FStats Stats = Queue->GetStats();
+		TestEqual(TEXT("Drop oldest, depth"), Stats.Depth, 0);
+		TestEqual(TEXT("Drop oldest, max depth"), Stats.MaxDepth, 2);
+		TestEqual(TEXT("Drop oldest, dropped"), Stats.DroppedFrames, 1);
+	}
+
+	// A frame sent to several peer connections leaves the queue once, a frame released on the way counts as dropped
+	{
+		auto Queue = MakeShared<FEncoderInputQueue, ESPMode::ThreadSafe>(4, EMillicastEncoderQueuePolicy::Block);
+
+		FTicketPtr Shared = Queue->Enqueue();
+		TestTrue(TEXT("First encoder"), Shared->Dequeue());
+		TestTrue(TEXT("Second encoder"), Shared->Dequeue());
+
+		FTicketPtr Lost = Queue->Enqueue();
+		TestEqual(TEXT("Waiting frame"), Queue->GetStats().Depth, 1);
+		Lost.Reset();
+
+		const FEncoderInputQueue::FStats Stats = Queue->GetStats();
+		TestEqual(TEXT("Released frame leaves the queue"), Stats.Depth, 0);
+		TestEqual(TEXT("Released frame is dropped"), Stats.DroppedFrames, 1);
+
+		// The queue of a source that went away doesn't hold its last frames back
+		FTicketPtr Orphan = Queue->Enqueue();
+		Queue.Reset();
+		TestTrue(TEXT("Frame outliving its queue"), Orphan->Dequeue());
+	}
+
+	// Block: a stuck encoder only holds the capture for the timeout
+	{
+		auto Queue = MakeShared<FEncoderInputQueue, ESPMode::ThreadSafe>(1, EMillicastEncoderQueuePolicy::Block);
+
+		FTicketPtr Stuck = Queue->Enqueue();
+		const uint64 StartCycles = FPlatformTime::Cycles64();
+		FTicketPtr Rejected = Queue->Enqueue();
+		const double BlockedMs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles);
+
+		TestFalse(TEXT("Frame rejected after the timeout"), Rejected.IsValid());
+		TestTrue(TEXT("Blocked for the timeout"), BlockedMs >= FEncoderInputQueue::BlockTimeoutMs - 1 && BlockedMs < FEncoderInputQueue::BlockTimeoutMs * 5);
+		TestEqual(TEXT("Rejected frame is dropped"), Queue->GetStats().DroppedFrames, 1);
+	}
+
+	// Slow encoder, drop oldest: the capture never waits and the latest frame is always encoded
+	{
+		auto Queue = MakeShared<FEncoderInputQueue, ESPMode::ThreadSafe>(2, EMillicastEncoderQueuePolicy::DropOldest);
+		const FEncodeResult Result = RunSlowEncoder(Queue, 2.0f, 10.0f);
+		const FEncoderInputQueue::FStats Stats = Queue->GetStats();
+
+		TestEqual(TEXT("Slow encoder, drop oldest, nothing rejected"), Result.NumRejected, 0);
+		TestTrue(TEXT("Slow encoder, drop oldest, capture not held"), Result.MaxEnqueueMs < 10.0);
+		TestTrue(TEXT("Slow encoder, drop oldest, frames dropped"), Stats.DroppedFrames > 0);
+		TestEqual(TEXT("Slow encoder, drop oldest, every frame encoded or dropped"), Result.EncodedFrames.Num() + Stats.DroppedFrames, NumFrames);
+		TestTrue(TEXT("Slow encoder, drop oldest, in order"), IsIncreasing(Result.EncodedFrames));
+		TestTrue(TEXT("Slow encoder, drop oldest, latest frame encoded"), Result.EncodedFrames.Num() > 0 && Result.EncodedFrames.Last() == NumFrames - 1);
+		TestTrue(TEXT("Slow encoder, drop oldest, bounded depth"), Stats.MaxDepth <= 2);
+		TestEqual(TEXT("Slow encoder, drop oldest, empty at the end"), Stats.Depth, 0);
+
+		AddInfo(FString::Printf(TEXT("Drop oldest: %d of %d frames encoded, wait %.1f ms"), Result.EncodedFrames.Num(), NumFrames, Stats.WaitTimeMs));
+	}
+
+	// Slow encoder, block: the capture waits for the encoder and every frame is encoded
+	{
+		auto Queue = MakeShared<FEncoderInputQueue, ESPMode::ThreadSafe>(2, EMillicastEncoderQueuePolicy::Block);
+		const FEncodeResult Result = RunSlowEncoder(Queue, 2.0f, 10.0f);
+		const FEncoderInputQueue::FStats Stats = Queue->GetStats();
+
+		TestEqual(TEXT("Slow encoder, block, nothing rejected"), Result.NumRejected, 0);
+		TestEqual(TEXT("Slow encoder, block, nothing dropped"), Stats.DroppedFrames, 0);
+		TestEqual(TEXT("Slow encoder, block, every frame encoded"), Result.EncodedFrames.Num(), NumFrames);
+		TestTrue(TEXT("Slow encoder, block, in order"), IsIncreasing(Result.EncodedFrames));
+		TestTrue(TEXT("Slow encoder, block, capture held"), Result.MaxEnqueueMs > 1.0 && Stats.BlockTimeMs > 0.0);
+		TestTrue(TEXT("Slow encoder, block, bounded depth"), Stats.MaxDepth <= 2);
+		TestEqual(TEXT("Slow encoder, block, empty at the end"), Stats.Depth, 0);
+
+		AddInfo(FString::Printf(TEXT("Block: capture held %.1f ms on average, %.1f ms at most"), Stats.BlockTimeMs, Result.MaxEnqueueMs));
+	}
+
+	return true;
+}
+
+#endif
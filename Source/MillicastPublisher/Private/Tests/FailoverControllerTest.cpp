@@ -0,0 +1,204 @@
+// Copyright Dolby.io 2023. All Rights Reserved.
+
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "WebRTC/FailoverController.h"
+
+#include "Async/Async.h"
+#include "Containers/Queue.h"
+
+namespace Millicast::Publisher
+{
+
+namespace
+{
+	using EIceState = webrtc::PeerConnectionInterface::IceConnectionState;
+	using EAction = FFailoverController::EAction;
+
+	constexpr double FailbackDelayMs = 5000.0;
+	constexpr int32 NumSwitches = 20;
+
+	struct FPostedState
+	{
+		EIceState State;
+		uint64 Cycles;
+	};
+
+	/**
+	 * Stands in for the signaling of the primary connection: its thread reports the ICE states,
+	 * which reach the thread running the controller through a queue, as the component posts them to the game thread.
+	 */
+	class FSignalingStandIn
+	{
+	public:
+		void Post(EIceState State)
+		{
+			Posted.Enqueue({ State, FPlatformTime::Cycles64() });
+		}
+
+		/** Connects the primary, then drops it and brings it back once each time the test asks */
+		TFuture<void> Run(int32 NumDrops, FEvent* DropRequested)
+		{
+			return Async(EAsyncExecution::Thread, [this, NumDrops, DropRequested]()
+			{
+				Post(EIceState::kIceConnectionChecking);
+				Post(EIceState::kIceConnectionConnected);
+
+				// Gives up when the test stops asking
+				for (int32 i = 0; i < NumDrops; ++i)
+				{
+					if (!DropRequested->Wait(1000))
+					{
+						return;
+					}
+					Post(EIceState::kIceConnectionDisconnected);
+
+					if (!DropRequested->Wait(1000))
+					{
+						return;
+					}
+					Post(EIceState::kIceConnectionConnected);
+				}
+			});
+		}
+
+		TQueue<FPostedState, EQueueMode::Mpsc> Posted;
+	};
+}
+
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FMillicastFailoverControllerTest, "Millicast.Publisher.WebRTC.FailoverController",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FMillicastFailoverControllerTest::RunTest(const FString& Parameters)
+{
+	using namespace Millicast::Publisher;
+
+	// Nothing to fail over to before the backup is connected
+	{
+		FFailoverController Controller(FailbackDelayMs);
+		TestTrue(TEXT("No backup"), Controller.OnPrimaryIceStateChanged(EIceState::kIceConnectionDisconnected, 0.0) == EAction::None);
+		TestFalse(TEXT("Still on the primary"), Controller.IsOnBackup());
+	}
+
+	// A disconnection fails over, the primary sends again once it stayed up for the delay
+	{
+		FFailoverController Controller(FailbackDelayMs);
+		Controller.SetBackupReady(true);
+
+		TestTrue(TEXT("Connected"), Controller.OnPrimaryIceStateChanged(EIceState::kIceConnectionConnected, 0.0) == EAction::None);
+		TestTrue(TEXT("Disconnected fails over"), Controller.OnPrimaryIceStateChanged(EIceState::kIceConnectionDisconnected, 100.0) == EAction::FailOver);
+		TestTrue(TEXT("Fails over once"), Controller.OnPrimaryIceStateChanged(EIceState::kIceConnectionDisconnected, 150.0) == EAction::None);
+		TestTrue(TEXT("On the backup"), Controller.IsOnBackup());
+		TestFalse(TEXT("Not waiting while disconnected"), Controller.IsWaitingToFailBack());
+
+		TestTrue(TEXT("Reconnected"), Controller.OnPrimaryIceStateChanged(EIceState::kIceConnectionConnected, 1000.0) == EAction::None);
+		TestTrue(TEXT("Waiting to fail back"), Controller.IsWaitingToFailBack());
+		TestTrue(TEXT("Completed keeps the reconnection time"), Controller.OnPrimaryIceStateChanged(EIceState::kIceConnectionCompleted, 2000.0) == EAction::None);
+		TestTrue(TEXT("Not before the delay"), Controller.Update(1000.0 + FailbackDelayMs - 1.0) == EAction::None);
+		TestTrue(TEXT("Fails back after the delay"), Controller.Update(1000.0 + FailbackDelayMs) == EAction::FailBack);
+		TestFalse(TEXT("Back on the primary"), Controller.IsOnBackup());
+		TestTrue(TEXT("Fails back once"), Controller.Update(1000.0 + 2 * FailbackDelayMs) == EAction::None);
+
+		TestTrue(TEXT("Fails over again"), Controller.OnPrimaryIceStateChanged(EIceState::kIceConnectionDisconnected, 10000.0) == EAction::FailOver);
+	}
+
+	// A flapping primary restarts the delay each time it goes down
+	{
+		FFailoverController Controller(FailbackDelayMs);
+		Controller.SetBackupReady(true);
+
+		Controller.OnPrimaryIceStateChanged(EIceState::kIceConnectionDisconnected, 0.0);
+		Controller.OnPrimaryIceStateChanged(EIceState::kIceConnectionConnected, 1000.0);
+		Controller.OnPrimaryIceStateChanged(EIceState::kIceConnectionDisconnected, 3000.0);
+		TestTrue(TEXT("Flapping, no fail back"), Controller.Update(1000.0 + FailbackDelayMs) == EAction::None);
+
+		Controller.OnPrimaryIceStateChanged(EIceState::kIceConnectionConnected, 4000.0);
+		TestTrue(TEXT("Flapping, not before the delay"), Controller.Update(4000.0 + FailbackDelayMs - 1.0) == EAction::None);
+		TestTrue(TEXT("Flapping, fails back once stable"), Controller.Update(4000.0 + FailbackDelayMs) == EAction::FailBack);
+	}
+
+	// A failed primary does not come back
+	{
+		FFailoverController Controller(FailbackDelayMs);
+		Controller.SetBackupReady(true);
+
+		TestTrue(TEXT("Failed fails over"), Controller.OnPrimaryIceStateChanged(EIceState::kIceConnectionFailed, 0.0) == EAction::FailOver);
+		Controller.OnPrimaryIceStateChanged(EIceState::kIceConnectionConnected, 1000.0);
+		TestTrue(TEXT("Failed primary"), Controller.IsPrimaryFailed());
+		TestFalse(TEXT("Failed, not waiting"), Controller.IsWaitingToFailBack());
+		TestTrue(TEXT("Failed, no fail back"), Controller.Update(1000.0 + 10 * FailbackDelayMs) == EAction::None);
+	}
+
+	// A disconnection turning into a failure while on the backup
+	{
+		FFailoverController Controller(FailbackDelayMs);
+		Controller.SetBackupReady(true);
+
+		Controller.OnPrimaryIceStateChanged(EIceState::kIceConnectionDisconnected, 0.0);
+		TestTrue(TEXT("Failure after the fail over"), Controller.OnPrimaryIceStateChanged(EIceState::kIceConnectionFailed, 500.0) == EAction::None);
+		Controller.OnPrimaryIceStateChanged(EIceState::kIceConnectionConnected, 1000.0);
+		TestTrue(TEXT("Failure after the fail over, no fail back"), Controller.Update(1000.0 + FailbackDelayMs) == EAction::None);
+		TestTrue(TEXT("Stays on the backup"), Controller.IsOnBackup());
+	}
+
+	// Switch time from the state change on the signaling thread to the decision, the stand-in drops the primary repeatedly
+	{
+		FFailoverController Controller(0.0);
+		Controller.SetBackupReady(true);
+
+		FSignalingStandIn Signaling;
+		FEvent* DropRequested = FPlatformProcess::GetSynchEventFromPool();
+		TFuture<void> SignalingThread = Signaling.Run(NumSwitches, DropRequested);
+
+		double MaxSwitchMs = 0.0;
+		double TotalSwitchMs = 0.0;
+		int32 NumFailOvers = 0;
+		int32 NumFailBacks = 0;
+		const uint64 TimeoutCycles = FPlatformTime::Cycles64() + static_cast<uint64>(10.0 / FPlatformTime::GetSecondsPerCycle64());
+
+		DropRequested->Trigger();
+		while (NumFailBacks < NumSwitches && FPlatformTime::Cycles64() < TimeoutCycles)
+		{
+			FPostedState Posted;
+			if (!Signaling.Posted.Dequeue(Posted))
+			{
+				FPlatformProcess::Yield();
+				continue;
+			}
+
+			const double PostedMs = FPlatformTime::ToMilliseconds64(Posted.Cycles);
+			if (Controller.OnPrimaryIceStateChanged(Posted.State, PostedMs) == EAction::FailOver)
+			{
+				const double SwitchMs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - Posted.Cycles);
+				MaxSwitchMs = FMath::Max(MaxSwitchMs, SwitchMs);
+				TotalSwitchMs += SwitchMs;
+				++NumFailOvers;
+				DropRequested->Trigger();
+			}
+
+			if (Controller.Update(FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64())) == EAction::FailBack)
+			{
+				++NumFailBacks;
+				DropRequested->Trigger();
+			}
+		}
+
+		SignalingThread.Wait();
+		FPlatformProcess::ReturnSynchEventToPool(DropRequested);
+
+		TestEqual(TEXT("Every drop fails over"), NumFailOvers, NumSwitches);
+		TestEqual(TEXT("Every reconnection fails back"), NumFailBacks, NumSwitches);
+		TestTrue(TEXT("Switch much faster than the failover timeout"), MaxSwitchMs < 100.0);
+
+		AddInfo(FString::Printf(TEXT("Fail over decision %.3f ms on average, %.3f ms at most, over %d switches"),
+			TotalSwitchMs / FMath::Max(NumFailOvers, 1), MaxSwitchMs, NumFailOvers));
+	}
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,162 @@
+// Copyright Dolby.io 2023. All Rights Reserved.
+
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "WebRTC/SimulcastEncoderFactory.h"
+#include "WebRTC/SimulcastVideoEncoder.h"
+
+namespace Millicast::Publisher
+{
+
+namespace
+{
+	constexpr int32 Width = 640;
+	constexpr int32 Height = 360;
+
+	/** Stands in for the RTP sender */
+	class FNullEncodedImageSink : public webrtc::EncodedImageCallback
+	{
+	public:
+#if WEBRTC_VERSION == 84
+		Result OnEncodedImage(const webrtc::EncodedImage& Image, const webrtc::CodecSpecificInfo* CodecInfo, const webrtc::RTPFragmentationHeader* Fragmentation) override
+#else
+		Result OnEncodedImage(const webrtc::EncodedImage& Image, const webrtc::CodecSpecificInfo* CodecInfo) override
+#endif
+		{
+			return Result(Result::OK);
+		}
+	};
+
+	webrtc::VideoCodec MakeCodec()
+	{
+		webrtc::VideoCodec Codec;
+		Codec.codecType = webrtc::kVideoCodecVP8;
+		Codec.width = Width;
+		Codec.height = Height;
+		Codec.startBitrate = 1000;
+		Codec.minBitrate = 30;
+		Codec.maxBitrate = 2000;
+		Codec.maxFramerate = 30;
+		Codec.qpMax = 56;
+		Codec.active = true;
+		Codec.numberOfSimulcastStreams = 1;
+		Codec.simulcastStream[0].width = Width;
+		Codec.simulcastStream[0].height = Height;
+		Codec.simulcastStream[0].maxFramerate = 30;
+		Codec.simulcastStream[0].numberOfTemporalLayers = 1;
+		Codec.simulcastStream[0].maxBitrate = Codec.maxBitrate;
+		Codec.simulcastStream[0].targetBitrate = Codec.maxBitrate;
+		Codec.simulcastStream[0].minBitrate = Codec.minBitrate;
+		Codec.simulcastStream[0].qpMax = Codec.qpMax;
+		Codec.simulcastStream[0].active = true;
+		*Codec.VP8() = webrtc::VideoEncoder::GetDefaultVp8Settings();
+		return Codec;
+	}
+
+	/** The encoder webrtc creates for the answer of a publisher, initialized and sending to a null sink */
+	std::unique_ptr<webrtc::VideoEncoder> CreatePublisherEncoder(FSimulcastEncoderFactory& Factory, const std::string& RecordingId, FNullEncodedImageSink& Sink)
+	{
+		std::map<std::string, std::string> Parameters;
+		if (!RecordingId.empty())
+		{
+			Parameters["x-millicast-recording"] = RecordingId;
+		}
+
+		std::unique_ptr<webrtc::VideoEncoder> Encoder = Factory.CreateVideoEncoder(webrtc::SdpVideoFormat("VP8", Parameters));
+		const webrtc::VideoCodec Codec = MakeCodec();
+		if (Encoder->InitEncode(&Codec, webrtc::VideoEncoder::Settings(webrtc::VideoEncoder::Capabilities(false), 1, 1200)) != WEBRTC_VIDEO_CODEC_OK)
+		{
+			return nullptr;
+		}
+		Encoder->RegisterEncodeCompleteCallback(&Sink);
+		return Encoder;
+	}
+
+	/** An encoded frame going through the adapter, as the encoder of the stream outputs it */
+	void SendFrame(webrtc::VideoEncoder& Encoder)
+	{
+		const uint8 Payload[] = { 0x10, 0x02, 0x00, 0x9D };
+		webrtc::EncodedImage Image;
+		Image.SetEncodedData(webrtc::EncodedImageBuffer::Create(Payload, sizeof(Payload)));
+		Image._frameType = webrtc::VideoFrameType::kVideoFrameKey;
+		Image._encodedWidth = Width;
+		Image._encodedHeight = Height;
+
+		webrtc::CodecSpecificInfo CodecInfo;
+		CodecInfo.codecType = webrtc::kVideoCodecVP8;
+
+		static_cast<FSimulcastVideoEncoder&>(Encoder).OnEncodedImage(0, Image, &CodecInfo
+#if WEBRTC_VERSION == 84
+			, nullptr
+#endif
+		);
+	}
+}
+
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FMillicastFailoverSwitchTest, "Millicast.Publisher.WebRTC.FailoverSwitch",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FMillicastFailoverSwitchTest::RunTest(const FString& Parameters)
+{
+	using namespace Millicast::Publisher;
+
+	FSimulcastEncoderFactory Factory;
+	FNullEncodedImageSink Sink;
+
+	// The primary and the backup each have their encoder, only the frames of the backup end the switch
+	std::unique_ptr<webrtc::VideoEncoder> Primary = CreatePublisherEncoder(Factory, "1", Sink);
+	std::unique_ptr<webrtc::VideoEncoder> Backup = CreatePublisherEncoder(Factory, "2", Sink);
+	std::unique_ptr<webrtc::VideoEncoder> Unnamed = CreatePublisherEncoder(Factory, "", Sink);
+	if (!TestTrue(TEXT("Encoders initialized"), Primary && Backup && Unnamed))
+	{
+		return true;
+	}
+
+	int32 NumCalls = 0;
+	uint64 SentCycles = 0;
+	const uint64 SwitchCycles = FPlatformTime::Cycles64();
+	Factory.NotifyNextFrameSent(TEXT("2"), [&NumCalls, &SentCycles](uint64 Cycles)
+	{
+		++NumCalls;
+		SentCycles = Cycles;
+	});
+
+	SendFrame(*Primary);
+	SendFrame(*Unnamed);
+	TestEqual(TEXT("Frames of the primary and unnamed encoders ignored"), NumCalls, 0);
+
+	SendFrame(*Backup);
+	TestEqual(TEXT("First frame of the backup"), NumCalls, 1);
+	TestTrue(TEXT("Sent after the switch started"), SentCycles >= SwitchCycles && SentCycles <= FPlatformTime::Cycles64());
+
+	SendFrame(*Backup);
+	TestEqual(TEXT("Called back once"), NumCalls, 1);
+
+	// A fail back before the backup sent anything cancels the wait
+	Factory.NotifyNextFrameSent(TEXT("2"), [&NumCalls](uint64) { ++NumCalls; });
+	Factory.NotifyNextFrameSent(TEXT("2"), nullptr);
+	SendFrame(*Backup);
+	TestEqual(TEXT("Cancelled wait not called back"), NumCalls, 1);
+
+	// Waiting again replaces the previous wait
+	int32 NumReplacedCalls = 0;
+	Factory.NotifyNextFrameSent(TEXT("2"), [&NumReplacedCalls](uint64) { ++NumReplacedCalls; });
+	Factory.NotifyNextFrameSent(TEXT("2"), [&NumCalls](uint64) { ++NumCalls; });
+	SendFrame(*Backup);
+	TestEqual(TEXT("Replaced wait not called back"), NumReplacedCalls, 0);
+	TestEqual(TEXT("Latest wait called back"), NumCalls, 2);
+
+	for (std::unique_ptr<webrtc::VideoEncoder>* Encoder : { &Primary, &Backup, &Unnamed })
+	{
+		(*Encoder)->RegisterEncodeCompleteCallback(nullptr);
+		(*Encoder)->Release();
+	}
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,306 @@
+// Copyright Dolby.io 2023. All Rights Reserved.
+
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "WebRTC/VideoEncoderH264Software.h"
+
+#include "api/video/i420_buffer.h"
+
+#if WITH_AVENCODER
+#include "WebRTC/AVEncoderContext.h"
+#include "VideoEncoderFactory.h"
+#include "RenderingThread.h"
+#endif
+
+namespace Millicast::Publisher
+{
+
+namespace
+{
+	constexpr int32 BenchmarkWidth = 1280;
+	constexpr int32 BenchmarkHeight = 720;
+	constexpr int32 BenchmarkFramerate = 60;
+	constexpr int32 BenchmarkNumFrames = 300;
+	constexpr int32 BenchmarkBitrateKbps = 4000;
+
+	struct FEncoderResults
+	{
+		int32 NumFrames = 0;
+		int64 NumBytes = 0;
+		double TotalEncodeMs = 0.0;
+		double MaxEncodeMs = 0.0;
+		double WallMs = 0.0;
+
+		void AddFrame(double EncodeMs, int64 Size)
+		{
+			++NumFrames;
+			NumBytes += Size;
+			TotalEncodeMs += EncodeMs;
+			MaxEncodeMs = FMath::Max(MaxEncodeMs, EncodeMs);
+		}
+
+		FString ToString(const TCHAR* Name) const
+		{
+			const double Seconds = NumFrames / double(BenchmarkFramerate);
+			return FString::Printf(TEXT("%s: %d frames, %.2f ms per frame (max %.2f ms), %.0f frames per second, %.2f Mbps"),
+				Name, NumFrames, TotalEncodeMs / FMath::Max(NumFrames, 1), MaxEncodeMs,
+				NumFrames * 1000.0 / FMath::Max(WallMs, 1.0), Seconds > 0.0 ? NumBytes * 8 / Seconds / 1000000.0 : 0.0);
+		}
+	};
+
+	/** Moving gradient with some noise so that every frame has something to encode */
+	uint8 GetPatternValue(int32 X, int32 Y, int32 Frame)
+	{
+		const uint32 Noise = (uint32(X) * 73856093u ^ uint32(Y) * 19349663u ^ uint32(Frame) * 83492791u) >> 28;
+		return uint8((X + Y + Frame * 4 + Noise) & 0xFF);
+	}
+
+	class FEncodedImageCounter : public webrtc::EncodedImageCallback
+	{
+	public:
+#if WEBRTC_VERSION == 84
+		Result OnEncodedImage(const webrtc::EncodedImage& EncodedImage, const webrtc::CodecSpecificInfo*, const webrtc::RTPFragmentationHeader*) override
+#else
+		Result OnEncodedImage(const webrtc::EncodedImage& EncodedImage, const webrtc::CodecSpecificInfo*) override
+#endif
+		{
+			LastSize = EncodedImage.size();
+			return Result(Result::OK);
+		}
+
+		int64 LastSize = 0;
+	};
+
+	/** OpenH264 encodes synchronously, each frame is timed around its Encode call */
+	FEncoderResults RunSoftwareEncoder()
+	{
+		FEncoderResults Results;
+
+		const webrtc::SdpVideoFormat Format(cricket::kH264CodecName, { { cricket::kH264FmtpPacketizationMode, "1" } });
+		FVideoEncoderH264Software Encoder(Format);
+
+		webrtc::VideoCodec Codec;
+		Codec.codecType = webrtc::kVideoCodecH264;
+		Codec.width = BenchmarkWidth;
+		Codec.height = BenchmarkHeight;
+		Codec.startBitrate = BenchmarkBitrateKbps;
+		Codec.maxBitrate = BenchmarkBitrateKbps;
+		Codec.minBitrate = 100;
+		Codec.maxFramerate = BenchmarkFramerate;
+		Codec.qpMax = 56;
+		*Codec.H264() = webrtc::VideoEncoder::GetDefaultH264Settings();
+		Codec.H264()->frameDroppingOn = false;
+
+		const webrtc::VideoEncoder::Settings Settings(webrtc::VideoEncoder::Capabilities(false), FPlatformMisc::NumberOfCores(), 1200);
+		if (Encoder.InitEncode(&Codec, Settings) != WEBRTC_VIDEO_CODEC_OK)
+		{
+			return Results;
+		}
+
+		FEncodedImageCounter Counter;
+		Encoder.RegisterEncodeCompleteCallback(&Counter);
+
+		webrtc::VideoBitrateAllocation Allocation;
+		Allocation.SetBitrate(0, 0, BenchmarkBitrateKbps * 1000);
+		Encoder.SetRates(webrtc::VideoEncoder::RateControlParameters(Allocation, BenchmarkFramerate));
+
+		const uint64 StartCycles = FPlatformTime::Cycles64();
+
+		for (int32 FrameIndex = 0; FrameIndex < BenchmarkNumFrames; ++FrameIndex)
+		{
+			rtc::scoped_refptr<webrtc::I420Buffer> Buffer = webrtc::I420Buffer::Create(BenchmarkWidth, BenchmarkHeight);
+			for (int32 Y = 0; Y < BenchmarkHeight; ++Y)
+			{
+				for (int32 X = 0; X < BenchmarkWidth; ++X)
+				{
+					Buffer->MutableDataY()[Y * Buffer->StrideY() + X] = GetPatternValue(X, Y, FrameIndex);
+				}
+			}
+			for (int32 Y = 0; Y < Buffer->ChromaHeight(); ++Y)
+			{
+				FMemory::Memset(Buffer->MutableDataU() + Y * Buffer->StrideU(), 128, Buffer->ChromaWidth());
+				FMemory::Memset(Buffer->MutableDataV() + Y * Buffer->StrideV(), uint8(96 + FrameIndex % 64), Buffer->ChromaWidth());
+			}
+
+			const webrtc::VideoFrame Frame = webrtc::VideoFrame::Builder()
+				.set_video_frame_buffer(Buffer)
+				.set_timestamp_rtp(FrameIndex * 90000 / BenchmarkFramerate)
+				.set_timestamp_us(int64(FrameIndex) * rtc::kNumMicrosecsPerSec / BenchmarkFramerate)
+				.build();
+
+			const std::vector<webrtc::VideoFrameType> FrameTypes { FrameIndex == 0 ? webrtc::VideoFrameType::kVideoFrameKey : webrtc::VideoFrameType::kVideoFrameDelta };
+
+			Counter.LastSize = 0;
+			const uint64 EncodeStartCycles = FPlatformTime::Cycles64();
+			Encoder.Encode(Frame, &FrameTypes);
+			Results.AddFrame(FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - EncodeStartCycles), Counter.LastSize);
+		}
+
+		Results.WallMs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles);
+
+		Encoder.RegisterEncodeCompleteCallback(nullptr);
+		Encoder.Release();
+		return Results;
+	}
+
+#if WITH_AVENCODER
+	/**
+	 * The hardware encoder is driven through AVEncoder directly, like the capturer does, with a pattern uploaded to the
+	 * capture texture. Frames are encoded asynchronously, the encode time is the one reported with each packet.
+	 */
+	TOptional<FEncoderResults> RunHardwareEncoder()
+	{
+		const TArray<AVEncoder::FVideoEncoderInfo>& Available = AVEncoder::FVideoEncoderFactory::Get().GetAvailable();
+		if (!GDynamicRHI || !AVEncoder::FVideoEncoderFactory::Get().IsSetup() || Available.Num() == 0)
+		{
+			return {};
+		}
+
+		FAVEncoderContext Context(BenchmarkWidth, BenchmarkHeight, true);
+		if (!Context.GetVideoEncoderInput())
+		{
+			return {};
+		}
+
+		AVEncoder::FVideoEncoder::FLayerConfig Config;
+		Config.Width = BenchmarkWidth;
+		Config.Height = BenchmarkHeight;
+		Config.MaxFramerate = BenchmarkFramerate;
+		Config.TargetBitrate = BenchmarkBitrateKbps * 1000;
+		Config.MaxBitrate = BenchmarkBitrateKbps * 1000;
+		Config.RateControlMode = AVEncoder::FVideoEncoder::RateControlMode::VBR;
+
+		TSharedPtr<AVEncoder::FVideoEncoder> Encoder(AVEncoder::FVideoEncoderFactory::Get().Create(Available[0].ID, Context.GetVideoEncoderInput(), Config).Release());
+		if (!Encoder)
+		{
+			return {};
+		}
+
+		FEncoderResults Results;
+		FCriticalSection ResultsSection;
+		FEvent* AllEncoded = FPlatformProcess::GetSynchEventFromPool(true);
+
+		Encoder->SetOnEncodedPacket([&Results, &ResultsSection, AllEncoded](uint32, const FVideoEncoderInputFrameType, const AVEncoder::FCodecPacket& Packet)
+			{
+				FScopeLock Lock(&ResultsSection);
+				Results.AddFrame((Packet.Timings.FinishTs - Packet.Timings.StartTs).GetTotalMilliseconds(), Packet.DataSize);
+				if (Results.NumFrames == BenchmarkNumFrames)
+				{
+					AllEncoded->Trigger();
+				}
+			});
+
+		TArray<uint8> Pixels;
+		Pixels.SetNumUninitialized(BenchmarkWidth * BenchmarkHeight * 4);
+
+		const uint64 StartCycles = FPlatformTime::Cycles64();
+
+		for (int32 FrameIndex = 0; FrameIndex < BenchmarkNumFrames; ++FrameIndex)
+		{
+			// Input frames come back once the encoder is done with them
+			FCapturedInput Input = Context.ObtainCapturedInput();
+			for (int32 Retry = 0; !Input.InputFrame && Retry < 1000; ++Retry)
+			{
+				FPlatformProcess::Sleep(0.001f);
+				Input = Context.ObtainCapturedInput();
+			}
+
+			if (!Input.InputFrame || !Input.Texture.IsSet())
+			{
+				break;
+			}
+
+			for (int32 Y = 0; Y < BenchmarkHeight; ++Y)
+			{
+				for (int32 X = 0; X < BenchmarkWidth; ++X)
+				{
+					const uint8 Value = GetPatternValue(X, Y, FrameIndex);
+					uint8* Pixel = &Pixels[(Y * BenchmarkWidth + X) * 4];
+					Pixel[0] = Value;
+					Pixel[1] = Value;
+					Pixel[2] = uint8(Value + FrameIndex);
+					Pixel[3] = 255;
+				}
+			}
+
+			FVideoEncoderInputFrameType InputFrame = Input.InputFrame;
+			FTexture2DRHIRef Texture = Input.Texture.GetValue();
+
+			InputFrame->SetTimestampRTP(FrameIndex * 90000 / BenchmarkFramerate);
+#if ENGINE_MAJOR_VERSION < 5 || ENGINE_MINOR_VERSION == 0
+#else
+			InputFrame->SetWidth(BenchmarkWidth);
+			InputFrame->SetHeight(BenchmarkHeight);
+#endif
+
+			AVEncoder::FVideoEncoder::FEncodeOptions Options;
+			Options.bForceKeyFrame = FrameIndex == 0;
+
+			ENQUEUE_RENDER_COMMAND(MillicastEncoderBenchmark)([Encoder, InputFrame, Texture, Options, &Pixels](FRHICommandListImmediate& RHICmdList)
+				{
+					RHICmdList.UpdateTexture2D(Texture, 0, FUpdateTextureRegion2D(0, 0, 0, 0, BenchmarkWidth, BenchmarkHeight), BenchmarkWidth * 4, Pixels.GetData());
+					Encoder->Encode(InputFrame, Options);
+					InputFrame->Release();
+				});
+
+			FlushRenderingCommands();
+		}
+
+		AllEncoded->Wait(FTimespan::FromSeconds(10));
+		FPlatformProcess::ReturnSynchEventToPool(AllEncoded);
+
+		{
+			FScopeLock Lock(&ResultsSection);
+			Results.WallMs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles);
+		}
+
+		// The encoder releases its input frames before the context destroys their textures
+		Encoder->SetOnEncodedPacket([](uint32, const FVideoEncoderInputFrameType, const AVEncoder::FCodecPacket&) {});
+		Encoder.Reset();
+
+		return Results;
+	}
+#endif
+}
+
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FMillicastH264EncoderBenchmark, "Millicast.Publisher.Benchmark.H264Encoders",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+
+bool FMillicastH264EncoderBenchmark::RunTest(const FString& Parameters)
+{
+	using namespace Millicast::Publisher;
+
+	AddInfo(FString::Printf(TEXT("%d frames of %dx%d at %d fps, %d kbps"), BenchmarkNumFrames, BenchmarkWidth, BenchmarkHeight, BenchmarkFramerate, BenchmarkBitrateKbps));
+
+	if (FVideoEncoderH264Software::IsSupported())
+	{
+		const FEncoderResults Software = RunSoftwareEncoder();
+		TestTrue(TEXT("OpenH264 encoded frames"), Software.NumFrames > 0 && Software.NumBytes > 0);
+		AddInfo(Software.ToString(TEXT("OpenH264")));
+	}
+	else
+	{
+		AddInfo(TEXT("libwebrtc is built without OpenH264, the software encoder is skipped"));
+	}
+
+#if WITH_AVENCODER
+	const TOptional<FEncoderResults> Hardware = RunHardwareEncoder();
+	if (Hardware.IsSet())
+	{
+		TestEqual(TEXT("Hardware encoded frames"), Hardware->NumFrames, BenchmarkNumFrames);
+		AddInfo(Hardware->ToString(TEXT("Hardware")));
+	}
+	else
+	{
+		AddInfo(TEXT("No hardware H264 encoder for this RHI, the hardware encoder is skipped"));
+	}
+#endif
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,254 @@
+// Copyright Dolby.io 2023. All Rights Reserved.
+
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "WebRTC/H264NalIndexer.h"
+
+#include "Math/RandomStream.h"
+
+namespace Millicast::Publisher
+{
+
+namespace
+{
+	using FNalUnitArray = TArray<FH264NalUnit>;
+
+	/** Byte by byte scan, the behaviour the indexer must reproduce */
+	FNalUnitArray IndexNaive(const uint8* Bitstream, size_t Size)
+	{
+		FNalUnitArray Units;
+
+		auto CloseLast = [&Units, Bitstream](size_t End)
+		{
+			if (Units.Num() > 0)
+			{
+				FH264NalUnit& Last = Units.Last();
+				while (End > Last.Offset && Bitstream[End - 1] == 0)
+				{
+					--End;
+				}
+				Last.Size = static_cast<uint32>(End - Last.Offset);
+			}
+		};
+
+		for (size_t i = 0; i + 3 <= Size; ++i)
+		{
+			if (Bitstream[i] == 0 && Bitstream[i + 1] == 0 && Bitstream[i + 2] == 1)
+			{
+				const uint8 StartCodeLength = (i > 0 && Bitstream[i - 1] == 0) ? 4 : 3;
+				CloseLast(i + 3 - StartCodeLength);
+				Units.Add({ static_cast<uint32>(i + 3), 0, StartCodeLength });
+			}
+		}
+
+		CloseLast(Size);
+
+		return Units;
+	}
+
+	/** Random bytes, zeros and ones are much more likely than in real data to produce start codes everywhere */
+	TArray<uint8> MakeRandomBitstream(FRandomStream& Random, int32 Size)
+	{
+		TArray<uint8> Bitstream;
+		Bitstream.SetNumUninitialized(Size);
+
+		for (uint8& Byte : Bitstream)
+		{
+			const int32 Roll = Random.RandHelper(8);
+			Byte = Roll < 4 ? 0 : (Roll == 4 ? 1 : static_cast<uint8>(Random.RandHelper(256)));
+		}
+
+		return Bitstream;
+	}
+
+	/**
+	 * Annex B stream of NAL units whose payload is mostly zeros, so that it is full of emulation prevention bytes.
+	 * The expected units are returned alongside.
+	 */
+	TArray<uint8> MakeEmulationPreventedBitstream(FRandomStream& Random, int32 NumUnits, FNalUnitArray& OutUnits)
+	{
+		TArray<uint8> Bitstream;
+		OutUnits.Reset();
+
+		for (int32 UnitIndex = 0; UnitIndex < NumUnits; ++UnitIndex)
+		{
+			if (Random.RandHelper(2))
+			{
+				Bitstream.Add(0);
+			}
+
+			// A trailing zero of the previous unit reads as the zero_byte of a 4 bytes start code too
+			const uint8 StartCodeLength = Bitstream.Num() > 0 && Bitstream.Last() == 0 ? 4 : 3;
+			Bitstream.Append({ 0, 0, 1 });
+
+			const uint32 Offset = Bitstream.Num();
+			Bitstream.Add(static_cast<uint8>(0x60 | Random.RandHelper(32))); // forbidden_zero_bit unset
+
+			int32 NumZeros = 0;
+			const int32 PayloadSize = 1 + Random.RandHelper(600);
+			for (int32 i = 0; i < PayloadSize; ++i)
+			{
+				const int32 Roll = Random.RandHelper(16);
+				uint8 Byte = Roll < 10 ? 0 : static_cast<uint8>(Roll < 14 ? Roll - 10 : Random.RandHelper(256));
+
+				// rbsp_trailing_bits, the last byte of a NAL unit is never zero
+				if (i == PayloadSize - 1 && Byte == 0)
+				{
+					Byte = 0x80;
+				}
+
+				if (NumZeros == 2 && Byte <= 3)
+				{
+					Bitstream.Add(3);
+					NumZeros = 0;
+				}
+
+				Bitstream.Add(Byte);
+				NumZeros = Byte == 0 ? NumZeros + 1 : 0;
+			}
+
+			OutUnits.Add({ Offset, static_cast<uint32>(Bitstream.Num() - Offset), StartCodeLength });
+
+			// trailing_zero_8bits
+			for (int32 i = Random.RandHelper(3); i > 0; --i)
+			{
+				Bitstream.Add(0);
+			}
+		}
+
+		return Bitstream;
+	}
+
+	bool IsSameUnits(const FH264NalIndexer::FNalUnits& Units, const FNalUnitArray& Expected)
+	{
+		if (Units.Num() != Expected.Num())
+		{
+			return false;
+		}
+
+		for (int32 i = 0; i < Units.Num(); ++i)
+		{
+			if (Units[i].Offset != Expected[i].Offset || Units[i].Size != Expected[i].Size || Units[i].StartCodeLength != Expected[i].StartCodeLength)
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+}
+
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FMillicastH264NalIndexerTest, "Millicast.Publisher.WebRTC.H264NalIndexer",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FMillicastH264NalIndexerTest::RunTest(const FString& Parameters)
+{
+	using namespace Millicast::Publisher;
+
+	FH264NalIndexer Indexer;
+	FRandomStream Random(0x264);
+
+	TestEqual(TEXT("Null bitstream"), Indexer.Index(nullptr, 16).Num(), 0);
+
+	const uint8 StartCodeOnly[] = { 0, 0, 1 };
+	TestEqual(TEXT("Too short bitstream"), Indexer.Index(StartCodeOnly, 2).Num(), 0);
+
+	const FH264NalIndexer::FNalUnits& Empty = Indexer.Index(StartCodeOnly, 3);
+	TestTrue(TEXT("Start code without payload"), Empty.Num() == 1 && Empty[0].Offset == 3 && Empty[0].Size == 0);
+
+	// A start code at every position of buffers around the 16 bytes blocks, so each lane and the scalar tail are hit
+	for (int32 Size = 3; Size <= 70; ++Size)
+	{
+		for (int32 Position = 0; Position + 3 <= Size; ++Position)
+		{
+			TArray<uint8> Bitstream;
+			Bitstream.Init(0xAB, Size);
+			Bitstream[Position] = 0;
+			Bitstream[Position + 1] = 0;
+			Bitstream[Position + 2] = 1;
+
+			if (!IsSameUnits(Indexer.Index(Bitstream.GetData(), Size), IndexNaive(Bitstream.GetData(), Size)))
+			{
+				AddError(FString::Printf(TEXT("Start code at %d of %d bytes"), Position, Size));
+			}
+		}
+	}
+
+	for (int32 Iteration = 0; Iteration < 200; ++Iteration)
+	{
+		const TArray<uint8> Bitstream = MakeRandomBitstream(Random, 1 + Random.RandHelper(4096));
+		if (!IsSameUnits(Indexer.Index(Bitstream.GetData(), Bitstream.Num()), IndexNaive(Bitstream.GetData(), Bitstream.Num())))
+		{
+			AddError(FString::Printf(TEXT("Random bitstream %d of %d bytes"), Iteration, Bitstream.Num()));
+		}
+	}
+
+	for (int32 Iteration = 0; Iteration < 50; ++Iteration)
+	{
+		FNalUnitArray Expected;
+		const TArray<uint8> Bitstream = MakeEmulationPreventedBitstream(Random, 1 + Random.RandHelper(20), Expected);
+		if (!IsSameUnits(Indexer.Index(Bitstream.GetData(), Bitstream.Num()), Expected))
+		{
+			AddError(FString::Printf(TEXT("Emulation prevented bitstream %d of %d bytes"), Iteration, Bitstream.Num()));
+		}
+	}
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FMillicastH264NalIndexerBenchmark, "Millicast.Publisher.Benchmark.H264NalIndexer",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+
+bool FMillicastH264NalIndexerBenchmark::RunTest(const FString& Parameters)
+{
+	using namespace Millicast::Publisher;
+
+	constexpr int32 NumIterations = 200;
+
+	FRandomStream Random(0x264);
+	FNalUnitArray Unused;
+
+	const TPair<const TCHAR*, TArray<uint8>> Inputs[] = {
+		{ TEXT("Random"), MakeRandomBitstream(Random, 1 << 20) },
+		{ TEXT("Emulation prevention"), MakeEmulationPreventedBitstream(Random, 3500, Unused) },
+	};
+
+	FH264NalIndexer Indexer;
+
+	for (const TPair<const TCHAR*, TArray<uint8>>& Input : Inputs)
+	{
+		const uint8* Data = Input.Value.GetData();
+		const int32 Size = Input.Value.Num();
+
+		int32 NumUnits = 0;
+		uint64 StartCycles = FPlatformTime::Cycles64();
+		for (int32 i = 0; i < NumIterations; ++i)
+		{
+			NumUnits = Indexer.Index(Data, Size).Num();
+		}
+		const double IndexerMs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles);
+
+		int32 NumNaiveUnits = 0;
+		StartCycles = FPlatformTime::Cycles64();
+		for (int32 i = 0; i < NumIterations; ++i)
+		{
+			NumNaiveUnits = IndexNaive(Data, Size).Num();
+		}
+		const double NaiveMs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles);
+
+		TestEqual(FString::Printf(TEXT("%s NAL units"), Input.Key), NumUnits, NumNaiveUnits);
+
+		const double MegaBytes = double(Size) * NumIterations / (1024.0 * 1024.0);
+		AddInfo(FString::Printf(TEXT("%s: %d bytes, %d NAL units, indexer %.0f MB/s, byte by byte %.0f MB/s (x%.1f)"),
+			Input.Key, Size, NumUnits, MegaBytes * 1000.0 / FMath::Max(IndexerMs, 0.001), MegaBytes * 1000.0 / FMath::Max(NaiveMs, 0.001),
+			NaiveMs / FMath::Max(IndexerMs, 0.001)));
+	}
+
+	return true;
+}
+
+#endif
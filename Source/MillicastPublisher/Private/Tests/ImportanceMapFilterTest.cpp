@@ -0,0 +1,227 @@
+// Copyright Dolby.io 2023. All Rights Reserved.
+
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "WebRTC/ImportanceMapFilter.h"
+
+namespace Millicast::Publisher
+{
+
+namespace
+{
+	/** A plane of the original frame and the same plane once filtered */
+	struct FPlanes
+	{
+		const uint8* Original;
+		int32 OriginalStride;
+		const uint8* Filtered;
+		int32 FilteredStride;
+	};
+
+	FPlanes GetPlanesY(const webrtc::I420Buffer& Original, const webrtc::I420Buffer& Filtered)
+	{
+		return { Original.DataY(), Original.StrideY(), Filtered.DataY(), Filtered.StrideY() };
+	}
+
+	FPlanes GetPlanesU(const webrtc::I420Buffer& Original, const webrtc::I420Buffer& Filtered)
+	{
+		return { Original.DataU(), Original.StrideU(), Filtered.DataU(), Filtered.StrideU() };
+	}
+
+	FPlanes GetPlanesV(const webrtc::I420Buffer& Original, const webrtc::I420Buffer& Filtered)
+	{
+		return { Original.DataV(), Original.StrideV(), Filtered.DataV(), Filtered.StrideV() };
+	}
+
+	/** Noise everywhere, nothing is flat before the filter */
+	rtc::scoped_refptr<webrtc::I420Buffer> MakeNoiseFrame(int32 Width, int32 Height, int32 Seed)
+	{
+		rtc::scoped_refptr<webrtc::I420Buffer> Buffer = webrtc::I420Buffer::Create(Width, Height);
+		FRandomStream Random(Seed);
+		const auto Fill = [&Random](uint8* Plane, int32 Stride, int32 PlaneWidth, int32 PlaneHeight)
+		{
+			for (int32 y = 0; y < PlaneHeight; ++y)
+			{
+				for (int32 x = 0; x < PlaneWidth; ++x)
+				{
+					Plane[y * Stride + x] = static_cast<uint8>(Random.RandRange(0, 255));
+				}
+			}
+		};
+		Fill(Buffer->MutableDataY(), Buffer->StrideY(), Buffer->width(), Buffer->height());
+		Fill(Buffer->MutableDataU(), Buffer->StrideU(), Buffer->ChromaWidth(), Buffer->ChromaHeight());
+		Fill(Buffer->MutableDataV(), Buffer->StrideV(), Buffer->ChromaWidth(), Buffer->ChromaHeight());
+		return Buffer;
+	}
+
+	bool IsUnchanged(const FPlanes& Planes, int32 X0, int32 Y0, int32 X1, int32 Y1)
+	{
+		for (int32 y = Y0; y < Y1; ++y)
+		{
+			if (FMemory::Memcmp(Planes.Original + y * Planes.OriginalStride + X0, Planes.Filtered + y * Planes.FilteredStride + X0, X1 - X0) != 0)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	/** Whether each block of the area, clipped to it, is filled with the rounded average of the original block */
+	bool IsAveraged(const FPlanes& Planes, int32 X0, int32 Y0, int32 X1, int32 Y1, int32 BlockSize)
+	{
+		for (int32 BlockY = Y0; BlockY < Y1; BlockY += BlockSize)
+		{
+			for (int32 BlockX = X0; BlockX < X1; BlockX += BlockSize)
+			{
+				const int32 BlockX1 = FMath::Min(BlockX + BlockSize, X1);
+				const int32 BlockY1 = FMath::Min(BlockY + BlockSize, Y1);
+
+				uint32 Sum = 0;
+				for (int32 y = BlockY; y < BlockY1; ++y)
+				{
+					for (int32 x = BlockX; x < BlockX1; ++x)
+					{
+						Sum += Planes.Original[y * Planes.OriginalStride + x];
+					}
+				}
+				const uint32 NumPixels = (BlockX1 - BlockX) * (BlockY1 - BlockY);
+				const uint8 Average = static_cast<uint8>((Sum + NumPixels / 2) / NumPixels);
+
+				for (int32 y = BlockY; y < BlockY1; ++y)
+				{
+					for (int32 x = BlockX; x < BlockX1; ++x)
+					{
+						if (Planes.Filtered[y * Planes.FilteredStride + x] != Average)
+						{
+							return false;
+						}
+					}
+				}
+			}
+		}
+		return true;
+	}
+
+	/** First luma row or column of a cell, even as the filter keeps them */
+	int32 GetCellStart(int32 Cell, int32 NumCells, int32 Size)
+	{
+		return Cell == NumCells ? Size : (Cell * Size / NumCells) & ~1;
+	}
+}
+
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FMillicastImportanceMapFilterTest, "Millicast.Publisher.WebRTC.ImportanceMapFilter",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FMillicastImportanceMapFilterTest::RunTest(const FString& Parameters)
+{
+	using namespace Millicast::Publisher;
+
+	// One cell of each kind on a 64x48 frame, each 32x24
+	{
+		const rtc::scoped_refptr<webrtc::I420Buffer> Original = MakeNoiseFrame(64, 48, 35);
+		rtc::scoped_refptr<webrtc::I420Buffer> Filtered = webrtc::I420Buffer::Copy(*Original);
+
+		FMillicastImportanceMap Map;
+		Map.Width = 2;
+		Map.Height = 2;
+		Map.Values = { 255, 128, 0, 192 };
+		ApplyImportanceMap(Map, *Filtered);
+
+		const FPlanes Y = GetPlanesY(*Original, *Filtered);
+		const FPlanes U = GetPlanesU(*Original, *Filtered);
+		const FPlanes V = GetPlanesV(*Original, *Filtered);
+
+		TestTrue(TEXT("Protected cell, luma bit-exact"), IsUnchanged(Y, 0, 0, 32, 24));
+		TestTrue(TEXT("Protected cell, chroma bit-exact"), IsUnchanged(U, 0, 0, 16, 12) && IsUnchanged(V, 0, 0, 16, 12));
+		TestTrue(TEXT("Cell at the threshold, luma bit-exact"), IsUnchanged(Y, 32, 24, 64, 48));
+		TestTrue(TEXT("Cell at the threshold, chroma bit-exact"), IsUnchanged(U, 16, 12, 32, 24) && IsUnchanged(V, 16, 12, 32, 24));
+
+		TestTrue(TEXT("Medium cell, luma averaged by 2x2 blocks"), IsAveraged(Y, 32, 0, 64, 24, 2));
+		TestTrue(TEXT("Medium cell, chroma kept"), IsUnchanged(U, 16, 0, 32, 12) && IsUnchanged(V, 16, 0, 32, 12));
+
+		TestTrue(TEXT("Low cell, luma averaged by 4x4 blocks"), IsAveraged(Y, 0, 24, 32, 48, 4));
+		TestTrue(TEXT("Low cell, chroma averaged by 2x2 blocks"), IsAveraged(U, 0, 12, 16, 24, 2) && IsAveraged(V, 0, 12, 16, 24, 2));
+	}
+
+	// Odd frame size, the last blocks are partial and the chroma planes round up to 31x18
+	{
+		const rtc::scoped_refptr<webrtc::I420Buffer> Original = MakeNoiseFrame(61, 35, 36);
+		rtc::scoped_refptr<webrtc::I420Buffer> Filtered = webrtc::I420Buffer::Copy(*Original);
+
+		FMillicastImportanceMap Map;
+		Map.Width = 1;
+		Map.Height = 1;
+		Map.Values = { 0 };
+		ApplyImportanceMap(Map, *Filtered);
+
+		TestTrue(TEXT("Odd size, luma averaged up to the edges"), IsAveraged(GetPlanesY(*Original, *Filtered), 0, 0, 61, 35, 4));
+		TestTrue(TEXT("Odd size, chroma averaged up to the edges"),
+			IsAveraged(GetPlanesU(*Original, *Filtered), 0, 0, 31, 18, 2) && IsAveraged(GetPlanesV(*Original, *Filtered), 0, 0, 31, 18, 2));
+	}
+
+	// Cells that don't divide the odd frame evenly: protected ones stay bit-exact next to averaged ones
+	{
+		constexpr int32 Width = 61;
+		constexpr int32 Height = 35;
+		const rtc::scoped_refptr<webrtc::I420Buffer> Original = MakeNoiseFrame(Width, Height, 37);
+		rtc::scoped_refptr<webrtc::I420Buffer> Filtered = webrtc::I420Buffer::Copy(*Original);
+
+		FMillicastImportanceMap Map;
+		Map.Width = 3;
+		Map.Height = 3;
+		Map.Values = { 255, 0, 255, 0, 255, 0, 255, 0, 255 };
+		ApplyImportanceMap(Map, *Filtered);
+
+		const FPlanes Y = GetPlanesY(*Original, *Filtered);
+		const FPlanes U = GetPlanesU(*Original, *Filtered);
+		const FPlanes V = GetPlanesV(*Original, *Filtered);
+
+		for (int32 CellY = 0; CellY < Map.Height; ++CellY)
+		{
+			for (int32 CellX = 0; CellX < Map.Width; ++CellX)
+			{
+				const int32 X0 = GetCellStart(CellX, Map.Width, Width);
+				const int32 X1 = GetCellStart(CellX + 1, Map.Width, Width);
+				const int32 Y0 = GetCellStart(CellY, Map.Height, Height);
+				const int32 Y1 = GetCellStart(CellY + 1, Map.Height, Height);
+				const FString Cell = FString::Printf(TEXT("Cell %d,%d"), CellX, CellY);
+
+				if (Map.Values[CellY * Map.Width + CellX] >= 192)
+				{
+					TestTrue(Cell + TEXT(" protected, luma bit-exact"), IsUnchanged(Y, X0, Y0, X1, Y1));
+					TestTrue(Cell + TEXT(" protected, chroma bit-exact"),
+						IsUnchanged(U, X0 / 2, Y0 / 2, (X1 + 1) / 2, (Y1 + 1) / 2) && IsUnchanged(V, X0 / 2, Y0 / 2, (X1 + 1) / 2, (Y1 + 1) / 2));
+				}
+				else
+				{
+					TestTrue(Cell + TEXT(" low, luma averaged"), IsAveraged(Y, X0, Y0, X1, Y1, 4));
+					TestTrue(Cell + TEXT(" low, chroma averaged"),
+						IsAveraged(U, X0 / 2, Y0 / 2, (X1 + 1) / 2, (Y1 + 1) / 2, 2) && IsAveraged(V, X0 / 2, Y0 / 2, (X1 + 1) / 2, (Y1 + 1) / 2, 2));
+				}
+			}
+		}
+	}
+
+	// A map that doesn't match its size is ignored
+	{
+		const rtc::scoped_refptr<webrtc::I420Buffer> Original = MakeNoiseFrame(32, 32, 38);
+		rtc::scoped_refptr<webrtc::I420Buffer> Filtered = webrtc::I420Buffer::Copy(*Original);
+
+		FMillicastImportanceMap Map;
+		Map.Width = 2;
+		Map.Height = 2;
+		Map.Values = { 0, 0, 0 };
+		ApplyImportanceMap(Map, *Filtered);
+
+		TestTrue(TEXT("Invalid map, frame untouched"), IsUnchanged(GetPlanesY(*Original, *Filtered), 0, 0, 32, 32)
+			&& IsUnchanged(GetPlanesU(*Original, *Filtered), 0, 0, 16, 16) && IsUnchanged(GetPlanesV(*Original, *Filtered), 0, 0, 16, 16));
+	}
+
+	return true;
+}
+
+#endif
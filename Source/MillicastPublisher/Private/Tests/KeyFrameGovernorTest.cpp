@@ -0,0 +1,123 @@
+// Copyright Dolby.io 2023. All Rights Reserved.
+
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "WebRTC/KeyFrameGovernor.h"
+#include "WebRTC/Stats.h"
+
+namespace Millicast::Publisher
+{
+
+namespace
+{
+	constexpr int32 NumStreams = 3;
+
+	FKeyFrameGovernor MakeGovernor(int32 MinIntervalMs, bool bPerLayer)
+	{
+		FKeyFrameGovernorSettings Settings;
+		Settings.MinIntervalMs = MinIntervalMs;
+		Settings.bPerLayer = bPerLayer;
+
+		FKeyFrameGovernor Governor;
+		Governor.SetSettings(Settings);
+		Governor.Reset();
+		return Governor;
+	}
+
+	/** Pending layers as a bit mask */
+	uint32 GetPendingStreams(const FKeyFrameGovernor& Governor, int64 NowMs)
+	{
+		uint32 Mask = 0;
+		for (int32 StreamIndex = 0; StreamIndex < NumStreams; ++StreamIndex)
+		{
+			Mask |= Governor.ShouldEncodeKeyFrame(StreamIndex, NowMs) ? 1u << StreamIndex : 0;
+		}
+		return Mask;
+	}
+
+	void SubmitKeyFrames(FKeyFrameGovernor& Governor, int64 NowMs)
+	{
+		for (int32 StreamIndex = 0; StreamIndex < NumStreams; ++StreamIndex)
+		{
+			if (Governor.ShouldEncodeKeyFrame(StreamIndex, NowMs))
+			{
+				Governor.OnKeyFrameSubmitted(StreamIndex, NowMs);
+			}
+		}
+	}
+}
+
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FMillicastKeyFrameGovernorTest, "Millicast.Publisher.WebRTC.KeyFrameGovernor",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FMillicastKeyFrameGovernorTest::RunTest(const FString& Parameters)
+{
+	using namespace Millicast::Publisher;
+
+	FPublisherStats& Stats = FPublisherStats::Get();
+
+	// All layers refreshed together
+	{
+		FKeyFrameGovernor Governor = MakeGovernor(300, false);
+		TestEqual(TEXT("Nothing pending at first"), GetPendingStreams(Governor, 1000), 0u);
+
+		const int32 Requested = Stats.GetKeyFramesRequested();
+		Governor.OnKeyFrameRequested(1);
+		TestEqual(TEXT("A request on one layer refreshes all of them"), GetPendingStreams(Governor, 1000), 0b111u);
+		TestEqual(TEXT("A request is counted once"), Stats.GetKeyFramesRequested(), Requested + 1);
+
+		SubmitKeyFrames(Governor, 1000);
+		TestEqual(TEXT("Submitting the key frames satisfies the request"), GetPendingStreams(Governor, 1000), 0u);
+
+		// A burst of PLI right after the key frame is merged into a single one once the interval has elapsed
+		for (int32 i = 0; i < 10; ++i)
+		{
+			Governor.OnKeyFrameRequested(i % NumStreams);
+		}
+		TestEqual(TEXT("Requests within the interval wait"), GetPendingStreams(Governor, 1299), 0u);
+		TestEqual(TEXT("Requests are served once the interval has elapsed"), GetPendingStreams(Governor, 1300), 0b111u);
+		SubmitKeyFrames(Governor, 1300);
+		TestEqual(TEXT("The burst gives a single key frame"), GetPendingStreams(Governor, 5000), 0u);
+
+		const int32 RequestedForStreams = Stats.GetKeyFramesRequested();
+		Governor.OnKeyFrameRequestedForStreams(0b111);
+		TestEqual(TEXT("A request for several layers is counted once"), Stats.GetKeyFramesRequested(), RequestedForStreams + 1);
+		Governor.OnKeyFrameRequestedForStreams(0);
+		TestEqual(TEXT("An empty request is not counted"), Stats.GetKeyFramesRequested(), RequestedForStreams + 1);
+	}
+
+	// Layers refreshed independently
+	{
+		FKeyFrameGovernor Governor = MakeGovernor(300, true);
+
+		Governor.OnKeyFrameRequested(2);
+		TestEqual(TEXT("Only the requesting layer is refreshed"), GetPendingStreams(Governor, 1000), 0b100u);
+		SubmitKeyFrames(Governor, 1000);
+
+		Governor.OnKeyFrameRequestedForStreams(0b101);
+		TestEqual(TEXT("The layer that just sent a key frame waits"), GetPendingStreams(Governor, 1100), 0b001u);
+		TestEqual(TEXT("Then both layers are refreshed"), GetPendingStreams(Governor, 1300), 0b101u);
+
+		Governor.CancelRequest(0);
+		TestEqual(TEXT("A layer that is not sent drops its request"), GetPendingStreams(Governor, 1300), 0b100u);
+	}
+
+	// Out of range layers are ignored
+	{
+		FKeyFrameGovernor Governor = MakeGovernor(0, true);
+		const int32 Requested = Stats.GetKeyFramesRequested();
+		Governor.OnKeyFrameRequested(-1);
+		Governor.OnKeyFrameRequested(webrtc::kMaxSimulcastStreams);
+		Governor.OnKeyFrameRequestedForStreams(1u << webrtc::kMaxSimulcastStreams);
+		TestEqual(TEXT("Nothing pending"), GetPendingStreams(Governor, 1000), 0u);
+		TestEqual(TEXT("Nothing counted"), Stats.GetKeyFramesRequested(), Requested);
+	}
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,181 @@
+// Copyright Dolby.io 2023. All Rights Reserved.
+
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "Media/AudioSampleConversion.h"
+#include "WebRTC/MultiOpus.h"
+#include "WebRTC/SdpEditor.h"
+
+#include "Algo/AllOf.h"
+
+namespace Millicast::Publisher
+{
+
+namespace
+{
+	constexpr int32 NumFrames = 480 + 3;
+
+	struct FSurround
+	{
+		int32 NumChannels;
+		const TCHAR* Name;
+		const TCHAR* EngineChannels[8];    // WAVE order the engine mixes in
+		const TCHAR* PublishedChannels[8]; // Vorbis order of RFC 7845, the rear channels being the surround ones of 5.1
+	};
+
+	const FSurround Surrounds[] =
+	{
+		{ 6, TEXT("5.1"), { TEXT("FL"), TEXT("FR"), TEXT("FC"), TEXT("LFE"), TEXT("SL"), TEXT("SR") }, { TEXT("FL"), TEXT("FC"), TEXT("FR"), TEXT("SL"), TEXT("SR"), TEXT("LFE") } },
+		{ 8, TEXT("7.1"), { TEXT("FL"), TEXT("FR"), TEXT("FC"), TEXT("LFE"), TEXT("BL"), TEXT("BR"), TEXT("SL"), TEXT("SR") }, { TEXT("FL"), TEXT("FC"), TEXT("FR"), TEXT("SL"), TEXT("SR"), TEXT("BL"), TEXT("BR"), TEXT("LFE") } },
+	};
+
+	TArray<int32> ParseList(const char* List)
+	{
+		TArray<FString> Values;
+		FString(UTF8_TO_TCHAR(List)).ParseIntoArray(Values, TEXT(","));
+
+		TArray<int32> Numbers;
+		for (const FString& Value : Values)
+		{
+			Numbers.Add(FCString::Atoi(*Value));
+		}
+		return Numbers;
+	}
+
+	/**
+	 * Audio section of an offer as webrtc creates it, between a session header and a video section.
+	 * The video codec is named opus too, only the audio section may change.
+	 */
+	const std::string Offer =
+		"v=0\r\n"
+		"o=- 4611731400430051336 2 IN IP4 127.0.0.1\r\n"
+		"s=-\r\n"
+		"t=0 0\r\n"
+		"a=group:BUNDLE 0 1\r\n"
+		"m=audio 9 UDP/TLS/RTP/SAVPF 111 63 103 9 0 8 13 110 126\r\n"
+		"c=IN IP4 0.0.0.0\r\n"
+		"a=mid:0\r\n"
+		"a=sendonly\r\n"
+		"a=rtpmap:111 opus/48000/2\r\n"
+		"a=rtcp-fb:111 transport-cc\r\n"
+		"a=fmtp:111 minptime=10;useinbandfec=1\r\n"
+		"a=rtpmap:63 red/48000/2\r\n"
+		"a=fmtp:63 111/111\r\n"
+		"a=rtpmap:103 ISAC/16000\r\n"
+		"a=rtpmap:9 G722/8000\r\n"
+		"a=rtpmap:0 PCMU/8000\r\n"
+		"a=rtpmap:8 PCMA/8000\r\n"
+		"a=rtpmap:13 CN/8000\r\n"
+		"a=rtpmap:110 telephone-event/48000\r\n"
+		"a=rtpmap:126 telephone-event/8000\r\n"
+		"m=video 9 UDP/TLS/RTP/SAVPF 96\r\n"
+		"c=IN IP4 0.0.0.0\r\n"
+		"a=mid:1\r\n"
+		"a=sendonly\r\n"
+		"a=rtpmap:96 opus/90000\r\n";
+
+	std::string Replace(std::string Sdp, const std::string& From, const std::string& To)
+	{
+		const size_t Pos = Sdp.find(From);
+		return Pos == std::string::npos ? Sdp : Sdp.replace(Pos, From.size(), To);
+	}
+}
+
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FMillicastMultiOpusTest, "Millicast.Publisher.WebRTC.MultiOpus",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FMillicastMultiOpusTest::RunTest(const FString& Parameters)
+{
+	using namespace Millicast::Publisher;
+
+	TestNull(TEXT("No layout for stereo"), FindMultiOpusLayout(2));
+	TestNull(TEXT("No layout for 4 channels"), FindMultiOpusLayout(4));
+
+	for (const FSurround& Surround : Surrounds)
+	{
+		const FMultiOpusLayout* Layout = FindMultiOpusLayout(Surround.NumChannels);
+		if (!TestNotNull(FString::Printf(TEXT("%s layout"), Surround.Name), Layout))
+		{
+			continue;
+		}
+
+		// Each engine channel is published once, at the place of its name in the Vorbis order
+		TArray<int16> Samples;
+		for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+		{
+			for (int32 Channel = 0; Channel < Surround.NumChannels; ++Channel)
+			{
+				Samples.Add(static_cast<int16>(Frame * 16 + Channel));
+			}
+		}
+
+		ReorderChannels(Samples.GetData(), NumFrames, Surround.NumChannels, Layout->EngineChannels);
+
+		bool bInPlace = true;
+		bool bNamesMatch = true;
+		for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+		{
+			for (int32 Channel = 0; Channel < Surround.NumChannels; ++Channel)
+			{
+				const int16 Sample = Samples[Frame * Surround.NumChannels + Channel];
+				bInPlace &= Sample / 16 == Frame;
+				bNamesMatch &= FCString::Strcmp(Surround.EngineChannels[Sample % 16], Surround.PublishedChannels[Channel]) == 0;
+			}
+		}
+
+		TestTrue(FString::Printf(TEXT("%s, samples stay in their frame"), Surround.Name), bInPlace);
+		TestTrue(FString::Printf(TEXT("%s, channels in the Vorbis order"), Surround.Name), bNamesMatch);
+
+		// The mapping gives every published channel its own decoded channel of the streams
+		const TArray<int32> Mapping = ParseList(Layout->ChannelMapping);
+		const int32 NumDecoded = Layout->NumStreams + Layout->NumCoupledStreams;
+		TSet<int32> Decoded;
+		for (const int32 Channel : Mapping)
+		{
+			Decoded.Add(Channel);
+		}
+
+		TestEqual(FString::Printf(TEXT("%s, mapping of every channel"), Surround.Name), Mapping.Num(), Surround.NumChannels);
+		TestEqual(FString::Printf(TEXT("%s, decoded channels"), Surround.Name), NumDecoded, Surround.NumChannels);
+		TestTrue(FString::Printf(TEXT("%s, decoded channels used once"), Surround.Name), Decoded.Num() == Mapping.Num()
+			&& Algo::AllOf(Mapping, [NumDecoded](int32 Channel) { return Channel >= 0 && Channel < NumDecoded; }));
+
+		// Only the opus codec of the audio section changes, its parameters are kept
+		FSdpEditor Editor(Offer);
+		TestTrue(FString::Printf(TEXT("%s offered"), Surround.Name), SetMultiOpusCodec(Editor, Surround.NumChannels));
+
+		std::string Expected = Replace(Offer, "a=rtpmap:111 opus/48000/2", "a=rtpmap:111 multiopus/48000/" + std::to_string(Surround.NumChannels));
+		Expected = Replace(Expected, "a=fmtp:111 minptime=10;useinbandfec=1", "a=fmtp:111 minptime=10;useinbandfec=1;channel_mapping=" + std::string(Layout->ChannelMapping)
+			+ ";num_streams=" + std::to_string(Layout->NumStreams) + ";coupled_streams=" + std::to_string(Layout->NumCoupledStreams));
+
+		const std::string Sdp = Editor.ToString();
+		TestTrue(FString::Printf(TEXT("%s offer"), Surround.Name), Sdp == Expected);
+		if (Sdp != Expected)
+		{
+			AddInfo(UTF8_TO_TCHAR(Sdp.c_str()));
+		}
+
+		// Once replaced, the codec is found under its new name
+		TestTrue(FString::Printf(TEXT("%s, multiopus found"), Surround.Name), FSdpEditor(Sdp).FindCodec("audio", "multiopus").IsSet());
+	}
+
+	// Nothing changes when it can't be offered
+	{
+		FSdpEditor Stereo(Offer);
+		TestFalse(TEXT("Stereo not offered"), SetMultiOpusCodec(Stereo, 2));
+		TestTrue(TEXT("Stereo offer unchanged"), Stereo.ToString() == Offer);
+
+		const std::string WithoutOpus = Replace(Offer, "a=rtpmap:111 opus/48000/2", "a=rtpmap:111 G722/8000");
+		FSdpEditor NoOpus(WithoutOpus);
+		TestFalse(TEXT("No opus to replace"), SetMultiOpusCodec(NoOpus, 6));
+		TestTrue(TEXT("Offer without opus unchanged"), NoOpus.ToString() == WithoutOpus);
+	}
+
+	return true;
+}
+
+#endif
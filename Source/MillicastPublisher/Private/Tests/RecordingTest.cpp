@@ -0,0 +1,535 @@
+// Copyright Dolby.io 2023. All Rights Reserved.
+
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "WebRTC/EncodedVideoRecorder.h"
+#include "WebRTC/SdpEditor.h"
+#include "WebRTC/SimulcastEncoderFactory.h"
+#include "WebRTC/VideoContainerWriter.h"
+
+#include "HAL/FileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+namespace Millicast::Publisher
+{
+
+namespace
+{
+	constexpr int32 Width = 640;
+	constexpr int32 Height = 360;
+
+	// 30 fps on the 90 kHz clock of the video
+	constexpr uint32 FrameDuration = 3000;
+
+	// Constrained baseline, level 3.0
+	const TArray<uint8> Sps = { 0x67, 0x42, 0xC0, 0x1E, 0xDA, 0x02, 0x80, 0xBF, 0xE5 };
+	const TArray<uint8> Pps = { 0x68, 0xCE, 0x3C, 0x80 };
+	const TArray<uint8> AccessUnitDelimiter = { 0x09, 0xF0 };
+
+	FString GetRecordingDir()
+	{
+		return FPaths::Combine(FPaths::AutomationTransientDir(), TEXT("MillicastRecording"));
+	}
+
+	TArray<uint8> LoadFile(const FString& Path)
+	{
+		TArray<uint8> Data;
+		FFileHelper::LoadFileToArray(Data, *Path, FILEREAD_Silent);
+		return Data;
+	}
+
+	TArray<uint8> MakePayload(uint8 Header, int32 Size)
+	{
+		TArray<uint8> Payload;
+		Payload.Add(Header);
+		for (int32 i = 1; i < Size; ++i)
+		{
+			// Never 0, no start code shows up in the payload
+			Payload.Add(static_cast<uint8>(i % 251 + 1));
+		}
+		return Payload;
+	}
+
+	TArray<uint8> ToAnnexB(const TArray<TArray<uint8>>& Units)
+	{
+		TArray<uint8> Bitstream;
+		for (const TArray<uint8>& Unit : Units)
+		{
+			Bitstream.Append({ 0, 0, 0, 1 });
+			Bitstream.Append(Unit);
+		}
+		return Bitstream;
+	}
+
+	FRecordedFrame MakeFrame(webrtc::VideoCodecType CodecType, const TArray<uint8>& Data, uint32 RtpTimestamp, bool bKeyFrame)
+	{
+		return { CodecType, Data, RtpTimestamp, Width, Height, bKeyFrame };
+	}
+
+	FRecordedAudioPacket MakePacket(const TSharedPtr<const FOpusStreamInfo, ESPMode::ThreadSafe>& StreamInfo, int32 Size, uint32 RtpTimestamp)
+	{
+		return { StreamInfo, MakePayload(0xFC, Size), RtpTimestamp, 960 };
+	}
+
+	uint32 ReadLE(const TArray<uint8>& Data, int32 Offset, int32 Size)
+	{
+		uint32 Value = 0;
+		for (int32 i = Size - 1; i >= 0; --i)
+		{
+			Value = (Value << 8) | Data[Offset + i];
+		}
+		return Value;
+	}
+
+	uint64 ReadLE64(const TArray<uint8>& Data, int32 Offset)
+	{
+		return ReadLE(Data, Offset, 4) | (static_cast<uint64>(ReadLE(Data, Offset + 4, 4)) << 32);
+	}
+
+	uint32 ReadBE32(const TArray<uint8>& Data, int32 Offset)
+	{
+		return (static_cast<uint32>(Data[Offset]) << 24) | (Data[Offset + 1] << 16) | (Data[Offset + 2] << 8) | Data[Offset + 3];
+	}
+
+	uint64 ReadBE64(const TArray<uint8>& Data, int32 Offset)
+	{
+		return (static_cast<uint64>(ReadBE32(Data, Offset)) << 32) | ReadBE32(Data, Offset + 4);
+	}
+
+	bool HasBytes(const TArray<uint8>& Data, int32 Offset, const TArray<uint8>& Expected)
+	{
+		return Offset >= 0 && Offset + Expected.Num() <= Data.Num() && FMemory::Memcmp(Data.GetData() + Offset, Expected.GetData(), Expected.Num()) == 0;
+	}
+
+	bool HasBytes(const TArray<uint8>& Data, int32 Offset, const char* Expected)
+	{
+		const int32 Size = FCStringAnsi::Strlen(Expected);
+		return Offset >= 0 && Offset + Size <= Data.Num() && FMemory::Memcmp(Data.GetData() + Offset, Expected, Size) == 0;
+	}
+
+	/** An ISO BMFF box, Offset is the one of its header */
+	struct FBox
+	{
+		int32 Offset;
+		int32 Size;
+	};
+
+	/** The boxes one after the other from Start to End, empty if they don't end exactly at End */
+	TArray<FBox> GetBoxes(const TArray<uint8>& Data, int32 Start, int32 End)
+	{
+		TArray<FBox> Boxes;
+		for (int32 Offset = Start; Offset < End;)
+		{
+			const int32 Size = Offset + 8 <= End ? static_cast<int32>(ReadBE32(Data, Offset)) : 0;
+			if (Size < 8 || Offset + Size > End)
+			{
+				return {};
+			}
+
+			Boxes.Add({ Offset, Size });
+			Offset += Size;
+		}
+		return Boxes;
+	}
+
+	TArray<FBox> GetChildren(const TArray<uint8>& Data, const FBox& Box, int32 HeaderSize = 8)
+	{
+		return GetBoxes(Data, Box.Offset + HeaderSize, Box.Offset + Box.Size);
+	}
+
+	TOptional<FBox> FindBox(const TArray<uint8>& Data, const TArray<FBox>& Boxes, const char* Type)
+	{
+		for (const FBox& Box : Boxes)
+		{
+			if (HasBytes(Data, Box.Offset + 4, Type))
+			{
+				return Box;
+			}
+		}
+		return {};
+	}
+
+	/** Length prefixed NAL units, as the samples of an MP4 file */
+	TArray<uint8> ToMp4Sample(const TArray<TArray<uint8>>& Units)
+	{
+		TArray<uint8> Sample;
+		for (const TArray<uint8>& Unit : Units)
+		{
+			Sample.Append({ 0, 0, static_cast<uint8>(Unit.Num() >> 8), static_cast<uint8>(Unit.Num() & 0xFF) });
+			Sample.Append(Unit);
+		}
+		return Sample;
+	}
+
+	struct FOggPage
+	{
+		uint8 HeaderType;
+		uint64 GranulePosition;
+		uint32 SerialNumber;
+		uint32 SequenceNumber;
+		bool bCrcValid;
+		TArray<uint8> Lacing;
+		TArray<uint8> Body;
+	};
+
+	/** The pages of an Ogg file, empty if one of them is truncated */
+	TArray<FOggPage> GetOggPages(const TArray<uint8>& Data)
+	{
+		TArray<FOggPage> Pages;
+		for (int32 Offset = 0; Offset < Data.Num();)
+		{
+			if (Offset + 27 > Data.Num() || !HasBytes(Data, Offset, "OggS") || Data[Offset + 4] != 0)
+			{
+				return {};
+			}
+
+			FOggPage Page;
+			Page.HeaderType = Data[Offset + 5];
+			Page.GranulePosition = ReadLE64(Data, Offset + 6);
+			Page.SerialNumber = ReadLE(Data, Offset + 14, 4);
+			Page.SequenceNumber = ReadLE(Data, Offset + 18, 4);
+
+			const int32 NumSegments = Data[Offset + 26];
+			if (Offset + 27 + NumSegments > Data.Num())
+			{
+				return {};
+			}
+			Page.Lacing.Append(Data.GetData() + Offset + 27, NumSegments);
+
+			int32 BodySize = 0;
+			for (const uint8 Segment : Page.Lacing)
+			{
+				BodySize += Segment;
+			}
+
+			const int32 PageSize = 27 + NumSegments + BodySize;
+			if (Offset + PageSize > Data.Num())
+			{
+				return {};
+			}
+			Page.Body.Append(Data.GetData() + Offset + 27 + NumSegments, BodySize);
+
+			// The CRC is computed with its own field set to 0
+			TArray<uint8> Unchecked(Data.GetData() + Offset, PageSize);
+			FMemory::Memzero(Unchecked.GetData() + 22, 4);
+			Page.bCrcValid = FOggOpusWriter::Crc32(Unchecked.GetData(), Unchecked.Num()) == ReadLE(Data, Offset + 22, 4);
+
+			Pages.Add(MoveTemp(Page));
+			Offset += PageSize;
+		}
+		return Pages;
+	}
+
+	webrtc::EncodedImage MakeEncodedImage(const TArray<uint8>& Data, uint32 RtpTimestamp, bool bKeyFrame)
+	{
+		webrtc::EncodedImage Image;
+		Image.SetEncodedData(webrtc::EncodedImageBuffer::Create(Data.GetData(), Data.Num()));
+		Image.SetTimestamp(RtpTimestamp);
+		Image._encodedWidth = Width;
+		Image._encodedHeight = Height;
+		Image._frameType = bKeyFrame ? webrtc::VideoFrameType::kVideoFrameKey : webrtc::VideoFrameType::kVideoFrameDelta;
+		return Image;
+	}
+
+	/** Shortened answer with two H264 profiles and their retransmission */
+	const std::string Answer =
+		"v=0\r\n"
+		"o=- 0 2 IN IP4 127.0.0.1\r\n"
+		"s=-\r\n"
+		"t=0 0\r\n"
+		"m=audio 9 UDP/TLS/RTP/SAVPF 111\r\n"
+		"a=mid:0\r\n"
+		"a=rtpmap:111 opus/48000/2\r\n"
+		"a=fmtp:111 minptime=10;useinbandfec=1\r\n"
+		"m=video 9 UDP/TLS/RTP/SAVPF 96 97 102 103\r\n"
+		"a=mid:1\r\n"
+		"a=rtpmap:96 VP8/90000\r\n"
+		"a=rtpmap:97 rtx/90000\r\n"
+		"a=fmtp:97 apt=96\r\n"
+		"a=rtpmap:102 H264/90000\r\n"
+		"a=fmtp:102 level-asymmetry-allowed=1;packetization-mode=1;profile-level-id=42e01f\r\n"
+		"a=rtpmap:103 H264/90000\r\n"
+		"a=fmtp:103 level-asymmetry-allowed=1;packetization-mode=1;profile-level-id=640c1f\r\n";
+}
+
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FMillicastRecordingTest, "Millicast.Publisher.WebRTC.Recording",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FMillicastRecordingTest::RunTest(const FString& Parameters)
+{
+	using namespace Millicast::Publisher;
+
+	const FString Dir = GetRecordingDir();
+	IFileManager::Get().DeleteDirectory(*Dir, false, true);
+	IFileManager::Get().MakeDirectory(*Dir, true);
+
+	const TArray<uint8> Vp8Key = MakePayload(0x10, 1500);
+	const TArray<uint8> Vp8Delta = MakePayload(0x31, 300);
+
+	// IVF: the file header, then each frame with its size and time from the first key frame
+	{
+		const FString Path = FPaths::Combine(Dir, TEXT("Vp8.ivf"));
+		TUniquePtr<IVideoContainerWriter> Writer = IVideoContainerWriter::Create(webrtc::kVideoCodecVP8);
+		if (!TestTrue(TEXT("IVF opened"), Writer.IsValid() && Writer->Open(Path)))
+		{
+			return true;
+		}
+
+		Writer->WriteFrame(MakeFrame(webrtc::kVideoCodecVP8, Vp8Delta, 87000, false));
+		Writer->WriteFrame(MakeFrame(webrtc::kVideoCodecVP8, Vp8Key, 90000, true));
+		Writer->WriteFrame(MakeFrame(webrtc::kVideoCodecVP8, Vp8Delta, 90000 + FrameDuration, false));
+		Writer->Close();
+
+		const TArray<uint8> File = LoadFile(Path);
+		if (TestEqual(TEXT("IVF size, the delta frame before the key frame left out"), File.Num(), 32 + 12 + Vp8Key.Num() + 12 + Vp8Delta.Num()))
+		{
+			TestTrue(TEXT("IVF signature"), HasBytes(File, 0, "DKIF"));
+			TestEqual(TEXT("IVF header size"), static_cast<int32>(ReadLE(File, 6, 2)), 32);
+			TestTrue(TEXT("IVF codec"), HasBytes(File, 8, "VP80"));
+			TestEqual(TEXT("IVF width"), static_cast<int32>(ReadLE(File, 12, 2)), Width);
+			TestEqual(TEXT("IVF height"), static_cast<int32>(ReadLE(File, 14, 2)), Height);
+			TestEqual(TEXT("IVF timescale"), static_cast<int32>(ReadLE(File, 16, 4)), 90000);
+			TestEqual(TEXT("IVF frame count patched"), static_cast<int32>(ReadLE(File, 24, 4)), 2);
+
+			TestEqual(TEXT("IVF key frame size"), static_cast<int32>(ReadLE(File, 32, 4)), Vp8Key.Num());
+			TestEqual(TEXT("IVF key frame first"), static_cast<int64>(ReadLE64(File, 36)), static_cast<int64>(0));
+			TestTrue(TEXT("IVF key frame payload"), HasBytes(File, 44, Vp8Key));
+
+			const int32 Second = 44 + Vp8Key.Num();
+			TestEqual(TEXT("IVF delta frame size"), static_cast<int32>(ReadLE(File, Second, 4)), Vp8Delta.Num());
+			TestEqual(TEXT("IVF delta frame time"), static_cast<int64>(ReadLE64(File, Second + 4)), static_cast<int64>(FrameDuration));
+			TestTrue(TEXT("IVF delta frame payload"), HasBytes(File, Second + 12, Vp8Delta));
+		}
+	}
+
+	// Fragmented MP4: header boxes from the parameter sets of the first key frame, then a fragment per frame
+	{
+		const FString Path = FPaths::Combine(Dir, TEXT("H264.mp4"));
+		TUniquePtr<IVideoContainerWriter> Writer = IVideoContainerWriter::Create(webrtc::kVideoCodecH264);
+		if (!TestTrue(TEXT("MP4 opened"), Writer.IsValid() && Writer->Open(Path)))
+		{
+			return true;
+		}
+
+		const TArray<uint8> Idr = MakePayload(0x65, 800);
+		const TArray<uint8> Slice = MakePayload(0x41, 200);
+
+		AddExpectedError(TEXT("without parameter sets"), EAutomationExpectedErrorFlags::Contains, 1);
+		Writer->WriteFrame(MakeFrame(webrtc::kVideoCodecH264, ToAnnexB({ Slice }), 84000, false));
+		Writer->WriteFrame(MakeFrame(webrtc::kVideoCodecH264, ToAnnexB({ Idr }), 87000, true));
+		Writer->WriteFrame(MakeFrame(webrtc::kVideoCodecH264, ToAnnexB({ AccessUnitDelimiter, Sps, Pps, Idr }), 90000, true));
+		Writer->WriteFrame(MakeFrame(webrtc::kVideoCodecH264, ToAnnexB({ AccessUnitDelimiter, Slice }), 90000 + FrameDuration, false));
+		Writer->WriteFrame(MakeFrame(webrtc::kVideoCodecH264, ToAnnexB({ Slice }), 90000 + 2 * FrameDuration, false));
+		Writer->Close();
+
+		const TArray<uint8> File = LoadFile(Path);
+		const TArray<FBox> Boxes = GetBoxes(File, 0, File.Num());
+		if (!TestEqual(TEXT("MP4 boxes cover the file"), Boxes.Num(), 8))
+		{
+			return true;
+		}
+
+		const char* const Types[] = { "ftyp", "moov", "moof", "mdat", "moof", "mdat", "moof", "mdat" };
+		for (int32 i = 0; i < Boxes.Num(); ++i)
+		{
+			TestTrue(FString::Printf(TEXT("MP4 box %d is %s"), i, ANSI_TO_TCHAR(Types[i])), HasBytes(File, Boxes[i].Offset + 4, Types[i]));
+		}
+
+		// moov/trak/mdia/minf/stbl/stsd/avc3/avcC
+		const TOptional<FBox> Trak = FindBox(File, GetChildren(File, Boxes[1]), "trak");
+		const TOptional<FBox> Mdia = Trak ? FindBox(File, GetChildren(File, *Trak), "mdia") : TOptional<FBox>();
+		const TOptional<FBox> Mdhd = Mdia ? FindBox(File, GetChildren(File, *Mdia), "mdhd") : TOptional<FBox>();
+		const TOptional<FBox> Minf = Mdia ? FindBox(File, GetChildren(File, *Mdia), "minf") : TOptional<FBox>();
+		const TOptional<FBox> Stbl = Minf ? FindBox(File, GetChildren(File, *Minf), "stbl") : TOptional<FBox>();
+		const TOptional<FBox> Stsd = Stbl ? FindBox(File, GetChildren(File, *Stbl), "stsd") : TOptional<FBox>();
+		const TOptional<FBox> Avc3 = Stsd ? FindBox(File, GetChildren(File, *Stsd, 16), "avc3") : TOptional<FBox>();
+		const TOptional<FBox> AvcC = Avc3 ? FindBox(File, GetChildren(File, *Avc3, 86), "avcC") : TOptional<FBox>();
+		if (TestTrue(TEXT("MP4 sample entry"), Mdhd.IsSet() && AvcC.IsSet()))
+		{
+			TestEqual(TEXT("MP4 timescale"), static_cast<int32>(ReadBE32(File, Mdhd->Offset + 20)), 90000);
+			TestEqual(TEXT("MP4 width"), static_cast<int32>(File[Avc3->Offset + 32] << 8 | File[Avc3->Offset + 33]), Width);
+			TestEqual(TEXT("MP4 height"), static_cast<int32>(File[Avc3->Offset + 34] << 8 | File[Avc3->Offset + 35]), Height);
+			TestTrue(TEXT("avcC profile and level from the SPS"), HasBytes(File, AvcC->Offset + 9, { Sps[1], Sps[2], Sps[3] }));
+			TestTrue(TEXT("avcC SPS"), File[AvcC->Offset + 13] == 0xE1 && HasBytes(File, AvcC->Offset + 14, { 0, static_cast<uint8>(Sps.Num()) }) && HasBytes(File, AvcC->Offset + 16, Sps));
+			const int32 PpsOffset = AvcC->Offset + 16 + Sps.Num();
+			TestTrue(TEXT("avcC PPS"), File[PpsOffset] == 1 && HasBytes(File, PpsOffset + 1, { 0, static_cast<uint8>(Pps.Num()) }) && HasBytes(File, PpsOffset + 3, Pps));
+		}
+
+		// Each moof points into the mdat right after it
+		struct FExpectedFragment
+		{
+			uint64 Time;
+			uint32 SampleFlags;
+			TArray<uint8> Sample;
+		};
+		const TArray<FExpectedFragment> Expected = {
+			{ 0, 0x02000000, ToMp4Sample({ Sps, Pps, Idr }) },
+			{ FrameDuration, 0x01010000, ToMp4Sample({ Slice }) },
+			{ 2 * FrameDuration, 0x01010000, ToMp4Sample({ Slice }) }
+		};
+		for (int32 i = 0; i < Expected.Num(); ++i)
+		{
+			const FString What = FString::Printf(TEXT("MP4 fragment %d"), i);
+			const FBox& Moof = Boxes[2 + 2 * i];
+			const FBox& Mdat = Boxes[3 + 2 * i];
+
+			const TOptional<FBox> Traf = FindBox(File, GetChildren(File, Moof), "traf");
+			const TOptional<FBox> Tfdt = Traf ? FindBox(File, GetChildren(File, *Traf), "tfdt") : TOptional<FBox>();
+			const TOptional<FBox> Trun = Traf ? FindBox(File, GetChildren(File, *Traf), "trun") : TOptional<FBox>();
+			if (!TestTrue(What + TEXT(" boxes"), Tfdt.IsSet() && Trun.IsSet()))
+			{
+				continue;
+			}
+
+			TestEqual(What + TEXT(" decode time"), static_cast<int64>(ReadBE64(File, Tfdt->Offset + 12)), static_cast<int64>(Expected[i].Time));
+			TestEqual(What + TEXT(" one sample"), static_cast<int32>(ReadBE32(File, Trun->Offset + 12)), 1);
+			TestEqual(What + TEXT(" data offset"), Moof.Offset + static_cast<int32>(ReadBE32(File, Trun->Offset + 16)), Mdat.Offset + 8);
+			TestEqual(What + TEXT(" duration"), static_cast<int32>(ReadBE32(File, Trun->Offset + 20)), static_cast<int32>(FrameDuration));
+			TestEqual(What + TEXT(" size"), static_cast<int32>(ReadBE32(File, Trun->Offset + 24)), Expected[i].Sample.Num());
+			TestEqual(What + TEXT(" flags"), static_cast<int64>(ReadBE32(File, Trun->Offset + 28)), static_cast<int64>(Expected[i].SampleFlags));
+			TestTrue(What + TEXT(" length prefixed NAL units, without the delimiter"), Mdat.Size == 8 + Expected[i].Sample.Num() && HasBytes(File, Mdat.Offset + 8, Expected[i].Sample));
+		}
+	}
+
+	// Ogg Opus: the identification and comment headers, then a page per packet with the granule position of its end
+	{
+		const uint8 Check[] = { '1', '2', '3', '4', '5', '6', '7', '8', '9' };
+		TestEqual(TEXT("Ogg CRC check value"), static_cast<int64>(FOggOpusWriter::Crc32(Check, sizeof(Check))), static_cast<int64>(0x89A1897F));
+
+		auto Stereo = MakeShared<FOpusStreamInfo, ESPMode::ThreadSafe>();
+
+		const FString Path = FPaths::Combine(Dir, TEXT("Stereo.opus"));
+		FOggOpusWriter Writer;
+		if (!TestTrue(TEXT("Ogg opened"), Writer.Open(Path)))
+		{
+			return true;
+		}
+
+		Writer.WritePacket(MakePacket(Stereo, 100, 1000));
+		Writer.WritePacket(MakePacket(Stereo, 600, 1960));
+		Writer.WritePacket(MakePacket(Stereo, 70000, 2920)); // Larger than a page, left out
+		Writer.WritePacket(MakePacket(Stereo, 255, 2920));
+		Writer.Close();
+
+		const TArray<FOggPage> Pages = GetOggPages(LoadFile(Path));
+		if (TestEqual(TEXT("Ogg pages"), Pages.Num(), 5))
+		{
+			for (int32 i = 0; i < Pages.Num(); ++i)
+			{
+				const FString What = FString::Printf(TEXT("Ogg page %d"), i);
+				TestTrue(What + TEXT(" CRC"), Pages[i].bCrcValid);
+				TestEqual(What + TEXT(" sequence number"), static_cast<int32>(Pages[i].SequenceNumber), i);
+				TestTrue(What + TEXT(" same stream"), Pages[i].SerialNumber == Pages[0].SerialNumber);
+			}
+
+			const TArray<uint8>& Head = Pages[0].Body;
+			TestEqual(TEXT("First page flagged"), static_cast<int32>(Pages[0].HeaderType), 0x02);
+			if (TestEqual(TEXT("OpusHead size"), Head.Num(), 19))
+			{
+				TestTrue(TEXT("OpusHead"), HasBytes(Head, 0, "OpusHead") && Head[8] == 1);
+				TestEqual(TEXT("OpusHead channels"), static_cast<int32>(Head[9]), 2);
+				TestEqual(TEXT("OpusHead pre-skip"), static_cast<int32>(ReadLE(Head, 10, 2)), 312);
+				TestEqual(TEXT("OpusHead input rate"), static_cast<int32>(ReadLE(Head, 12, 4)), 48000);
+				TestEqual(TEXT("OpusHead mapping family"), static_cast<int32>(Head[18]), 0);
+			}
+			TestTrue(TEXT("OpusTags"), HasBytes(Pages[1].Body, 0, "OpusTags") && Pages[1].GranulePosition == 0);
+
+			TestTrue(TEXT("Packet in one segment"), Pages[2].Lacing == TArray<uint8>({ 100 }) && Pages[2].GranulePosition == 960);
+			TestTrue(TEXT("Packet laced over segments"), Pages[3].Lacing == TArray<uint8>({ 255, 255, 90 }) && Pages[3].GranulePosition == 1920);
+			TestTrue(TEXT("Packet of 255 bytes ended by an empty segment"), Pages[4].Lacing == TArray<uint8>({ 255, 0 }) && Pages[4].GranulePosition == 2880);
+			TestEqual(TEXT("Last page flagged"), static_cast<int32>(Pages[4].HeaderType), 0x04);
+			TestTrue(TEXT("Packet data"), Pages[3].Body == MakePacket(Stereo, 600, 0).Data);
+		}
+
+		// 5.1 uses the multistream mapping family
+		auto Surround = MakeShared<FOpusStreamInfo, ESPMode::ThreadSafe>();
+		Surround->NumChannels = 6;
+		Surround->NumStreams = 4;
+		Surround->NumCoupledStreams = 2;
+		Surround->ChannelMapping = { 0, 4, 1, 2, 3, 5 };
+
+		const FString SurroundPath = FPaths::Combine(Dir, TEXT("Surround.opus"));
+		FOggOpusWriter SurroundWriter;
+		SurroundWriter.Open(SurroundPath);
+		SurroundWriter.WritePacket(MakePacket(Surround, 400, 0));
+		SurroundWriter.Close();
+
+		const TArray<FOggPage> SurroundPages = GetOggPages(LoadFile(SurroundPath));
+		if (TestEqual(TEXT("Surround Ogg pages"), SurroundPages.Num(), 3))
+		{
+			const TArray<uint8>& Head = SurroundPages[0].Body;
+			TestTrue(TEXT("Surround OpusHead"), Head.Num() == 27 && Head[9] == 6 && Head[18] == 1 && Head[19] == 4 && Head[20] == 2
+				&& HasBytes(Head, 21, Surround->ChannelMapping));
+		}
+	}
+
+	// The recorder starts the file at the first key frame and the audio with it
+	{
+		FEncodedVideoRecorder Recorder(FPaths::Combine(Dir, TEXT("Recorder.mp4")), 0);
+		TestTrue(TEXT("Key frame requested once"), Recorder.ConsumeKeyFrameRequest());
+		TestFalse(TEXT("Key frame not requested twice"), Recorder.ConsumeKeyFrameRequest());
+
+		auto Stereo = MakeShared<FOpusStreamInfo, ESPMode::ThreadSafe>();
+		const TArray<uint8> Packet = MakePayload(0xFC, 120);
+
+		Recorder.OnEncodedImage(webrtc::kVideoCodecVP8, MakeEncodedImage(Vp8Delta, 87000, false));
+		Recorder.OnEncodedImage(webrtc::kVideoCodecVP8, MakeEncodedImage(Vp8Key, 90000, true));
+		Recorder.OnEncodedAudio(Stereo, 48000, 960, Packet.GetData(), Packet.Num());
+		Recorder.OnEncodedImage(webrtc::kVideoCodecVP8, MakeEncodedImage(Vp8Delta, 90000 + FrameDuration, false));
+		Recorder.Finish();
+
+		// Nothing is taken once finished
+		Recorder.OnEncodedImage(webrtc::kVideoCodecVP8, MakeEncodedImage(Vp8Delta, 90000 + 2 * FrameDuration, false));
+
+		const TArray<uint8> Video = LoadFile(FPaths::Combine(Dir, TEXT("Recorder.ivf")));
+		if (TestEqual(TEXT("Recorded to the container of the codec"), Video.Num(), 32 + 12 + Vp8Key.Num() + 12 + Vp8Delta.Num()))
+		{
+			TestEqual(TEXT("Recorded frames"), static_cast<int32>(ReadLE(Video, 24, 4)), 2);
+			TestTrue(TEXT("Recording starts with the key frame"), HasBytes(Video, 44, Vp8Key));
+		}
+
+		const TArray<FOggPage> Audio = GetOggPages(LoadFile(FPaths::Combine(Dir, TEXT("Recorder.opus"))));
+		TestTrue(TEXT("Audio recorded next to the video"), Audio.Num() == 3 && Audio[2].Body == Packet && Audio[2].HeaderType == 0x04);
+	}
+
+	// Each publisher has its recording, the encoders find theirs by the id of the answer they were created from
+	{
+		FSdpEditor Editor(Answer);
+		SetRecordingId(Editor, TEXT("42"));
+		const std::string Sdp = Editor.ToString();
+
+		TestTrue(TEXT("Recording id on VP8"), Sdp.find("a=rtpmap:96 VP8/90000\r\na=fmtp:96 x-millicast-recording=42\r\n") != std::string::npos);
+		TestTrue(TEXT("Recording id on every H264 profile"), Sdp.find("profile-level-id=42e01f;x-millicast-recording=42\r\n") != std::string::npos
+			&& Sdp.find("profile-level-id=640c1f;x-millicast-recording=42\r\n") != std::string::npos);
+		TestTrue(TEXT("Recording id on opus"), Sdp.find("a=fmtp:111 minptime=10;useinbandfec=1;x-millicast-recording=42\r\n") != std::string::npos);
+		TestTrue(TEXT("Retransmission untouched"), Sdp.find("a=fmtp:97 apt=96\r\n") != std::string::npos);
+
+		TestEqual(TEXT("Recording id read back"), GetRecordingId({ { "profile-level-id", "42e01f" }, { "x-millicast-recording", "42" } }), FString(TEXT("42")));
+		TestTrue(TEXT("No recording id"), GetRecordingId({ { "profile-level-id", "42e01f" } }).IsEmpty());
+
+		FSimulcastEncoderFactory Factory;
+		Factory.StartRecording(TEXT("1"), FPaths::Combine(Dir, TEXT("First")), 0);
+		Factory.StartRecording(TEXT("2"), FPaths::Combine(Dir, TEXT("Second")), 1);
+
+		const auto First = Factory.GetRecorder(TEXT("1"));
+		const auto Second = Factory.GetRecorder(TEXT("2"));
+		TestTrue(TEXT("A recorder per publisher"), First.IsValid() && Second.IsValid() && First != Second && Second->GetStreamIndex() == 1);
+		TestFalse(TEXT("No recorder for another publisher"), Factory.GetRecorder(TEXT("3")).IsValid());
+		TestFalse(TEXT("No recorder without an id"), Factory.GetRecorder(FString()).IsValid());
+
+		Factory.StopRecording(TEXT("2"));
+		TestFalse(TEXT("Stopped"), Factory.GetRecorder(TEXT("2")).IsValid());
+		TestTrue(TEXT("Other publisher still recording"), Factory.GetRecorder(TEXT("1")) == First);
+		Factory.StopRecording(TEXT("1"));
+	}
+
+	IFileManager::Get().DeleteDirectory(*Dir, false, true);
+	return true;
+}
+
+#endif
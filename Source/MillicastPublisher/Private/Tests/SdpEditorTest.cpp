@@ -0,0 +1,181 @@
+// Copyright Dolby.io 2023. All Rights Reserved.
+
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "WebRTC/SdpEditor.h"
+
+namespace Millicast::Publisher
+{
+
+namespace
+{
+	const std::string AbsCaptureTime = "http://www.webrtc.org/experimental/rtp-hdrext/abs-capture-time";
+
+	/** Shortened offer of the publisher, an audio and a video section bundled together and a data channel */
+	const std::string Offer =
+		"v=0\r\n"
+		"o=- 4611731400430051336 2 IN IP4 127.0.0.1\r\n"
+		"s=-\r\n"
+		"t=0 0\r\n"
+		"a=group:BUNDLE 0 1 2\r\n"
+		"a=msid-semantic: WMS stream\r\n"
+		"m=audio 9 UDP/TLS/RTP/SAVPF 111 63\r\n"
+		"c=IN IP4 0.0.0.0\r\n"
+		"a=mid:0\r\n"
+		"a=extmap:1 urn:ietf:params:rtp-hdrext:ssrc-audio-level\r\n"
+		"a=extmap:2 http://www.webrtc.org/experimental/rtp-hdrext/abs-send-time\r\n"
+		"a=extmap:4 urn:ietf:params:rtp-hdrext:sdes:mid\r\n"
+		"a=sendonly\r\n"
+		"a=rtpmap:111 opus/48000/2\r\n"
+		"a=fmtp:111 minptime=10;useinbandfec=1\r\n"
+		"a=rtpmap:63 red/48000/2\r\n"
+		"m=video 9 UDP/TLS/RTP/SAVPF 96 97\r\n"
+		"c=IN IP4 0.0.0.0\r\n"
+		"a=mid:1\r\n"
+		"a=extmap:14 urn:ietf:params:rtp-hdrext:toffset\r\n"
+		"a=extmap:2 http://www.webrtc.org/experimental/rtp-hdrext/abs-send-time\r\n"
+		"a=extmap:3 urn:3gpp:video-orientation\r\n"
+		"a=extmap:4 urn:ietf:params:rtp-hdrext:sdes:mid\r\n"
+		"a=sendonly\r\n"
+		"a=rtpmap:96 VP8/90000\r\n"
+		"a=rtpmap:97 rtx/90000\r\n"
+		"a=fmtp:97 apt=96\r\n"
+		"m=application 9 UDP/DTLS/SCTP webrtc-datachannel\r\n"
+		"c=IN IP4 0.0.0.0\r\n"
+		"a=mid:2\r\n"
+		"a=sctp-port:5000\r\n";
+
+	int32 CountLines(const std::string& Sdp, const std::string& Line)
+	{
+		int32 Count = 0;
+		for (size_t Pos = Sdp.find(Line + "\r\n"); Pos != std::string::npos; Pos = Sdp.find(Line + "\r\n", Pos + 1))
+		{
+			Count += Pos == 0 || Sdp[Pos - 1] == '\n';
+		}
+		return Count;
+	}
+}
+
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FMillicastSdpEditorTest, "Millicast.Publisher.WebRTC.SdpEditor",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FMillicastSdpEditorTest::RunTest(const FString& Parameters)
+{
+	using namespace Millicast::Publisher;
+
+	// Unedited, the description is unchanged
+	TestTrue(TEXT("Round trip"), FSdpEditor(Offer).ToString() == Offer);
+
+	// Sections and their attributes
+	{
+		const FSdpEditor Editor(Offer);
+		TestEqual(TEXT("Sections"), Editor.GetNumSections(), 3);
+		TestTrue(TEXT("Media"), Editor.GetMedia(0) == "audio" && Editor.GetMedia(1) == "video" && Editor.GetMedia(2) == "application");
+
+		const TArray<std::string> Mid = Editor.GetAttributes(1, "mid");
+		TestTrue(TEXT("Attribute value"), Mid.Num() == 1 && Mid[0] == "1");
+		TestEqual(TEXT("Attributes of a section only"), Editor.GetAttributes(0, "extmap").Num(), 3);
+		TestEqual(TEXT("No attribute"), Editor.GetAttributes(2, "extmap").Num(), 0);
+	}
+
+	// An attribute goes after the last one of its name, or at the end of the section, and the following sections still edit
+	{
+		FSdpEditor Editor(Offer);
+		Editor.AddAttribute(0, "extmap", "7 urn:test");
+		Editor.AddAttribute(1, "rtcp-fb", "96 nack");
+		Editor.AddAttribute(2, "x-flag", "");
+
+		const TOptional<FSdpEditor::FCodec> Vp8 = Editor.FindCodec("video", "vp8");
+		if (TestTrue(TEXT("Codec found after the edits"), Vp8.IsSet()))
+		{
+			Editor.SetParameter(Vp8.GetValue(), "x-google-start-bitrate", "1000");
+		}
+
+		const std::string Sdp = Editor.ToString();
+		TestTrue(TEXT("After the last of its name"), Sdp.find("a=extmap:4 urn:ietf:params:rtp-hdrext:sdes:mid\r\na=extmap:7 urn:test\r\na=sendonly\r\n") != std::string::npos);
+		TestTrue(TEXT("At the end of the section"), Sdp.find("a=fmtp:97 apt=96\r\na=rtcp-fb:96 nack\r\nm=application") != std::string::npos);
+		const std::string Tail = "a=sctp-port:5000\r\na=x-flag\r\n";
+		TestTrue(TEXT("Flag at the end of the description"), Sdp.size() > Tail.size() && Sdp.compare(Sdp.size() - Tail.size(), Tail.size(), Tail) == 0);
+		TestTrue(TEXT("Codec edited in its section"), Sdp.find("a=rtpmap:96 VP8/90000\r\na=fmtp:96 x-google-start-bitrate=1000\r\n") != std::string::npos);
+	}
+
+	// The absolute capture time extension, with the first id none of the bundled sections uses
+	{
+		FSdpEditor Editor(Offer);
+		TestEqual(TEXT("First free id"), Editor.AddHeaderExtension(AbsCaptureTime, { "audio", "video" }), 5);
+
+		const std::string Sdp = Editor.ToString();
+		TestEqual(TEXT("Offered in the audio and video sections"), CountLines(Sdp, "a=extmap:5 " + AbsCaptureTime), 2);
+		TestTrue(TEXT("After the audio extensions"), Sdp.find("a=extmap:4 urn:ietf:params:rtp-hdrext:sdes:mid\r\na=extmap:5 " + AbsCaptureTime + "\r\na=sendonly\r\na=rtpmap:111") != std::string::npos);
+		TestTrue(TEXT("After the video extensions"), Sdp.find("a=extmap:4 urn:ietf:params:rtp-hdrext:sdes:mid\r\na=extmap:5 " + AbsCaptureTime + "\r\na=sendonly\r\na=rtpmap:96") != std::string::npos);
+		TestEqual(TEXT("Nothing else changed"), static_cast<int64>(Sdp.size()), static_cast<int64>(Offer.size() + 2 * (std::string("a=extmap:5 ").size() + AbsCaptureTime.size() + 2)));
+
+		// Offering it again keeps the id and changes nothing
+		FSdpEditor Again(Sdp);
+		TestEqual(TEXT("Already offered"), Again.AddHeaderExtension(AbsCaptureTime, { "audio", "video" }), 5);
+		TestTrue(TEXT("Not offered twice"), Again.ToString() == Sdp);
+	}
+
+	// Only in the sections of the media given
+	{
+		FSdpEditor Editor(Offer);
+		Editor.AddHeaderExtension(AbsCaptureTime, { "video" });
+		TestEqual(TEXT("Video only"), CountLines(Editor.ToString(), "a=extmap:5 " + AbsCaptureTime), 1);
+		TestEqual(TEXT("Not in the audio section"), Editor.GetAttributes(0, "extmap").Num(), 3);
+	}
+
+	// Already offered in one section: the other sections get it with the same id
+	{
+		FSdpEditor VideoOnly(Offer);
+		VideoOnly.AddHeaderExtension(AbsCaptureTime, { "video" });
+		const std::string VideoOnlySdp = VideoOnly.ToString();
+
+		FSdpEditor Editor(VideoOnlySdp);
+		TestEqual(TEXT("Id of the video section"), Editor.AddHeaderExtension(AbsCaptureTime, { "audio", "video" }), 5);
+
+		const std::string Sdp = Editor.ToString();
+		TestEqual(TEXT("Added to the audio section"), CountLines(Sdp, "a=extmap:5 " + AbsCaptureTime), 2);
+		TestEqual(TEXT("Not twice in the video section"), Editor.GetAttributes(1, "extmap").Num(), 5);
+		TestTrue(TEXT("Added after the audio extensions"), Sdp.find("a=extmap:4 urn:ietf:params:rtp-hdrext:sdes:mid\r\na=extmap:5 " + AbsCaptureTime + "\r\na=sendonly\r\na=rtpmap:111") != std::string::npos);
+
+		// An id taken in the audio section is used as is, even if a lower one is free
+		std::string AudioWithId = Offer;
+		AudioWithId.insert(AudioWithId.find("a=sendonly\r\n"), "a=extmap:9 " + AbsCaptureTime + "\r\n");
+		FSdpEditor Audio(AudioWithId);
+		TestEqual(TEXT("Id of the audio section"), Audio.AddHeaderExtension(AbsCaptureTime, { "audio", "video" }), 9);
+		TestEqual(TEXT("Video section with the same id"), CountLines(Audio.ToString(), "a=extmap:9 " + AbsCaptureTime), 2);
+	}
+
+	// Offered at the session level, every section has it
+	{
+		std::string Session = Offer;
+		Session.insert(Session.find("a=group:BUNDLE"), "a=extmap:6 " + AbsCaptureTime + "\r\n");
+
+		FSdpEditor Editor(Session);
+		TestEqual(TEXT("Session level id"), Editor.AddHeaderExtension(AbsCaptureTime, { "audio", "video" }), 6);
+		TestTrue(TEXT("Sections unchanged"), Editor.ToString() == Session);
+	}
+
+	// No one byte header id left
+	{
+		std::string Full = Offer;
+		std::string Extensions;
+		for (int32 Id = 1; Id <= 14; ++Id)
+		{
+			Extensions += "a=extmap:" + std::to_string(Id) + " urn:test:" + std::to_string(Id) + "\r\n";
+		}
+		Full.insert(Full.find("a=sendonly\r\n"), Extensions);
+
+		FSdpEditor Editor(Full);
+		TestEqual(TEXT("No id left"), Editor.AddHeaderExtension(AbsCaptureTime, { "audio", "video" }), static_cast<int32>(INDEX_NONE));
+		TestTrue(TEXT("Unchanged without an id"), Editor.ToString() == Full);
+	}
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,119 @@
+// Copyright Dolby.io 2023. All Rights Reserved.
+
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "MillicastPublisherComponent.h"
+#include "WebRTC/Texture2DVideoSourceAdapter.h"
+
+namespace Millicast::Publisher
+{
+
+namespace
+{
+	constexpr int32 RenderFps = 60;
+	constexpr int32 RenderSeconds = 10;
+
+	/** 1080p60, 720p30 and 360p15 */
+	TArray<FMillicastSimulcastLayer> MakeLadder()
+	{
+		return {
+			FMillicastSimulcastLayer(TEXT("h"), 1.f, 6000, 0),
+			FMillicastSimulcastLayer(TEXT("m"), 1.5f, 2500, 30),
+			FMillicastSimulcastLayer(TEXT("l"), 3.f, 600, 15)
+		};
+	}
+
+	/** Renders at RenderFps with up to half a millisecond of jitter, returns the frames each layer captured */
+	TArray<int32> CountCapturedFrames(FTexture2DVideoSourceAdapter& Adapter, int32 NumLayers)
+	{
+		FRandomStream Random(27);
+		TArray<int32> NumCaptured;
+		NumCaptured.Init(0, NumLayers);
+
+		const int64 IntervalUs = rtc::kNumMicrosecsPerSec / RenderFps;
+		for (int32 Frame = 1; Frame <= RenderFps * RenderSeconds; ++Frame)
+		{
+			const int64 TimestampUs = Frame * IntervalUs + Random.RandRange(-500, 500);
+			for (int32 LayerIndex = 0; LayerIndex < NumLayers; ++LayerIndex)
+			{
+				NumCaptured[LayerIndex] += Adapter.ShouldCaptureLayer(LayerIndex, TimestampUs);
+			}
+		}
+		return NumCaptured;
+	}
+}
+
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FMillicastSimulcastLayersTest, "Millicast.Publisher.WebRTC.SimulcastLayers",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FMillicastSimulcastLayersTest::RunTest(const FString& Parameters)
+{
+	using namespace Millicast::Publisher;
+
+	// Each layer is captured at its own framerate cap, a jittery render loop doesn't lose frames on a capped layer
+	{
+		rtc::scoped_refptr<FTexture2DVideoSourceAdapter> Adapter = new rtc::RefCountedObject<FTexture2DVideoSourceAdapter>();
+		const TArray<FMillicastSimulcastLayer> Ladder = MakeLadder();
+		Adapter->SetSimulcastLayers(Ladder);
+
+		const TArray<int32> NumCaptured = CountCapturedFrames(*Adapter, Ladder.Num());
+		const int32 NumRendered = RenderFps * RenderSeconds;
+		TestEqual(TEXT("Uncapped layer, every frame"), NumCaptured[0], NumRendered);
+		TestTrue(FString::Printf(TEXT("30 fps layer (%d frames)"), NumCaptured[1]), FMath::Abs(NumCaptured[1] - 30 * RenderSeconds) <= 3);
+		TestTrue(FString::Printf(TEXT("15 fps layer (%d frames)"), NumCaptured[2]), FMath::Abs(NumCaptured[2] - 15 * RenderSeconds) <= 3);
+	}
+
+	// A cap at the render rate or above keeps every frame
+	{
+		rtc::scoped_refptr<FTexture2DVideoSourceAdapter> Adapter = new rtc::RefCountedObject<FTexture2DVideoSourceAdapter>();
+		Adapter->SetSimulcastLayers({ FMillicastSimulcastLayer(TEXT("h"), 1.f, 0, 60), FMillicastSimulcastLayer(TEXT("l"), 2.f, 0, 120) });
+
+		const TArray<int32> NumCaptured = CountCapturedFrames(*Adapter, 2);
+		TestEqual(TEXT("Cap at the render rate, every frame"), NumCaptured[0], RenderFps * RenderSeconds);
+		TestEqual(TEXT("Cap above the render rate, every frame"), NumCaptured[1], RenderFps * RenderSeconds);
+	}
+
+	// The ladder is checked before the component takes it
+	{
+		UMillicastPublisherComponent* Publisher = NewObject<UMillicastPublisherComponent>(GetTransientPackage());
+
+		TestTrue(TEXT("1080p60, 720p30 and 360p15 accepted"), Publisher->SetSimulcastLayers(MakeLadder()));
+
+		AddExpectedError(TEXT("Simulcast needs between 2 and"), EAutomationExpectedErrorFlags::Contains, 2);
+		TestFalse(TEXT("Single layer refused"), Publisher->SetSimulcastLayers({ FMillicastSimulcastLayer(TEXT("h"), 1.f) }));
+
+		TArray<FMillicastSimulcastLayer> TooMany = MakeLadder();
+		TooMany.Add(FMillicastSimulcastLayer(TEXT("xl"), 4.f));
+		TestFalse(TEXT("More layers than webrtc has streams refused"), Publisher->SetSimulcastLayers(TooMany));
+
+		AddExpectedError(TEXT("rid must be unique and not empty"), EAutomationExpectedErrorFlags::Contains, 2);
+		TArray<FMillicastSimulcastLayer> SameRid = MakeLadder();
+		SameRid[2].Rid = TEXT("m");
+		TestFalse(TEXT("Duplicate rid refused"), Publisher->SetSimulcastLayers(SameRid));
+
+		TArray<FMillicastSimulcastLayer> NoRid = MakeLadder();
+		NoRid[1].Rid.Empty();
+		TestFalse(TEXT("Empty rid refused"), Publisher->SetSimulcastLayers(NoRid));
+
+		AddExpectedError(TEXT("Invalid settings for simulcast layer"), EAutomationExpectedErrorFlags::Contains, 3);
+		TArray<FMillicastSimulcastLayer> Upscaled = MakeLadder();
+		Upscaled[0].ScaleResolutionDownBy = 0.5f;
+		TestFalse(TEXT("Upscaled layer refused"), Publisher->SetSimulcastLayers(Upscaled));
+
+		TArray<FMillicastSimulcastLayer> NegativeBitrate = MakeLadder();
+		NegativeBitrate[1].MaxBitrate = -1;
+		TestFalse(TEXT("Negative bitrate refused"), Publisher->SetSimulcastLayers(NegativeBitrate));
+
+		TArray<FMillicastSimulcastLayer> NegativeFramerate = MakeLadder();
+		NegativeFramerate[2].MaxFramerate = -1;
+		TestFalse(TEXT("Negative framerate refused"), Publisher->SetSimulcastLayers(NegativeFramerate));
+	}
+
+	return true;
+}
+
+#endif
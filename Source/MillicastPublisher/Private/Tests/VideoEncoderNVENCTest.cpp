@@ -0,0 +1,139 @@
+// Copyright Dolby.io 2023. All Rights Reserved.
+
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS && WITH_AVENCODER
+
+#include "WebRTC/VideoEncoderNVENC.h"
+
+namespace Millicast::Publisher
+{
+
+namespace
+{
+	using FLayerConfig = AVEncoder::FVideoEncoder::FLayerConfig;
+	using EH264Profile = AVEncoder::FVideoEncoder::H264Profile;
+
+	constexpr int32 StartBitrateKbps = 2000;
+	constexpr int32 MaxBitrateKbps = 4000;
+
+	webrtc::SdpVideoFormat MakeH264Format(const char* ProfileLevelId)
+	{
+		webrtc::SdpVideoFormat Format(cricket::kH264CodecName, { { cricket::kH264FmtpPacketizationMode, "1" } });
+		if (ProfileLevelId)
+		{
+			Format.parameters[cricket::kH264FmtpProfileLevelId] = ProfileLevelId;
+		}
+		return Format;
+	}
+
+	webrtc::VideoCodec MakeCodec()
+	{
+		webrtc::VideoCodec Codec;
+		Codec.codecType = webrtc::kVideoCodecH264;
+		Codec.width = 1280;
+		Codec.height = 720;
+		Codec.startBitrate = StartBitrateKbps;
+		Codec.maxBitrate = MaxBitrateKbps;
+		Codec.minBitrate = 30;
+		Codec.maxFramerate = 60;
+		return Codec;
+	}
+
+	webrtc::VideoEncoder::RateControlParameters MakeRates(int32 TargetBps, int32 AllocatedBps)
+	{
+		webrtc::VideoBitrateAllocation Allocation;
+		Allocation.SetBitrate(0, 0, TargetBps);
+		return webrtc::VideoEncoder::RateControlParameters(Allocation, 60.0, webrtc::DataRate::BitsPerSec(AllocatedBps));
+	}
+
+	const TCHAR* ToString(EMillicastVideoEncoderPreset Preset)
+	{
+		switch (Preset)
+		{
+		case EMillicastVideoEncoderPreset::UltraLowLatency: return TEXT("UltraLowLatency");
+		case EMillicastVideoEncoderPreset::Quality: return TEXT("Quality");
+		default: return TEXT("Balanced");
+		}
+	}
+}
+
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FMillicastVideoEncoderNVENCPresetTest, "Millicast.Publisher.WebRTC.VideoEncoderNVENC.Presets",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FMillicastVideoEncoderNVENCPresetTest::RunTest(const FString& Parameters)
+{
+	using namespace Millicast::Publisher;
+
+	// The profile is the negotiated one
+	TestTrue(TEXT("Constrained baseline"), FVideoEncoderNVENC::GetH264Profile(MakeH264Format("42e01f")) == EH264Profile::CONSTRAINED_BASELINE);
+	TestTrue(TEXT("Baseline"), FVideoEncoderNVENC::GetH264Profile(MakeH264Format("42001f")) == EH264Profile::BASELINE);
+	TestTrue(TEXT("Main"), FVideoEncoderNVENC::GetH264Profile(MakeH264Format("4d0015")) == EH264Profile::MAIN);
+	TestTrue(TEXT("High"), FVideoEncoderNVENC::GetH264Profile(MakeH264Format("64001f")) == EH264Profile::HIGH);
+	TestTrue(TEXT("No profile-level-id"), FVideoEncoderNVENC::GetH264Profile(MakeH264Format(nullptr)) == EH264Profile::CONSTRAINED_BASELINE);
+
+	const EMillicastVideoEncoderPreset Presets[] = { EMillicastVideoEncoderPreset::UltraLowLatency, EMillicastVideoEncoderPreset::Balanced, EMillicastVideoEncoderPreset::Quality };
+	const char* ProfileLevelIds[] = { "42e01f", "4d0015" };
+
+	const webrtc::VideoCodec Codec = MakeCodec();
+	const webrtc::VideoEncoder::Settings Settings(webrtc::VideoEncoder::Capabilities(false), 1, 1200);
+	const FLayerConfig DefaultConfig;
+
+	for (const EMillicastVideoEncoderPreset Preset : Presets)
+	{
+		for (const char* ProfileLevelId : ProfileLevelIds)
+		{
+			const webrtc::SdpVideoFormat Format = MakeH264Format(ProfileLevelId);
+			const FString What = FString::Printf(TEXT("%s with %s"), ToString(Preset), UTF8_TO_TCHAR(ProfileLevelId));
+
+			FVideoEncoderNVENC Encoder(Format, Preset);
+			TestEqual(What + TEXT(" initializes"), Encoder.InitEncode(&Codec, Settings), WEBRTC_VIDEO_CODEC_OK);
+
+			FLayerConfig Config = Encoder.GetConfig();
+			TestTrue(What + TEXT(" keeps the negotiated profile"), Config.H264Profile == FVideoEncoderNVENC::GetH264Profile(Format));
+			TestEqual(What + TEXT(" target bitrate"), static_cast<int32>(Config.TargetBitrate), StartBitrateKbps * 1000);
+
+			switch (Preset)
+			{
+			case EMillicastVideoEncoderPreset::UltraLowLatency:
+				TestTrue(What + TEXT(" is CBR without multipass"), Config.RateControlMode == AVEncoder::FVideoEncoder::RateControlMode::CBR
+					&& Config.MultipassMode == AVEncoder::FVideoEncoder::MultipassMode::DISABLED);
+				TestEqual(What + TEXT(" peak is the target"), static_cast<int32>(Config.MaxBitrate), StartBitrateKbps * 1000);
+				break;
+			case EMillicastVideoEncoderPreset::Quality:
+				TestTrue(What + TEXT(" is VBR with full multipass"), Config.RateControlMode == AVEncoder::FVideoEncoder::RateControlMode::VBR
+					&& Config.MultipassMode == AVEncoder::FVideoEncoder::MultipassMode::FULL);
+				TestEqual(What + TEXT(" peak is 1.5 times the target"), static_cast<int32>(Config.MaxBitrate), StartBitrateKbps * 1500);
+				break;
+			default:
+				TestTrue(What + TEXT(" is VBR with the default multipass"), Config.RateControlMode == AVEncoder::FVideoEncoder::RateControlMode::VBR
+					&& Config.MultipassMode == DefaultConfig.MultipassMode);
+				TestEqual(What + TEXT(" peak is the max bitrate"), static_cast<int32>(Config.MaxBitrate), MaxBitrateKbps * 1000);
+				break;
+			}
+
+			// Little headroom over the target, the peak never exceeds the allocation
+			Encoder.SetRates(MakeRates(2'500'000, 3'000'000));
+			Config = Encoder.GetConfig();
+			TestEqual(What + TEXT(" new target"), static_cast<int32>(Config.TargetBitrate), 2'500'000);
+			TestTrue(What + TEXT(" peak within the allocation"), static_cast<int64>(Config.MaxBitrate) >= static_cast<int64>(Config.TargetBitrate) && static_cast<int64>(Config.MaxBitrate) <= 3'000'000);
+			TestTrue(What + TEXT(" keeps the profile on rate changes"), Config.H264Profile == FVideoEncoderNVENC::GetH264Profile(Format));
+
+			Encoder.Release();
+		}
+	}
+
+	// Peak bitrates of the presets, bounded by the allocation but never below the target
+	TestEqual(TEXT("UltraLowLatency peak"), FVideoEncoderNVENC::GetPresetMaxBitrate(EMillicastVideoEncoderPreset::UltraLowLatency, 2'000'000, 10'000'000), 2'000'000);
+	TestEqual(TEXT("Balanced peak"), FVideoEncoderNVENC::GetPresetMaxBitrate(EMillicastVideoEncoderPreset::Balanced, 2'000'000, 10'000'000), 10'000'000);
+	TestEqual(TEXT("Quality peak with headroom"), FVideoEncoderNVENC::GetPresetMaxBitrate(EMillicastVideoEncoderPreset::Quality, 2'000'000, 10'000'000), 3'000'000);
+	TestEqual(TEXT("Quality peak clamped to the allocation"), FVideoEncoderNVENC::GetPresetMaxBitrate(EMillicastVideoEncoderPreset::Quality, 2'000'000, 2'400'000), 2'400'000);
+	TestEqual(TEXT("Quality peak never below the target"), FVideoEncoderNVENC::GetPresetMaxBitrate(EMillicastVideoEncoderPreset::Quality, 2'000'000, 1'000'000), 2'000'000);
+	TestEqual(TEXT("Balanced peak never below the target"), FVideoEncoderNVENC::GetPresetMaxBitrate(EMillicastVideoEncoderPreset::Balanced, 2'000'000, 1'000'000), 2'000'000);
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,155 @@
+// Copyright Dolby.io 2023. All Rights Reserved.
+
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "WebRTC/SimulcastEncoderFactory.h"
+
+namespace Millicast::Publisher
+{
+
+namespace
+{
+	constexpr int32 Width = 1280;
+	constexpr int32 Height = 720;
+	constexpr int32 MinBitrateBps = 300'000;
+	constexpr int32 MaxBitrateBps = 2'500'000;
+	constexpr int32 MaxFramerate = 60;
+
+	bool WaitForWarmUp(const FWarmEncoderPool& Pool, int32 NumEncoders)
+	{
+		const double Deadline = FPlatformTime::Seconds() + 10.0;
+		while (Pool.GetNumEncoders() < NumEncoders && FPlatformTime::Seconds() < Deadline)
+		{
+			FPlatformProcess::Sleep(0.01f);
+		}
+		return Pool.GetNumEncoders() == NumEncoders;
+	}
+
+	/**
+	 * A single VP8 stream as webrtc hands it to InitEncode after the negotiation: one simulcast stream, texture input,
+	 * timing frames and its own start bitrate, which none of the warm up settings have.
+	 */
+	webrtc::VideoCodec MakeNegotiatedCodec(int32 InWidth, int32 InHeight)
+	{
+		webrtc::VideoCodec Codec;
+		Codec.codecType = webrtc::kVideoCodecVP8;
+		Codec.width = InWidth;
+		Codec.height = InHeight;
+		Codec.startBitrate = 1200;
+		Codec.minBitrate = MinBitrateBps / 1000;
+		Codec.maxBitrate = MaxBitrateBps / 1000;
+		Codec.maxFramerate = MaxFramerate;
+		Codec.qpMax = 56;
+		Codec.active = true;
+		Codec.mode = webrtc::VideoCodecMode::kRealtimeVideo;
+		Codec.expect_encode_from_texture = true;
+		Codec.timing_frame_thresholds = { 200, 250 };
+
+		Codec.numberOfSimulcastStreams = 1;
+		webrtc::SimulcastStream& Stream = Codec.simulcastStream[0];
+		Stream.width = InWidth;
+		Stream.height = InHeight;
+		Stream.maxFramerate = MaxFramerate;
+		Stream.numberOfTemporalLayers = 1;
+		Stream.minBitrate = Codec.minBitrate;
+		Stream.targetBitrate = Codec.maxBitrate;
+		Stream.maxBitrate = Codec.maxBitrate;
+		Stream.qpMax = Codec.qpMax;
+		Stream.active = true;
+
+		*Codec.VP8() = webrtc::VideoEncoder::GetDefaultVp8Settings();
+		Codec.VP8()->automaticResizeOn = true;
+		Codec.VP8()->keyFrameInterval = 3000;
+		return Codec;
+	}
+}
+
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FMillicastWarmEncoderPoolTest, "Millicast.Publisher.WebRTC.WarmEncoderPool",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FMillicastWarmEncoderPoolTest::RunTest(const FString& Parameters)
+{
+	using namespace Millicast::Publisher;
+
+	FSimulcastEncoderFactory Factory;
+
+	// Not the core count and payload size the warm up uses either
+	const webrtc::VideoEncoder::Settings Settings(webrtc::VideoEncoder::Capabilities(false), 2, 1188);
+
+	// The encoder warmed up before the negotiation is the one the next InitEncode uses
+	{
+		TSharedPtr<FWarmEncoderPool, ESPMode::ThreadSafe> Pool = Factory.WarmUp(TEXT("VP8"), Width, Height, {}, MinBitrateBps, MaxBitrateBps, MaxFramerate, false);
+		if (!TestTrue(TEXT("VP8 warmed up"), Pool.IsValid() && WaitForWarmUp(*Pool, 1)))
+		{
+			return true;
+		}
+
+		std::unique_ptr<webrtc::VideoEncoder> Encoder = Factory.CreateVideoEncoder(webrtc::SdpVideoFormat("VP8"));
+		const webrtc::VideoCodec Codec = MakeNegotiatedCodec(Width, Height);
+		TestEqual(TEXT("Initialized"), Encoder->InitEncode(&Codec, Settings), WEBRTC_VIDEO_CODEC_OK);
+		TestEqual(TEXT("Warm encoder used"), Pool->GetNumEncoders(), 0);
+
+		Encoder->Release();
+	}
+
+	// A resolution or content mode that changed since the warm up needs a new encoder, the warm one stays in the pool
+	{
+		TSharedPtr<FWarmEncoderPool, ESPMode::ThreadSafe> Pool = Factory.WarmUp(TEXT("VP8"), Width, Height, {}, MinBitrateBps, MaxBitrateBps, MaxFramerate, false);
+		if (!TestTrue(TEXT("VP8 warmed up again"), Pool.IsValid() && WaitForWarmUp(*Pool, 1)))
+		{
+			return true;
+		}
+
+		std::unique_ptr<webrtc::VideoEncoder> Encoder = Factory.CreateVideoEncoder(webrtc::SdpVideoFormat("VP8"));
+		const webrtc::VideoCodec Smaller = MakeNegotiatedCodec(Width / 2, Height / 2);
+		TestEqual(TEXT("Other resolution initialized"), Encoder->InitEncode(&Smaller, Settings), WEBRTC_VIDEO_CODEC_OK);
+		TestEqual(TEXT("Other resolution, warm encoder kept"), Pool->GetNumEncoders(), 1);
+		Encoder->Release();
+
+		webrtc::VideoCodec Screen = MakeNegotiatedCodec(Width, Height);
+		Screen.mode = webrtc::VideoCodecMode::kScreensharing;
+		TestEqual(TEXT("Screen content initialized"), Encoder->InitEncode(&Screen, Settings), WEBRTC_VIDEO_CODEC_OK);
+		TestEqual(TEXT("Screen content, warm encoder kept"), Pool->GetNumEncoders(), 1);
+		Encoder->Release();
+
+		// Released by the publisher once negotiated, nothing is handed out anymore
+		Pool.Reset();
+		const webrtc::VideoCodec Codec = MakeNegotiatedCodec(Width, Height);
+		TestEqual(TEXT("Pool released, new encoder initialized"), Encoder->InitEncode(&Codec, Settings), WEBRTC_VIDEO_CODEC_OK);
+		Encoder->Release();
+	}
+
+	// Each layer of a simulcast ladder is warmed up and handed to its stream
+	{
+		const TArray<FMillicastSimulcastLayer> Layers = { FMillicastSimulcastLayer(TEXT("h"), 1.f), FMillicastSimulcastLayer(TEXT("l"), 2.f) };
+		TSharedPtr<FWarmEncoderPool, ESPMode::ThreadSafe> Pool = Factory.WarmUp(TEXT("VP8"), Width, Height, Layers, MinBitrateBps, MaxBitrateBps, MaxFramerate, false);
+		if (!TestTrue(TEXT("Simulcast warmed up"), Pool.IsValid() && WaitForWarmUp(*Pool, Layers.Num())))
+		{
+			return true;
+		}
+
+		// The streams in the order of the ladder, as the publisher sets the encodings, with the temporal layers webrtc
+		// gives VP8 simulcast streams
+		webrtc::VideoCodec Codec = MakeNegotiatedCodec(Width, Height);
+		Codec.numberOfSimulcastStreams = 2;
+		Codec.VP8()->numberOfTemporalLayers = 3;
+		Codec.simulcastStream[0].numberOfTemporalLayers = 3;
+		Codec.simulcastStream[1] = Codec.simulcastStream[0];
+		Codec.simulcastStream[1].width = Width / 2;
+		Codec.simulcastStream[1].height = Height / 2;
+		Codec.simulcastStream[1].maxBitrate = Codec.simulcastStream[1].targetBitrate = MaxBitrateBps / 2000;
+
+		std::unique_ptr<webrtc::VideoEncoder> Encoder = Factory.CreateVideoEncoder(webrtc::SdpVideoFormat("VP8"));
+		TestEqual(TEXT("Simulcast initialized"), Encoder->InitEncode(&Codec, Settings), WEBRTC_VIDEO_CODEC_OK);
+		TestEqual(TEXT("Warm encoder of every layer used"), Pool->GetNumEncoders(), 0);
+		Encoder->Release();
+	}
+
+	return true;
+}
+
+#endif
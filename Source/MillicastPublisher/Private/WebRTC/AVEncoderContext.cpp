@@ -21,13 +21,13 @@ THIRD_PARTY_INCLUDES_END
 namespace Millicast::Publisher
 {
 
-FAVEncoderContext::FAVEncoderContext(int32 InCaptureWidth, int32 InCaptureHeight, bool bInFixedResolution)
+FAVEncoderContext::FAVEncoderContext(int32 InCaptureWidth, int32 InCaptureHeight, bool bInFixedResolution, int32 MaxNumBuffers)
 	: CaptureWidth(InCaptureWidth)
 	, CaptureHeight(InCaptureHeight)
 	, bFixedResolution(bInFixedResolution)
 	, VideoEncoderInput(CreateVideoEncoderInput(InCaptureWidth, InCaptureHeight, bInFixedResolution))
 {
-	VideoEncoderInput->SetMaxNumBuffers(3);
+	VideoEncoderInput->SetMaxNumBuffers(MaxNumBuffers);
 }
 
 void FAVEncoderContext::DeleteBackBuffers()
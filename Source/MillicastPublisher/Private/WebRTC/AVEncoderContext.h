@@ -22,7 +22,8 @@ namespace Millicast::Publisher
 	class FAVEncoderContext final
 	{
 	public:
-		FAVEncoderContext(int32 InCaptureWidth, int32 InCaptureHeight, bool bInFixedResolution);
+		/** MaxNumBuffers is the number of input frames that can be in use at once, ObtainCapturedInput fails past it */
+		FAVEncoderContext(int32 InCaptureWidth, int32 InCaptureHeight, bool bInFixedResolution, int32 MaxNumBuffers = 3);
 
 		int32 GetCaptureWidth() const { return CaptureWidth; }
 		int32 GetCaptureHeight() const { return CaptureHeight; }
@@ -49,7 +50,8 @@ namespace Millicast::Publisher
 		int32 CaptureHeight = 0;
 		bool bFixedResolution = false;
 		
-		TSharedPtr<AVEncoder::FVideoEncoderInput> VideoEncoderInput;
+		// The input is destroyed first, its frames remove themselves from the back buffers when they are destroyed
 		TMap<AVEncoder::FVideoEncoderInputFrame*, FTexture2DRHIRef> BackBuffers;
+		TSharedPtr<AVEncoder::FVideoEncoderInput> VideoEncoderInput;
 	};
 }
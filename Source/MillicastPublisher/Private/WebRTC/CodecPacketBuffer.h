@@ -0,0 +1,40 @@
+// Copyright Dolby.io 2023. All Rights Reserved.
+
+#pragma once
+
+#if WITH_AVENCODER
+#include "WebRTCInc.h"
+#include "VideoEncoder.h"
+
+namespace Millicast::Publisher
+{
+	/*
+	 * Encoded image storage backed by the data of an AVEncoder packet.
+	 * Holds a reference to the packet data instead of copying it, so that key frames are not memcpy'd on the encoder thread.
+	 * The packet data of UE 4.27 is only valid during the callback, in that case it is copied once.
+	 */
+	class FCodecPacketBuffer : public webrtc::EncodedImageBufferInterface
+	{
+	public:
+		static rtc::scoped_refptr<webrtc::EncodedImageBufferInterface> Create(const AVEncoder::FCodecPacket& Packet)
+		{
+#if ENGINE_MAJOR_VERSION < 5
+			return webrtc::EncodedImageBuffer::Create(const_cast<uint8_t*>(Packet.Data), Packet.DataSize);
+#else
+			return rtc::make_ref_counted<FCodecPacketBuffer>(Packet.Data, Packet.DataSize);
+#endif
+		}
+
+		const uint8_t* data() const override { return Data.Get(); }
+		uint8_t* data() override { return Data.Get(); }
+		size_t size() const override { return Size; }
+
+	protected:
+		FCodecPacketBuffer(TSharedPtr<uint8> InData, size_t InSize) : Data(MoveTemp(InData)), Size(InSize) {}
+
+	private:
+		TSharedPtr<uint8> Data;
+		size_t Size;
+	};
+}
+#endif
@@ -0,0 +1,25 @@
+// Copyright Dolby.io 2023. All Rights Reserved.
+
+#include "EncodedFrameBuffer.h"
+
+#include "MillicastPublisherPrivate.h"
+
+namespace Millicast::Publisher
+{
+
+rtc::scoped_refptr<webrtc::I420BufferInterface> FEncodedFrameBuffer::ToI420()
+{
+	// Once per process, webrtc would ask for every frame of the stream
+	static TAtomic<bool> bLogged { false };
+	if (!bLogged.Exchange(true))
+	{
+		UE_LOG(LogMillicastPublisher, Warning, TEXT("An encoded %dx%d frame was converted to I420, a black frame is sent instead. "
+			"Passthrough frames can't be scaled, cropped or re-encoded"), Width, Height);
+	}
+
+	rtc::scoped_refptr<webrtc::I420Buffer> Buffer = webrtc::I420Buffer::Create(Width, Height);
+	webrtc::I420Buffer::SetBlack(Buffer.get());
+	return Buffer;
+}
+
+}
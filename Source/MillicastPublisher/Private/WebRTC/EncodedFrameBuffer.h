@@ -0,0 +1,88 @@
+// Copyright Dolby.io 2023. All Rights Reserved.
+
+#pragma once
+
+#include "WebRTCInc.h"
+
+namespace Millicast::Publisher
+{
+	/** Where the frames of a passthrough stream come from, a pre-encoded file or the encoder of another stream */
+	class IEncodedFrameSource
+	{
+	public:
+		virtual ~IEncodedFrameSource() = default;
+
+		/** The passthrough encoder can't produce a key frame, the source sends one as soon as it can */
+		virtual void RequestKeyFrame() = 0;
+
+		/** Bitrate webrtc allocates to the stream, the source may or may not follow it */
+		virtual void SetTargetBitrate(uint32 Bps) {}
+	};
+
+	/*
+	 * A frame that is already encoded, handed as is to the passthrough encoder.
+	 * It can't be converted to I420, the frames of such a source must not reach a real encoder.
+	 * If webrtc still asks for one, to scale or crop the frame or for a software fallback, it gets a black frame.
+	 */
+	class FEncodedFrameBuffer : public webrtc::VideoFrameBuffer
+	{
+	public:
+		/** Sequence increases by one for each frame sent by the source, a gap means a frame was dropped before the encoder */
+		FEncodedFrameBuffer(TSharedPtr<IEncodedFrameSource, ESPMode::ThreadSafe> InSource,
+			rtc::scoped_refptr<webrtc::EncodedImageBufferInterface> InData,
+			webrtc::VideoCodecType InCodecType,
+			int InWidth,
+			int InHeight,
+			bool bInKeyFrame,
+			uint32 InSequence)
+			: Source(MoveTemp(InSource))
+			, Data(MoveTemp(InData))
+			, CodecType(InCodecType)
+			, Width(InWidth)
+			, Height(InHeight)
+			, bKeyFrame(bInKeyFrame)
+			, Sequence(InSequence)
+		{}
+
+		rtc::scoped_refptr<webrtc::EncodedImageBufferInterface> GetEncodedData() const { return Data; }
+		const uint8* GetData() const { return Data->data(); }
+		int32 GetSize() const { return static_cast<int32>(Data->size()); }
+		bool IsKeyFrame() const { return bKeyFrame; }
+		webrtc::VideoCodecType GetCodecType() const { return CodecType; }
+		uint32 GetSequence() const { return Sequence; }
+
+		IEncodedFrameSource& GetSource() const { return *Source; }
+
+		Type type() const override
+		{
+			return Type::kNative;
+		}
+
+		int width() const override
+		{
+			return Width;
+		}
+
+		int height() const override
+		{
+			return Height;
+		}
+
+		/** A black frame of the same size, the first conversion is logged */
+		rtc::scoped_refptr<webrtc::I420BufferInterface> ToI420() override;
+
+		const webrtc::I420BufferInterface* GetI420() const override
+		{
+			return nullptr;
+		}
+
+	private:
+		TSharedPtr<IEncodedFrameSource, ESPMode::ThreadSafe> Source;
+		rtc::scoped_refptr<webrtc::EncodedImageBufferInterface> Data;
+		webrtc::VideoCodecType CodecType;
+		int Width;
+		int Height;
+		bool bKeyFrame;
+		uint32 Sequence;
+	};
+}
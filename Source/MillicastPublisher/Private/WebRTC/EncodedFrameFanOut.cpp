@@ -0,0 +1,121 @@
+// Copyright Dolby.io 2023. All Rights Reserved.
+
+#include "EncodedFrameFanOut.h"
+
+#include "FrameBufferRHI.h"
+#include "MillicastPublisherPrivate.h"
+
+namespace Millicast::Publisher
+{
+
+FEncodedFrameFanOut::FDestinationPtr FEncodedFrameFanOut::AddDestination(int32 StreamIndex)
+{
+	FDestinationPtr Destination = MakeShareable(new FDestination(StreamIndex));
+
+	FScopeLock Lock(&DestinationsGuard);
+	Destinations.Add(Destination);
+
+	UE_LOG(LogMillicastPublisher, Log, TEXT("Added encoded frame destination, %d destinations"), Destinations.Num());
+
+	return Destination;
+}
+
+void FEncodedFrameFanOut::RemoveDestination(const FDestinationPtr& Destination)
+{
+	FScopeLock Lock(&DestinationsGuard);
+	Destinations.Remove(Destination);
+}
+
+bool FEncodedFrameFanOut::HasDestinations() const
+{
+	FScopeLock Lock(&DestinationsGuard);
+	return Destinations.Num() > 0;
+}
+
+bool FEncodedFrameFanOut::IsDestinationOf(const FDestination& Destination, int32 StreamIndex, int32 NumStreams)
+{
+	// Without simulcast on the publisher, every destination gets the only stream
+	const bool bFollowsHighest = Destination.StreamIndex == INDEX_NONE || Destination.StreamIndex >= NumStreams;
+	return bFollowsHighest ? StreamIndex == NumStreams - 1 : StreamIndex == Destination.StreamIndex;
+}
+
+void FEncodedFrameFanOut::OnEncodedImage(int32 StreamIndex, int32 NumStreams, webrtc::VideoCodecType CodecType, const webrtc::EncodedImage& Image)
+{
+	FScopeLock Lock(&DestinationsGuard);
+
+	if (Destinations.Num() == 0)
+	{
+		return;
+	}
+
+	// The encoded data is shared by all the destinations, it is only copied if the encoder did not make it ref counted
+	rtc::scoped_refptr<webrtc::EncodedImageBufferInterface> Data = Image.GetEncodedData();
+	if (!Data)
+	{
+		Data = webrtc::EncodedImageBuffer::Create(Image.data(), Image.size());
+	}
+
+	const bool bKeyFrame = Image._frameType == webrtc::VideoFrameType::kVideoFrameKey;
+	const int64 TimestampUs = Image.capture_time_ms_ > 0 ? Image.capture_time_ms_ * rtc::kNumMicrosecsPerMillisec : rtc::TimeMicros();
+
+	for (const FDestinationPtr& Destination : Destinations)
+	{
+		if (!IsDestinationOf(*Destination, StreamIndex, NumStreams))
+		{
+			continue;
+		}
+
+		auto EncodedFrame = rtc::make_ref_counted<FEncodedFrameBuffer>(Destination, Data, CodecType,
+			Image._encodedWidth, Image._encodedHeight, bKeyFrame, Destination->Sequence++);
+
+		auto SimulcastBuffer = rtc::make_ref_counted<FSimulcastFrameBuffer>(Image._encodedWidth, Image._encodedHeight);
+		SimulcastBuffer->SetEncodedFrame(EncodedFrame);
+
+		webrtc::VideoFrame Frame = webrtc::VideoFrame::Builder()
+			.set_video_frame_buffer(SimulcastBuffer)
+			.set_timestamp_us(TimestampUs)
+			.set_rotation(Image.rotation_)
+			.build();
+
+		Destination->VideoSource->Deliver(Frame);
+	}
+}
+
+bool FEncodedFrameFanOut::ConsumeKeyFrameRequest(int32 StreamIndex, int32 NumStreams)
+{
+	FScopeLock Lock(&DestinationsGuard);
+
+	bool bRequested = false;
+	for (const FDestinationPtr& Destination : Destinations)
+	{
+		if (IsDestinationOf(*Destination, StreamIndex, NumStreams))
+		{
+			bRequested |= Destination->bKeyFrameRequested.Exchange(false);
+		}
+	}
+
+	return bRequested;
+}
+
+uint32 FEncodedFrameFanOut::GetMinTargetBitrate() const
+{
+	FScopeLock Lock(&DestinationsGuard);
+
+	uint32 MinBitrateBps = 0;
+	for (const FDestinationPtr& Destination : Destinations)
+	{
+		const uint32 TargetBitrateBps = Destination->TargetBitrateBps;
+
+		// Destinations forwarding a lower layer don't constrain the highest one
+		if (Destination->StreamIndex != INDEX_NONE || TargetBitrateBps == 0)
+		{
+			continue;
+		}
+
+		MinBitrateBps = MinBitrateBps == 0 ? TargetBitrateBps : FMath::Min(MinBitrateBps, TargetBitrateBps);
+	}
+
+	return MinBitrateBps;
+}
+
+}
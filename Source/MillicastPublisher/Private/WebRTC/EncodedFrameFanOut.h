@@ -0,0 +1,87 @@
+// Copyright Dolby.io 2023. All Rights Reserved.
+
+#pragma once
+
+#include "WebRTCInc.h"
+#include "EncodedFrameBuffer.h"
+
+namespace Millicast::Publisher
+{
+	/*
+	 * Video source of a destination, fed with the encoded frames of another publisher.
+	 * Its frames go through the passthrough encoder of the destination peer connection.
+	 */
+	class FEncodedFrameRelaySource : public rtc::AdaptedVideoTrackSource
+	{
+	public:
+		void Deliver(const webrtc::VideoFrame& Frame) { OnFrame(Frame); }
+
+		// rtc::AdaptedVideoTrackSource
+		webrtc::MediaSourceInterface::SourceState state() const override { return webrtc::MediaSourceInterface::kLive; }
+		absl::optional<bool> needs_denoising() const override { return false; }
+		bool is_screencast() const override { return bScreencast; }
+		bool remote() const override { return false; }
+		// ~rtc::AdaptedVideoTrackSource
+
+		void SetScreencast(bool bInScreencast) { bScreencast = bInScreencast; }
+
+	private:
+		bool bScreencast = false;
+	};
+
+	/*
+	 * Shares the output of the encoders of a publisher with other peer connections, so that publishing the same content
+	 * to several streams captures and encodes it once.
+	 * A destination either follows the highest layer, in which case the encoder is capped to the lowest bitrate
+	 * allocated by all of them, or forwards a given simulcast layer as it is.
+	 */
+	class FEncodedFrameFanOut
+	{
+	public:
+		class FDestination : public IEncodedFrameSource
+		{
+		public:
+			int32 GetStreamIndex() const { return StreamIndex; }
+			rtc::scoped_refptr<FEncodedFrameRelaySource> GetVideoSource() const { return VideoSource; }
+
+			// IEncodedFrameSource, called by the passthrough encoder of the destination
+			void RequestKeyFrame() override { bKeyFrameRequested = true; }
+			void SetTargetBitrate(uint32 Bps) override { TargetBitrateBps = Bps; }
+
+		private:
+			friend class FEncodedFrameFanOut;
+
+			FDestination(int32 InStreamIndex) : StreamIndex(InStreamIndex), VideoSource(rtc::make_ref_counted<FEncodedFrameRelaySource>()) {}
+
+			int32 StreamIndex;
+			rtc::scoped_refptr<FEncodedFrameRelaySource> VideoSource;
+
+			// The destination starts with a key frame
+			TAtomic<bool> bKeyFrameRequested { true };
+			TAtomic<uint32> TargetBitrateBps { 0 };
+			uint32 Sequence = 0;
+		};
+
+		using FDestinationPtr = TSharedPtr<FDestination, ESPMode::ThreadSafe>;
+
+		/** Destinations follow the highest layer with INDEX_NONE, or the simulcast layer of the publisher at that index */
+		FDestinationPtr AddDestination(int32 StreamIndex = INDEX_NONE);
+		void RemoveDestination(const FDestinationPtr& Destination);
+		bool HasDestinations() const;
+
+		/** Called by the encoder of the publisher for every encoded image of every stream */
+		void OnEncodedImage(int32 StreamIndex, int32 NumStreams, webrtc::VideoCodecType CodecType, const webrtc::EncodedImage& Image);
+
+		/** Whether a destination of the stream is waiting for a key frame, resets the requests */
+		bool ConsumeKeyFrameRequest(int32 StreamIndex, int32 NumStreams);
+
+		/** Lowest bitrate allocated by the destinations following the highest layer, 0 if none is known */
+		uint32 GetMinTargetBitrate() const;
+
+	private:
+		static bool IsDestinationOf(const FDestination& Destination, int32 StreamIndex, int32 NumStreams);
+
+		mutable FCriticalSection DestinationsGuard;
+		TArray<FDestinationPtr> Destinations;
+	};
+}
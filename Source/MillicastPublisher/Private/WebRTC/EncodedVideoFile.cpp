@@ -0,0 +1,473 @@
+// Copyright Dolby.io 2023. All Rights Reserved.
+
+#include "EncodedVideoFile.h"
+
+#include "H264NalIndexer.h"
+#include "MillicastPublisherPrivate.h"
+
+#include "Algo/BinarySearch.h"
+#include "Misc/FileHelper.h"
+
+namespace Millicast::Publisher
+{
+
+namespace
+{
+	uint16 ReadLE16(const uint8* In)
+	{
+		return In[0] | (In[1] << 8);
+	}
+
+	uint32 ReadLE32(const uint8* In)
+	{
+		return ReadLE16(In) | (static_cast<uint32>(ReadLE16(In + 2)) << 16);
+	}
+
+	uint64 ReadLE64(const uint8* In)
+	{
+		return ReadLE32(In) | (static_cast<uint64>(ReadLE32(In + 4)) << 32);
+	}
+
+	/** Reads the bitstream MSB first, reading past the end returns zeros */
+	class FBitReader
+	{
+	public:
+		FBitReader(const uint8* InData, int32 InSize) : Data(InData), Size(InSize) {}
+
+		uint32 ReadBits(int32 NumBits)
+		{
+			uint32 Value = 0;
+			for (int32 i = 0; i < NumBits; ++i, ++Position)
+			{
+				const int32 Byte = Position >> 3;
+				const uint32 Bit = Byte < Size ? (Data[Byte] >> (7 - (Position & 7))) & 1 : 0;
+				Value = (Value << 1) | Bit;
+			}
+			return Value;
+		}
+
+		/** Exp-Golomb unsigned, a code longer than 32 bits is malformed and returns MAX_uint32 */
+		uint32 ReadUE()
+		{
+			int32 LeadingZeros = 0;
+			while (LeadingZeros < 32 && ReadBits(1) == 0)
+			{
+				++LeadingZeros;
+			}
+			if (LeadingZeros == 32)
+			{
+				return MAX_uint32;
+			}
+			return LeadingZeros == 0 ? 0 : (1u << LeadingZeros) - 1 + ReadBits(LeadingZeros);
+		}
+
+		int32 ReadSE()
+		{
+			const uint32 Value = ReadUE();
+			return (Value & 1) ? static_cast<int32>((Value + 1) / 2) : -static_cast<int32>(Value / 2);
+		}
+
+		/** Whether more bits were read than there are, the values read are then meaningless */
+		bool IsOverrun() const
+		{
+			return Position > static_cast<int64>(Size) * 8;
+		}
+
+	private:
+		const uint8* Data;
+		int32 Size;
+		int32 Position = 0;
+	};
+
+	bool IsVP8KeyFrame(const uint8* Frame, int32 Size)
+	{
+		return Size > 0 && (Frame[0] & 1) == 0;
+	}
+
+	bool IsVP9KeyFrame(const uint8* Frame, int32 Size)
+	{
+		FBitReader Reader(Frame, Size);
+		if (Reader.ReadBits(2) != 2) // frame_marker
+		{
+			return false;
+		}
+
+		const uint32 ProfileLowBit = Reader.ReadBits(1);
+		const uint32 Profile = (Reader.ReadBits(1) << 1) | ProfileLowBit;
+		if (Profile == 3)
+		{
+			Reader.ReadBits(1); // reserved_zero
+		}
+
+		if (Reader.ReadBits(1)) // show_existing_frame
+		{
+			return false;
+		}
+
+		return Reader.ReadBits(1) == 0; // frame_type
+	}
+
+	void SkipScalingList(FBitReader& Reader, int32 Size)
+	{
+		int32 LastScale = 8;
+		int32 NextScale = 8;
+		for (int32 i = 0; i < Size; ++i)
+		{
+			if (NextScale != 0)
+			{
+				NextScale = (LastScale + Reader.ReadSE() + 256) % 256;
+			}
+			LastScale = NextScale == 0 ? LastScale : NextScale;
+		}
+	}
+
+	/** Resolution of an H264 SPS, the NAL header excluded. The outputs are only set for a complete SPS with a valid size */
+	bool ParseSpsResolution(const uint8* Sps, int32 Size, int32& OutWidth, int32& OutHeight)
+	{
+		if (Size <= 0)
+		{
+			return false;
+		}
+
+		// Remove the emulation prevention bytes
+		TArray<uint8> Rbsp;
+		Rbsp.Reserve(Size);
+		for (int32 i = 0; i < Size; ++i)
+		{
+			if (i >= 2 && Sps[i] == 3 && Sps[i - 1] == 0 && Sps[i - 2] == 0)
+			{
+				continue;
+			}
+			Rbsp.Add(Sps[i]);
+		}
+
+		FBitReader Reader(Rbsp.GetData(), Rbsp.Num());
+
+		const uint32 ProfileIdc = Reader.ReadBits(8);
+		Reader.ReadBits(16); // constraint flags and level_idc
+		Reader.ReadUE(); // seq_parameter_set_id
+
+		uint32 ChromaFormatIdc = 1;
+		bool bSeparateColourPlane = false;
+		if (ProfileIdc == 100 || ProfileIdc == 110 || ProfileIdc == 122 || ProfileIdc == 244 || ProfileIdc == 44 || ProfileIdc == 83
+			|| ProfileIdc == 86 || ProfileIdc == 118 || ProfileIdc == 128 || ProfileIdc == 138 || ProfileIdc == 139 || ProfileIdc == 134 || ProfileIdc == 135)
+		{
+			ChromaFormatIdc = Reader.ReadUE();
+			if (ChromaFormatIdc == 3)
+			{
+				bSeparateColourPlane = Reader.ReadBits(1) != 0;
+			}
+			Reader.ReadUE(); // bit_depth_luma_minus8
+			Reader.ReadUE(); // bit_depth_chroma_minus8
+			Reader.ReadBits(1); // qpprime_y_zero_transform_bypass_flag
+			if (Reader.ReadBits(1)) // seq_scaling_matrix_present_flag
+			{
+				for (int32 i = 0; i < (ChromaFormatIdc != 3 ? 8 : 12); ++i)
+				{
+					if (Reader.ReadBits(1))
+					{
+						SkipScalingList(Reader, i < 6 ? 16 : 64);
+					}
+				}
+			}
+		}
+
+		Reader.ReadUE(); // log2_max_frame_num_minus4
+		const uint32 PicOrderCntType = Reader.ReadUE();
+		if (PicOrderCntType == 0)
+		{
+			Reader.ReadUE(); // log2_max_pic_order_cnt_lsb_minus4
+		}
+		else if (PicOrderCntType == 1)
+		{
+			Reader.ReadBits(1); // delta_pic_order_always_zero_flag
+			Reader.ReadSE(); // offset_for_non_ref_pic
+			Reader.ReadSE(); // offset_for_top_to_bottom_field
+			const uint32 NumRefFramesInCycle = Reader.ReadUE();
+			for (uint32 i = 0; i < NumRefFramesInCycle && i < 256; ++i)
+			{
+				Reader.ReadSE();
+			}
+		}
+
+		Reader.ReadUE(); // max_num_ref_frames
+		Reader.ReadBits(1); // gaps_in_frame_num_value_allowed_flag
+		const int64 WidthInMbs = static_cast<int64>(Reader.ReadUE()) + 1;
+		const int64 HeightInMapUnits = static_cast<int64>(Reader.ReadUE()) + 1;
+		const uint32 FrameMbsOnly = Reader.ReadBits(1);
+		if (!FrameMbsOnly)
+		{
+			Reader.ReadBits(1); // mb_adaptive_frame_field_flag
+		}
+		Reader.ReadBits(1); // direct_8x8_inference_flag
+
+		uint32 CropLeft = 0, CropRight = 0, CropTop = 0, CropBottom = 0;
+		if (Reader.ReadBits(1)) // frame_cropping_flag
+		{
+			CropLeft = Reader.ReadUE();
+			CropRight = Reader.ReadUE();
+			CropTop = Reader.ReadUE();
+			CropBottom = Reader.ReadUE();
+		}
+
+		// Truncated, the fields read past the end are all zeros
+		if (Reader.IsOverrun())
+		{
+			return false;
+		}
+
+		// Crop units depend on the chroma subsampling
+		const bool bHasChroma = ChromaFormatIdc != 0 && !bSeparateColourPlane;
+		const int64 CropUnitX = bHasChroma && ChromaFormatIdc != 3 ? 2 : 1;
+		const int64 CropUnitY = (bHasChroma && ChromaFormatIdc == 1 ? 2 : 1) * (2 - FrameMbsOnly);
+
+		// 64 bits so malformed sizes and crops can't wrap around into a plausible resolution
+		const int64 Width = WidthInMbs * 16 - (static_cast<int64>(CropLeft) + CropRight) * CropUnitX;
+		const int64 Height = (2 - FrameMbsOnly) * HeightInMapUnits * 16 - (static_cast<int64>(CropTop) + CropBottom) * CropUnitY;
+
+		// H264 levels stop well below 16384 pixels on a side
+		constexpr int64 MaxSize = 16384;
+		if (Width <= 0 || Height <= 0 || Width > MaxSize || Height > MaxSize)
+		{
+			return false;
+		}
+
+		OutWidth = static_cast<int32>(Width);
+		OutHeight = static_cast<int32>(Height);
+		return true;
+	}
+}
+
+TSharedPtr<const FEncodedVideoFile, ESPMode::ThreadSafe> FEncodedVideoFile::Load(const FString& Path, int32 DefaultFramerate)
+{
+	TSharedPtr<FEncodedVideoFile, ESPMode::ThreadSafe> File = MakeShared<FEncodedVideoFile, ESPMode::ThreadSafe>();
+
+	if (!FFileHelper::LoadFileToArray(File->Data, *Path))
+	{
+		UE_LOG(LogMillicastPublisher, Warning, TEXT("Could not read encoded video file %s"), *Path);
+		return nullptr;
+	}
+
+	const bool bIvf = File->Data.Num() >= 4 && FMemory::Memcmp(File->Data.GetData(), "DKIF", 4) == 0;
+	const bool bParsed = bIvf ? File->ParseIvf() : File->ParseAnnexB(FMath::Max(DefaultFramerate, 1));
+	if (!bParsed)
+	{
+		UE_LOG(LogMillicastPublisher, Warning, TEXT("Could not parse encoded video file %s, only IVF (VP8, VP9) and Annex B (H264) are supported"), *Path);
+		return nullptr;
+	}
+
+	UE_LOG(LogMillicastPublisher, Log, TEXT("Loaded encoded video file %s: %dx%d, %d frames, %d key frames, %.1f seconds"),
+		*Path, File->Width, File->Height, File->Frames.Num(), File->KeyFrames.Num(), File->DurationUs / 1000000.0);
+
+	return File;
+}
+
+bool FEncodedVideoFile::ParseIvf()
+{
+	constexpr int32 FileHeaderSize = 32;
+	constexpr int32 FrameHeaderSize = 12;
+
+	if (Data.Num() < FileHeaderSize)
+	{
+		return false;
+	}
+
+	const uint8* Header = Data.GetData();
+	if (FMemory::Memcmp(Header + 8, "VP80", 4) == 0)
+	{
+		CodecType = webrtc::kVideoCodecVP8;
+	}
+	else if (FMemory::Memcmp(Header + 8, "VP90", 4) == 0)
+	{
+		CodecType = webrtc::kVideoCodecVP9;
+	}
+	else
+	{
+		return false;
+	}
+
+	Width = ReadLE16(Header + 12);
+	Height = ReadLE16(Header + 14);
+
+	uint64 TimebaseDenominator = ReadLE32(Header + 16);
+	uint64 TimebaseNumerator = ReadLE32(Header + 20);
+	if (TimebaseDenominator == 0 || TimebaseNumerator == 0)
+	{
+		TimebaseDenominator = 30;
+		TimebaseNumerator = 1;
+	}
+
+	int64 Offset = FMath::Max<int32>(ReadLE16(Header + 6), FileHeaderSize);
+	while (Offset + FrameHeaderSize <= Data.Num())
+	{
+		const uint32 FrameSize = ReadLE32(Data.GetData() + Offset);
+		const uint64 Pts = ReadLE64(Data.GetData() + Offset + 4);
+		Offset += FrameHeaderSize;
+
+		// Truncated file, keep what we have
+		if (FrameSize == 0 || FrameSize > Data.Num() - Offset)
+		{
+			break;
+		}
+
+		const uint8* Frame = Data.GetData() + Offset;
+		const bool bKeyFrame = CodecType == webrtc::kVideoCodecVP8 ? IsVP8KeyFrame(Frame, FrameSize) : IsVP9KeyFrame(Frame, FrameSize);
+		const int64 TimestampUs = static_cast<int64>(Pts * TimebaseNumerator * 1000000 / TimebaseDenominator);
+
+		Frames.Add({ Offset, static_cast<int32>(FrameSize), TimestampUs, bKeyFrame });
+		Offset += FrameSize;
+	}
+
+	if (Frames.Num() < 2)
+	{
+		return Finalize(1000000 / 30);
+	}
+
+	// The last frame is displayed for as long as the average frame
+	return Finalize((Frames.Last().TimestampUs - Frames[0].TimestampUs) / (Frames.Num() - 1));
+}
+
+bool FEncodedVideoFile::ParseAnnexB(int32 DefaultFramerate)
+{
+	CodecType = webrtc::kVideoCodecH264;
+
+	FH264NalIndexer NalIndexer;
+	const FH264NalIndexer::FNalUnits& NalUnits = NalIndexer.Index(Data.GetData(), Data.Num());
+
+	const int64 FrameDurationUs = 1000000 / DefaultFramerate;
+
+	// Group the NAL units in access units, one per frame
+	int64 AccessUnitStart = -1;
+	bool bAccessUnitHasSlice = false;
+	bool bAccessUnitIsIdr = false;
+
+	auto CloseAccessUnit = [&](int64 End) {
+		if (AccessUnitStart >= 0 && bAccessUnitHasSlice)
+		{
+			Frames.Add({ AccessUnitStart, static_cast<int32>(End - AccessUnitStart), Frames.Num() * FrameDurationUs, bAccessUnitIsIdr });
+		}
+		AccessUnitStart = -1;
+		bAccessUnitHasSlice = false;
+		bAccessUnitIsIdr = false;
+	};
+
+	for (const FH264NalUnit& NalUnit : NalUnits)
+	{
+		const uint8 Type = NalUnit.GetType(Data.GetData());
+		const int64 UnitStart = NalUnit.Offset - NalUnit.StartCodeLength;
+		const bool bSlice = Type == 1 || Type == 5;
+
+		// An access unit ends at the first AUD, SPS, PPS, SEI or first slice of a new picture following a slice
+		if (bAccessUnitHasSlice)
+		{
+			const bool bFirstSliceOfPicture = bSlice && NalUnit.Size > 1 && (Data[NalUnit.Offset + 1] & 0x80) != 0; // first_mb_in_slice == 0
+			if (bFirstSliceOfPicture || Type == 6 || Type == 7 || Type == 8 || Type == 9 || (Type >= 14 && Type <= 18))
+			{
+				CloseAccessUnit(UnitStart);
+			}
+		}
+
+		if (AccessUnitStart < 0)
+		{
+			AccessUnitStart = UnitStart;
+		}
+
+		bAccessUnitHasSlice |= bSlice;
+		bAccessUnitIsIdr |= Type == 5;
+
+		if (Type == 7 && Width == 0)
+		{
+			ParseSpsResolution(Data.GetData() + NalUnit.Offset + 1, NalUnit.Size - 1, Width, Height);
+		}
+	}
+	CloseAccessUnit(Data.Num());
+
+	return Width > 0 && Height > 0 && Finalize(FrameDurationUs);
+}
+
+bool FEncodedVideoFile::Finalize(int64 FrameDurationUs)
+{
+	const int32 FirstKeyFrame = Frames.IndexOfByPredicate([](const FFrame& Frame) { return Frame.bKeyFrame; });
+	if (FirstKeyFrame == INDEX_NONE)
+	{
+		return false;
+	}
+
+	Frames.RemoveAt(0, FirstKeyFrame);
+
+	const int64 FirstTimestampUs = Frames[0].TimestampUs;
+	int64 PreviousTimestampUs = 0;
+	for (int32 i = 0; i < Frames.Num(); ++i)
+	{
+		// Timestamps must increase for the pacing
+		Frames[i].TimestampUs = FMath::Max(Frames[i].TimestampUs - FirstTimestampUs, PreviousTimestampUs);
+		PreviousTimestampUs = Frames[i].TimestampUs;
+
+		if (Frames[i].bKeyFrame)
+		{
+			KeyFrames.Add(i);
+		}
+	}
+
+	DurationUs = Frames.Last().TimestampUs + FMath::Max<int64>(FrameDurationUs, 1000);
+
+	return true;
+}
+
+int32 FEncodedVideoFile::FindNearestKeyFrame(int32 FrameIndex) const
+{
+	FrameIndex = FMath::Clamp(FrameIndex, 0, Frames.Num() - 1);
+
+	const int32 Next = Algo::LowerBound(KeyFrames, FrameIndex);
+
+	// The first frame is a key frame, so the one after the last frame is one too
+	const int32 NextKeyFrame = Next < KeyFrames.Num() ? KeyFrames[Next] : Frames.Num();
+	const int32 PreviousKeyFrame = Next > 0 ? KeyFrames[Next - 1] : 0;
+
+	// Replaying a few frames is better than skipping as many
+	if (NextKeyFrame - FrameIndex < FrameIndex - PreviousKeyFrame)
+	{
+		return NextKeyFrame % Frames.Num();
+	}
+
+	return PreviousKeyFrame;
+}
+
+/** Encoded image backed by a frame of the file, which stays loaded while the image is referenced */
+class FEncodedFileImageBuffer : public webrtc::EncodedImageBufferInterface
+{
+public:
+	FEncodedFileImageBuffer(TSharedPtr<const FEncodedVideoFile, ESPMode::ThreadSafe> InFile, int32 InFrameIndex)
+		: File(MoveTemp(InFile))
+		, FrameIndex(InFrameIndex)
+	{}
+
+	const uint8_t* data() const override { return File->GetFrameData(FrameIndex); }
+	uint8_t* data() override { return const_cast<uint8_t*>(File->GetFrameData(FrameIndex)); }
+	size_t size() const override { return File->GetFrame(FrameIndex).Size; }
+
+private:
+	TSharedPtr<const FEncodedVideoFile, ESPMode::ThreadSafe> File;
+	int32 FrameIndex;
+};
+
+rtc::scoped_refptr<FEncodedFrameBuffer> FEncodedVideoFilePlayback::Advance(int64& OutFrameDurationUs)
+{
+	const int32 NumFrames = File->GetNumFrames();
+
+	if (bKeyFrameRequested.Exchange(false))
+	{
+		NextFrame = File->FindNearestKeyFrame(NextFrame);
+	}
+
+	const int32 Frame = NextFrame;
+	NextFrame = (NextFrame + 1) % NumFrames;
+
+	const int64 NextTimestampUs = NextFrame == 0 ? File->GetDurationUs() : File->GetFrame(NextFrame).TimestampUs;
+	OutFrameDurationUs = NextTimestampUs - File->GetFrame(Frame).TimestampUs;
+
+	return rtc::make_ref_counted<FEncodedFrameBuffer>(AsShared(), rtc::make_ref_counted<FEncodedFileImageBuffer>(File, Frame),
+		File->GetCodecType(), File->GetWidth(), File->GetHeight(), File->GetFrame(Frame).bKeyFrame, Sequence++);
+}
+
+}
@@ -0,0 +1,90 @@
+// Copyright Dolby.io 2023. All Rights Reserved.
+
+#pragma once
+
+#include "WebRTCInc.h"
+#include "EncodedFrameBuffer.h"
+
+namespace Millicast::Publisher
+{
+	/*
+	 * A pre-encoded video loaded in memory and split into frames: IVF for VP8 and VP9, Annex B for H264.
+	 * Immutable once loaded so it can be shared by any number of sources replaying it.
+	 */
+	class FEncodedVideoFile
+	{
+	public:
+		struct FFrame
+		{
+			int64 Offset;
+			int32 Size;
+			int64 TimestampUs; // Relative to the first frame
+			bool bKeyFrame;
+		};
+
+		/**
+		 * Load and index the whole file, returns null if it can't be read or has no key frame.
+		 * Annex B files have no timing information, their frames are spaced by 1/DefaultFramerate.
+		 */
+		static TSharedPtr<const FEncodedVideoFile, ESPMode::ThreadSafe> Load(const FString& Path, int32 DefaultFramerate = 30);
+
+		webrtc::VideoCodecType GetCodecType() const { return CodecType; }
+		int32 GetWidth() const { return Width; }
+		int32 GetHeight() const { return Height; }
+
+		int32 GetNumFrames() const { return Frames.Num(); }
+		const FFrame& GetFrame(int32 Index) const { return Frames[Index]; }
+		const uint8* GetFrameData(int32 Index) const { return Data.GetData() + Frames[Index].Offset; }
+
+		/** Duration of the whole file, including the display time of the last frame */
+		int64 GetDurationUs() const { return DurationUs; }
+
+		/** The key frame closest to the frame, before or after it. An index out of the file is clamped to it */
+		int32 FindNearestKeyFrame(int32 FrameIndex) const;
+
+	private:
+		bool ParseIvf();
+		bool ParseAnnexB(int32 DefaultFramerate);
+
+		/** Frames before the first key frame can't be decoded, drop them and compute the duration */
+		bool Finalize(int64 FrameDurationUs);
+
+		TArray<uint8> Data;
+		TArray<FFrame> Frames;
+		TArray<int32> KeyFrames;
+
+		webrtc::VideoCodecType CodecType = webrtc::kVideoCodecGeneric;
+		int32 Width = 0;
+		int32 Height = 0;
+		int64 DurationUs = 0;
+	};
+
+	/*
+	 * Play position of a source in an encoded file.
+	 * Shared with the passthrough encoder, which can't encode a key frame and asks the source to seek to one instead.
+	 */
+	class FEncodedVideoFilePlayback : public IEncodedFrameSource, public TSharedFromThis<FEncodedVideoFilePlayback, ESPMode::ThreadSafe>
+	{
+	public:
+		explicit FEncodedVideoFilePlayback(TSharedPtr<const FEncodedVideoFile, ESPMode::ThreadSafe> InFile) : File(MoveTemp(InFile)) {}
+
+		const FEncodedVideoFile& GetFile() const { return *File; }
+
+		/**
+		 * Returns the next frame to send and how long to wait after it, loops at the end of the file.
+		 * The frame references the data of the file, nothing is copied.
+		 */
+		rtc::scoped_refptr<FEncodedFrameBuffer> Advance(int64& OutFrameDurationUs);
+
+		/** Called by the encoder, the next frame returned by Advance is the key frame nearest to the current position */
+		void RequestKeyFrame() override { bKeyFrameRequested = true; }
+
+	private:
+		TSharedPtr<const FEncodedVideoFile, ESPMode::ThreadSafe> File;
+		TAtomic<bool> bKeyFrameRequested { false };
+
+		// Source thread only
+		int32 NextFrame = 0;
+		uint32 Sequence = 0;
+	};
+}
@@ -0,0 +1,258 @@
+// Copyright Dolby.io 2023. All Rights Reserved.
+
+#include "EncodedVideoRecorder.h"
+
+#include "MillicastPublisherPrivate.h"
+#include "SdpEditor.h"
+#include "Stats.h"
+#include "Util.h"
+
+#include "HAL/Event.h"
+#include "HAL/RunnableThread.h"
+#include "Misc/Paths.h"
+
+namespace Millicast::Publisher
+{
+
+// Frames waiting for the disk above this size are dropped, a few seconds of a high bitrate stream
+constexpr int64 MaxQueuedBytes = 64 * 1024 * 1024;
+
+// Not standard, it never leaves the answer the encoders are created from
+const std::string RecordingIdParameter = "x-millicast-recording";
+
+void SetRecordingId(FSdpEditor& Sdp, const FString& RecordingId)
+{
+	static const TArray<std::pair<std::string, std::string>> RecordedCodecs = {
+		{ "video", "VP8" }, { "video", "VP9" }, { "video", "H264" }, { "video", "AV1" }, { "video", "AV1X" },
+		{ "audio", "opus" }, { "audio", "multiopus" }
+	};
+
+	const std::string Value = to_string(RecordingId);
+	for (const auto& RecordedCodec : RecordedCodecs)
+	{
+		for (const FSdpEditor::FCodec& Codec : Sdp.FindCodecs(RecordedCodec.first, RecordedCodec.second))
+		{
+			Sdp.SetParameter(Codec, RecordingIdParameter, Value);
+		}
+	}
+}
+
+FString GetRecordingId(const std::map<std::string, std::string>& Parameters)
+{
+	const auto RecordingId = Parameters.find(RecordingIdParameter);
+	return RecordingId != Parameters.end() ? ToString(RecordingId->second) : FString();
+}
+
+FEncodedVideoRecorder::FEncodedVideoRecorder(const FString& InPath, int32 InStreamIndex)
+	: Path(InPath)
+	, StreamIndex(InStreamIndex)
+{
+	FramesAvailable = FPlatformProcess::GetSynchEventFromPool();
+	Thread.Reset(FRunnableThread::Create(this, TEXT("MillicastRecorder"), 0, TPri_BelowNormal));
+}
+
+FEncodedVideoRecorder::~FEncodedVideoRecorder()
+{
+	Finish();
+	FPlatformProcess::ReturnSynchEventToPool(FramesAvailable);
+}
+
+void FEncodedVideoRecorder::Finish()
+{
+	if (Thread)
+	{
+		Stop();
+		Thread->WaitForCompletion();
+		Thread.Reset();
+	}
+}
+
+bool FEncodedVideoRecorder::ConsumeKeyFrameRequest()
+{
+	return bWaitingForKeyFrame && !bKeyFrameRequested.Exchange(true);
+}
+
+void FEncodedVideoRecorder::OnEncodedImage(webrtc::VideoCodecType CodecType, const webrtc::EncodedImage& Image)
+{
+	if (bStopping)
+	{
+		return;
+	}
+
+	const bool bKeyFrame = Image._frameType == webrtc::VideoFrameType::kVideoFrameKey;
+
+	// A delta frame can't be decoded without the frames that were dropped before it
+	if (bWaitingForKeyFrame && !bKeyFrame)
+	{
+		return;
+	}
+
+	if (QueuedBytes + static_cast<int64>(Image.size()) > MaxQueuedBytes)
+	{
+		if (!bWaitingForKeyFrame)
+		{
+			UE_LOG(LogMillicastPublisher, Warning, TEXT("Recording can't keep up, dropping frames until the next key frame"));
+		}
+
+		bWaitingForKeyFrame = true;
+		bKeyFrameRequested = false;
+		++DroppedFrames;
+		return;
+	}
+
+	bWaitingForKeyFrame = false;
+
+	// Copied once, encoders like libvpx reuse their output buffer for the next frame
+	auto Frame = MakeUnique<FRecordedFrame>();
+	Frame->CodecType = CodecType;
+	Frame->Data.Append(Image.data(), Image.size());
+	Frame->RtpTimestamp = Image.Timestamp();
+	Frame->Width = Image._encodedWidth;
+	Frame->Height = Image._encodedHeight;
+	Frame->bKeyFrame = bKeyFrame;
+
+	QueuedBytes += Frame->Data.Num();
+	Frames.Enqueue(MoveTemp(Frame));
+	FramesAvailable->Trigger();
+}
+
+void FEncodedVideoRecorder::OnEncodedAudio(const TSharedPtr<const FOpusStreamInfo, ESPMode::ThreadSafe>& StreamInfo, uint32 RtpTimestamp, uint32 Duration, const uint8* Data, size_t Size)
+{
+	// Audio can be dropped anywhere, nothing depends on a lost packet
+	if (bStopping || Size == 0 || QueuedBytes + static_cast<int64>(Size) > MaxQueuedBytes)
+	{
+		return;
+	}
+
+	auto Packet = MakeUnique<FRecordedAudioPacket>();
+	Packet->StreamInfo = StreamInfo;
+	Packet->Data.Append(Data, Size);
+	Packet->RtpTimestamp = RtpTimestamp;
+	Packet->Duration = Duration;
+
+	QueuedBytes += Packet->Data.Num();
+	AudioPackets.Enqueue(MoveTemp(Packet));
+	FramesAvailable->Trigger();
+}
+
+void FEncodedVideoRecorder::DrainQueues()
+{
+	TUniquePtr<FRecordedFrame> Frame;
+	while (Frames.Dequeue(Frame))
+	{
+		QueuedBytes -= Frame->Data.Num();
+		WriteFrame(*Frame);
+	}
+
+	TUniquePtr<FRecordedAudioPacket> Packet;
+	while (AudioPackets.Dequeue(Packet))
+	{
+		QueuedBytes -= Packet->Data.Num();
+		WriteAudioPacket(*Packet);
+	}
+}
+
+uint32 FEncodedVideoRecorder::Run()
+{
+	for (;;)
+	{
+		DrainQueues();
+
+		FPublisherStats::Get().SetRecordingStats(QueuedBytes, DroppedFrames);
+
+		if (bStopping)
+		{
+			break;
+		}
+
+		FramesAvailable->Wait(100);
+	}
+
+	// Frames queued while stopping
+	DrainQueues();
+
+	if (AudioWriter)
+	{
+		AudioWriter->Close();
+		AudioWriter.Reset();
+	}
+
+	if (Writer)
+	{
+		Writer->Close();
+		Writer.Reset();
+		UE_LOG(LogMillicastPublisher, Log, TEXT("Recording closed, %d frames dropped"), DroppedFrames.Load());
+	}
+
+	return 0;
+}
+
+void FEncodedVideoRecorder::Stop()
+{
+	bStopping = true;
+	FramesAvailable->Trigger();
+}
+
+void FEncodedVideoRecorder::WriteFrame(const FRecordedFrame& Frame)
+{
+	if (!Writer)
+	{
+		if (RecordedCodecType != webrtc::kVideoCodecGeneric)
+		{
+			return; // The file could not be created
+		}
+
+		RecordedCodecType = Frame.CodecType;
+		Writer = IVideoContainerWriter::Create(Frame.CodecType);
+		if (!Writer)
+		{
+			UE_LOG(LogMillicastPublisher, Error, TEXT("Recording is not supported for this codec"));
+			return;
+		}
+
+		const FString FilePath = FPaths::SetExtension(Path, IVideoContainerWriter::GetExtension(Frame.CodecType));
+		if (!Writer->Open(FilePath))
+		{
+			Writer.Reset();
+			return;
+		}
+
+		UE_LOG(LogMillicastPublisher, Log, TEXT("Recording to %s"), *FilePath);
+	}
+
+	// The codec changed with a new negotiation, the recording can't continue in the same container
+	if (Frame.CodecType != RecordedCodecType)
+	{
+		return;
+	}
+
+	Writer->WriteFrame(Frame);
+}
+
+void FEncodedVideoRecorder::WriteAudioPacket(const FRecordedAudioPacket& Packet)
+{
+	// The audio starts with the video, at its first key frame
+	if (!Writer || bAudioFailed)
+	{
+		return;
+	}
+
+	if (!AudioWriter)
+	{
+		AudioWriter = MakeUnique<FOggOpusWriter>();
+
+		const FString FilePath = FPaths::SetExtension(Path, TEXT("opus"));
+		if (!AudioWriter->Open(FilePath))
+		{
+			AudioWriter.Reset();
+			bAudioFailed = true;
+			return;
+		}
+
+		UE_LOG(LogMillicastPublisher, Log, TEXT("Recording audio to %s"), *FilePath);
+	}
+
+	AudioWriter->WritePacket(Packet);
+}
+
+}
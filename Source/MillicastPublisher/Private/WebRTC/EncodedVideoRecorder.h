@@ -0,0 +1,84 @@
+// Copyright Dolby.io 2023. All Rights Reserved.
+
+#pragma once
+
+#include "WebRTCInc.h"
+#include "VideoContainerWriter.h"
+
+#include "Containers/Queue.h"
+#include "HAL/Runnable.h"
+
+class FRunnableThread;
+class FEvent;
+
+namespace Millicast::Publisher
+{
+	class FSdpEditor;
+
+	/**
+	 * Names the recording of a publisher in the codecs of the answer its encoders are created from, so that they find
+	 * their recorder and the encoders of other publishers don't.
+	 */
+	void SetRecordingId(FSdpEditor& Sdp, const FString& RecordingId);
+
+	/** Recording the encoder of a negotiated format goes to, empty if the answer named none */
+	FString GetRecordingId(const std::map<std::string, std::string>& Parameters);
+
+	/*
+	 * Records the encoded frames of one stream into a file, exactly as they are published.
+	 * Frames are handed over by the encoder callback and written on a dedicated thread.
+	 * When the disk can't keep up the frames are dropped until the next key frame, the encoder is never blocked.
+	 * The Opus packets go to an Ogg file next to the video, from the start of the video.
+	 */
+	class FEncodedVideoRecorder : public FRunnable
+	{
+	public:
+		/** The extension of Path is replaced by the one of the container of the codec */
+		FEncodedVideoRecorder(const FString& InPath, int32 InStreamIndex);
+		virtual ~FEncodedVideoRecorder() override;
+
+		/** Write the remaining frames and close the file. Blocks until it is done */
+		void Finish();
+
+		int32 GetStreamIndex() const { return StreamIndex; }
+
+		/** Returns true once each time the recorder needs a key frame to start or to resume after dropping frames */
+		bool ConsumeKeyFrameRequest();
+
+		/** Called by the encoder callback for every frame of the recorded stream */
+		void OnEncodedImage(webrtc::VideoCodecType CodecType, const webrtc::EncodedImage& Image);
+
+		/** Called by the audio encoder for every packet it sends */
+		void OnEncodedAudio(const TSharedPtr<const FOpusStreamInfo, ESPMode::ThreadSafe>& StreamInfo, uint32 RtpTimestamp, uint32 Duration, const uint8* Data, size_t Size);
+
+		// FRunnable
+		virtual uint32 Run() override;
+		virtual void Stop() override;
+		// ~FRunnable
+
+	private:
+		void WriteFrame(const FRecordedFrame& Frame);
+		void WriteAudioPacket(const FRecordedAudioPacket& Packet);
+		void DrainQueues();
+
+		FString Path;
+		int32 StreamIndex;
+
+		TQueue<TUniquePtr<FRecordedFrame>, EQueueMode::Mpsc> Frames;
+		TQueue<TUniquePtr<FRecordedAudioPacket>, EQueueMode::Mpsc> AudioPackets;
+		TAtomic<int64> QueuedBytes { 0 };
+		TAtomic<bool> bWaitingForKeyFrame { true };
+		TAtomic<bool> bKeyFrameRequested { false };
+		TAtomic<bool> bStopping { false };
+		TAtomic<int32> DroppedFrames { 0 };
+
+		FEvent* FramesAvailable = nullptr;
+		TUniquePtr<FRunnableThread> Thread;
+
+		// Writer thread only
+		TUniquePtr<IVideoContainerWriter> Writer;
+		webrtc::VideoCodecType RecordedCodecType = webrtc::kVideoCodecGeneric;
+		TUniquePtr<FOggOpusWriter> AudioWriter;
+		bool bAudioFailed = false;
+	};
+}
@@ -0,0 +1,92 @@
+// Copyright Dolby.io 2023. All Rights Reserved.
+
+#include "EncodedVideoSourceAdapter.h"
+
+#include "FrameBufferRHI.h"
+#include "Stats.h"
+
+#include "HAL/Event.h"
+#include "HAL/RunnableThread.h"
+
+namespace Millicast::Publisher
+{
+
+// Skip ahead rather than sending a burst of frames when the thread has been stalled for longer than this
+constexpr int64 MaxPlaybackLagUs = 1000000;
+
+FEncodedVideoSourceAdapter::FEncodedVideoSourceAdapter(TSharedPtr<const FEncodedVideoFile, ESPMode::ThreadSafe> InFile)
+	: Playback(MakeShared<FEncodedVideoFilePlayback, ESPMode::ThreadSafe>(MoveTemp(InFile)))
+{
+	StopEvent = FPlatformProcess::GetSynchEventFromPool();
+}
+
+FEncodedVideoSourceAdapter::~FEncodedVideoSourceAdapter()
+{
+	StopPlayback();
+	FPlatformProcess::ReturnSynchEventToPool(StopEvent);
+}
+
+void FEncodedVideoSourceAdapter::StartPlayback()
+{
+	if (!Thread)
+	{
+		bStopping = false;
+		Thread.Reset(FRunnableThread::Create(this, TEXT("MillicastEncodedVideoSource"), 0, TPri_AboveNormal));
+	}
+}
+
+void FEncodedVideoSourceAdapter::StopPlayback()
+{
+	if (Thread)
+	{
+		Stop();
+		Thread->WaitForCompletion();
+		Thread.Reset();
+	}
+}
+
+uint32 FEncodedVideoSourceAdapter::Run()
+{
+	const FEncodedVideoFile& File = Playback->GetFile();
+
+	int64 NextFrameUs = rtc::TimeMicros();
+
+	while (!bStopping)
+	{
+		const int64 NowUs = rtc::TimeMicros();
+		if (NowUs < NextFrameUs)
+		{
+			StopEvent->Wait(FMath::Max<uint32>((NextFrameUs - NowUs) / 1000, 1));
+			continue;
+		}
+
+		int64 FrameDurationUs = 0;
+
+		auto SimulcastBuffer = rtc::make_ref_counted<FSimulcastFrameBuffer>(File.GetWidth(), File.GetHeight());
+		SimulcastBuffer->SetEncodedFrame(Playback->Advance(FrameDurationUs));
+		SimulcastBuffer->SetFanOut(FanOut);
+		SimulcastBuffer->SetKeyFrameSettings(KeyFrameSettings);
+
+		webrtc::VideoFrame Frame = webrtc::VideoFrame::Builder()
+									   .set_video_frame_buffer(SimulcastBuffer)
+									   .set_timestamp_us(NowUs)
+									   .set_rotation(webrtc::VideoRotation::kVideoRotation_0)
+									   .build();
+
+		rtc::AdaptedVideoTrackSource::OnFrame(Frame);
+
+		FPublisherStats::Get().FrameRendered();
+
+		NextFrameUs = NowUs - NextFrameUs > MaxPlaybackLagUs ? NowUs + FrameDurationUs : NextFrameUs + FrameDurationUs;
+	}
+
+	return 0;
+}
+
+void FEncodedVideoSourceAdapter::Stop()
+{
+	bStopping = true;
+	StopEvent->Trigger();
+}
+
+}
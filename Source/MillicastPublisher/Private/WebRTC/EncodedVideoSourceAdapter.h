@@ -0,0 +1,62 @@
+// Copyright Dolby.io 2023. All Rights Reserved.
+
+#pragma once
+
+#include "WebRTCInc.h"
+#include "IMillicastSource.h"
+#include "EncodedVideoFile.h"
+
+#include "HAL/Runnable.h"
+
+class FRunnableThread;
+class FEvent;
+
+namespace Millicast::Publisher
+{
+	class FEncodedFrameFanOut;
+
+	/*
+	 * Video source replaying a pre-encoded file in a loop, at the pace of its timestamps.
+	 * The frames carry the encoded data to the passthrough encoder, nothing is captured, decoded or encoded.
+	 */
+	class FEncodedVideoSourceAdapter : public rtc::AdaptedVideoTrackSource, public FRunnable
+	{
+	public:
+		explicit FEncodedVideoSourceAdapter(TSharedPtr<const FEncodedVideoFile, ESPMode::ThreadSafe> InFile);
+		virtual ~FEncodedVideoSourceAdapter() override;
+
+		/** Frames are pushed from a dedicated thread between these calls, StopPlayback blocks until it has exited */
+		void StartPlayback();
+		void StopPlayback();
+
+		// rtc::AdaptedVideoTrackSource
+		webrtc::MediaSourceInterface::SourceState state() const override { return webrtc::MediaSourceInterface::kLive; }
+		absl::optional<bool> needs_denoising() const override { return false; }
+		bool is_screencast() const override { return ContentHint == EMillicastVideoContentHint::Detail; }
+		bool remote() const override { return false; }
+		// ~rtc::AdaptedVideoTrackSource
+
+		void SetContentHint(EMillicastVideoContentHint InContentHint) { ContentHint = InContentHint; }
+
+		/** Share the frames with other peer connections, set before the playback starts */
+		void SetFanOut(TSharedPtr<FEncodedFrameFanOut, ESPMode::ThreadSafe> InFanOut) { FanOut = MoveTemp(InFanOut); }
+
+		/** When the passthrough encoder waits for a key frame of the file, set before the playback starts */
+		void SetKeyFrameSettings(TSharedPtr<const FKeyFrameGovernorSettings, ESPMode::ThreadSafe> InSettings) { KeyFrameSettings = MoveTemp(InSettings); }
+
+		// FRunnable
+		virtual uint32 Run() override;
+		virtual void Stop() override;
+		// ~FRunnable
+
+	private:
+		TSharedPtr<FEncodedVideoFilePlayback, ESPMode::ThreadSafe> Playback;
+		EMillicastVideoContentHint ContentHint = EMillicastVideoContentHint::Motion;
+		TSharedPtr<FEncodedFrameFanOut, ESPMode::ThreadSafe> FanOut;
+		TSharedPtr<const FKeyFrameGovernorSettings, ESPMode::ThreadSafe> KeyFrameSettings;
+
+		TAtomic<bool> bStopping { false };
+		FEvent* StopEvent = nullptr;
+		TUniquePtr<FRunnableThread> Thread;
+	};
+}
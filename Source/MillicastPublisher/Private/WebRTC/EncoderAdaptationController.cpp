@@ -0,0 +1,177 @@
+// Copyright Dolby.io 2023. All Rights Reserved.
+
+#include "EncoderAdaptationController.h"
+
+#include "MillicastPublisherPrivate.h"
+#include "Stats.h"
+
+namespace Millicast::Publisher
+{
+
+// From no restriction to the most restricted level, the resolution goes first as it is usually what costs the most
+static const FAdaptationLevel AdaptationLevels[] = {
+	{ 1.0f, 0 },
+	{ 0.75f, 0 },
+	{ 0.75f, 30 },
+	{ 0.5f, 30 },
+	{ 0.5f, 15 },
+};
+
+// Same for detailed content, text gets unreadable when downscaled so the framerate goes first
+static const FAdaptationLevel MaintainResolutionLevels[] = {
+	{ 1.0f, 0 },
+	{ 1.0f, 30 },
+	{ 1.0f, 15 },
+	{ 1.0f, 10 },
+	{ 0.75f, 10 },
+};
+
+// Number of frames averaged before taking any decision
+constexpr int32 NumSamples = 30;
+
+// The encoder is overused when a frame takes more than this fraction of the frame budget to encode,
+// or when too many frames are waiting in the encoder.
+constexpr double OveruseThreshold = 0.9;
+constexpr int32 MaxQueueDepth = 3;
+
+// Going up a level is only done if the estimated encode time at that level is under this fraction of its budget.
+// The gap with the overuse threshold avoids switching back and forth between two levels.
+constexpr double UnderuseThreshold = 0.6;
+
+// Time the condition must hold before stepping down or up
+constexpr double OveruseHoldSeconds = 1.0;
+constexpr double UnderuseHoldSeconds = 5.0;
+
+void FEncoderAdaptationController::SetMaintainResolution(bool bInMaintainResolution)
+{
+	FScopeLock Lock(&CriticalSection);
+
+	if (bMaintainResolution != bInMaintainResolution)
+	{
+		bMaintainResolution = bInMaintainResolution;
+		SetLevelIndex(0, bMaintainResolution ? TEXT("maintaining resolution") : TEXT("maintaining framerate"), LastCaptureSeconds);
+	}
+}
+
+void FEncoderAdaptationController::OnFrameCaptured(double TimeSeconds)
+{
+	FScopeLock Lock(&CriticalSection);
+
+	if (LastCaptureSeconds != 0)
+	{
+		const double IntervalMs = (TimeSeconds - LastCaptureSeconds) * 1000.0;
+		CaptureSamples = FMath::Min(CaptureSamples + 1, NumSamples);
+		CaptureIntervalMs = CalcEMA(CaptureIntervalMs, CaptureSamples, IntervalMs);
+	}
+	LastCaptureSeconds = TimeSeconds;
+}
+
+void FEncoderAdaptationController::OnFrameEncoded(double InEncodeTimeMs, int32 QueueDepth, double TimeSeconds)
+{
+	FScopeLock Lock(&CriticalSection);
+
+	EncodeSamples = FMath::Min(EncodeSamples + 1, NumSamples);
+	EncodeTimeMs = CalcEMA(EncodeTimeMs, EncodeSamples, InEncodeTimeMs);
+
+	FPublisherStats::Get().SetAdaptationStats(EncodeTimeMs, QueueDepth);
+
+	if (EncodeSamples < NumSamples || CaptureSamples < NumSamples)
+	{
+		return;
+	}
+
+	const double Now = TimeSeconds;
+
+	const TArrayView<const FAdaptationLevel> Levels = GetLevels();
+
+	const bool bOveruse = LevelIndex < Levels.Num() - 1
+		&& (EncodeTimeMs > GetFrameBudgetMs(LevelIndex) * OveruseThreshold || QueueDepth > MaxQueueDepth);
+
+	bool bUnderuse = false;
+	if (!bOveruse && LevelIndex > 0 && QueueDepth <= 1)
+	{
+		// Estimate the encode time at the upper level from the pixel count ratio
+		const float ScaleRatio = Levels[LevelIndex - 1].ResolutionScale / Levels[LevelIndex].ResolutionScale;
+		const double EstimatedEncodeTimeMs = EncodeTimeMs * ScaleRatio * ScaleRatio;
+
+		bUnderuse = EstimatedEncodeTimeMs < GetFrameBudgetMs(LevelIndex - 1) * UnderuseThreshold;
+	}
+
+	if (bOveruse)
+	{
+		UnderuseStartSeconds = 0;
+		if (OveruseStartSeconds == 0)
+		{
+			OveruseStartSeconds = Now;
+		}
+		else if (Now - OveruseStartSeconds >= OveruseHoldSeconds)
+		{
+			SetLevelIndex(LevelIndex + 1, (QueueDepth > MaxQueueDepth) ? TEXT("encoder queue is growing") : TEXT("encode time is over budget"), Now);
+		}
+	}
+	else if (bUnderuse)
+	{
+		OveruseStartSeconds = 0;
+		if (UnderuseStartSeconds == 0)
+		{
+			UnderuseStartSeconds = Now;
+		}
+		else if (Now - UnderuseStartSeconds >= UnderuseHoldSeconds && Now - LastChangeSeconds >= UnderuseHoldSeconds)
+		{
+			SetLevelIndex(LevelIndex - 1, TEXT("encoder has room"), Now);
+		}
+	}
+	else
+	{
+		OveruseStartSeconds = 0;
+		UnderuseStartSeconds = 0;
+	}
+}
+
+FAdaptationLevel FEncoderAdaptationController::GetLevel() const
+{
+	FScopeLock Lock(&CriticalSection);
+	return GetLevels()[LevelIndex];
+}
+
+TArrayView<const FAdaptationLevel> FEncoderAdaptationController::GetLevels() const
+{
+	if (bMaintainResolution)
+	{
+		return MaintainResolutionLevels;
+	}
+
+	return AdaptationLevels;
+}
+
+double FEncoderAdaptationController::GetFrameBudgetMs(int32 InLevelIndex) const
+{
+	const int32 MaxFramerate = GetLevels()[InLevelIndex].MaxFramerate;
+	if (MaxFramerate > 0)
+	{
+		return FMath::Max(CaptureIntervalMs, 1000.0 / MaxFramerate);
+	}
+
+	return CaptureIntervalMs;
+}
+
+void FEncoderAdaptationController::SetLevelIndex(int32 NewLevelIndex, const TCHAR* Reason, double TimeSeconds)
+{
+	LevelIndex = FMath::Clamp(NewLevelIndex, 0, GetLevels().Num() - 1);
+
+	// Start measuring again at the new level
+	EncodeSamples = 0;
+	EncodeTimeMs = 0;
+	OveruseStartSeconds = 0;
+	UnderuseStartSeconds = 0;
+	LastChangeSeconds = TimeSeconds;
+
+	const FAdaptationLevel& Level = GetLevels()[LevelIndex];
+
+	UE_LOG(LogMillicastPublisher, Log, TEXT("Encoder adaptation level %d (%s): resolution scale %.2f, max framerate %d"),
+		LevelIndex, Reason, Level.ResolutionScale, Level.MaxFramerate);
+
+	FPublisherStats::Get().SetAdaptationLevel(LevelIndex, Level.ResolutionScale, Level.MaxFramerate);
+}
+
+}
@@ -0,0 +1,61 @@
+// Copyright Dolby.io 2023. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+namespace Millicast::Publisher
+{
+	/** Restriction applied to the capture for a given adaptation level */
+	struct FAdaptationLevel
+	{
+		float ResolutionScale; // Applied to the source resolution, 1 means full resolution
+		int32 MaxFramerate; // 0 means no restriction
+	};
+
+	/*
+	 * Steps the capture resolution and framerate down when the encoder can't keep up with the source,
+	 * and back up when it has room again. This is independent of webrtc's cpu adaptation which is disabled in the
+	 * peerconnection config because it is based on the capture to encode delay and does not work with hardware encoders.
+	 * One controller is owned by each video source adapter and shared with the encoders through the frame buffers.
+	 */
+	class FEncoderAdaptationController
+	{
+	public:
+		/** Reduce the framerate before the resolution, for content where details matter more than motion */
+		void SetMaintainResolution(bool bInMaintainResolution);
+
+		/** Called by the source for every frame it receives, before any framerate restriction, at TimeSeconds of FPlatformTime::Seconds */
+		void OnFrameCaptured(double TimeSeconds);
+
+		/**
+		 * Called by the encoder for every frame it outputs.
+		 * EncodeTimeMs is the time between the frame submission and the encoded output,
+		 * QueueDepth the number of frames submitted to the encoder but not output yet.
+		 */
+		void OnFrameEncoded(double EncodeTimeMs, int32 QueueDepth, double TimeSeconds);
+
+		FAdaptationLevel GetLevel() const;
+
+	private:
+		TArrayView<const FAdaptationLevel> GetLevels() const;
+		double GetFrameBudgetMs(int32 InLevelIndex) const;
+		void SetLevelIndex(int32 NewLevelIndex, const TCHAR* Reason, double TimeSeconds);
+
+		mutable FCriticalSection CriticalSection;
+
+		int32 LevelIndex = 0;
+		bool bMaintainResolution = false;
+
+		double LastCaptureSeconds = 0;
+		int32 CaptureSamples = 0;
+		double CaptureIntervalMs = 0;
+
+		int32 EncodeSamples = 0;
+		double EncodeTimeMs = 0;
+
+		double OveruseStartSeconds = 0;
+		double UnderuseStartSeconds = 0;
+		double LastChangeSeconds = 0;
+	};
+}
@@ -0,0 +1,149 @@
+// Copyright Dolby.io 2023. All Rights Reserved.
+
+#include "EncoderInputQueue.h"
+
+#include "MillicastPublisherPrivate.h"
+#include "Stats.h"
+
+namespace Millicast::Publisher
+{
+
+FEncoderInputQueue::FTicket::~FTicket()
+{
+	if (TSharedPtr<FEncoderInputQueue, ESPMode::ThreadSafe> PinnedQueue = Queue.Pin())
+	{
+		PinnedQueue->Remove(*this);
+	}
+}
+
+bool FEncoderInputQueue::FTicket::Dequeue()
+{
+	TSharedPtr<FEncoderInputQueue, ESPMode::ThreadSafe> PinnedQueue = Queue.Pin();
+	return !PinnedQueue || PinnedQueue->Dequeue(*this);
+}
+
+FEncoderInputQueue::FEncoderInputQueue(int32 InMaxDepth, EMillicastEncoderQueuePolicy InPolicy)
+	: MaxDepth(FMath::Max(InMaxDepth, 1))
+	, Policy(InPolicy)
+	, DequeuedEvent(FPlatformProcess::GetSynchEventFromPool(false))
+{
+}
+
+FEncoderInputQueue::~FEncoderInputQueue()
+{
+	FPlatformProcess::ReturnSynchEventToPool(DequeuedEvent);
+}
+
+FEncoderInputQueue::FTicketPtr FEncoderInputQueue::Enqueue()
+{
+	const uint64 StartCycles = FPlatformTime::Cycles64();
+
+	FScopeLock Lock(&CriticalSection);
+
+	if (Pending.Num() >= MaxDepth)
+	{
+		if (Policy == EMillicastEncoderQueuePolicy::DropOldest)
+		{
+			DropOldest();
+		}
+		else
+		{
+			while (Pending.Num() >= MaxDepth)
+			{
+				const double ElapsedMs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles);
+				if (ElapsedMs >= BlockTimeoutMs)
+				{
+					// The encoder is stuck, give the capture back rather than freezing the render thread
+					++Stats.DroppedFrames;
+					ReportStats();
+					return nullptr;
+				}
+
+				FScopeUnlock Unlock(&CriticalSection);
+				DequeuedEvent->Wait(BlockTimeoutMs - static_cast<uint32>(ElapsedMs));
+			}
+
+			BlockSamples = FMath::Min(BlockSamples + 1, 60);
+			Stats.BlockTimeMs = CalcEMA(Stats.BlockTimeMs, BlockSamples, FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles));
+		}
+	}
+
+	FTicketPtr Ticket = MakeShareable(new FTicket(AsShared()));
+	Pending.Add(Ticket.Get());
+
+	Stats.Depth = Pending.Num();
+	Stats.MaxDepth = FMath::Max(Stats.MaxDepth, Stats.Depth);
+
+	return Ticket;
+}
+
+FEncoderInputQueue::FStats FEncoderInputQueue::GetStats() const
+{
+	FScopeLock Lock(&CriticalSection);
+	return Stats;
+}
+
+bool FEncoderInputQueue::Dequeue(FTicket& Ticket)
+{
+	FScopeLock Lock(&CriticalSection);
+
+	if (Ticket.bDropped)
+	{
+		return false;
+	}
+
+	// A frame sent to several peer connections reaches several encoders, only the first one takes it out of the queue
+	if (!Ticket.bQueued)
+	{
+		return true;
+	}
+
+	Ticket.bQueued = false;
+	Pending.Remove(&Ticket);
+
+	WaitSamples = FMath::Min(WaitSamples + 1, 60);
+	Stats.WaitTimeMs = CalcEMA(Stats.WaitTimeMs, WaitSamples, FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - Ticket.EnqueueCycles));
+	Stats.Depth = Pending.Num();
+	ReportStats();
+
+	DequeuedEvent->Trigger();
+	return true;
+}
+
+void FEncoderInputQueue::Remove(FTicket& Ticket)
+{
+	FScopeLock Lock(&CriticalSection);
+
+	if (!Ticket.bQueued)
+	{
+		return;
+	}
+
+	// Released before reaching the encoder, the capture failed or webrtc dropped the frame
+	Ticket.bQueued = false;
+	Pending.Remove(&Ticket);
+
+	++Stats.DroppedFrames;
+	Stats.Depth = Pending.Num();
+	ReportStats();
+
+	DequeuedEvent->Trigger();
+}
+
+void FEncoderInputQueue::DropOldest()
+{
+	FTicket* Oldest = Pending[0];
+	Oldest->bQueued = false;
+	Oldest->bDropped = true;
+	Pending.RemoveAt(0);
+
+	++Stats.DroppedFrames;
+	UE_LOG(LogMillicastPublisher, Verbose, TEXT("Encoder input queue full, dropped the oldest frame"));
+}
+
+void FEncoderInputQueue::ReportStats() const
+{
+	FPublisherStats::Get().SetEncoderQueueStats(Stats.Depth, Stats.MaxDepth, Stats.WaitTimeMs, Stats.BlockTimeMs, Stats.DroppedFrames);
+}
+
+}
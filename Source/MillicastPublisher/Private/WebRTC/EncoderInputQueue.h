@@ -0,0 +1,84 @@
+// Copyright Dolby.io 2023. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "IMillicastSource.h"
+
+namespace Millicast::Publisher
+{
+	/*
+	 * Bounds the number of captured frames waiting for the encoder.
+	 * A frame enters the queue when it is captured and leaves it when it reaches the encoder, or when it is dropped on the way.
+	 * When the queue is full, the capture either drops the oldest frame waiting, so that the encoder always gets the latest one,
+	 * or waits for the encoder to take a frame, so that every frame is encoded.
+	 * One queue is owned by each video source adapter, its tickets travel with the frames to the encoders.
+	 */
+	class FEncoderInputQueue : public TSharedFromThis<FEncoderInputQueue, ESPMode::ThreadSafe>
+	{
+	public:
+		struct FStats
+		{
+			int32 Depth = 0; // Frames waiting for the encoder
+			int32 MaxDepth = 0;
+			double WaitTimeMs = 0; // Average time between the capture and the encoder
+			double BlockTimeMs = 0; // Average time the capture waited for room in the queue
+			int32 DroppedFrames = 0; // Frames captured that never reached the encoder
+		};
+
+		/** Place of a frame in the queue, held by its frame buffer so that it leaves the queue when the frame is released */
+		class FTicket
+		{
+		public:
+			~FTicket();
+
+			/** Called by the encoder, false if the frame was dropped from the queue while waiting and must not be encoded */
+			bool Dequeue();
+
+		private:
+			friend class FEncoderInputQueue;
+
+			FTicket(TWeakPtr<FEncoderInputQueue, ESPMode::ThreadSafe> InQueue) : Queue(MoveTemp(InQueue)), EnqueueCycles(FPlatformTime::Cycles64()) {}
+
+			TWeakPtr<FEncoderInputQueue, ESPMode::ThreadSafe> Queue;
+			uint64 EnqueueCycles;
+
+			// Guarded by the queue
+			bool bQueued = true;
+			bool bDropped = false;
+		};
+
+		using FTicketPtr = TSharedPtr<FTicket, ESPMode::ThreadSafe>;
+
+		/** Longest time a Block queue holds the capture, after which the new frame is dropped */
+		static constexpr uint32 BlockTimeoutMs = 100;
+
+		FEncoderInputQueue(int32 InMaxDepth, EMillicastEncoderQueuePolicy InPolicy);
+		~FEncoderInputQueue();
+
+		/** Called by the capture for every frame, makes room for it according to the policy. Null if the frame must be dropped. */
+		FTicketPtr Enqueue();
+
+		int32 GetMaxDepth() const { return MaxDepth; }
+		EMillicastEncoderQueuePolicy GetPolicy() const { return Policy; }
+
+		FStats GetStats() const;
+
+	private:
+		bool Dequeue(FTicket& Ticket);
+		void Remove(FTicket& Ticket);
+		void DropOldest();
+		void ReportStats() const;
+
+		const int32 MaxDepth;
+		const EMillicastEncoderQueuePolicy Policy;
+
+		mutable FCriticalSection CriticalSection;
+		TArray<FTicket*> Pending; // Oldest first
+		FEvent* DequeuedEvent;
+
+		int32 WaitSamples = 0;
+		int32 BlockSamples = 0;
+		FStats Stats;
+	};
+}
@@ -0,0 +1,51 @@
+// Copyright Dolby.io 2023. All Rights Reserved.
+
+#include "FailoverController.h"
+
+namespace Millicast::Publisher
+{
+
+FFailoverController::EAction FFailoverController::OnPrimaryIceStateChanged(webrtc::PeerConnectionInterface::IceConnectionState State, double TimeMs)
+{
+	switch (State)
+	{
+	case webrtc::PeerConnectionInterface::kIceConnectionDisconnected:
+	case webrtc::PeerConnectionInterface::kIceConnectionFailed:
+		// ICE does not recover from failed without a restart
+		bPrimaryFailed |= State == webrtc::PeerConnectionInterface::kIceConnectionFailed;
+		ReconnectedTimeMs.Reset();
+
+		if (!bOnBackup && bBackupReady)
+		{
+			bOnBackup = true;
+			return EAction::FailOver;
+		}
+		return EAction::None;
+
+	case webrtc::PeerConnectionInterface::kIceConnectionConnected:
+	case webrtc::PeerConnectionInterface::kIceConnectionCompleted:
+		// Wait for the primary to stay up before switching again, a flapping connection would switch back and forth
+		if (bOnBackup && !bPrimaryFailed && !ReconnectedTimeMs.IsSet())
+		{
+			ReconnectedTimeMs = TimeMs;
+		}
+		return EAction::None;
+
+	default:
+		return EAction::None;
+	}
+}
+
+FFailoverController::EAction FFailoverController::Update(double TimeMs)
+{
+	if (!bOnBackup || bPrimaryFailed || !ReconnectedTimeMs.IsSet() || TimeMs - ReconnectedTimeMs.GetValue() < FailbackDelayMs)
+	{
+		return EAction::None;
+	}
+
+	bOnBackup = false;
+	ReconnectedTimeMs.Reset();
+	return EAction::FailBack;
+}
+
+}
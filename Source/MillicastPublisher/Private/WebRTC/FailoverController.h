@@ -0,0 +1,49 @@
+// Copyright Dolby.io 2023. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "WebRTCInc.h"
+
+namespace Millicast::Publisher
+{
+	/*
+	 * Decides whether the primary or the backup connection of a publisher sends, from the ICE states of the primary.
+	 * A disconnected primary may come back: once it has been connected again for the fail back delay, it sends again.
+	 * A failed primary does not come back without a new connection, the backup keeps sending.
+	 * Only accessed from the game thread, the times are in milliseconds of the same clock.
+	 */
+	class FFailoverController
+	{
+	public:
+		enum class EAction : uint8
+		{
+			None,
+			FailOver,
+			FailBack
+		};
+
+		explicit FFailoverController(double InFailbackDelayMs) : FailbackDelayMs(InFailbackDelayMs) {}
+
+		/** The backup is connected in standby and can take over */
+		void SetBackupReady(bool bReady) { bBackupReady = bReady; }
+
+		EAction OnPrimaryIceStateChanged(webrtc::PeerConnectionInterface::IceConnectionState State, double TimeMs);
+
+		/** Called once the fail back delay has elapsed after the primary reconnected */
+		EAction Update(double TimeMs);
+
+		bool IsOnBackup() const { return bOnBackup; }
+		bool IsPrimaryFailed() const { return bPrimaryFailed; }
+		/** The primary is connected again while the backup sends, Update fails back after the delay */
+		bool IsWaitingToFailBack() const { return bOnBackup && ReconnectedTimeMs.IsSet(); }
+		double GetFailbackDelayMs() const { return FailbackDelayMs; }
+
+	private:
+		double FailbackDelayMs;
+		bool bBackupReady = false;
+		bool bOnBackup = false;
+		bool bPrimaryFailed = false;
+		TOptional<double> ReconnectedTimeMs;
+	};
+}
@@ -4,6 +4,11 @@
 
 #include "WebRTCInc.h"
 #include "MillicastTypes.h"
+#include "EncoderAdaptationController.h"
+#include "ImportanceMapFilter.h"
+#include "EncodedFrameBuffer.h"
+#include "EncoderInputQueue.h"
+#include "KeyFrameGovernor.h"
 #include "RHI.h"
 #include "RHIGPUReadback.h"
 #include "Util.h"
@@ -41,6 +46,9 @@ namespace libyuv
 #endif
 namespace Millicast::Publisher
 {
+	class FAVEncoderContext;
+	class FEncodedFrameFanOut;
+
 	class FFrameBufferRHI : public webrtc::VideoFrameBuffer
 	{
 	public:
@@ -113,11 +121,22 @@ namespace Millicast::Publisher
 						Buffer->StrideV(),
 						Buffer->width(),
 						Buffer->height());
+
+					if (ImportanceMap)
+					{
+						ApplyImportanceMap(*ImportanceMap, *Buffer);
+					}
 				}
 			}
 			return Buffer;
 		}
 
+		/** Regions of the frame to encode with fewer bits, applied when the frame is converted to I420 */
+		void SetImportanceMap(TSharedPtr<const FMillicastImportanceMap, ESPMode::ThreadSafe> InImportanceMap)
+		{
+			ImportanceMap = MoveTemp(InImportanceMap);
+		}
+
 		virtual const webrtc::I420BufferInterface* GetI420() const override
 		{
 			return nullptr;
@@ -141,11 +160,24 @@ namespace Millicast::Publisher
 			return VideoEncoderInput;
 		}
 
+		/** The context owning the texture of the frame, kept alive until the frame is released */
+		void SetEncoderContext(TSharedPtr<FAVEncoderContext, ESPMode::ThreadSafe> InEncoderContext)
+		{
+			EncoderContext = MoveTemp(InEncoderContext);
+		}
+
+		const TSharedPtr<FAVEncoderContext, ESPMode::ThreadSafe>& GetEncoderContext() const
+		{
+			return EncoderContext;
+		}
+
 	private:
 		FTexture2DRHIRef TextureRef;
 		FVideoEncoderInputFrameType Frame;
+		TSharedPtr<FAVEncoderContext, ESPMode::ThreadSafe> EncoderContext; // Destroyed after the frame and the input are released
 		TSharedPtr<AVEncoder::FVideoEncoderInput> VideoEncoderInput;
 		rtc::scoped_refptr<webrtc::I420Buffer> Buffer = nullptr;
+		TSharedPtr<const FMillicastImportanceMap, ESPMode::ThreadSafe> ImportanceMap;
 		TUniquePtr<FRHIGPUTextureReadback> Readback;
 		int PitchPixels = 0;
     
@@ -204,12 +236,75 @@ namespace Millicast::Publisher
 	class FSimulcastFrameBuffer : public webrtc::VideoFrameBuffer
 	{
 	public:
+		/** Width and height are the capture resolution, webrtc derives the simulcast layer resolutions from it */
+		FSimulcastFrameBuffer(int InWidth, int InHeight)
+			: Width(InWidth)
+			, Height(InHeight)
+		{}
+
+		/** A null layer means the layer has not been captured for this frame because of its framerate cap */
 		void AddLayer(rtc::scoped_refptr<FFrameBufferRHI> Layer)
 		{
 			FScopeLock Lock(&CriticalSection);
 			FrameBuffers.Add(Layer);
 		}
 
+		/** The controller of the source that captured this frame, the encoder reports its load to it */
+		void SetAdaptationController(TSharedPtr<FEncoderAdaptationController, ESPMode::ThreadSafe> InAdaptationController)
+		{
+			AdaptationController = MoveTemp(InAdaptationController);
+		}
+
+		TSharedPtr<FEncoderAdaptationController, ESPMode::ThreadSafe> GetAdaptationController() const
+		{
+			return AdaptationController;
+		}
+
+		/** Key frame settings of the publisher of the source that produced this frame, null for the defaults */
+		void SetKeyFrameSettings(TSharedPtr<const FKeyFrameGovernorSettings, ESPMode::ThreadSafe> InKeyFrameSettings)
+		{
+			KeyFrameSettings = MoveTemp(InKeyFrameSettings);
+		}
+
+		const TSharedPtr<const FKeyFrameGovernorSettings, ESPMode::ThreadSafe>& GetKeyFrameSettings() const
+		{
+			return KeyFrameSettings;
+		}
+
+		/** Frame of a pre-encoded source, sent by the passthrough encoder instead of encoding the layers */
+		void SetEncodedFrame(rtc::scoped_refptr<FEncodedFrameBuffer> InEncodedFrame)
+		{
+			EncodedFrame = MoveTemp(InEncodedFrame);
+		}
+
+		rtc::scoped_refptr<FEncodedFrameBuffer> GetEncodedFrame() const
+		{
+			return EncodedFrame;
+		}
+
+		/** Other peer connections sharing the output of the encoder of this frame */
+		void SetFanOut(TSharedPtr<FEncodedFrameFanOut, ESPMode::ThreadSafe> InFanOut)
+		{
+			FanOut = MoveTemp(InFanOut);
+		}
+
+		TSharedPtr<FEncodedFrameFanOut, ESPMode::ThreadSafe> GetFanOut() const
+		{
+			return FanOut;
+		}
+
+		/** Place of the frame in the input queue of its source, the frame leaves it with this buffer */
+		void SetInputTicket(FEncoderInputQueue::FTicketPtr InInputTicket)
+		{
+			InputTicket = MoveTemp(InInputTicket);
+		}
+
+		/** Called by the encoder, false if a newer frame replaced this one in the queue and it must not be encoded */
+		bool DequeueInput() const
+		{
+			return !InputTicket || InputTicket->Dequeue();
+		}
+
 		int32 GetNumLayers() const
 		{
 			FScopeLock Lock(&CriticalSection);
@@ -229,25 +324,12 @@ namespace Millicast::Publisher
 
 		int width() const override
 		{
-			FScopeLock Lock(&CriticalSection);
-
-      		if( IsEmpty(FrameBuffers) )
-			{
-				return 0;
-			}
-
-			return FrameBuffers[0]->width();
+			return Width;
 		}
 
 		int height() const override
 		{
-			FScopeLock Lock(&CriticalSection);
-		    if( IsEmpty(FrameBuffers) )
-			{
-				return 0;
-			}
-			
-			return FrameBuffers[0]->height();
+			return Height;
 		}
 
 		rtc::scoped_refptr<webrtc::I420BufferInterface> ToI420() override
@@ -261,7 +343,14 @@ namespace Millicast::Publisher
 		}
 
 	private:
+		int Width;
+		int Height;
+		TSharedPtr<FEncoderAdaptationController, ESPMode::ThreadSafe> AdaptationController;
+		TSharedPtr<const FKeyFrameGovernorSettings, ESPMode::ThreadSafe> KeyFrameSettings;
 		TArray<rtc::scoped_refptr<FFrameBufferRHI>> FrameBuffers;
+		rtc::scoped_refptr<FEncodedFrameBuffer> EncodedFrame;
+		TSharedPtr<FEncodedFrameFanOut, ESPMode::ThreadSafe> FanOut;
+		FEncoderInputQueue::FTicketPtr InputTicket;
 		mutable FCriticalSection CriticalSection;
 	};
 }
@@ -0,0 +1,108 @@
+// Copyright Dolby.io 2023. All Rights Reserved.
+
+#include "H264NalIndexer.h"
+
+#if PLATFORM_ENABLE_VECTORINTRINSICS_NEON
+#include <arm_neon.h>
+#elif PLATFORM_ENABLE_VECTORINTRINSICS
+#include <emmintrin.h>
+#endif
+
+namespace Millicast::Publisher
+{
+
+const FH264NalIndexer::FNalUnits& FH264NalIndexer::Index(const uint8* Bitstream, size_t Size)
+{
+	NalUnits.Reset();
+
+	if (!Bitstream || Size < 3)
+	{
+		return NalUnits;
+	}
+
+	size_t i = 0;
+
+	// Look for 00 00 01 at every position of a 16 bytes block at once, with three overlapping loads.
+	// Emulation prevention guarantees this sequence only appears in start codes.
+#if PLATFORM_ENABLE_VECTORINTRINSICS_NEON
+	const uint8x16_t Zero = vdupq_n_u8(0);
+	const uint8x16_t One = vdupq_n_u8(1);
+
+	for (; i + 18 <= Size; i += 16)
+	{
+		const uint8x16_t Byte0 = vld1q_u8(Bitstream + i);
+		const uint8x16_t Byte1 = vld1q_u8(Bitstream + i + 1);
+		const uint8x16_t Byte2 = vld1q_u8(Bitstream + i + 2);
+		const uint8x16_t Match = vandq_u8(vandq_u8(vceqq_u8(Byte0, Zero), vceqq_u8(Byte1, Zero)), vceqq_u8(Byte2, One));
+
+		// NEON has no movemask, narrow each byte to 4 bits instead
+		uint64 Mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(Match), 4)), 0);
+		while (Mask)
+		{
+			const uint64 Bit = FMath::CountTrailingZeros64(Mask);
+			AddStartCode(Bitstream, i + Bit / 4);
+			Mask &= ~(uint64(0xF) << Bit);
+		}
+	}
+#elif PLATFORM_ENABLE_VECTORINTRINSICS
+	const __m128i Zero = _mm_setzero_si128();
+	const __m128i One = _mm_set1_epi8(1);
+
+	for (; i + 18 <= Size; i += 16)
+	{
+		const __m128i Byte0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Bitstream + i));
+		const __m128i Byte1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Bitstream + i + 1));
+		const __m128i Byte2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Bitstream + i + 2));
+		const __m128i Match = _mm_and_si128(_mm_and_si128(_mm_cmpeq_epi8(Byte0, Zero), _mm_cmpeq_epi8(Byte1, Zero)), _mm_cmpeq_epi8(Byte2, One));
+
+		uint32 Mask = static_cast<uint32>(_mm_movemask_epi8(Match));
+		while (Mask)
+		{
+			AddStartCode(Bitstream, i + FMath::CountTrailingZeros(Mask));
+			Mask &= Mask - 1;
+		}
+	}
+#endif
+
+	for (; i + 3 <= Size; ++i)
+	{
+		if (Bitstream[i] == 0 && Bitstream[i + 1] == 0 && Bitstream[i + 2] == 1)
+		{
+			AddStartCode(Bitstream, i);
+		}
+	}
+
+	CloseLastUnit(Bitstream, Size);
+
+	return NalUnits;
+}
+
+void FH264NalIndexer::AddStartCode(const uint8* Bitstream, size_t Position)
+{
+	// 00 00 00 01 is found as 00 00 01 one byte further
+	const uint8 StartCodeLength = (Position > 0 && Bitstream[Position - 1] == 0) ? 4 : 3;
+
+	CloseLastUnit(Bitstream, Position + 3 - StartCodeLength);
+
+	NalUnits.Add({ static_cast<uint32>(Position + 3), 0, StartCodeLength });
+}
+
+void FH264NalIndexer::CloseLastUnit(const uint8* Bitstream, size_t End)
+{
+	if (NalUnits.Num() == 0)
+	{
+		return;
+	}
+
+	FH264NalUnit& LastUnit = NalUnits.Last();
+
+	// A NAL unit never ends with a zero byte, those are trailing_zero_8bits of the stream
+	while (End > LastUnit.Offset && Bitstream[End - 1] == 0)
+	{
+		--End;
+	}
+
+	LastUnit.Size = static_cast<uint32>(End - LastUnit.Offset);
+}
+
+}
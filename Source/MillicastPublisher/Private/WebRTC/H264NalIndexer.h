@@ -0,0 +1,40 @@
+// Copyright Dolby.io 2023. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+namespace Millicast::Publisher
+{
+	/** A NAL unit of an Annex B bitstream, the start code is not part of it */
+	struct FH264NalUnit
+	{
+		uint32 Offset; // Offset of the NAL header in the bitstream
+		uint32 Size;
+		uint8 StartCodeLength; // 3 or 4
+
+		uint8 GetType(const uint8* Bitstream) const { return Bitstream[Offset] & 0x1F; }
+	};
+
+	/*
+	 * Finds the NAL units of an H264 Annex B bitstream in a single pass.
+	 * The start codes are searched 16 bytes at a time with SSE2 or NEON when available.
+	 * Keep an instance around to reuse the storage of the units between frames.
+	 */
+	class FH264NalIndexer
+	{
+	public:
+		using FNalUnits = TArray<FH264NalUnit, TInlineAllocator<16>>;
+
+		/** Index the bitstream, the result is valid until the next call */
+		const FNalUnits& Index(const uint8* Bitstream, size_t Size);
+
+		const FNalUnits& GetNalUnits() const { return NalUnits; }
+
+	private:
+		void AddStartCode(const uint8* Bitstream, size_t Position);
+		void CloseLastUnit(const uint8* Bitstream, size_t End);
+
+		FNalUnits NalUnits;
+	};
+}
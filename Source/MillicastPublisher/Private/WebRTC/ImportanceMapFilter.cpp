@@ -0,0 +1,85 @@
+// Copyright Dolby.io 2023. All Rights Reserved.
+
+#include "ImportanceMapFilter.h"
+
+namespace Millicast::Publisher
+{
+
+constexpr uint8 FullQualityImportance = 192;
+constexpr uint8 MediumQualityImportance = 96;
+
+/** Replace each BlockSize x BlockSize block of the area by its average */
+static void AverageBlocks(uint8* Plane, int32 Stride, int32 X0, int32 Y0, int32 X1, int32 Y1, int32 BlockSize)
+{
+	for (int32 BlockY = Y0; BlockY < Y1; BlockY += BlockSize)
+	{
+		const int32 BlockHeight = FMath::Min(BlockSize, Y1 - BlockY);
+
+		for (int32 BlockX = X0; BlockX < X1; BlockX += BlockSize)
+		{
+			const int32 BlockWidth = FMath::Min(BlockSize, X1 - BlockX);
+
+			uint32 Sum = 0;
+			for (int32 y = 0; y < BlockHeight; ++y)
+			{
+				const uint8* Row = Plane + (BlockY + y) * Stride + BlockX;
+				for (int32 x = 0; x < BlockWidth; ++x)
+				{
+					Sum += Row[x];
+				}
+			}
+
+			const int32 NumPixels = BlockWidth * BlockHeight;
+			const uint8 Average = static_cast<uint8>((Sum + NumPixels / 2) / NumPixels);
+
+			for (int32 y = 0; y < BlockHeight; ++y)
+			{
+				FMemory::Memset(Plane + (BlockY + y) * Stride + BlockX, Average, BlockWidth);
+			}
+		}
+	}
+}
+
+void ApplyImportanceMap(const FMillicastImportanceMap& ImportanceMap, webrtc::I420Buffer& Buffer)
+{
+	if (!ImportanceMap.IsValid())
+	{
+		return;
+	}
+
+	const int32 Width = Buffer.width();
+	const int32 Height = Buffer.height();
+
+	for (int32 CellY = 0; CellY < ImportanceMap.Height; ++CellY)
+	{
+		// Cell bounds are kept even so that they map exactly onto the chroma planes
+		const int32 Y0 = (CellY * Height / ImportanceMap.Height) & ~1;
+		const int32 Y1 = (CellY + 1 == ImportanceMap.Height) ? Height : ((CellY + 1) * Height / ImportanceMap.Height) & ~1;
+
+		for (int32 CellX = 0; CellX < ImportanceMap.Width; ++CellX)
+		{
+			const uint8 Importance = ImportanceMap.Values[CellY * ImportanceMap.Width + CellX];
+			if (Importance >= FullQualityImportance)
+			{
+				continue;
+			}
+
+			const int32 X0 = (CellX * Width / ImportanceMap.Width) & ~1;
+			const int32 X1 = (CellX + 1 == ImportanceMap.Width) ? Width : ((CellX + 1) * Width / ImportanceMap.Width) & ~1;
+
+			const int32 BlockSize = Importance >= MediumQualityImportance ? 2 : 4;
+			AverageBlocks(Buffer.MutableDataY(), Buffer.StrideY(), X0, Y0, X1, Y1, BlockSize);
+
+			// The chroma planes already are at half resolution, only the least important cells lose chroma details
+			if (BlockSize > 2)
+			{
+				const int32 ChromaX1 = (X1 + 1) / 2;
+				const int32 ChromaY1 = (Y1 + 1) / 2;
+				AverageBlocks(Buffer.MutableDataU(), Buffer.StrideU(), X0 / 2, Y0 / 2, ChromaX1, ChromaY1, BlockSize / 2);
+				AverageBlocks(Buffer.MutableDataV(), Buffer.StrideV(), X0 / 2, Y0 / 2, ChromaX1, ChromaY1, BlockSize / 2);
+			}
+		}
+	}
+}
+
+}
@@ -0,0 +1,17 @@
+// Copyright Dolby.io 2023. All Rights Reserved.
+
+#pragma once
+
+#include "WebRTCInc.h"
+#include "MillicastRegionOfInterest.h"
+
+namespace Millicast::Publisher
+{
+	/*
+	 * Removes details from the least important cells of the importance map before the frame is encoded.
+	 * The libvpx and OpenH264 encoders are wrapped by libwebrtc, which does not give access to their ROI maps,
+	 * so the bits are saved by flattening the content instead: flat blocks are nearly free to encode.
+	 * Cells from 192 are untouched, cells from 96 are averaged by 2x2 luma blocks and the others by 4x4 blocks.
+	 */
+	void ApplyImportanceMap(const FMillicastImportanceMap& ImportanceMap, webrtc::I420Buffer& Buffer);
+}
@@ -0,0 +1,78 @@
+// Copyright Dolby.io 2023. All Rights Reserved.
+
+#include "KeyFrameGovernor.h"
+
+#include "Stats.h"
+
+namespace Millicast::Publisher
+{
+
+void FKeyFrameGovernor::Reset()
+{
+	for (int32 i = 0; i < webrtc::kMaxSimulcastStreams; ++i)
+	{
+		Pending[i] = false;
+		LastKeyFrameMs[i] = 0;
+	}
+}
+
+void FKeyFrameGovernor::OnKeyFrameRequested(int32 StreamIndex)
+{
+	if (StreamIndex < 0 || StreamIndex >= webrtc::kMaxSimulcastStreams)
+	{
+		return;
+	}
+
+	OnKeyFrameRequestedForStreams(1u << StreamIndex);
+}
+
+void FKeyFrameGovernor::OnKeyFrameRequestedForStreams(uint32 StreamMask)
+{
+	StreamMask &= (1u << webrtc::kMaxSimulcastStreams) - 1;
+	if (StreamMask == 0)
+	{
+		return;
+	}
+
+	FPublisherStats::Get().KeyFrameRequested();
+
+	// Unless layers are refreshed independently, a request for any layer refreshes all of them
+	for (int32 i = 0; i < webrtc::kMaxSimulcastStreams; ++i)
+	{
+		if (!Settings.bPerLayer || (StreamMask & (1u << i)))
+		{
+			Pending[i] = true;
+		}
+	}
+}
+
+void FKeyFrameGovernor::CancelRequest(int32 StreamIndex)
+{
+	if (StreamIndex >= 0 && StreamIndex < webrtc::kMaxSimulcastStreams)
+	{
+		Pending[StreamIndex] = false;
+	}
+}
+
+bool FKeyFrameGovernor::ShouldEncodeKeyFrame(int32 StreamIndex, int64 NowMs) const
+{
+	if (StreamIndex < 0 || StreamIndex >= webrtc::kMaxSimulcastStreams)
+	{
+		return false;
+	}
+
+	return Pending[StreamIndex] && (LastKeyFrameMs[StreamIndex] == 0 || NowMs - LastKeyFrameMs[StreamIndex] >= Settings.MinIntervalMs);
+}
+
+void FKeyFrameGovernor::OnKeyFrameSubmitted(int32 StreamIndex, int64 NowMs)
+{
+	if (StreamIndex < 0 || StreamIndex >= webrtc::kMaxSimulcastStreams)
+	{
+		return;
+	}
+
+	Pending[StreamIndex] = false;
+	LastKeyFrameMs[StreamIndex] = NowMs;
+}
+
+}
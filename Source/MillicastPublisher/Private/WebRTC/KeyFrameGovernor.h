@@ -0,0 +1,54 @@
+// Copyright Dolby.io 2023. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "WebRTCInc.h"
+
+namespace Millicast::Publisher
+{
+	struct FKeyFrameGovernorSettings
+	{
+		/** Key frame requests received within this window after a key frame are merged into the next one */
+		int32 MinIntervalMs = 300;
+
+		/** Only refresh the layers that requested a key frame instead of all of them */
+		bool bPerLayer = false;
+	};
+
+	/*
+	 * Decides when the simulcast encoder produces key frames.
+	 * PLI/FIR from many viewers can request a key frame every few frames, which spikes the bitrate and the encode time.
+	 * Requests are kept pending until the minimum interval since the last key frame of the layer has elapsed.
+	 * The settings are those of the publisher of the source being encoded.
+	 * Only accessed from the encoder thread.
+	 */
+	class FKeyFrameGovernor
+	{
+	public:
+		void SetSettings(const FKeyFrameGovernorSettings& InSettings) { Settings = InSettings; }
+		bool IsPerLayer() const { return Settings.bPerLayer; }
+
+		void Reset();
+
+		/** A receiver or webrtc asked for a key frame on this layer */
+		void OnKeyFrameRequested(int32 StreamIndex);
+
+		/** A single request for a key frame on several layers, one bit per stream index, e.g. webrtc asking for all of them */
+		void OnKeyFrameRequestedForStreams(uint32 StreamMask);
+
+		/** The layer is not sent anymore, its pending request is dropped */
+		void CancelRequest(int32 StreamIndex);
+
+		bool ShouldEncodeKeyFrame(int32 StreamIndex, int64 NowMs) const;
+
+		/** A key frame has been submitted to the encoder of this layer, it satisfies the pending request */
+		void OnKeyFrameSubmitted(int32 StreamIndex, int64 NowMs);
+
+	private:
+		FKeyFrameGovernorSettings Settings;
+
+		bool Pending[webrtc::kMaxSimulcastStreams] = {};
+		int64 LastKeyFrameMs[webrtc::kMaxSimulcastStreams] = {};
+	};
+}
@@ -11,14 +11,19 @@
 #else
 #include "api/video_codecs/h264_profile_level_id.h"
 #endif
+#include "VideoEncoderH264Software.h"
 #include "VideoEncoderNVENC.h"
+#include "VideoEncoderPassthrough.h"
 #include "VideoEncoderVPX.h"
 #include "MillicastPublisherPrivate.h"
 
+#if WITH_AVENCODER
+#include "VideoEncoderFactory.h"
+#endif
+
 namespace Millicast::Publisher
 {
 //#if ENGINE_MAJOR_VERSION < 5 || ENGINE_MINOR_VERSION == 0
-#if WITH_AVENCODER
 #if WEBRTC_VERSION < 96
 #define H264_Level webrtc::H264::Level
 #define H264_Profile webrtc::H264::Profile
@@ -43,15 +48,34 @@ webrtc::SdpVideoFormat CreateH264Format(H264_Profile profile, H264_Level level)
 			{ cricket::kH264FmtpPacketizationMode, "1" }
 		});
 }
+
+bool IsHardwareH264Available()
+{
+#if WITH_AVENCODER
+	return AVEncoder::FVideoEncoderFactory::Get().IsSetup() && AVEncoder::FVideoEncoderFactory::Get().GetAvailable().Num() > 0;
+#else
+	return false;
 #endif
+}
+
+bool IsH264Available()
+{
+	return IsHardwareH264Available() || FVideoEncoderH264Software::IsSupported();
+}
+
 std::vector<webrtc::SdpVideoFormat> FMillicastVideoEncoderFactory::GetSupportedFormats() const
 {
 	std::vector<webrtc::SdpVideoFormat> VideoFormats;
-#if WITH_AVENCODER
-	VideoFormats.push_back(CreateH264Format(H264_Profile::kProfileMain, H264_Level::kLevel1));
-	VideoFormats.push_back(CreateH264Format(H264_Profile::kProfileConstrainedBaseline, H264_Level::kLevel3_1));
-	VideoFormats.push_back(CreateH264Format(H264_Profile::kProfileBaseline, H264_Level::kLevel3_1));
-#endif
+	if (IsH264Available())
+	{
+		// OpenH264 only produces (constrained) baseline streams
+		if (IsHardwareH264Available())
+		{
+			VideoFormats.push_back(CreateH264Format(H264_Profile::kProfileMain, H264_Level::kLevel1));
+		}
+		VideoFormats.push_back(CreateH264Format(H264_Profile::kProfileConstrainedBaseline, H264_Level::kLevel3_1));
+		VideoFormats.push_back(CreateH264Format(H264_Profile::kProfileBaseline, H264_Level::kLevel3_1));
+	}
 	VideoFormats.push_back(webrtc::SdpVideoFormat(cricket::kVp8CodecName));
 	VideoFormats.push_back(webrtc::SdpVideoFormat(cricket::kVp9CodecName));
 	return VideoFormats;
@@ -71,7 +95,7 @@ FMillicastVideoEncoderFactory::CodecInfo FMillicastVideoEncoderFactory::QueryVid
 	}
 	if (absl::EqualsIgnoreCase(format.name, cricket::kH264CodecName))
 	{
-		codec_info.is_hardware_accelerated = true;
+		codec_info.is_hardware_accelerated = IsHardwareH264Available();
 	}
 #endif
 
@@ -90,15 +114,29 @@ std::unique_ptr<webrtc::VideoEncoder> FMillicastVideoEncoderFactory::CreateVideo
 		return std::make_unique<Millicast::Publisher::FVideoEncoderVPX>(9);
 	}
 
-#if WITH_AVENCODER
 	if (absl::EqualsIgnoreCase(format.name, cricket::kH264CodecName))
 	{
-		return std::make_unique<Millicast::Publisher::FVideoEncoderNVENC>();
-	}
+#if WITH_AVENCODER
+		if (IsHardwareH264Available())
+		{
+			return std::make_unique<Millicast::Publisher::FVideoEncoderNVENC>(format, EncoderPreset.Load());
+		}
 #endif
+		// No hardware encoder on this machine, fallback on OpenH264
+		if (FVideoEncoderH264Software::IsSupported())
+		{
+			UE_LOG(LogMillicastPublisher, Log, TEXT("No hardware H264 encoder available, using the OpenH264 software encoder"));
+			return std::make_unique<Millicast::Publisher::FVideoEncoderH264Software>(format);
+		}
+	}
 
 	UE_LOG(LogMillicastPublisher, Warning, TEXT("CreateVideoEncoder called with unknown encoder: %s"), *FString(format.name.c_str()) );
 	return nullptr;
 }
 
+std::unique_ptr<webrtc::VideoEncoder> FMillicastVideoEncoderFactory::CreatePassthroughEncoder() const
+{
+	return std::make_unique<Millicast::Publisher::FVideoEncoderPassthrough>();
+}
+
 }
\ No newline at end of file
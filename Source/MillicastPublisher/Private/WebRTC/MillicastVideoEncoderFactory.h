@@ -3,6 +3,7 @@
 #pragma once
 
 #include "WebRTCInc.h"
+#include "RtcCodecsConstants.h"
 
 namespace Millicast::Publisher
 {
@@ -18,5 +19,15 @@ namespace Millicast::Publisher
 		// Todo : ForceKeyFrame
 
 		// webrtc::VideoEncoderFactory Interface end
+
+		/** Encoder sending the frames of pre-encoded sources as they are, whatever the codec */
+		std::unique_ptr<webrtc::VideoEncoder> CreatePassthroughEncoder() const;
+
+		/** Preset of the hardware H264 encoders created from now on */
+		void SetEncoderPreset(EMillicastVideoEncoderPreset InPreset) { EncoderPreset = InPreset; }
+		EMillicastVideoEncoderPreset GetEncoderPreset() const { return EncoderPreset.Load(); }
+
+	private:
+		TAtomic<EMillicastVideoEncoderPreset> EncoderPreset { EMillicastVideoEncoderPreset::Balanced };
 	};
 }
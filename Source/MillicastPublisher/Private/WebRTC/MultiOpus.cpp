@@ -0,0 +1,54 @@
+// Copyright Dolby.io 2023. All Rights Reserved.
+
+#include "MultiOpus.h"
+
+#include "MillicastPublisherPrivate.h"
+#include "SdpEditor.h"
+
+namespace Millicast::Publisher
+{
+
+namespace
+{
+	const FMultiOpusLayout Layouts[] =
+	{
+		// 5.1: FL FC FR RL RR LFE, from FL FR FC LFE SL SR
+		{ 6, 4, 2, "0,4,1,2,3,5", { 0, 2, 1, 4, 5, 3 } },
+		// 7.1: FL FC FR SL SR RL RR LFE, from FL FR FC LFE BL BR SL SR
+		{ 8, 5, 3, "0,6,1,2,3,4,5,7", { 0, 2, 1, 6, 7, 4, 5, 3 } },
+	};
+}
+
+const FMultiOpusLayout* FindMultiOpusLayout(int32 NumChannels)
+{
+	for (const FMultiOpusLayout& Layout : Layouts)
+	{
+		if (Layout.NumChannels == NumChannels)
+		{
+			return &Layout;
+		}
+	}
+
+	return nullptr;
+}
+
+bool SetMultiOpusCodec(FSdpEditor& Sdp, int32 NumChannels)
+{
+	const FMultiOpusLayout* Layout = FindMultiOpusLayout(NumChannels);
+	const TOptional<FSdpEditor::FCodec> Opus = Sdp.FindCodec("audio", "opus");
+	if (!Layout || !Opus)
+	{
+		return false;
+	}
+
+	Sdp.SetEncoding(*Opus, "multiopus/48000/" + std::to_string(Layout->NumChannels));
+	Sdp.SetParameter(*Opus, "channel_mapping", Layout->ChannelMapping);
+	Sdp.SetParameter(*Opus, "num_streams", std::to_string(Layout->NumStreams));
+	Sdp.SetParameter(*Opus, "coupled_streams", std::to_string(Layout->NumCoupledStreams));
+
+	UE_LOG(LogMillicastPublisher, Log, TEXT("Offering %d channels audio with Opus multistream"), Layout->NumChannels);
+
+	return true;
+}
+
+}
@@ -0,0 +1,29 @@
+// Copyright Dolby.io 2023. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+namespace Millicast::Publisher
+{
+	class FSdpEditor;
+
+	/*
+	 * Opus multistream ("multiopus") layouts of the surround audio, the channel mapping family 1 of RFC 7845.
+	 * The engine mixes surround in the WAVE channel order, it is published in the Vorbis order the mapping refers to.
+	 */
+	struct FMultiOpusLayout
+	{
+		int32 NumChannels;
+		int32 NumStreams;
+		int32 NumCoupledStreams;
+		const char* ChannelMapping;
+		int32 EngineChannels[8]; // Engine channel of each published channel
+	};
+
+	/** Layout of a surround channel count, 5.1 or 7.1, null for the other counts */
+	const FMultiOpusLayout* FindMultiOpusLayout(int32 NumChannels);
+
+	/** Replaces opus by multiopus with the layout of NumChannels on the audio section of an offer, false if it can't */
+	bool SetMultiOpusCodec(FSdpEditor& Sdp, int32 NumChannels);
+}
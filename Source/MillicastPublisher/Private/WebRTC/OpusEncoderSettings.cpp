@@ -0,0 +1,103 @@
+// Copyright Dolby.io 2023. All Rights Reserved.
+
+#include "OpusEncoderSettings.h"
+
+#include "SdpEditor.h"
+
+namespace Millicast::Publisher
+{
+
+namespace
+{
+	// Not standard, they never leave the answer the encoder is configured from
+	const std::string ComplexityParameter = "x-millicast-complexity";
+	const std::string ApplicationParameter = "x-millicast-application";
+
+	int32 GetFrameDurationMs(EMillicastOpusFrameDuration Duration)
+	{
+		switch (Duration)
+		{
+		case EMillicastOpusFrameDuration::Ms10: return 10;
+		default:
+		case EMillicastOpusFrameDuration::Ms20: return 20;
+		case EMillicastOpusFrameDuration::Ms40: return 40;
+		case EMillicastOpusFrameDuration::Ms60: return 60;
+		}
+	}
+
+	template<typename ConfigType>
+	void ApplyCommonParameters(const webrtc::SdpAudioFormat& Format, ConfigType& Config)
+	{
+		const auto Complexity = Format.parameters.find(ComplexityParameter);
+		if (Complexity != Format.parameters.end())
+		{
+			Config.complexity = FMath::Clamp(std::atoi(Complexity->second.c_str()), 0, 10);
+		}
+
+		const auto Application = Format.parameters.find(ApplicationParameter);
+		if (Application != Format.parameters.end())
+		{
+			Config.application = Application->second == "voip" ? ConfigType::ApplicationMode::kVoip : ConfigType::ApplicationMode::kAudio;
+		}
+	}
+}
+
+void ApplyOpusSettings(FSdpEditor& Sdp, const FMillicastAudioEncoderSettings& Settings, bool bConfiguresEncoder)
+{
+	bool bMultistream = false;
+	TOptional<FSdpEditor::FCodec> Codec = Sdp.FindCodec("audio", "opus");
+	if (!Codec)
+	{
+		Codec = Sdp.FindCodec("audio", "multiopus");
+		bMultistream = true;
+	}
+
+	if (!Codec)
+	{
+		return;
+	}
+
+	// Stereo is always received, the capturers downmix or upmix to the published layout
+	if (!bMultistream)
+	{
+		Sdp.SetParameter(*Codec, "stereo", "1");
+	}
+
+	Sdp.SetParameter(*Codec, "ptime", std::to_string(GetFrameDurationMs(Settings.FrameDuration)));
+	Sdp.SetParameter(*Codec, "useinbandfec", Settings.bInbandFec ? "1" : "0");
+	Sdp.SetParameter(*Codec, "usedtx", Settings.bDtx ? "1" : "0");
+	Sdp.SetParameter(*Codec, "cbr", Settings.bConstantBitrate ? "1" : "0");
+
+	if (Settings.BitrateKbps > 0)
+	{
+		Sdp.SetParameter(*Codec, "maxaveragebitrate", std::to_string(Settings.BitrateKbps * 1000));
+	}
+
+	if (bConfiguresEncoder)
+	{
+		if (Settings.Complexity >= 0)
+		{
+			Sdp.SetParameter(*Codec, ComplexityParameter, std::to_string(Settings.Complexity));
+		}
+
+		Sdp.SetParameter(*Codec, ApplicationParameter, Settings.Application == EMillicastOpusApplication::Voice ? "voip" : "audio");
+	}
+}
+
+void ApplyEncoderParameters(const webrtc::SdpAudioFormat& Format, webrtc::AudioEncoderOpusConfig& Config)
+{
+	ApplyCommonParameters(Format, Config);
+
+	// The complexity is otherwise raised at low bitrates
+	if (Format.parameters.count(ComplexityParameter) != 0)
+	{
+		Config.low_rate_complexity = Config.complexity;
+	}
+}
+
+void ApplyEncoderParameters(const webrtc::SdpAudioFormat& Format, webrtc::AudioEncoderMultiChannelOpusConfig& Config)
+{
+	ApplyCommonParameters(Format, Config);
+}
+
+}
@@ -0,0 +1,65 @@
+// Copyright Dolby.io 2023. All Rights Reserved.
+
+#pragma once
+
+#include "MillicastAudioEncoderSettings.h"
+#include "RecordedAudioEncoder.h"
+#include "WebRTCInc.h"
+
+namespace Millicast::Publisher
+{
+	class FSdpEditor;
+
+	/**
+	 * Writes the settings to the fmtp parameters of the opus or multiopus codec of the audio section.
+	 * The description the encoder is configured from, the answer of the server, also gets the complexity and the
+	 * application, which webrtc doesn't take from the SDP and only the encoders below read.
+	 */
+	void ApplyOpusSettings(FSdpEditor& Sdp, const FMillicastAudioEncoderSettings& Settings, bool bConfiguresEncoder);
+
+	/** Applies the parameters of ApplyOpusSettings webrtc ignores */
+	void ApplyEncoderParameters(const webrtc::SdpAudioFormat& Format, webrtc::AudioEncoderOpusConfig& Config);
+	void ApplyEncoderParameters(const webrtc::SdpAudioFormat& Format, webrtc::AudioEncoderMultiChannelOpusConfig& Config);
+
+	/**
+	 * webrtc::AudioEncoderOpus or webrtc::AudioEncoderMultiChannelOpus for the audio encoder factory, with all the settings applied.
+	 * The encoders are wrapped to be recorded with the recording the answer named.
+	 */
+	template<typename EncoderType>
+	struct TOpusEncoder
+	{
+		struct Config
+		{
+			typename EncoderType::Config EncoderConfig;
+			FString RecordingId;
+		};
+
+		static absl::optional<Config> SdpToConfig(const webrtc::SdpAudioFormat& Format)
+		{
+			absl::optional<typename EncoderType::Config> EncoderConfig = EncoderType::SdpToConfig(Format);
+			if (!EncoderConfig)
+			{
+				return absl::nullopt;
+			}
+
+			ApplyEncoderParameters(Format, *EncoderConfig);
+			return Config{ *EncoderConfig, GetRecordingId(Format.parameters) };
+		}
+
+		static void AppendSupportedEncoders(std::vector<webrtc::AudioCodecSpec>* Specs)
+		{
+			EncoderType::AppendSupportedEncoders(Specs);
+		}
+
+		static webrtc::AudioCodecInfo QueryAudioEncoder(const Config& InConfig)
+		{
+			return EncoderType::QueryAudioEncoder(InConfig.EncoderConfig);
+		}
+
+		static std::unique_ptr<webrtc::AudioEncoder> MakeAudioEncoder(const Config& InConfig, int PayloadType, absl::optional<webrtc::AudioCodecPairId> CodecPairId = absl::nullopt)
+		{
+			std::unique_ptr<webrtc::AudioEncoder> Encoder = EncoderType::MakeAudioEncoder(InConfig.EncoderConfig, PayloadType, CodecPairId);
+			return Encoder ? MakeRecordedEncoder(std::move(Encoder), InConfig.EncoderConfig, InConfig.RecordingId) : nullptr;
+		}
+	};
+}
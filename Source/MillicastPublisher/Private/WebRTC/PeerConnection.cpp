@@ -7,6 +7,7 @@
 #include "VideoEncoderFactory.h"
 #endif
 #include "MillicastVideoEncoderFactory.h"
+#include "OpusEncoderSettings.h"
 #include "SimulcastEncoderFactory.h"
 
 #include <sstream>
@@ -21,6 +22,7 @@ rtc::scoped_refptr<webrtc::PeerConnectionFactoryInterface> FWebRTCPeerConnection
 TUniquePtr<rtc::Thread> FWebRTCPeerConnection::SignalingThread = nullptr;
 rtc::scoped_refptr<FAudioDeviceModule> FWebRTCPeerConnection::AudioDeviceModule = nullptr;
 std::unique_ptr<webrtc::TaskQueueFactory> FWebRTCPeerConnection::TaskQueueFactory = nullptr;
+FSimulcastEncoderFactory* FWebRTCPeerConnection::SimulcastEncoderFactory = nullptr;
 
 void FWebRTCPeerConnection::CreatePeerConnectionFactory()
 {
@@ -53,11 +55,14 @@ void FWebRTCPeerConnection::CreatePeerConnectionFactory()
 	// Apply the config.
 	AudioProcessingModule->ApplyConfig(ApmConfig);
 
+	auto VideoEncoderFactory = std::make_unique<FSimulcastEncoderFactory>();
+	SimulcastEncoderFactory = VideoEncoderFactory.get();
+
 	PeerConnectionFactory = webrtc::CreatePeerConnectionFactory(
 				nullptr, nullptr, SignalingThread.Get(), AudioDeviceModule,
-				webrtc::CreateAudioEncoderFactory<webrtc::AudioEncoderOpus>(),
-				webrtc::CreateAudioDecoderFactory<webrtc::AudioDecoderOpus>(),
-				std::make_unique<FSimulcastEncoderFactory>(),
+				webrtc::CreateAudioEncoderFactory<TOpusEncoder<webrtc::AudioEncoderOpus>, TOpusEncoder<webrtc::AudioEncoderMultiChannelOpus>>(),
+				webrtc::CreateAudioDecoderFactory<webrtc::AudioDecoderOpus, webrtc::AudioDecoderMultiChannelOpus>(),
+				std::move(VideoEncoderFactory),
 				webrtc::CreateBuiltinVideoDecoderFactory(),
 				nullptr, AudioProcessingModule
 	  ).release();
@@ -94,6 +99,11 @@ rtc::scoped_refptr<FAudioDeviceModule> FWebRTCPeerConnection::GetAudioDeviceModu
 	return AudioDeviceModule;
 }
 
+FSimulcastEncoderFactory* FWebRTCPeerConnection::GetSimulcastEncoderFactory()
+{
+	return SimulcastEncoderFactory;
+}
+
 TArray<FString> FWebRTCPeerConnection::GetSupportedVideoCodecs()
 {
 	return GetSupportedCodecs<cricket::MediaType::MEDIA_TYPE_VIDEO>();
@@ -348,8 +358,13 @@ void FWebRTCPeerConnection::OnRenegotiationNeeded()
 	UE_LOG(LogMillicastPublisher, Log, TEXT("OnRenegociationNeeded"));
 }
 
-void FWebRTCPeerConnection::OnIceConnectionChange(webrtc::PeerConnectionInterface::IceConnectionState)
-{}
+void FWebRTCPeerConnection::OnIceConnectionChange(webrtc::PeerConnectionInterface::IceConnectionState NewState)
+{
+	if (OnIceConnectionStateChanged)
+	{
+		OnIceConnectionStateChanged(NewState);
+	}
+}
 
 void FWebRTCPeerConnection::OnIceGatheringChange(webrtc::PeerConnectionInterface::IceGatheringState)
 {}
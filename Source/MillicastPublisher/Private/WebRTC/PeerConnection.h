@@ -17,6 +17,8 @@ class TaskQueueFactory;
 
 namespace Millicast::Publisher
 {
+	class FSimulcastEncoderFactory;
+
 	class FWebRTCPeerConnectionConfig
 	{
 	public:
@@ -48,6 +50,7 @@ namespace Millicast::Publisher
 		static TUniquePtr<rtc::Thread>                       SignalingThread;
 		static rtc::scoped_refptr<FAudioDeviceModule> AudioDeviceModule;
 		static std::unique_ptr<webrtc::TaskQueueFactory>     TaskQueueFactory;
+		static FSimulcastEncoderFactory*                     SimulcastEncoderFactory; // Owned by the peerconnection factory
 
 		using FCreateSessionDescriptionObserver = TSessionDescriptionObserver<webrtc::CreateSessionDescriptionObserver>;
 		using FSetSessionDescriptionObserver = TSessionDescriptionObserver<webrtc::SetSessionDescriptionObserver>;
@@ -73,6 +76,9 @@ namespace Millicast::Publisher
 
 		std::function<void(uint32 Ssrc, uint32 Timestamp, TArray<uint8>& Data)> OnTransformableFrame = nullptr;
 
+		/** Called on the signaling thread */
+		std::function<void(webrtc::PeerConnectionInterface::IceConnectionState)> OnIceConnectionStateChanged = nullptr;
+
 		using FRTCConfig = webrtc::PeerConnectionInterface::RTCConfiguration;
 
 		/** Offer/Answer options (e.g. offer to receive audio/video) */
@@ -86,6 +92,8 @@ namespace Millicast::Publisher
 		static rtc::scoped_refptr<webrtc::PeerConnectionFactoryInterface> GetPeerConnectionFactory();
 		/** Get the audio device module */
 		static rtc::scoped_refptr<FAudioDeviceModule> GetAudioDeviceModule();
+		/** Get the video encoder factory, to warm up encoders before publishing. Null until the peerconnection factory is created */
+		static FSimulcastEncoderFactory* GetSimulcastEncoderFactory();
 		/** Get the supported video codecs */
 		static TArray<FString> GetSupportedVideoCodecs();
 		/** Get the supported audio codecs */
@@ -0,0 +1,100 @@
+// Copyright Dolby.io 2023. All Rights Reserved.
+
+#include "RecordedAudioEncoder.h"
+
+#include "PeerConnection.h"
+#include "SimulcastEncoderFactory.h"
+
+namespace Millicast::Publisher
+{
+
+namespace
+{
+	/** Forwards everything to the wrapped encoder and tees the encoded packets to the recorder */
+	class FRecordedAudioEncoder : public webrtc::AudioEncoder
+	{
+	public:
+		FRecordedAudioEncoder(std::unique_ptr<webrtc::AudioEncoder> InEncoder, TSharedPtr<const FOpusStreamInfo, ESPMode::ThreadSafe> InStreamInfo, const FString& InRecordingId)
+			: Encoder(std::move(InEncoder))
+			, StreamInfo(MoveTemp(InStreamInfo))
+			, RecordingId(InRecordingId)
+		{
+		}
+
+		int SampleRateHz() const override { return Encoder->SampleRateHz(); }
+		size_t NumChannels() const override { return Encoder->NumChannels(); }
+		int RtpTimestampRateHz() const override { return Encoder->RtpTimestampRateHz(); }
+		size_t Num10MsFramesInNextPacket() const override { return Encoder->Num10MsFramesInNextPacket(); }
+		size_t Max10MsFramesInAPacket() const override { return Encoder->Max10MsFramesInAPacket(); }
+		int GetTargetBitrate() const override { return Encoder->GetTargetBitrate(); }
+		void Reset() override { Encoder->Reset(); }
+		bool SetFec(bool bEnable) override { return Encoder->SetFec(bEnable); }
+		bool SetDtx(bool bEnable) override { return Encoder->SetDtx(bEnable); }
+		bool GetDtx() const override { return Encoder->GetDtx(); }
+		bool SetApplication(Application InApplication) override { return Encoder->SetApplication(InApplication); }
+		void SetMaxPlaybackRate(int FrequencyHz) override { Encoder->SetMaxPlaybackRate(FrequencyHz); }
+		bool EnableAudioNetworkAdaptor(const std::string& Config, webrtc::RtcEventLog* EventLog) override { return Encoder->EnableAudioNetworkAdaptor(Config, EventLog); }
+		void DisableAudioNetworkAdaptor() override { Encoder->DisableAudioNetworkAdaptor(); }
+		void OnReceivedUplinkPacketLossFraction(float Fraction) override { Encoder->OnReceivedUplinkPacketLossFraction(Fraction); }
+		void OnReceivedTargetAudioBitrate(int TargetBps) override { Encoder->OnReceivedTargetAudioBitrate(TargetBps); }
+		void OnReceivedUplinkBandwidth(int TargetBps, absl::optional<int64_t> BwePeriodMs) override { Encoder->OnReceivedUplinkBandwidth(TargetBps, BwePeriodMs); }
+		void OnReceivedUplinkAllocation(webrtc::BitrateAllocationUpdate Update) override { Encoder->OnReceivedUplinkAllocation(Update); }
+		void OnReceivedRtt(int RttMs) override { Encoder->OnReceivedRtt(RttMs); }
+		void OnReceivedOverhead(size_t OverheadBytesPerPacket) override { Encoder->OnReceivedOverhead(OverheadBytesPerPacket); }
+		void SetReceiverFrameLengthRange(int MinMs, int MaxMs) override { Encoder->SetReceiverFrameLengthRange(MinMs, MaxMs); }
+		webrtc::ANAStats GetANAStats() const override { return Encoder->GetANAStats(); }
+		absl::optional<std::pair<webrtc::TimeDelta, webrtc::TimeDelta>> GetFrameLengthRange() const override { return Encoder->GetFrameLengthRange(); }
+
+	protected:
+		EncodedInfo EncodeImpl(uint32_t RtpTimestamp, rtc::ArrayView<const int16_t> Audio, rtc::Buffer* Encoded) override
+		{
+			// Known before the packet is completed, the 10 ms blocks are buffered until then
+			const uint32 Duration = Encoder->Num10MsFramesInNextPacket() * Encoder->RtpTimestampRateHz() / 100;
+			const size_t Offset = Encoded->size();
+
+			EncodedInfo Info = Encoder->Encode(RtpTimestamp, Audio, Encoded);
+
+			if (Info.encoded_bytes > 0 && !RecordingId.IsEmpty())
+			{
+				FSimulcastEncoderFactory* EncoderFactory = FWebRTCPeerConnection::GetSimulcastEncoderFactory();
+				const auto Recorder = EncoderFactory ? EncoderFactory->GetRecorder(RecordingId) : nullptr;
+				if (Recorder)
+				{
+					Recorder->OnEncodedAudio(StreamInfo, Info.encoded_timestamp, Duration, Encoded->data() + Offset, Info.encoded_bytes);
+				}
+			}
+
+			return Info;
+		}
+
+	private:
+		std::unique_ptr<webrtc::AudioEncoder> Encoder;
+		TSharedPtr<const FOpusStreamInfo, ESPMode::ThreadSafe> StreamInfo;
+		const FString RecordingId;
+	};
+}
+
+std::unique_ptr<webrtc::AudioEncoder> MakeRecordedEncoder(std::unique_ptr<webrtc::AudioEncoder> Encoder, const webrtc::AudioEncoderOpusConfig& Config, const FString& RecordingId)
+{
+	auto StreamInfo = MakeShared<FOpusStreamInfo, ESPMode::ThreadSafe>();
+	StreamInfo->NumChannels = static_cast<int32>(Config.num_channels);
+	StreamInfo->NumCoupledStreams = Config.num_channels > 1 ? 1 : 0;
+
+	return std::make_unique<FRecordedAudioEncoder>(std::move(Encoder), MoveTemp(StreamInfo), RecordingId);
+}
+
+std::unique_ptr<webrtc::AudioEncoder> MakeRecordedEncoder(std::unique_ptr<webrtc::AudioEncoder> Encoder, const webrtc::AudioEncoderMultiChannelOpusConfig& Config, const FString& RecordingId)
+{
+	auto StreamInfo = MakeShared<FOpusStreamInfo, ESPMode::ThreadSafe>();
+	StreamInfo->NumChannels = static_cast<int32>(Config.num_channels);
+	StreamInfo->NumStreams = Config.num_streams;
+	StreamInfo->NumCoupledStreams = Config.coupled_streams;
+	for (const unsigned char Channel : Config.channel_mapping)
+	{
+		StreamInfo->ChannelMapping.Add(Channel);
+	}
+
+	return std::make_unique<FRecordedAudioEncoder>(std::move(Encoder), MoveTemp(StreamInfo), RecordingId);
+}
+
+}
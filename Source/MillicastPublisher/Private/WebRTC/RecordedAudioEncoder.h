@@ -0,0 +1,15 @@
+// Copyright Dolby.io 2023. All Rights Reserved.
+
+#pragma once
+
+#include "EncodedVideoRecorder.h"
+
+namespace Millicast::Publisher
+{
+	/**
+	 * Wraps the encoder to hand the packets it sends to the recording of its publisher, when there is one.
+	 * RecordingId is the one the answer named, see SetRecordingId, the packets of other publishers are never recorded.
+	 */
+	std::unique_ptr<webrtc::AudioEncoder> MakeRecordedEncoder(std::unique_ptr<webrtc::AudioEncoder> Encoder, const webrtc::AudioEncoderOpusConfig& Config, const FString& RecordingId);
+	std::unique_ptr<webrtc::AudioEncoder> MakeRecordedEncoder(std::unique_ptr<webrtc::AudioEncoder> Encoder, const webrtc::AudioEncoderMultiChannelOpusConfig& Config, const FString& RecordingId);
+}
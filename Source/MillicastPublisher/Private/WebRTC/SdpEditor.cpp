@@ -0,0 +1,392 @@
+// Copyright Dolby.io 2023. All Rights Reserved.
+
+#include "SdpEditor.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+
+namespace Millicast::Publisher
+{
+
+namespace
+{
+	const std::string LineBreak = "\r\n";
+
+	bool StartsWith(const std::string& Line, const std::string& Prefix)
+	{
+		return Line.compare(0, Prefix.size(), Prefix) == 0;
+	}
+
+	bool EqualsIgnoreCase(const std::string& A, const std::string& B)
+	{
+		return A.size() == B.size() && std::equal(A.begin(), A.end(), B.begin(), [](char a, char b) { return std::tolower(a) == std::tolower(b); });
+	}
+
+	std::string Trim(const std::string& Value)
+	{
+		const size_t First = Value.find_first_not_of(' ');
+		const size_t Last = Value.find_last_not_of(' ');
+		return First == std::string::npos ? std::string() : Value.substr(First, Last - First + 1);
+	}
+
+	/** Whether an extmap line or value, "<id>[/<direction>] <uri>[ <attributes>]", is the extension of this URI */
+	bool IsExtension(const std::string& Extmap, const std::string& Uri)
+	{
+		const size_t Space = Extmap.find(' ');
+		return Space != std::string::npos && Extmap.compare(Space + 1, Extmap.find(' ', Space + 1) - Space - 1, Uri) == 0;
+	}
+}
+
+FSdpEditor::FSdpEditor(const std::string& InSdp)
+{
+	for (size_t Start = 0; Start < InSdp.size();)
+	{
+		size_t End = InSdp.find(LineBreak, Start);
+		if (End == std::string::npos)
+		{
+			End = InSdp.size();
+		}
+
+		if (InSdp.compare(Start, 2, "m=") == 0)
+		{
+			Sections.Add(Lines.Num());
+		}
+
+		Lines.Add(InSdp.substr(Start, End - Start));
+		Start = End + LineBreak.size();
+	}
+}
+
+std::string FSdpEditor::ToString() const
+{
+	std::string Sdp;
+	for (const std::string& Line : Lines)
+	{
+		Sdp += Line + LineBreak;
+	}
+
+	return Sdp;
+}
+
+TOptional<FSdpEditor::FCodec> FSdpEditor::FindCodec(const std::string& Media, const std::string& Name) const
+{
+	static const std::string Rtpmap = "a=rtpmap:";
+
+	for (int32 Section = 0; Section < Sections.Num(); ++Section)
+	{
+		if (!StartsWith(Lines[Sections[Section]], "m=" + Media + " "))
+		{
+			continue;
+		}
+
+		const int32 End = GetSectionEnd(Section);
+		for (int32 i = Sections[Section]; i < End; ++i)
+		{
+			// a=rtpmap:<payload type> <name>/<clock rate>[/<channels>]
+			const std::string& Line = Lines[i];
+			const size_t Space = Line.find(' ');
+			if (!StartsWith(Line, Rtpmap) || Space == std::string::npos)
+			{
+				continue;
+			}
+
+			if (EqualsIgnoreCase(Line.substr(Space + 1, Line.find('/', Space) - Space - 1), Name))
+			{
+				return FCodec{ Section, Line.substr(Rtpmap.size(), Space - Rtpmap.size()) };
+			}
+		}
+
+		return {};
+	}
+
+	return {};
+}
+
+TArray<FSdpEditor::FCodec> FSdpEditor::FindCodecs(const std::string& Media, const std::string& Name) const
+{
+	static const std::string Rtpmap = "a=rtpmap:";
+
+	TArray<FCodec> Codecs;
+	for (int32 Section = 0; Section < Sections.Num(); ++Section)
+	{
+		if (!StartsWith(Lines[Sections[Section]], "m=" + Media + " "))
+		{
+			continue;
+		}
+
+		const int32 End = GetSectionEnd(Section);
+		for (int32 i = Sections[Section]; i < End; ++i)
+		{
+			const std::string& Line = Lines[i];
+			const size_t Space = Line.find(' ');
+			if (StartsWith(Line, Rtpmap) && Space != std::string::npos
+				&& EqualsIgnoreCase(Line.substr(Space + 1, Line.find('/', Space) - Space - 1), Name))
+			{
+				Codecs.Add(FCodec{ Section, Line.substr(Rtpmap.size(), Space - Rtpmap.size()) });
+			}
+		}
+	}
+
+	return Codecs;
+}
+
+void FSdpEditor::SetEncoding(const FCodec& Codec, const std::string& Encoding)
+{
+	const std::string Prefix = "a=rtpmap:" + Codec.PayloadType + " ";
+
+	const int32 Line = FindLine(Codec, Prefix);
+	if (Line != INDEX_NONE)
+	{
+		Lines[Line] = Prefix + Encoding;
+	}
+}
+
+void FSdpEditor::SetParameter(const FCodec& Codec, const std::string& Name, const std::string& Value)
+{
+	TArray<FParameter> Parameters = GetParameters(Codec);
+
+	FParameter* Parameter = Parameters.FindByPredicate([&Name](const FParameter& p) { return EqualsIgnoreCase(p.Key, Name); });
+	if (Parameter)
+	{
+		Parameter->Value = Value;
+	}
+	else
+	{
+		Parameters.Emplace(Name, Value);
+	}
+
+	SetParameters(Codec, Parameters);
+}
+
+void FSdpEditor::RemoveParameter(const FCodec& Codec, const std::string& Name)
+{
+	TArray<FParameter> Parameters = GetParameters(Codec);
+	if (Parameters.RemoveAll([&Name](const FParameter& p) { return EqualsIgnoreCase(p.Key, Name); }) > 0)
+	{
+		SetParameters(Codec, Parameters);
+	}
+}
+
+std::string FSdpEditor::GetMedia(int32 Section) const
+{
+	// m=<media> <port> <proto> <fmt> ...
+	const std::string& Line = Lines[Sections[Section]];
+	return Line.substr(2, Line.find(' ') - 2);
+}
+
+TArray<std::string> FSdpEditor::GetAttributes(int32 Section, const std::string& Name) const
+{
+	TArray<std::string> Values;
+
+	const std::string Prefix = "a=" + Name + ":";
+	for (int32 i = Sections[Section]; i < GetSectionEnd(Section); ++i)
+	{
+		if (StartsWith(Lines[i], Prefix))
+		{
+			Values.Add(Lines[i].substr(Prefix.size()));
+		}
+	}
+
+	return Values;
+}
+
+void FSdpEditor::AddAttribute(int32 Section, const std::string& Name, const std::string& Value)
+{
+	const std::string Attribute = "a=" + Name;
+	const int32 End = GetSectionEnd(Section);
+
+	int32 Line = End;
+	for (int32 i = End - 1; i > Sections[Section]; --i)
+	{
+		if (Lines[i] == Attribute || StartsWith(Lines[i], Attribute + ":"))
+		{
+			Line = i + 1;
+			break;
+		}
+	}
+
+	Lines.Insert(Value.empty() ? Attribute : Attribute + ":" + Value, Line);
+	ShiftSections(Section, 1);
+}
+
+int32 FSdpEditor::AddHeaderExtension(const std::string& Uri, const TArray<std::string>& Media)
+{
+	static const std::string Extmap = "a=extmap:";
+
+	// a=extmap:<id>[/<direction>] <uri>[ <attributes>], in any section or at the session level
+	TSet<int32> UsedIds;
+	int32 ExistingId = INDEX_NONE;
+	bool bSessionLevel = false;
+	for (int32 i = 0; i < Lines.Num(); ++i)
+	{
+		const std::string& Line = Lines[i];
+		if (!StartsWith(Line, Extmap))
+		{
+			continue;
+		}
+
+		const int32 Id = std::atoi(Line.c_str() + Extmap.size());
+		if (IsExtension(Line, Uri))
+		{
+			ExistingId = Id;
+			bSessionLevel |= Sections.Num() == 0 || i < Sections[0];
+		}
+
+		UsedIds.Add(Id);
+	}
+
+	// Every section has it already
+	if (bSessionLevel)
+	{
+		return ExistingId;
+	}
+
+	// The sections that offer it already keep their id, the others use the same one so that bundled sections agree
+	int32 Id = ExistingId;
+	if (Id == INDEX_NONE)
+	{
+		Id = 1;
+		while (UsedIds.Contains(Id))
+		{
+			++Id;
+		}
+
+		// Beyond 14 the extension would need the two bytes header
+		if (Id > 14)
+		{
+			return INDEX_NONE;
+		}
+	}
+
+	for (int32 Section = 0; Section < Sections.Num(); ++Section)
+	{
+		if (!Media.Contains(GetMedia(Section)))
+		{
+			continue;
+		}
+
+		const TArray<std::string> Extensions = GetAttributes(Section, "extmap");
+		const bool bOffered = Extensions.ContainsByPredicate([&Uri](const std::string& Extension) { return IsExtension(Extension, Uri); });
+
+		if (Extensions.Num() > 0 && !bOffered)
+		{
+			AddAttribute(Section, "extmap", std::to_string(Id) + " " + Uri);
+		}
+	}
+
+	return Id;
+}
+
+int32 FSdpEditor::GetSectionEnd(int32 Section) const
+{
+	return Section + 1 < Sections.Num() ? Sections[Section + 1] : Lines.Num();
+}
+
+int32 FSdpEditor::FindLine(const FCodec& Codec, const std::string& Prefix) const
+{
+	if (!Sections.IsValidIndex(Codec.Section))
+	{
+		return INDEX_NONE;
+	}
+
+	const int32 End = GetSectionEnd(Codec.Section);
+	for (int32 i = Sections[Codec.Section]; i < End; ++i)
+	{
+		if (StartsWith(Lines[i], Prefix))
+		{
+			return i;
+		}
+	}
+
+	return INDEX_NONE;
+}
+
+TArray<FSdpEditor::FParameter> FSdpEditor::GetParameters(const FCodec& Codec) const
+{
+	TArray<FParameter> Parameters;
+
+	const std::string Prefix = "a=fmtp:" + Codec.PayloadType + " ";
+	const int32 Line = FindLine(Codec, Prefix);
+	if (Line == INDEX_NONE)
+	{
+		return Parameters;
+	}
+
+	// name=value pairs separated by semicolons, a parameter may have no value
+	const std::string& Fmtp = Lines[Line];
+	for (size_t Start = Prefix.size(); Start < Fmtp.size();)
+	{
+		size_t End = Fmtp.find(';', Start);
+		if (End == std::string::npos)
+		{
+			End = Fmtp.size();
+		}
+
+		const std::string Parameter = Trim(Fmtp.substr(Start, End - Start));
+		if (!Parameter.empty())
+		{
+			const size_t Equal = Parameter.find('=');
+			if (Equal == std::string::npos)
+			{
+				Parameters.Emplace(Parameter, std::string());
+			}
+			else
+			{
+				Parameters.Emplace(Trim(Parameter.substr(0, Equal)), Trim(Parameter.substr(Equal + 1)));
+			}
+		}
+
+		Start = End + 1;
+	}
+
+	return Parameters;
+}
+
+void FSdpEditor::SetParameters(const FCodec& Codec, const TArray<FParameter>& Parameters)
+{
+	const std::string Prefix = "a=fmtp:" + Codec.PayloadType + " ";
+
+	std::string Fmtp = Prefix;
+	for (int32 i = 0; i < Parameters.Num(); ++i)
+	{
+		Fmtp += (i > 0 ? ";" : "") + Parameters[i].Key + (Parameters[i].Value.empty() ? "" : "=" + Parameters[i].Value);
+	}
+
+	int32 Line = FindLine(Codec, Prefix);
+	if (Line != INDEX_NONE)
+	{
+		// A codec left without parameters has no fmtp line
+		if (Parameters.Num() == 0)
+		{
+			Lines.RemoveAt(Line);
+			ShiftSections(Codec.Section, -1);
+		}
+		else
+		{
+			Lines[Line] = Fmtp;
+		}
+
+		return;
+	}
+
+	// A codec without parameters gets its fmtp line right after its rtpmap line
+	Line = FindLine(Codec, "a=rtpmap:" + Codec.PayloadType + " ");
+	if (Line == INDEX_NONE || Parameters.Num() == 0)
+	{
+		return;
+	}
+
+	Lines.Insert(Fmtp, Line + 1);
+	ShiftSections(Codec.Section, 1);
+}
+
+void FSdpEditor::ShiftSections(int32 EditedSection, int32 NumLines)
+{
+	for (int32 Section = EditedSection + 1; Section < Sections.Num(); ++Section)
+	{
+		Sections[Section] += NumLines;
+	}
+}
+
+}
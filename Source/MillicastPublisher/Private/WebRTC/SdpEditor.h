@@ -0,0 +1,76 @@
+// Copyright Dolby.io 2023. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include <string>
+
+namespace Millicast::Publisher
+{
+	/*
+	 * Edits the codecs and attributes of a session description line by line rather than by searching its text.
+	 * A codec is found by name in a media section, its rtpmap and fmtp lines are edited in place and the fmtp parameters
+	 * keep their order, so an edited description only differs where it was edited.
+	 */
+	class FSdpEditor
+	{
+	public:
+		struct FCodec
+		{
+			int32 Section = INDEX_NONE;
+			std::string PayloadType;
+		};
+
+		explicit FSdpEditor(const std::string& InSdp);
+
+		std::string ToString() const;
+
+		/** First codec of this name in the first section of this kind, e.g. ("audio", "opus"). The name is case insensitive. */
+		TOptional<FCodec> FindCodec(const std::string& Media, const std::string& Name) const;
+
+		/** Every codec of this name in the sections of this kind, H264 has one per profile */
+		TArray<FCodec> FindCodecs(const std::string& Media, const std::string& Name) const;
+
+		/** Changes the encoding of the rtpmap line, e.g. "multiopus/48000/6" */
+		void SetEncoding(const FCodec& Codec, const std::string& Encoding);
+
+		/** Sets a parameter of the fmtp line, the line is added if the codec has none */
+		void SetParameter(const FCodec& Codec, const std::string& Name, const std::string& Value);
+		void RemoveParameter(const FCodec& Codec, const std::string& Name);
+
+		int32 GetNumSections() const { return Sections.Num(); }
+
+		/** Media of a section, e.g. "audio" */
+		std::string GetMedia(int32 Section) const;
+
+		/** Values of the attributes of this name in a section, e.g. "3 urn:ietf:params:rtp-hdrext:sdes:mid" for "a=extmap:3 urn:ietf:params:rtp-hdrext:sdes:mid" */
+		TArray<std::string> GetAttributes(int32 Section, const std::string& Name) const;
+
+		/** Adds an attribute to a section, after the last one of the same name or at the end of the section */
+		void AddAttribute(int32 Section, const std::string& Name, const std::string& Value);
+
+		/**
+		 * Offers an RTP header extension in the sections of these media that already offer extensions and not this one.
+		 * Bundled sections must use the same id: the one the extension already has in another section, or else the first id
+		 * no other extension uses. The id of the extension, INDEX_NONE if none is left.
+		 */
+		int32 AddHeaderExtension(const std::string& Uri, const TArray<std::string>& Media);
+
+	private:
+		using FParameter = TPair<std::string, std::string>;
+
+		/** Line after the last one of a section */
+		int32 GetSectionEnd(int32 Section) const;
+
+		int32 FindLine(const FCodec& Codec, const std::string& Prefix) const;
+		TArray<FParameter> GetParameters(const FCodec& Codec) const;
+		void SetParameters(const FCodec& Codec, const TArray<FParameter>& Parameters);
+
+		/** Moves the sections after an edited one by the lines added or removed */
+		void ShiftSections(int32 EditedSection, int32 NumLines);
+
+		TArray<std::string> Lines;
+		TArray<int32> Sections; // First line of each media section
+	};
+}
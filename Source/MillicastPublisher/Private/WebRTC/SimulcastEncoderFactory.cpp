@@ -4,6 +4,10 @@
 
 #include "MillicastVideoEncoderFactory.h"
 #include "SimulcastVideoEncoder.h"
+#include "MillicastPublisherPrivate.h"
+#include "Util.h"
+
+#include "Async/Async.h"
 
 namespace Millicast::Publisher
 {
@@ -39,4 +43,306 @@ FMillicastVideoEncoderFactory* FSimulcastEncoderFactory::GetEncoderFactory(int S
 	return EncoderFactories[StreamIndex].Get();
 }
 
+webrtc::VideoCodec CreateWarmCodec(webrtc::VideoCodecType CodecType, int32 Width, int32 Height, int32 MinBitrateBps, int32 MaxBitrateBps, int32 MaxFramerate, webrtc::VideoCodecMode Mode,
+	int32 NumTemporalLayers)
+{
+	// Mirror what webrtc computes for a single stream. Only the layout of the stream has to match what webrtc asks for
+	// (see IsCompatibleCodec), the rates are applied when the encoder is handed out.
+	webrtc::VideoCodec Codec;
+	Codec.codecType = CodecType;
+	Codec.width = Width;
+	Codec.height = Height;
+	Codec.maxBitrate = MaxBitrateBps / 1000;
+	Codec.startBitrate = Codec.maxBitrate / 2;
+	Codec.minBitrate = MinBitrateBps > 0 ? MinBitrateBps / 1000 : 30; // kDefaultMinVideoBitrateBps of the webrtc video engine
+	Codec.maxFramerate = MaxFramerate;
+	Codec.qpMax = 56; // kDefaultQpMax of the webrtc video engine
+	Codec.numberOfSimulcastStreams = 0;
+	Codec.active = true;
+	Codec.mode = Mode;
+
+	switch (CodecType)
+	{
+	case webrtc::kVideoCodecVP8:
+		*Codec.VP8() = webrtc::VideoEncoder::GetDefaultVp8Settings();
+		Codec.VP8()->numberOfTemporalLayers = NumTemporalLayers;
+		break;
+	case webrtc::kVideoCodecVP9:
+		*Codec.VP9() = webrtc::VideoEncoder::GetDefaultVp9Settings();
+		break;
+	case webrtc::kVideoCodecH264:
+		*Codec.H264() = webrtc::VideoEncoder::GetDefaultH264Settings();
+		Codec.H264()->numberOfTemporalLayers = NumTemporalLayers;
+		break;
+	default:
+		break;
+	}
+
+	return Codec;
+}
+
+/*
+ * Whether an encoder initialized with A can encode what webrtc asks for with B: the settings the encoders only read in
+ * InitEncode, that is the codec, the resolution, the content mode and the layers. webrtc fills the rest differently
+ * from one version or field trial to the next (texture input, timing frames, denoising, qp), and the rates are changed
+ * with SetRates anyway.
+ */
+bool IsCompatibleCodec(const webrtc::VideoCodec& A, const webrtc::VideoCodec& B)
+{
+	// A single stream is described either way, by webrtc with one simulcast stream and by the adapter for each layer without
+	const int NumStreamsA = A.numberOfSimulcastStreams > 1 ? A.numberOfSimulcastStreams : 0;
+	const int NumStreamsB = B.numberOfSimulcastStreams > 1 ? B.numberOfSimulcastStreams : 0;
+
+	if (A.codecType != B.codecType || A.width != B.width || A.height != B.height || A.mode != B.mode || NumStreamsA != NumStreamsB)
+	{
+		return false;
+	}
+
+	for (int i = 0; i < NumStreamsA; ++i)
+	{
+		const webrtc::SimulcastStream& StreamA = A.simulcastStream[i];
+		const webrtc::SimulcastStream& StreamB = B.simulcastStream[i];
+		if (StreamA.width != StreamB.width || StreamA.height != StreamB.height || StreamA.numberOfTemporalLayers != StreamB.numberOfTemporalLayers)
+		{
+			return false;
+		}
+	}
+
+	switch (A.codecType)
+	{
+	case webrtc::kVideoCodecVP8:
+		return A.VP8().numberOfTemporalLayers == B.VP8().numberOfTemporalLayers;
+	case webrtc::kVideoCodecVP9:
+		return A.VP9().numberOfTemporalLayers == B.VP9().numberOfTemporalLayers
+			&& A.VP9().numberOfSpatialLayers == B.VP9().numberOfSpatialLayers
+			&& A.VP9().flexibleMode == B.VP9().flexibleMode;
+	case webrtc::kVideoCodecH264:
+		return A.H264().numberOfTemporalLayers == B.H264().numberOfTemporalLayers;
+	default:
+		return false;
+	}
+}
+
+// The core count only sizes the thread pool of the software encoders, the payload size only matters to H264 in single
+// NAL unit mode which we don't negotiate
+bool IsCompatibleSettings(const webrtc::VideoEncoder::Settings& A, const webrtc::VideoEncoder::Settings& B)
+{
+	return A.capabilities.loss_notification == B.capabilities.loss_notification;
+}
+
+std::unique_ptr<webrtc::VideoEncoder> FWarmEncoderPool::Acquire(int StreamIndex, const webrtc::VideoCodec& Codec, const webrtc::VideoEncoder::Settings& Settings, EMillicastVideoEncoderPreset Preset)
+{
+	std::unique_ptr<webrtc::VideoEncoder> Encoder;
+	{
+		FScopeLock Lock(&Guard);
+
+		const auto It = std::find_if(Encoders.begin(), Encoders.end(), [&](const FWarmEncoder& WarmEncoder) {
+			return WarmEncoder.StreamIndex == StreamIndex && WarmEncoder.Preset == Preset
+				&& IsCompatibleCodec(WarmEncoder.Codec, Codec) && IsCompatibleSettings(WarmEncoder.Settings, Settings);
+		});
+
+		if (It == Encoders.end())
+		{
+			return nullptr;
+		}
+
+		Encoder = std::move(It->Encoder);
+		Encoders.erase(It);
+	}
+
+	// Start at the rates webrtc asked for, until it sets its own allocation
+	webrtc::VideoBitrateAllocation Allocation;
+	Allocation.SetBitrate(0, 0, Codec.startBitrate * 1000);
+	Encoder->SetRates(webrtc::VideoEncoder::RateControlParameters(Allocation, Codec.maxFramerate));
+
+	return Encoder;
+}
+
+int32 FWarmEncoderPool::GetNumEncoders() const
+{
+	FScopeLock Lock(&Guard);
+	return static_cast<int32>(Encoders.size());
+}
+
+TSharedPtr<FWarmEncoderPool, ESPMode::ThreadSafe> FSimulcastEncoderFactory::WarmUp(const FString& CodecName, int32 Width, int32 Height, const TArray<FMillicastSimulcastLayer>& Layers,
+	int32 MinBitrateBps, int32 MaxBitrateBps, int32 MaxFramerate, bool bScreencast)
+{
+	const webrtc::VideoCodecType CodecType = webrtc::PayloadStringToCodecType(TCHAR_TO_UTF8(*CodecName.ToUpper()));
+
+	// Take the parameters (e.g. H264 profile) of the first format we support for this codec
+	const std::vector<webrtc::SdpVideoFormat> Formats = GetSupportedFormats();
+	const auto FormatIt = std::find_if(Formats.begin(), Formats.end(), [CodecType](const webrtc::SdpVideoFormat& Format) {
+		return webrtc::PayloadStringToCodecType(Format.name) == CodecType;
+	});
+
+	if (FormatIt == Formats.end() || Width <= 0 || Height <= 0)
+	{
+		return nullptr;
+	}
+
+	const webrtc::VideoCodecMode Mode = bScreencast ? webrtc::VideoCodecMode::kScreensharing : webrtc::VideoCodecMode::kRealtimeVideo;
+
+	// Temporal layers webrtc gives each simulcast stream of VP8 and H264 (DefaultNumberOfTemporalLayers of its simulcast config)
+	const int32 NumSimulcastTemporalLayers = bScreencast ? 2 : 3;
+
+	// One codec per stream, the full ladder when doing simulcast
+	TArray<webrtc::VideoCodec> StreamCodecs;
+	if (Layers.Num() > 1)
+	{
+		for (int i = 0; i < FMath::Min(Layers.Num(), static_cast<int32>(webrtc::kMaxSimulcastStreams)); ++i)
+		{
+			const FMillicastSimulcastLayer& Layer = Layers[i];
+			const float Scale = FMath::Max(Layer.ScaleResolutionDownBy, 1.f);
+			const int32 LayerBitrate = Layer.MaxBitrate > 0 ? Layer.MaxBitrate : static_cast<int32>(MaxBitrateBps / Scale);
+			const int32 LayerFramerate = Layer.MaxFramerate > 0 ? FMath::Min(Layer.MaxFramerate, MaxFramerate) : MaxFramerate;
+
+			StreamCodecs.Add(CreateWarmCodec(CodecType, static_cast<int32>(Width / Scale), static_cast<int32>(Height / Scale), 0, LayerBitrate, LayerFramerate, Mode, NumSimulcastTemporalLayers));
+		}
+	}
+	else
+	{
+		StreamCodecs.Add(CreateWarmCodec(CodecType, Width, Height, MinBitrateBps, MaxBitrateBps, MaxFramerate, Mode, 1));
+	}
+
+	auto Pool = MakeShared<FWarmEncoderPool, ESPMode::ThreadSafe>();
+	{
+		FScopeLock Lock(&WarmPoolsGuard);
+		WarmPools.RemoveAll([](const auto& WarmPool) { return !WarmPool.IsValid(); });
+		WarmPools.Add(Pool);
+	}
+
+	const webrtc::SdpVideoFormat Format = *FormatIt;
+	const EMillicastVideoEncoderPreset Preset = GetEncoderFactory(0)->GetEncoderPreset();
+	TWeakPtr<FWarmEncoderPool, ESPMode::ThreadSafe> WeakPool = Pool;
+
+	// libvpx allocates its buffers in InitEncode which can take a few frames worth of time at high resolution.
+	// The task only holds the pool weakly, it stops when the publisher lets go of it.
+	AsyncTask(ENamedThreads::AnyBackgroundThreadNormalTask, [WeakPool, Format, StreamCodecs, Preset]() {
+		FMillicastVideoEncoderFactory EncoderFactory;
+		EncoderFactory.SetEncoderPreset(Preset);
+
+		const webrtc::VideoEncoder::Settings Settings(webrtc::VideoEncoder::Capabilities(false), FPlatformMisc::NumberOfCoresIncludingHyperthreads(), 1200);
+		std::vector<FWarmEncoderPool::FWarmEncoder> NewEncoders;
+
+		for (int StreamIndex = 0; StreamIndex < StreamCodecs.Num() && WeakPool.IsValid(); ++StreamIndex)
+		{
+			std::unique_ptr<webrtc::VideoEncoder> Encoder = EncoderFactory.CreateVideoEncoder(Format);
+			if (Encoder && Encoder->InitEncode(&StreamCodecs[StreamIndex], Settings) == WEBRTC_VIDEO_CODEC_OK)
+			{
+				NewEncoders.push_back({ StreamIndex, StreamCodecs[StreamIndex], Settings, Preset, std::move(Encoder) });
+			}
+		}
+
+		if (TSharedPtr<FWarmEncoderPool, ESPMode::ThreadSafe> Pool = WeakPool.Pin())
+		{
+			FScopeLock Lock(&Pool->Guard);
+			Pool->Encoders = std::move(NewEncoders);
+			UE_LOG(LogMillicastPublisher, Log, TEXT("Warmed up %d %s encoder(s)"), static_cast<int32>(Pool->Encoders.size()), *ToString(Format.name));
+		}
+	});
+
+	return Pool;
+}
+
+void FSimulcastEncoderFactory::SetEncoderPreset(EMillicastVideoEncoderPreset InPreset)
+{
+	for (auto& EncoderFactory : EncoderFactories)
+	{
+		EncoderFactory->SetEncoderPreset(InPreset);
+	}
+}
+
+void FSimulcastEncoderFactory::StartRecording(const FString& RecordingId, const FString& Path, int32 StreamIndex)
+{
+	StopRecording(RecordingId);
+
+	auto NewRecorder = MakeShared<FEncodedVideoRecorder, ESPMode::ThreadSafe>(Path, StreamIndex);
+
+	FScopeLock Lock(&RecorderGuard);
+	Recorders.Add(RecordingId, MoveTemp(NewRecorder));
+}
+
+void FSimulcastEncoderFactory::StopRecording(const FString& RecordingId)
+{
+	TSharedPtr<FEncodedVideoRecorder, ESPMode::ThreadSafe> StoppedRecorder;
+	{
+		FScopeLock Lock(&RecorderGuard);
+		Recorders.RemoveAndCopyValue(RecordingId, StoppedRecorder);
+	}
+
+	// Close the file here rather than on the encoder thread which may release the last reference
+	if (StoppedRecorder)
+	{
+		StoppedRecorder->Finish();
+	}
+}
+
+TSharedPtr<FEncodedVideoRecorder, ESPMode::ThreadSafe> FSimulcastEncoderFactory::GetRecorder(const FString& RecordingId) const
+{
+	if (RecordingId.IsEmpty())
+	{
+		return nullptr;
+	}
+
+	FScopeLock Lock(&RecorderGuard);
+	const TSharedPtr<FEncodedVideoRecorder, ESPMode::ThreadSafe>* Recorder = Recorders.Find(RecordingId);
+	return Recorder ? *Recorder : nullptr;
+}
+
+void FSimulcastEncoderFactory::NotifyNextFrameSent(const FString& RecordingId, TFunction<void(uint64 SentCycles)> Callback)
+{
+	FScopeLock Lock(&FrameSentGuard);
+	if (Callback)
+	{
+		FrameSentCallbacks.Add(RecordingId, MoveTemp(Callback));
+	}
+	else
+	{
+		FrameSentCallbacks.Remove(RecordingId);
+	}
+	bHasFrameSentCallbacks = FrameSentCallbacks.Num() > 0;
+}
+
+void FSimulcastEncoderFactory::OnFrameSent(const FString& RecordingId)
+{
+	if (!bHasFrameSentCallbacks || RecordingId.IsEmpty())
+	{
+		return;
+	}
+
+	const uint64 SentCycles = FPlatformTime::Cycles64();
+
+	TFunction<void(uint64)> Callback;
+	{
+		FScopeLock Lock(&FrameSentGuard);
+		if (!FrameSentCallbacks.RemoveAndCopyValue(RecordingId, Callback))
+		{
+			return;
+		}
+		bHasFrameSentCallbacks = FrameSentCallbacks.Num() > 0;
+	}
+
+	Callback(SentCycles);
+}
+
+std::unique_ptr<webrtc::VideoEncoder> FSimulcastEncoderFactory::AcquireWarmEncoder(int StreamIndex, const webrtc::VideoCodec& Codec, const webrtc::VideoEncoder::Settings& Settings)
+{
+	const EMillicastVideoEncoderPreset Preset = GetEncoderFactory(StreamIndex)->GetEncoderPreset();
+
+	FScopeLock Lock(&WarmPoolsGuard);
+
+	for (const TWeakPtr<FWarmEncoderPool, ESPMode::ThreadSafe>& WeakPool : WarmPools)
+	{
+		if (TSharedPtr<FWarmEncoderPool, ESPMode::ThreadSafe> Pool = WeakPool.Pin())
+		{
+			if (std::unique_ptr<webrtc::VideoEncoder> Encoder = Pool->Acquire(StreamIndex, Codec, Settings, Preset))
+			{
+				return Encoder;
+			}
+		}
+	}
+
+	return nullptr;
+}
+
 }
@@ -3,11 +3,46 @@
 #pragma once
 
 #include "WebRTCInc.h"
+#include "MillicastSimulcastLayer.h"
+#include "RtcCodecsConstants.h"
+#include "EncodedVideoRecorder.h"
 
 namespace Millicast::Publisher
 {
 	class FMillicastVideoEncoderFactory;
 
+	/*
+	 * Encoders warmed up for one publisher. They are initialized in the background and dropped with the pool, so a
+	 * publisher only ever replaces or clears its own warm encoders.
+	 */
+	class FWarmEncoderPool
+	{
+	public:
+		/**
+		 * An encoder initialized for the same codec, resolution, content mode and layers, null if there is none.
+		 * It is set to the start bitrate and max framerate of Codec.
+		 */
+		std::unique_ptr<webrtc::VideoEncoder> Acquire(int StreamIndex, const webrtc::VideoCodec& Codec, const webrtc::VideoEncoder::Settings& Settings, EMillicastVideoEncoderPreset Preset);
+
+		/** Encoders warmed up and not handed out yet, 0 until the background initialization is done */
+		int32 GetNumEncoders() const;
+
+	private:
+		friend class FSimulcastEncoderFactory;
+
+		struct FWarmEncoder
+		{
+			int StreamIndex;
+			webrtc::VideoCodec Codec;
+			webrtc::VideoEncoder::Settings Settings;
+			EMillicastVideoEncoderPreset Preset;
+			std::unique_ptr<webrtc::VideoEncoder> Encoder;
+		};
+
+		mutable FCriticalSection Guard;
+		std::vector<FWarmEncoder> Encoders;
+	};
+
 	class FSimulcastEncoderFactory : public webrtc::VideoEncoderFactory
 	{
 	public:
@@ -19,8 +54,53 @@ namespace Millicast::Publisher
 
 		FMillicastVideoEncoderFactory* GetEncoderFactory(int StreamIndex);
 
+		/**
+		 * Create and initialize the encoders of each stream in the background, ahead of the SDP negotiation,
+		 * so that the first frame does not pay for the encoder creation.
+		 * Layers is empty when not doing simulcast. bScreencast must match the source so that the encoders are
+		 * initialized in the mode webrtc will ask for.
+		 * The encoders go to the returned pool, the publisher keeps it until the negotiation is done and releases it to
+		 * drop the encoders that were not used. Null if the codec can't be warmed up.
+		 */
+		TSharedPtr<FWarmEncoderPool, ESPMode::ThreadSafe> WarmUp(const FString& CodecName, int32 Width, int32 Height, const TArray<FMillicastSimulcastLayer>& Layers,
+			int32 MinBitrateBps, int32 MaxBitrateBps, int32 MaxFramerate, bool bScreencast);
+
+		/** Preset of the hardware H264 encoders created from now on, including the warmed up ones */
+		void SetEncoderPreset(EMillicastVideoEncoderPreset InPreset);
+
+		/**
+		 * Record the encoded frames of a stream to a file, 0 being the first simulcast layer.
+		 * Only the encoders of the answer named with RecordingId write to it, see SetRecordingId.
+		 * Replaces the recording of the same id if there is one.
+		 */
+		void StartRecording(const FString& RecordingId, const FString& Path, int32 StreamIndex);
+		void StopRecording(const FString& RecordingId);
+		TSharedPtr<FEncodedVideoRecorder, ESPMode::ThreadSafe> GetRecorder(const FString& RecordingId) const;
+
+		/**
+		 * Call back once, on the encoder thread, when an encoder of the answer named with RecordingId has handed its next
+		 * frame to the RTP sender, with the time it did. Replaces the callback of the same id, a null callback removes it.
+		 */
+		void NotifyNextFrameSent(const FString& RecordingId, TFunction<void(uint64 SentCycles)> Callback);
+
+		/** Called by the encoders for every frame they hand to the RTP sender */
+		void OnFrameSent(const FString& RecordingId);
+
+		/** Hand out a warm encoder of a publisher that can encode with these settings, null if there is none */
+		std::unique_ptr<webrtc::VideoEncoder> AcquireWarmEncoder(int StreamIndex, const webrtc::VideoCodec& Codec, const webrtc::VideoEncoder::Settings& Settings);
+
 	private:
 		TArray<TUniquePtr<FMillicastVideoEncoderFactory>> EncoderFactories;
 		TUniquePtr<FMillicastVideoEncoderFactory> VideoEncoderFactory;
+
+		FCriticalSection WarmPoolsGuard;
+		TArray<TWeakPtr<FWarmEncoderPool, ESPMode::ThreadSafe>> WarmPools;
+
+		mutable FCriticalSection RecorderGuard;
+		TMap<FString, TSharedPtr<FEncodedVideoRecorder, ESPMode::ThreadSafe>> Recorders;
+
+		FCriticalSection FrameSentGuard;
+		TMap<FString, TFunction<void(uint64)>> FrameSentCallbacks;
+		TAtomic<bool> bHasFrameSentCallbacks { false }; // Spares the lock to the encoders almost all the time
 	};
 }
@@ -4,7 +4,11 @@
 
 #include "MillicastVideoEncoderFactory.h"
 #include "SimulcastEncoderFactory.h"
+#include "EncodedFrameFanOut.h"
 #include "FrameBufferRHI.h"
+#include "Stats.h"
+
+#include "Misc/ScopeExit.h"
 
 namespace Millicast::Publisher
 {
@@ -85,6 +89,7 @@ FSimulcastVideoEncoder::FSimulcastVideoEncoder(FSimulcastEncoderFactory& InSimul
 	: Initialized(false)
 	, SimulcastEncoderFactory(InSimulcastFactory)
 	, VideoFormat(format)
+	, RecordingId(GetRecordingId(format.parameters))
 	, EncodedCompleteCallback(nullptr)
 {
 	memset(&CurrentCodec, 0, sizeof(webrtc::VideoCodec));
@@ -111,6 +116,11 @@ int FSimulcastVideoEncoder::Release()
 		}
 	}
 
+	{
+		FScopeLock Lock(&FanOutGuard);
+		FanOut = nullptr;
+	}
+
 	Initialized = false;
 
 	return WEBRTC_VIDEO_CODEC_OK;
@@ -123,6 +133,11 @@ int FSimulcastVideoEncoder::InitEncode(const webrtc::VideoCodec* codec_settings,
 
 	CurrentCodec = *codec_settings;
 
+	KeyFrameGovernor.Reset();
+
+	LastRateParameters.Reset();
+	FanOutBitrateCapBps = 0;
+
 	// clang-format off
 	const webrtc::SdpVideoFormat Format(CurrentCodec.codecType == webrtc::kVideoCodecVP8 ? "VP8"
 		: CurrentCodec.codecType == webrtc::kVideoCodecVP9 ? "VP9"
@@ -134,10 +149,8 @@ int FSimulcastVideoEncoder::InitEncode(const webrtc::VideoCodec* codec_settings,
 	{
 		// with one stream we just proxy the pixelstreaming encoder
 		const int LastStreamIndex = 0; //  UE::PixelStreaming::Settings::SimulcastParameters.Layers.Num() - 1; // Last stream is highest res.
-		FMillicastVideoEncoderFactory* EncoderFactory = SimulcastEncoderFactory.GetEncoderFactory(LastStreamIndex);
-		std::unique_ptr<VideoEncoder> Encoder = EncoderFactory->CreateVideoEncoder(Format);
-
-		int ReturnCode = Encoder->InitEncode(&CurrentCodec, settings);
+		int ReturnCode = WEBRTC_VIDEO_CODEC_OK;
+		std::unique_ptr<VideoEncoder> Encoder = CreateStreamEncoder(LastStreamIndex, Format, CurrentCodec, settings, ReturnCode);
 		if (ReturnCode < 0)
 		{
 			// Explicitly destroy the current encoder; because we haven't registered
@@ -162,10 +175,8 @@ int FSimulcastVideoEncoder::InitEncode(const webrtc::VideoCodec* codec_settings,
 			uint32_t StartBitrateKbps = CurrentCodec.simulcastStream[i].targetBitrate;
 			PopulateStreamCodec(CurrentCodec, i, StartBitrateKbps, &StreamCodec);
 
-			FMillicastVideoEncoderFactory* EncoderFactory = SimulcastEncoderFactory.GetEncoderFactory(i);
-			std::unique_ptr<VideoEncoder> Encoder = EncoderFactory->CreateVideoEncoder(Format);
-
-			int ReturnCode = Encoder->InitEncode(&StreamCodec, settings);
+			int ReturnCode = WEBRTC_VIDEO_CODEC_OK;
+			std::unique_ptr<VideoEncoder> Encoder = CreateStreamEncoder(i, Format, StreamCodec, settings, ReturnCode);
 			if (ReturnCode < 0)
 			{
 				// Explicitly destroy the current encoder; because we haven't registered
@@ -201,26 +212,51 @@ int FSimulcastVideoEncoder::Encode(const webrtc::VideoFrame& input_image, const
 		return WEBRTC_VIDEO_CODEC_UNINITIALIZED;
 	}
 
-	// All active streams should generate a key frame if
-	// a key frame is requested by any stream.
-	bool bSendKeyFrame = false;
+	const int64 NowMs = rtc::TimeMillis();
+
+	// Frames of the sources of the plugin, null for I420 frames webrtc may send (e.g. black frames when muted)
+	auto* FrameBuffer = input_image.video_frame_buffer()->GetI420() ? nullptr : static_cast<FSimulcastFrameBuffer*>(input_image.video_frame_buffer().get());
+
+	// Key frames follow the settings of the publisher of the source
+	if (FrameBuffer && FrameBuffer->GetKeyFrameSettings())
+	{
+		KeyFrameGovernor.SetSettings(*FrameBuffer->GetKeyFrameSettings());
+	}
+
+	// Key frames requested by webrtc (PLI/FIR) go through the governor which merges bursts of requests.
+	// There is one frame type per stream when simulcasting, otherwise a request applies to every stream.
+	// They are a single request for the frame, whatever the number of streams it refreshes.
 	if (frame_types)
 	{
+		const bool bPerStream = frame_types->size() == StreamInfos.size();
+		uint32 RequestedStreams = 0;
+
 		for (size_t i = 0; i < frame_types->size(); ++i)
 		{
 			if (frame_types->at(i) == webrtc::VideoFrameType::kVideoFrameKey)
 			{
-				bSendKeyFrame = true;
-				break;
+				RequestedStreams |= bPerStream ? (1u << i) : (1u << StreamInfos.size()) - 1;
 			}
 		}
+
+		KeyFrameGovernor.OnKeyFrameRequestedForStreams(RequestedStreams);
+	}
+
+	// The recording starts, or resumes after dropping frames, with a key frame
+	const auto Recorder = SimulcastEncoderFactory.GetRecorder(RecordingId);
+	if (Recorder && Recorder->ConsumeKeyFrameRequest())
+	{
+		KeyFrameGovernor.OnKeyFrameRequested(Recorder->GetStreamIndex());
 	}
 
+	// A stream that just started must begin with a key frame whatever the governor says,
+	// and unless refreshing layers independently, all active streams generate one with it.
+	bool bForceKeyFrame = false;
 	for (size_t StreamIdx = 0; StreamIdx < StreamInfos.size(); ++StreamIdx)
 	{
 		if (StreamInfos[StreamIdx].KeyFrameRequest && StreamInfos[StreamIdx].bSendStream)
 		{
-			bSendKeyFrame = true;
+			bForceKeyFrame = !KeyFrameGovernor.IsPerLayer();
 			break;
 		}
 	}
@@ -230,17 +266,36 @@ int FSimulcastVideoEncoder::Encode(const webrtc::VideoFrame& input_image, const
 		return WEBRTC_VIDEO_CODEC_OK;
 	}
 
-	auto* FrameBuffer = static_cast<FSimulcastFrameBuffer*>(input_image.video_frame_buffer().get());
 	if (!FrameBuffer)
 	{
 		return WEBRTC_VIDEO_CODEC_ENCODER_FAILURE;
 	}
 
+	// The frame waited too long in the input queue of the source, a newer one is coming
+	if (!FrameBuffer->DequeueInput())
+	{
+		return WEBRTC_VIDEO_CODEC_OK;
+	}
+
+	UpdateFanOut(FrameBuffer->GetFanOut());
+
+	if (rtc::scoped_refptr<FEncodedFrameBuffer> EncodedFrame = FrameBuffer->GetEncodedFrame())
+	{
+		return EncodePassthrough(input_image, EncodedFrame, NowMs, bForceKeyFrame);
+	}
+
+	BeginFrameSubmission(input_image.timestamp(), FrameBuffer->GetAdaptationController());
+	ON_SCOPE_EXIT
+	{
+		EndFrameSubmission(input_image.timestamp());
+	};
+
 	for (size_t StreamIdx = 0; StreamIdx < StreamInfos.size(); ++StreamIdx)
 	{
 		// Don't encode frames in resolutions that we don't intend to send.
 		if (!StreamInfos[StreamIdx].bSendStream)
 		{
+			KeyFrameGovernor.CancelRequest(StreamIdx);
 			continue;
 		}
 
@@ -251,6 +306,13 @@ int FSimulcastVideoEncoder::Encode(const webrtc::VideoFrame& input_image, const
 
 		if (!LayerFrameBuffer)
 		{
+			// The layer was not captured this frame because of its framerate cap.
+			// Keep any pending key frame request for the next captured frame.
+			if (LayerIndex < FrameBuffer->GetNumLayers())
+			{
+				continue;
+			}
+
 			return WEBRTC_VIDEO_CODEC_ENCODER_FAILURE;
 		}
 
@@ -266,10 +328,12 @@ int FSimulcastVideoEncoder::Encode(const webrtc::VideoFrame& input_image, const
 		// frame types for all streams should be passed to the encoder unchanged.
 		// Otherwise a single per-encoder frame type is passed.
 		std::vector<webrtc::VideoFrameType> StreamFrameTypes(StreamInfos.size() == 1 ? GetNumberOfStreams(CurrentCodec) : 1);
+		const bool bSendKeyFrame = bForceKeyFrame || StreamInfos[StreamIdx].KeyFrameRequest || KeyFrameGovernor.ShouldEncodeKeyFrame(StreamIdx, NowMs);
 		if (bSendKeyFrame)
 		{
 			std::fill(StreamFrameTypes.begin(), StreamFrameTypes.end(), webrtc::VideoFrameType::kVideoFrameKey);
 			StreamInfos[StreamIdx].KeyFrameRequest = false;
+			KeyFrameGovernor.OnKeyFrameSubmitted(StreamIdx, NowMs);
 		}
 		else
 		{
@@ -286,6 +350,7 @@ int FSimulcastVideoEncoder::Encode(const webrtc::VideoFrame& input_image, const
 #if WEBRTC_VERSION == 84
 		StreamInfos[StreamIdx].FramerateController->AddFrame(FrameTimestampMs);
 #endif
+		OnStreamSubmitted(input_image.timestamp());
 		const int RtcError = StreamInfos[StreamIdx].Encoder->Encode(NewFrame, &StreamFrameTypes);
 		if (RtcError != WEBRTC_VIDEO_CODEC_OK)
 		{
@@ -296,6 +361,132 @@ int FSimulcastVideoEncoder::Encode(const webrtc::VideoFrame& input_image, const
 	return WEBRTC_VIDEO_CODEC_OK;
 }
 
+int FSimulcastVideoEncoder::EncodePassthrough(const webrtc::VideoFrame& InputImage, rtc::scoped_refptr<FEncodedFrameBuffer> EncodedFrame, int64 NowMs, bool bForceKeyFrame)
+{
+	// A pre-encoded file has a single layer, sent on the highest stream
+	const size_t StreamIdx = StreamInfos.size() - 1;
+	for (size_t i = 0; i < StreamIdx; ++i)
+	{
+		KeyFrameGovernor.CancelRequest(i);
+	}
+
+	if (!StreamInfos[StreamIdx].bSendStream)
+	{
+		KeyFrameGovernor.CancelRequest(StreamIdx);
+		return WEBRTC_VIDEO_CODEC_OK;
+	}
+
+	if (!StreamInfos[StreamIdx].bPassthrough)
+	{
+		const int ReturnCode = SwitchToPassthrough(StreamIdx);
+		if (ReturnCode != WEBRTC_VIDEO_CODEC_OK)
+		{
+			return ReturnCode;
+		}
+	}
+
+	webrtc::VideoFrame NewFrame(InputImage);
+	NewFrame.set_video_frame_buffer(EncodedFrame);
+
+	// No framerate control, dropping a frame would break the following ones until the next key frame
+	std::vector<webrtc::VideoFrameType> FrameTypes(1, webrtc::VideoFrameType::kVideoFrameDelta);
+	if (bForceKeyFrame || StreamInfos[StreamIdx].KeyFrameRequest || KeyFrameGovernor.ShouldEncodeKeyFrame(StreamIdx, NowMs))
+	{
+		FrameTypes[0] = webrtc::VideoFrameType::kVideoFrameKey;
+		StreamInfos[StreamIdx].KeyFrameRequest = false;
+		KeyFrameGovernor.OnKeyFrameSubmitted(StreamIdx, NowMs);
+	}
+
+	return StreamInfos[StreamIdx].Encoder->Encode(NewFrame, &FrameTypes);
+}
+
+int FSimulcastVideoEncoder::SwitchToPassthrough(size_t StreamIdx)
+{
+	webrtc::VideoCodec StreamCodec = CurrentCodec;
+	if (StreamInfos.size() > 1)
+	{
+		PopulateStreamCodec(CurrentCodec, StreamIdx, CurrentCodec.simulcastStream[StreamIdx].targetBitrate, &StreamCodec);
+	}
+
+	std::unique_ptr<VideoEncoder> Encoder = SimulcastEncoderFactory.GetEncoderFactory(StreamIdx)->CreatePassthroughEncoder();
+
+	const webrtc::VideoEncoder::Settings Settings(webrtc::VideoEncoder::Capabilities(false), 1, 0);
+	const int ReturnCode = Encoder->InitEncode(&StreamCodec, Settings);
+	if (ReturnCode != WEBRTC_VIDEO_CODEC_OK)
+	{
+		return ReturnCode;
+	}
+
+	Encoder->RegisterEncodeCompleteCallback(StreamInfos[StreamIdx].Callback.get());
+
+	// The encoder created for the negotiated codec is never going to be used
+	FScopeLock Lock(&StreamInfosGuard);
+	StreamInfos[StreamIdx].Encoder->RegisterEncodeCompleteCallback(nullptr);
+	StreamInfos[StreamIdx].Encoder->Release();
+	StreamInfos[StreamIdx].Encoder = std::move(Encoder);
+	StreamInfos[StreamIdx].bPassthrough = true;
+
+	RTC_LOG(LS_INFO) << "Stream " << StreamIdx << " sends a pre-encoded source, using the passthrough encoder";
+
+	return WEBRTC_VIDEO_CODEC_OK;
+}
+
+void FSimulcastVideoEncoder::UpdateFanOut(TSharedPtr<FEncodedFrameFanOut, ESPMode::ThreadSafe> FrameFanOut)
+{
+	{
+		FScopeLock Lock(&FanOutGuard);
+		FanOut = FrameFanOut;
+	}
+
+	if (FrameFanOut)
+	{
+		const int32 NumStreams = StreamInfos.size();
+		uint32 RequestedStreams = 0;
+		for (int32 StreamIdx = 0; StreamIdx < NumStreams; ++StreamIdx)
+		{
+			if (FrameFanOut->ConsumeKeyFrameRequest(StreamIdx, NumStreams))
+			{
+				RequestedStreams |= 1u << StreamIdx;
+			}
+		}
+		KeyFrameGovernor.OnKeyFrameRequestedForStreams(RequestedStreams);
+	}
+
+	// The rates of the last allocation are applied again when a destination gets a new bitrate
+	const uint32 BitrateCapBps = FrameFanOut ? FrameFanOut->GetMinTargetBitrate() : 0;
+	if (BitrateCapBps != FanOutBitrateCapBps)
+	{
+		FanOutBitrateCapBps = BitrateCapBps;
+		if (LastRateParameters.IsSet())
+		{
+			ApplyRates(CapToFanOutBitrate(LastRateParameters.GetValue()));
+		}
+	}
+}
+
+webrtc::VideoEncoder::RateControlParameters FSimulcastVideoEncoder::CapToFanOutBitrate(const RateControlParameters& Parameters) const
+{
+	const size_t HighestStream = StreamInfos.size() - 1;
+	const uint32 StreamBitrateBps = Parameters.bitrate.GetSpatialLayerSum(HighestStream);
+	if (FanOutBitrateCapBps == 0 || StreamBitrateBps <= FanOutBitrateCapBps)
+	{
+		return Parameters;
+	}
+
+	// Scale the temporal layers down together so that they keep their ratio
+	RateControlParameters CappedParameters = Parameters;
+	for (int i = 0; i < webrtc::kMaxTemporalStreams; ++i)
+	{
+		if (Parameters.bitrate.HasBitrate(HighestStream, i))
+		{
+			const uint64 LayerBitrateBps = Parameters.bitrate.GetBitrate(HighestStream, i);
+			CappedParameters.bitrate.SetBitrate(HighestStream, i, static_cast<uint32>(LayerBitrateBps * FanOutBitrateCapBps / StreamBitrateBps));
+		}
+	}
+
+	return CappedParameters;
+}
+
 int FSimulcastVideoEncoder::RegisterEncodeCompleteCallback(webrtc::EncodedImageCallback* callback)
 {
 	EncodedCompleteCallback = callback;
@@ -316,18 +507,24 @@ void FSimulcastVideoEncoder::SetRates(const RateControlParameters& parameters)
 		return;
 	}
 
-	CurrentCodec.maxFramerate = static_cast<uint32_t>(parameters.framerate_fps + 0.5);
+	LastRateParameters = parameters;
+	ApplyRates(CapToFanOutBitrate(parameters));
+}
+
+void FSimulcastVideoEncoder::ApplyRates(const RateControlParameters& Parameters)
+{
+	CurrentCodec.maxFramerate = static_cast<uint32_t>(Parameters.framerate_fps + 0.5);
 
 	if (StreamInfos.size() == 1)
 	{
 		// Not doing simulcast.
-		StreamInfos[0].Encoder->SetRates(parameters);
+		StreamInfos[0].Encoder->SetRates(Parameters);
 		return;
 	}
 
 	for (size_t StreamIdx = 0; StreamIdx < StreamInfos.size(); ++StreamIdx)
 	{
-		uint32_t StreamBitrateKbps = parameters.bitrate.GetSpatialLayerSum(StreamIdx) / 1000;
+		uint32_t StreamBitrateKbps = Parameters.bitrate.GetSpatialLayerSum(StreamIdx) / 1000;
 
 		// Need a key frame if we have not sent this stream before.
 		if (StreamBitrateKbps > 0 && !StreamInfos[StreamIdx].bSendStream)
@@ -338,21 +535,21 @@ void FSimulcastVideoEncoder::SetRates(const RateControlParameters& parameters)
 
 		// Slice the temporal layers out of the full allocation and pass it on to
 		// the encoder handling the current simulcast stream.
-		RateControlParameters StreamParameters = parameters;
+		RateControlParameters StreamParameters = Parameters;
 		StreamParameters.bitrate = webrtc::VideoBitrateAllocation();
 		for (int i = 0; i < webrtc::kMaxTemporalStreams; ++i)
 		{
-			if (parameters.bitrate.HasBitrate(StreamIdx, i))
+			if (Parameters.bitrate.HasBitrate(StreamIdx, i))
 			{
-				StreamParameters.bitrate.SetBitrate(0, i, parameters.bitrate.GetBitrate(StreamIdx, i));
+				StreamParameters.bitrate.SetBitrate(0, i, Parameters.bitrate.GetBitrate(StreamIdx, i));
 			}
 		}
 
 		// Assign link allocation proportionally to spatial layer allocation.
-		if (!parameters.bandwidth_allocation.IsZero() && parameters.bitrate.get_sum_bps() > 0)
+		if (!Parameters.bandwidth_allocation.IsZero() && Parameters.bitrate.get_sum_bps() > 0)
 		{
 			StreamParameters.bandwidth_allocation =
-				webrtc::DataRate::BitsPerSec((parameters.bandwidth_allocation.bps() * StreamParameters.bitrate.get_sum_bps()) / parameters.bitrate.get_sum_bps());
+				webrtc::DataRate::BitsPerSec((Parameters.bandwidth_allocation.bps() * StreamParameters.bitrate.get_sum_bps()) / Parameters.bitrate.get_sum_bps());
 			// Make sure we don't allocate bandwidth lower than target bitrate.
 			if (StreamParameters.bandwidth_allocation.bps() < StreamParameters.bitrate.get_sum_bps())
 			{
@@ -361,9 +558,9 @@ void FSimulcastVideoEncoder::SetRates(const RateControlParameters& parameters)
 			}
 		}
 #if WEBRTC_VERSION == 84
-		StreamParameters.framerate_fps = std::min<double>(parameters.framerate_fps, StreamInfos[StreamIdx].FramerateController->GetTargetRate());
+		StreamParameters.framerate_fps = std::min<double>(Parameters.framerate_fps, StreamInfos[StreamIdx].FramerateController->GetTargetRate());
 #elif WEBRTC_VERSION == 96
-		StreamParameters.framerate_fps = std::min<double>(parameters.framerate_fps, StreamInfos[StreamIdx].FramerateController->GetMaxFramerate());
+		StreamParameters.framerate_fps = std::min<double>(Parameters.framerate_fps, StreamInfos[StreamIdx].FramerateController->GetMaxFramerate());
 #endif
 
 		StreamInfos[StreamIdx].Encoder->SetRates(StreamParameters);
@@ -399,7 +596,11 @@ FSimulcastVideoEncoder::EncoderInfo FSimulcastVideoEncoder::GetEncoderInfo() con
 	if (StreamInfos.size() == 1)
 	{
 		// Not using simulcast adapting functionality, just pass through.
-		return StreamInfos[0].Encoder->GetEncoderInfo();
+		// The frames reaching the adapter are always its own layered buffers which can't be converted to I420 as a whole,
+		// the layer encoder converts its layer itself if it needs to.
+		VideoEncoder::EncoderInfo EncoderInfo = StreamInfos[0].Encoder->GetEncoderInfo();
+		EncoderInfo.supports_native_handle = true;
+		return EncoderInfo;
 	}
 
 	VideoEncoder::EncoderInfo EncoderInfo;
@@ -451,8 +652,8 @@ FSimulcastVideoEncoder::EncoderInfo FSimulcastVideoEncoder::GetEncoderInfo() con
 			EncoderInfo.has_internal_source &= EncoderImplInfo.has_internal_source;
 		}
 
-		// Nasty hack to allow us to manually convert VPX frames to I420 later in the encode block
-		if (CurrentCodec.codecType == webrtc::kVideoCodecVP8)
+		// Nasty hack to allow us to manually convert software encoded frames to I420 later in the encode block
+		if (CurrentCodec.codecType == webrtc::kVideoCodecVP8 || CurrentCodec.codecType == webrtc::kVideoCodecH264)
 		{
 			EncoderInfo.supports_native_handle = true;
 		}
@@ -474,22 +675,144 @@ bool FSimulcastVideoEncoder::IsInitialized() const
 	return Initialized;
 }
 
+std::unique_ptr<webrtc::VideoEncoder> FSimulcastVideoEncoder::CreateStreamEncoder(int StreamIndex, const webrtc::SdpVideoFormat& Format, const webrtc::VideoCodec& StreamCodec, const webrtc::VideoEncoder::Settings& Settings, int& OutReturnCode)
+{
+	// A warm encoder is already initialized for this codec, resolution and layers
+	if (std::unique_ptr<VideoEncoder> WarmEncoder = SimulcastEncoderFactory.AcquireWarmEncoder(StreamIndex, StreamCodec, Settings))
+	{
+		OutReturnCode = WEBRTC_VIDEO_CODEC_OK;
+		return WarmEncoder;
+	}
+
+	std::unique_ptr<VideoEncoder> Encoder = SimulcastEncoderFactory.GetEncoderFactory(StreamIndex)->CreateVideoEncoder(Format);
+	OutReturnCode = Encoder->InitEncode(&StreamCodec, Settings);
+	return Encoder;
+}
+
+void FSimulcastVideoEncoder::BeginFrameSubmission(uint32 RtpTimestamp, TSharedPtr<FEncoderAdaptationController, ESPMode::ThreadSafe> InAdaptationController)
+{
+	FScopeLock Lock(&PendingFramesGuard);
+
+	const uint64 Now = FPlatformTime::Cycles64();
+
+	// Encoders may drop frames without notice (rate control), forget about frames that are too old
+	for (auto It = PendingFrames.CreateIterator(); It; ++It)
+	{
+		if (FPlatformTime::ToSeconds64(Now - It.Value().SubmitCycles) > 1.0)
+		{
+			It.RemoveCurrent();
+		}
+	}
+
+	PendingFrames.Add(RtpTimestamp, { Now, 0, 0, true });
+	AdaptationController = MoveTemp(InAdaptationController);
+}
+
+void FSimulcastVideoEncoder::OnStreamSubmitted(uint32 RtpTimestamp)
+{
+	FScopeLock Lock(&PendingFramesGuard);
+
+	if (FPendingFrame* PendingFrame = PendingFrames.Find(RtpTimestamp))
+	{
+		++PendingFrame->SubmittedStreams;
+		++PendingFrame->RemainingStreams;
+	}
+}
+
+void FSimulcastVideoEncoder::EndFrameSubmission(uint32 RtpTimestamp)
+{
+	FScopeLock Lock(&PendingFramesGuard);
+
+	FPendingFrame* PendingFrame = PendingFrames.Find(RtpTimestamp);
+	if (!PendingFrame)
+	{
+		return;
+	}
+
+	PendingFrame->bSubmitting = false;
+
+	if (PendingFrame->SubmittedStreams == 0)
+	{
+		// All the streams dropped the frame
+		PendingFrames.Remove(RtpTimestamp);
+	}
+	else if (PendingFrame->RemainingStreams <= 0)
+	{
+		CompleteFrame(RtpTimestamp);
+	}
+}
+
+void FSimulcastVideoEncoder::OnStreamEncoded(uint32 RtpTimestamp)
+{
+	FScopeLock Lock(&PendingFramesGuard);
+
+	FPendingFrame* PendingFrame = PendingFrames.Find(RtpTimestamp);
+	if (!PendingFrame)
+	{
+		return;
+	}
+
+	if (--PendingFrame->RemainingStreams <= 0 && !PendingFrame->bSubmitting)
+	{
+		CompleteFrame(RtpTimestamp);
+	}
+}
+
+void FSimulcastVideoEncoder::CompleteFrame(uint32 RtpTimestamp)
+{
+	const FPendingFrame PendingFrame = PendingFrames.FindAndRemoveChecked(RtpTimestamp);
+	const double EncodeTimeMs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - PendingFrame.SubmitCycles);
+
+	if (AdaptationController)
+	{
+		AdaptationController->OnFrameEncoded(EncodeTimeMs, PendingFrames.Num(), FPlatformTime::Seconds());
+	}
+}
+
 #if WEBRTC_VERSION == 84
 webrtc::EncodedImageCallback::Result FSimulcastVideoEncoder::OnEncodedImage(size_t stream_idx, const webrtc::EncodedImage& encoded_image, const webrtc::CodecSpecificInfo* codec_specific_info, const webrtc::RTPFragmentationHeader* fragmentation)
 #else
 webrtc::EncodedImageCallback::Result FSimulcastVideoEncoder::OnEncodedImage(size_t stream_idx, const webrtc::EncodedImage& encoded_image, const webrtc::CodecSpecificInfo* codec_specific_info)
 #endif // WEBRTC_VERSION == 84
 {
-	webrtc::EncodedImage StreamImage(encoded_image);
-	webrtc::CodecSpecificInfo StreamCodecSpecific = *codec_specific_info;
+	OnStreamEncoded(encoded_image.Timestamp());
+	FPublisherStats::Get().FrameEncoded();
+
+	if (encoded_image._frameType == webrtc::VideoFrameType::kVideoFrameKey)
+	{
+		FPublisherStats::Get().KeyFrameEncoded();
+	}
+
+	const auto Recorder = SimulcastEncoderFactory.GetRecorder(RecordingId);
+	if (Recorder && Recorder->GetStreamIndex() == static_cast<int32>(stream_idx))
+	{
+		Recorder->OnEncodedImage(codec_specific_info ? codec_specific_info->codecType : CurrentCodec.codecType, encoded_image);
+	}
+
+	TSharedPtr<FEncodedFrameFanOut, ESPMode::ThreadSafe> EncodedFanOut;
+	{
+		FScopeLock Lock(&FanOutGuard);
+		EncodedFanOut = FanOut;
+	}
+
+	if (EncodedFanOut)
+	{
+		EncodedFanOut->OnEncodedImage(stream_idx, StreamInfos.size(), codec_specific_info ? codec_specific_info->codecType : CurrentCodec.codecType, encoded_image);
+	}
 
+	// Only the metadata is copied to set the spatial index, the encoded data is ref counted and shared.
+	webrtc::EncodedImage StreamImage(encoded_image);
 	StreamImage.SetSpatialIndex(stream_idx);
 
-	return EncodedCompleteCallback->OnEncodedImage(StreamImage, &StreamCodecSpecific
+	const webrtc::EncodedImageCallback::Result Result = EncodedCompleteCallback->OnEncodedImage(StreamImage, codec_specific_info
 #if WEBRTC_VERSION == 84
 		,fragmentation
 #endif
 	);
+
+	SimulcastEncoderFactory.OnFrameSent(RecordingId);
+
+	return Result;
 }
 
 }
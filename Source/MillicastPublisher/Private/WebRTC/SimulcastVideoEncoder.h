@@ -4,10 +4,14 @@
 
 #include "CoreMinimal.h"
 #include "WebRTCInc.h"
+#include "EncoderAdaptationController.h"
+#include "KeyFrameGovernor.h"
 
 namespace Millicast::Publisher
 {
 	class FSimulcastEncoderFactory;
+	class FEncodedFrameBuffer;
+	class FEncodedFrameFanOut;
 
 	struct StreamInfo
 	{
@@ -36,6 +40,7 @@ namespace Millicast::Publisher
 
 		bool KeyFrameRequest;
 		bool bSendStream;
+		bool bPassthrough = false;
 	};
 
 	class FSimulcastVideoEncoder : public ::webrtc::VideoEncoder
@@ -72,13 +77,53 @@ namespace Millicast::Publisher
 	private:
 		bool IsInitialized() const;
 
+		/** Take a warm encoder from the factory if there is one, create and initialize a new one otherwise */
+		std::unique_ptr<webrtc::VideoEncoder> CreateStreamEncoder(int StreamIndex, const webrtc::SdpVideoFormat& Format, const webrtc::VideoCodec& StreamCodec, const webrtc::VideoEncoder::Settings& Settings, int& OutReturnCode);
+
+		/** Send a frame of a pre-encoded source, replacing the encoder of the stream by a passthrough one the first time */
+		int EncodePassthrough(const webrtc::VideoFrame& InputImage, rtc::scoped_refptr<FEncodedFrameBuffer> EncodedFrame, int64 NowMs, bool bForceKeyFrame);
+		int SwitchToPassthrough(size_t StreamIdx);
+
+		/** Forward the key frame requests of the destinations sharing the encoded frames, and follow their bitrate */
+		void UpdateFanOut(TSharedPtr<FEncodedFrameFanOut, ESPMode::ThreadSafe> FrameFanOut);
+		/** The highest stream is encoded at the lowest bitrate of the destinations following it */
+		RateControlParameters CapToFanOutBitrate(const RateControlParameters& Parameters) const;
+		void ApplyRates(const RateControlParameters& Parameters);
+
+		// Track the frames submitted to the encoders to report the encode time and queue depth to the adaptation controller
+		// Software encoders output synchronously so the frame is only complete once Encode returns.
+		void BeginFrameSubmission(uint32 RtpTimestamp, TSharedPtr<FEncoderAdaptationController, ESPMode::ThreadSafe> InAdaptationController);
+		void OnStreamSubmitted(uint32 RtpTimestamp);
+		void EndFrameSubmission(uint32 RtpTimestamp);
+		void OnStreamEncoded(uint32 RtpTimestamp);
+		void CompleteFrame(uint32 RtpTimestamp);
+
+		struct FPendingFrame
+		{
+			uint64 SubmitCycles;
+			int32 SubmittedStreams;
+			int32 RemainingStreams;
+			bool bSubmitting;
+		};
+
+		FCriticalSection PendingFramesGuard;
+		TMap<uint32, FPendingFrame> PendingFrames;
+		TSharedPtr<FEncoderAdaptationController, ESPMode::ThreadSafe> AdaptationController;
+
 		TAtomic<bool> Initialized;
 
 		FSimulcastEncoderFactory&     SimulcastEncoderFactory;
 		const webrtc::SdpVideoFormat  VideoFormat;
+		const FString                 RecordingId;
 		webrtc::VideoCodec			  CurrentCodec;
 		FCriticalSection              StreamInfosGuard;
 		std::vector<StreamInfo>       StreamInfos;
 		webrtc::EncodedImageCallback* EncodedCompleteCallback;
+		FKeyFrameGovernor             KeyFrameGovernor;
+
+		FCriticalSection FanOutGuard;
+		TSharedPtr<FEncodedFrameFanOut, ESPMode::ThreadSafe> FanOut;
+		TOptional<RateControlParameters> LastRateParameters;
+		uint32 FanOutBitrateCapBps = 0;
 	};
 }
\ No newline at end of file
@@ -56,6 +56,95 @@ void FPublisherStats::SetEncoderStats(double LatencyMs, double BitrateMbps, int
 	EncoderQP = CalcEMA(EncoderQP, EncoderStatSamples, QP);
 }
 
+void FPublisherStats::SetAdaptationStats(double EncodeTimeMs, int QueueDepth)
+{
+	FScopeLock Lock(&AdaptationSection);
+	AdaptationEncodeTimeMs = EncodeTimeMs;
+	AdaptationQueueDepth = QueueDepth;
+}
+
+void FPublisherStats::SetAdaptationLevel(int Level, float ResolutionScale, int MaxFramerate)
+{
+	FScopeLock Lock(&AdaptationSection);
+	AdaptationLevel = Level;
+	AdaptationResolutionScale = ResolutionScale;
+	AdaptationMaxFramerate = MaxFramerate;
+	++AdaptationChanges;
+}
+
+void FPublisherStats::PublishStarted()
+{
+	PublishStartCycles = FPlatformTime::Cycles64();
+}
+
+void FPublisherStats::FrameEncoded()
+{
+	const uint64 StartCycles = PublishStartCycles.Exchange(0);
+	if (StartCycles == 0)
+	{
+		return;
+	}
+
+	TimeToFirstFrameMs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles);
+	UE_LOG(LogMillicastPublisherStats, Log, TEXT("First frame encoded %.2f ms after publish"), TimeToFirstFrameMs);
+}
+
+void FPublisherStats::KeyFrameRequested()
+{
+	++KeyFramesRequested;
+}
+
+void FPublisherStats::KeyFrameEncoded()
+{
+	++KeyFramesEncoded;
+}
+
+void FPublisherStats::SetRecordingStats(int64 QueuedBytes, int32 DroppedFrames)
+{
+	RecordingQueuedBytes = QueuedBytes;
+	RecordingDroppedFrames = DroppedFrames;
+	bRecording = true;
+}
+
+void FPublisherStats::SetEncoderQueueStats(int Depth, int MaxDepth, double WaitTimeMs, double BlockTimeMs, int32 DroppedFrames)
+{
+	EncoderQueueDepth = Depth;
+	EncoderQueueMaxDepth = MaxDepth;
+	EncoderQueueWaitTimeMs = WaitTimeMs;
+	EncoderQueueBlockTimeMs = BlockTimeMs;
+	EncoderQueueDroppedFrames = DroppedFrames;
+}
+
+void FPublisherStats::SetAudioDriftStats(double DriftPpm, double CorrectionPpm, double FillMs, int32 NumInputs)
+{
+	bAudioDrift = true;
+	AudioDriftPpm = DriftPpm;
+	AudioCorrectionPpm = CorrectionPpm;
+	AudioFillMs = FillMs;
+	AudioDriftInputs = NumInputs;
+}
+
+void FPublisherStats::SetAudioDeliveryStats(int LatencyMs, int TargetLatencyMs, int32 Underruns, int32 Overruns)
+{
+	bAudioDelivery = true;
+	AudioDeliveryLatencyMs = LatencyMs;
+	AudioDeliveryTargetLatencyMs = TargetLatencyMs;
+	AudioUnderruns = Underruns;
+	AudioOverruns = Overruns;
+}
+
+void FPublisherStats::AudioFrameSent(double LatencyMs)
+{
+	AudioLatencySamples = FPlatformMath::Min(AudioLatencySamples + 1, 100);
+	AudioLatencyMs = CalcEMA(AudioLatencyMs, AudioLatencySamples, LatencyMs);
+}
+
+void FPublisherStats::VideoFrameSent(double LatencyMs)
+{
+	VideoLatencySamples = FPlatformMath::Min(VideoLatencySamples + 1, 60);
+	VideoLatencyMs = CalcEMA(VideoLatencyMs, VideoLatencySamples, LatencyMs);
+}
+
 void FPublisherStats::Tick(float DeltaTime)
 {
 	if (!GEngine)
@@ -163,6 +252,68 @@ int32 FPublisherStats::OnRenderStats(UWorld* World, FViewport* Viewport, FCanvas
 	GEngine->AddOnScreenDebugMessage(MessageKey++, 0.0f, FColor::Green, FString::Printf(TEXT("Encode Latency = %.2f ms"), EncoderLatencyMs), true);
 	GEngine->AddOnScreenDebugMessage(MessageKey++, 0.0f, FColor::Green, FString::Printf(TEXT("Encode Bitrate = %.2f Mbps"), EncoderBitrateMbps), true);
 	GEngine->AddOnScreenDebugMessage(MessageKey++, 0.0f, FColor::Green, FString::Printf(TEXT("Encode QP = %.0f"), EncoderQP), true);
+	{
+		FScopeLock Lock(&AdaptationSection);
+		GEngine->AddOnScreenDebugMessage(MessageKey++, 0.0f, FColor::Green, FString::Printf(TEXT("Encode Time = %.2f ms, Queue Depth = %d"), AdaptationEncodeTimeMs, AdaptationQueueDepth), true);
+		GEngine->AddOnScreenDebugMessage(MessageKey++, 0.0f, FColor::Green, FString::Printf(TEXT("Adaptation Level = %d (scale %.2f, max fps %d, %d changes)"), AdaptationLevel, AdaptationResolutionScale, AdaptationMaxFramerate, AdaptationChanges), true);
+
+		MILLI_STAT(AdaptationEncodeTime, static_cast<float>(AdaptationEncodeTimeMs));
+		MILLI_STAT(AdaptationQueueDepth, AdaptationQueueDepth);
+		MILLI_STAT(AdaptationLevel, AdaptationLevel);
+		MILLI_STAT(AdaptationChanges, AdaptationChanges);
+	}
+
+	GEngine->AddOnScreenDebugMessage(MessageKey++, 0.0f, FColor::Green, FString::Printf(TEXT("Encoder Input Queue = %d (max %d), Wait = %.2f ms, Block = %.2f ms, Dropped Frames = %d"),
+		EncoderQueueDepth, EncoderQueueMaxDepth, EncoderQueueWaitTimeMs, EncoderQueueBlockTimeMs, EncoderQueueDroppedFrames), true);
+	MILLI_STAT(EncoderQueueDepth, EncoderQueueDepth);
+	MILLI_STAT(EncoderQueueWaitTime, static_cast<float>(EncoderQueueWaitTimeMs));
+	MILLI_STAT(EncoderQueueBlockTime, static_cast<float>(EncoderQueueBlockTimeMs));
+	MILLI_STAT(EncoderQueueDroppedFrames, EncoderQueueDroppedFrames);
+
+	if (bAudioDrift)
+	{
+		const FString Inputs = AudioDriftInputs > 1 ? FString::Printf(TEXT(" (worst of %d inputs)"), AudioDriftInputs) : FString();
+		GEngine->AddOnScreenDebugMessage(MessageKey++, 0.0f, FColor::Green, FString::Printf(TEXT("Audio Clock Drift = %.1f ppm, Correction = %.1f ppm, Fill = %.2f ms%s"),
+			AudioDriftPpm, AudioCorrectionPpm, AudioFillMs, *Inputs), true);
+		MILLI_STAT(AudioClockDrift, static_cast<float>(AudioDriftPpm));
+		MILLI_STAT(AudioDriftCorrection, static_cast<float>(AudioCorrectionPpm));
+		MILLI_STAT(AudioFill, static_cast<float>(AudioFillMs));
+	}
+
+	if (bAudioDelivery)
+	{
+		GEngine->AddOnScreenDebugMessage(MessageKey++, 0.0f, FColor::Green, FString::Printf(TEXT("Audio Queue = %d ms (target %d ms), Underruns = %d, Overruns = %d"),
+			AudioDeliveryLatencyMs, AudioDeliveryTargetLatencyMs, AudioUnderruns, AudioOverruns), true);
+		MILLI_STAT(AudioQueueLatency, AudioDeliveryLatencyMs);
+		MILLI_STAT(AudioUnderruns, AudioUnderruns);
+		MILLI_STAT(AudioOverruns, AudioOverruns);
+	}
+
+	if (bMeasureAVOffset)
+	{
+		// Positive when the audio reaches webrtc later after its capture than the video
+		const double AVOffsetMs = AudioLatencyMs - VideoLatencyMs;
+		GEngine->AddOnScreenDebugMessage(MessageKey++, 0.0f, FColor::Green, FString::Printf(TEXT("A/V Offset = %.2f ms (Audio Latency = %.2f ms, Video Latency = %.2f ms)"), AVOffsetMs, AudioLatencyMs, VideoLatencyMs), true);
+		MILLI_STAT(AVOffset, static_cast<float>(AVOffsetMs));
+		MILLI_STAT(AudioCaptureLatency, static_cast<float>(AudioLatencyMs));
+		MILLI_STAT(VideoCaptureLatency, static_cast<float>(VideoLatencyMs));
+	}
+
+	GEngine->AddOnScreenDebugMessage(MessageKey++, 0.0f, FColor::Green, FString::Printf(TEXT("Time To First Frame = %.2f ms"), TimeToFirstFrameMs), true);
+	MILLI_STAT(TimeToFirstFrame, static_cast<float>(TimeToFirstFrameMs));
+
+	GEngine->AddOnScreenDebugMessage(MessageKey++, 0.0f, FColor::Green, FString::Printf(TEXT("Key Frames Requested = %d, Encoded = %d"), KeyFramesRequested.Load(), KeyFramesEncoded.Load()), true);
+	MILLI_STAT(KeyFramesRequested, KeyFramesRequested.Load());
+	MILLI_STAT(KeyFramesEncoded, KeyFramesEncoded.Load());
+
+	if (bRecording)
+	{
+		const double RecordingQueuedMB = RecordingQueuedBytes.Load() / (1024.0 * 1024.0);
+		const int32 DroppedFrames = RecordingDroppedFrames.Load();
+		GEngine->AddOnScreenDebugMessage(MessageKey++, 0.0f, FColor::Green, FString::Printf(TEXT("Recording Queue = %.2f MB, Dropped Frames = %d"), RecordingQueuedMB, DroppedFrames), true);
+		MILLI_STAT(RecordingQueue, static_cast<float>(RecordingQueuedMB));
+		MILLI_STAT(RecordingDroppedFrames, DroppedFrames);
+	}
 
 	return Y;
 }
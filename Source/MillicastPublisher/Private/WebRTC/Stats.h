@@ -10,6 +10,9 @@ namespace Millicast::Publisher
 
 class FWebRTCPeerConnection;
 
+	/** Exponential moving average over NumSamples */
+	double CalcEMA(double PrevAvg, int NumSamples, double Value);
+
 	class FRTCStatsCollector : public webrtc::RTCStatsCollectorCallback
 	{
 		double LastVideoStatTimestamp;
@@ -77,6 +80,31 @@ class FWebRTCPeerConnection;
 		void FrameRendered();
 
 		void SetEncoderStats(double LatencyMs, double BitrateMbps, int QP);
+		void SetAdaptationStats(double EncodeTimeMs, int QueueDepth);
+		void SetAdaptationLevel(int Level, float ResolutionScale, int MaxFramerate);
+
+		/** Start measuring the time to the first encoded frame */
+		void PublishStarted();
+		void FrameEncoded();
+
+		void KeyFrameRequested();
+		void KeyFrameEncoded();
+		int32 GetKeyFramesRequested() const { return KeyFramesRequested.Load(); }
+		int32 GetKeyFramesEncoded() const { return KeyFramesEncoded.Load(); }
+
+		void SetRecordingStats(int64 QueuedBytes, int32 DroppedFrames);
+
+		void SetEncoderQueueStats(int Depth, int MaxDepth, double WaitTimeMs, double BlockTimeMs, int32 DroppedFrames);
+
+		/** Drift of the capture clock, the worst of NumInputs inputs for a mixer */
+		void SetAudioDriftStats(double DriftPpm, double CorrectionPpm, double FillMs, int32 NumInputs = 1);
+		void SetAudioDeliveryStats(int LatencyMs, int TargetLatencyMs, int32 Underruns, int32 Overruns);
+
+		/** Time from capture to webrtc of the audio and video frames, measured only when enabled */
+		void SetMeasureAVOffset(bool bMeasure) { bMeasureAVOffset = bMeasure; }
+		bool IsMeasuringAVOffset() const { return bMeasureAVOffset; }
+		void AudioFrameSent(double LatencyMs);
+		void VideoFrameSent(double LatencyMs);
 
 	private:
 		// Intent is to access through FPublisherStats::Get()
@@ -95,6 +123,50 @@ class FWebRTCPeerConnection;
 		double EncoderBitrateMbps = 0;
 		double EncoderQP = 0;
 
+		// Written by the encoder threads
+		mutable FCriticalSection AdaptationSection;
+		double AdaptationEncodeTimeMs = 0;
+		int AdaptationQueueDepth = 0;
+		int AdaptationLevel = 0;
+		float AdaptationResolutionScale = 1.f;
+		int AdaptationMaxFramerate = 0;
+		int AdaptationChanges = 0;
+
+		TAtomic<uint64> PublishStartCycles { 0 };
+		double TimeToFirstFrameMs = 0;
+
+		TAtomic<int32> KeyFramesRequested { 0 };
+		TAtomic<int32> KeyFramesEncoded { 0 };
+
+		// Written by the writer thread of the recorder
+		TAtomic<bool> bRecording { false };
+		TAtomic<int64> RecordingQueuedBytes { 0 };
+		TAtomic<int32> RecordingDroppedFrames { 0 };
+
+		int EncoderQueueDepth = 0;
+		int EncoderQueueMaxDepth = 0;
+		double EncoderQueueWaitTimeMs = 0;
+		double EncoderQueueBlockTimeMs = 0;
+		int32 EncoderQueueDroppedFrames = 0;
+
+		bool bAudioDrift = false;
+		double AudioDriftPpm = 0;
+		double AudioCorrectionPpm = 0;
+		double AudioFillMs = 0;
+		int32 AudioDriftInputs = 0;
+
+		bool bAudioDelivery = false;
+		int AudioDeliveryLatencyMs = 0;
+		int AudioDeliveryTargetLatencyMs = 0;
+		int32 AudioUnderruns = 0;
+		int32 AudioOverruns = 0;
+
+		TAtomic<bool> bMeasureAVOffset { false };
+		int AudioLatencySamples = 0;
+		double AudioLatencyMs = 0;
+		int VideoLatencySamples = 0;
+		double VideoLatencyMs = 0;
+
 		bool bRegisterEngineStats = false;
 
 		bool OnToggleStats(UWorld* World, FCommonViewportClient* ViewportClient, const TCHAR* Stream);
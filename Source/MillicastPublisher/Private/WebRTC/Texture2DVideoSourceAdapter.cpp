@@ -2,9 +2,11 @@
 
 #include "Texture2DVideoSourceAdapter.h"
 
+#include "MillicastPublisherPrivate.h"
 #include "Stats.h"
 
 #include "FrameBufferRHI.h"
+#include "Media/CaptureClock.h"
 #include "RHI/CopyTexture.h"
 
 namespace Millicast::Publisher
@@ -12,22 +14,58 @@ namespace Millicast::Publisher
 
 void FTexture2DVideoSourceAdapter::OnFrameReady(const FTexture2DRHIRef& FrameBuffer)
 {
-	const int64 Timestamp = rtc::TimeMicros();
+	const int64 Timestamp = GetCaptureTimestampUs();
+
+	const FIntPoint CaptureSize = ApplyEncoderAdaptation(FrameBuffer->GetSizeXY());
+
+	TSharedPtr<const FMillicastImportanceMap, ESPMode::ThreadSafe> FrameImportanceMap;
+	{
+		FScopeLock Lock(&ImportanceMapSection);
+		FrameImportanceMap = ImportanceMap;
+	}
 
 	if (!AdaptVideoFrame(Timestamp, FrameBuffer->GetSizeXY()))
 		return;
+
+	// Leaves the queue when the encoder takes the frame, or when the frame is released without being encoded
+	FEncoderInputQueue::FTicketPtr InputTicket = InputQueue->Enqueue();
+	if (!InputTicket)
+	{
+		return;
+	}
 #if WITH_AVENCODER
-	TryInitializeCaptureContexts(FrameBuffer);
+	TryInitializeCaptureContexts(CaptureSize);
 
-	auto SimulcastBuffer = rtc::make_ref_counted<FSimulcastFrameBuffer>();
+	auto SimulcastBuffer = rtc::make_ref_counted<FSimulcastFrameBuffer>(CaptureSize.X, CaptureSize.Y);
+	SimulcastBuffer->SetAdaptationController(AdaptationController);
+	SimulcastBuffer->SetFanOut(FanOut);
+	SimulcastBuffer->SetKeyFrameSettings(KeyFrameSettings);
+	SimulcastBuffer->SetInputTicket(MoveTemp(InputTicket));
 
 	TArray<FVideoEncoderInputFrameType> InputFrames;
 	InputFrames.Reserve( CaptureContexts.Num() );
 	
-	for (const auto& Context : CaptureContexts)
+	for (int32 LayerIndex = 0; LayerIndex < CaptureContexts.Num(); ++LayerIndex)
 	{
+		if (!ShouldCaptureLayer(LayerIndex, Timestamp))
+		{
+			SimulcastBuffer->AddLayer(nullptr);
+			continue;
+		}
+
+		const auto& Context = CaptureContexts[LayerIndex];
 		const auto& CapturedInput = Context->ObtainCapturedInput();
 		FVideoEncoderInputFrameType InputFrame = CapturedInput.InputFrame;
+		if (!InputFrame || !CapturedInput.Texture.IsSet())
+		{
+			// Every input frame is still held by the encoder, the frame is dropped and leaves the queue with its buffer
+			UE_LOG(LogMillicastPublisher, Verbose, TEXT("No encoder input frame available for layer %d, dropping the frame"), LayerIndex);
+			for (auto& ObtainedFrame : InputFrames)
+			{
+				ObtainedFrame->Release();
+			}
+			return;
+		}
 		InputFrames.Add(InputFrame);
 
 		const FTexture2DRHIRef Texture = CapturedInput.Texture.GetValue();
@@ -44,6 +82,8 @@ void FTexture2DVideoSourceAdapter::OnFrameReady(const FTexture2DRHIRef& FrameBuf
 		CopyTexture(RHICmdList, FrameBuffer, Texture);
 
 		const auto& Buffer = rtc::make_ref_counted<FFrameBufferRHI>(Texture, InputFrame, Context->GetVideoEncoderInput());
+		Buffer->SetEncoderContext(Context);
+		Buffer->SetImportanceMap(FrameImportanceMap);
 		SimulcastBuffer->AddLayer(Buffer);
 	}
 
@@ -65,22 +105,27 @@ void FTexture2DVideoSourceAdapter::OnFrameReady(const FTexture2DRHIRef& FrameBuf
 #else
 #if ENGINE_MAJOR_VERSION < 5 || ENGINE_MINOR_VERSION == 0
 	FRHIResourceCreateInfo CreateInfo(TEXT("VideoCapturerBackBuffer"));
-	FTexture2DRHIRef Texture = GDynamicRHI->RHICreateTexture2D(FrameBuffer->GetTexture2D()->GetSizeX(), FrameBuffer->GetTexture2D()->GetSizeY(), EPixelFormat::PF_B8G8R8A8, 1, 1, TexCreate_Shared | TexCreate_RenderTargetable, ERHIAccess::CopyDest, CreateInfo);
+	FTexture2DRHIRef Texture = GDynamicRHI->RHICreateTexture2D(CaptureSize.X, CaptureSize.Y, EPixelFormat::PF_B8G8R8A8, 1, 1, TexCreate_Shared | TexCreate_RenderTargetable, ERHIAccess::CopyDest, CreateInfo);
 #else
 
 	FRHITextureCreateDesc CreateDesc = FRHITextureCreateDesc::Create2D(TEXT("VideoCapturerBackBuffer"),
-		FrameBuffer->GetTexture2D()->GetSizeX(), FrameBuffer->GetTexture2D()->GetSizeY(), EPixelFormat::PF_B8G8R8A8);
+		CaptureSize.X, CaptureSize.Y, EPixelFormat::PF_B8G8R8A8);
 	CreateDesc.SetFlags(TexCreate_Shared | TexCreate_RenderTargetable);
 	CreateDesc.SetInitialState(ERHIAccess::CopyDest);
 
 	FTexture2DRHIRef Texture = GDynamicRHI->RHICreateTexture(CreateDesc);
 #endif
-	auto SimulcastBuffer = rtc::make_ref_counted<FSimulcastFrameBuffer>();
+	auto SimulcastBuffer = rtc::make_ref_counted<FSimulcastFrameBuffer>(CaptureSize.X, CaptureSize.Y);
+	SimulcastBuffer->SetAdaptationController(AdaptationController);
+	SimulcastBuffer->SetFanOut(FanOut);
+	SimulcastBuffer->SetKeyFrameSettings(KeyFrameSettings);
+	SimulcastBuffer->SetInputTicket(MoveTemp(InputTicket));
 	auto InputFrame = MakeShared<AVEncoder::FVideoEncoderInputFrame>();
 
 	FRHICommandListImmediate& RHICmdList = FRHICommandListExecutor::GetImmediateCommandList();
 	CopyTexture(RHICmdList, FrameBuffer, Texture);
 	const auto& Buffer = rtc::make_ref_counted<FFrameBufferRHI>(Texture, InputFrame, nullptr);
+	Buffer->SetImportanceMap(FrameImportanceMap);
 	SimulcastBuffer->AddLayer(Buffer);
 	webrtc::VideoFrame Frame = webrtc::VideoFrame::Builder()
 		.set_video_frame_buffer(SimulcastBuffer)
@@ -93,23 +138,147 @@ void FTexture2DVideoSourceAdapter::OnFrameReady(const FTexture2DRHIRef& FrameBuf
 }
 #if WITH_AVENCODER
 
-void FTexture2DVideoSourceAdapter::TryInitializeCaptureContexts(const FTexture2DRHIRef& FrameBuffer)
+void FTexture2DVideoSourceAdapter::TryInitializeCaptureContexts(const FIntPoint& FBSize)
 {
         if (!IsEmpty(CaptureContexts))
 	{
 		return;
 	}
-	
-	const auto& FBSize = FrameBuffer->GetSizeXY();
-	CaptureContexts.Add(MakeUnique<FAVEncoderContext>(FBSize.X, FBSize.Y, true));
 
-	if (Simulcast)
+	if (!Simulcast)
 	{
-		CaptureContexts.Add(MakeUnique<FAVEncoderContext>(FBSize.X / 2, FBSize.Y / 2, true));
-		CaptureContexts.Add(MakeUnique<FAVEncoderContext>(FBSize.X / 4, FBSize.Y / 4, true));
+		SimulcastLayers.Empty();
+		CaptureContexts.Add(MakeShared<FAVEncoderContext, ESPMode::ThreadSafe>(FBSize.X, FBSize.Y, true, GetNumEncoderInputFrames()));
+		return;
+	}
+
+	if (IsEmpty(SimulcastLayers))
+	{
+		SimulcastLayers = FMillicastSimulcastLayer::GetDefaultLayers();
+	}
+
+	// One capture context per layer, in the same order as the encodings of the transceiver
+	for (const FMillicastSimulcastLayer& Layer : SimulcastLayers)
+	{
+		const float Scale = FMath::Max(Layer.ScaleResolutionDownBy, 1.f);
+		const int32 Width = FMath::Max(FMath::FloorToInt(FBSize.X / Scale), 1);
+		const int32 Height = FMath::Max(FMath::FloorToInt(FBSize.Y / Scale), 1);
+
+		UE_LOG(LogMillicastPublisher, Log, TEXT("Simulcast layer %s: %dx%d, max framerate %d"), *Layer.Rid, Width, Height, Layer.MaxFramerate);
+		CaptureContexts.Add(MakeShared<FAVEncoderContext, ESPMode::ThreadSafe>(Width, Height, true, GetNumEncoderInputFrames()));
 	}
 }
+
+int32 FTexture2DVideoSourceAdapter::GetNumEncoderInputFrames() const
+{
+	// The frames waiting in the queue, the one being encoded and the one being captured
+	return InputQueue->GetMaxDepth() + 2;
+}
+#endif
+
+void FTexture2DVideoSourceAdapter::SetEncoderQueue(int32 InDepth, EMillicastEncoderQueuePolicy InPolicy)
+{
+	InputQueue = MakeShared<FEncoderInputQueue, ESPMode::ThreadSafe>(InDepth, InPolicy);
+
+	UE_LOG(LogMillicastPublisher, Log, TEXT("Encoder input queue of %d frames, %s when full"), InputQueue->GetMaxDepth(),
+		InPolicy == EMillicastEncoderQueuePolicy::Block ? TEXT("block") : TEXT("drop oldest"));
+}
+
+FIntPoint FTexture2DVideoSourceAdapter::ApplyEncoderAdaptation(const FIntPoint& SourceSize)
+{
+	AdaptationController->OnFrameCaptured(FPlatformTime::Seconds());
+
+	const FAdaptationLevel Level = AdaptationController->GetLevel();
+
+	if (Level.MaxFramerate != AdaptedMaxFramerate)
+	{
+		AdaptedMaxFramerate = Level.MaxFramerate;
+
+		// Frames over the framerate are then dropped by AdaptFrame
+		video_adapter()->OnOutputFormatRequest(absl::nullopt, absl::nullopt,
+			AdaptedMaxFramerate > 0 ? absl::optional<int>(AdaptedMaxFramerate) : absl::nullopt);
+	}
+
+	if (Level.ResolutionScale != AdaptedResolutionScale)
+	{
+		AdaptedResolutionScale = Level.ResolutionScale;
+#if WITH_AVENCODER
+		// Capture contexts have a fixed resolution, recreate them at the new one. The encoders and the frames in flight
+		// still hold the previous ones, which are destroyed when they let go of them.
+		CaptureContexts.Empty();
 #endif
+	}
+
+	if (AdaptedResolutionScale >= 1.f)
+	{
+		return SourceSize;
+	}
+
+	// Keep the size even for the I420 conversion
+	const int32 Width = FMath::Max(FMath::FloorToInt(SourceSize.X * AdaptedResolutionScale) & ~1, 2);
+	const int32 Height = FMath::Max(FMath::FloorToInt(SourceSize.Y * AdaptedResolutionScale) & ~1, 2);
+
+	return { Width, Height };
+}
+
+void FTexture2DVideoSourceAdapter::SetContentHint(EMillicastVideoContentHint InContentHint)
+{
+	ContentHint = InContentHint;
+	AdaptationController->SetMaintainResolution(ContentHint == EMillicastVideoContentHint::Detail);
+}
+
+webrtc::VideoTrackInterface::ContentHint FTexture2DVideoSourceAdapter::GetTrackContentHint() const
+{
+	return ContentHint == EMillicastVideoContentHint::Detail
+		? webrtc::VideoTrackInterface::ContentHint::kDetailed
+		: webrtc::VideoTrackInterface::ContentHint::kFluid;
+}
+
+void FTexture2DVideoSourceAdapter::SetImportanceMap(TSharedPtr<const FMillicastImportanceMap, ESPMode::ThreadSafe> InImportanceMap)
+{
+	FScopeLock Lock(&ImportanceMapSection);
+	ImportanceMap = MoveTemp(InImportanceMap);
+}
+
+bool FTexture2DVideoSourceAdapter::ShouldCaptureLayer(int32 LayerIndex, int64 TimestampUs)
+{
+	if (!SimulcastLayers.IsValidIndex(LayerIndex) || SimulcastLayers[LayerIndex].MaxFramerate <= 0)
+	{
+		return true;
+	}
+
+	if (LastLayerCaptureUs.Num() != SimulcastLayers.Num())
+	{
+		LastLayerCaptureUs.Init(0, SimulcastLayers.Num());
+	}
+
+	// Allow some jitter on the render loop so that a 60fps capture yields 30fps and not 20fps on a 30fps layer
+	const int64 MinIntervalUs = (rtc::kNumMicrosecsPerSec / SimulcastLayers[LayerIndex].MaxFramerate) * 9 / 10;
+	if (TimestampUs - LastLayerCaptureUs[LayerIndex] < MinIntervalUs)
+	{
+		return false;
+	}
+
+	LastLayerCaptureUs[LayerIndex] = TimestampUs;
+	return true;
+}
+
+int64 FTexture2DVideoSourceAdapter::GetCaptureTimestampUs()
+{
+	// Called on the render thread, the frame it renders was begun by the game thread with the same number
+	const int64 FrameTimeUs = FCaptureClock::Get().GetFrameTimeUs(GFrameNumberRenderThread);
+
+	// webrtc expects increasing timestamps, even if the same engine frame is captured twice
+	LastTimestampUs = FMath::Max(FrameTimeUs, LastTimestampUs + 1);
+
+	if (FPublisherStats::Get().IsMeasuringAVOffset())
+	{
+		FPublisherStats::Get().VideoFrameSent((FCaptureClock::NowUs() - LastTimestampUs) / 1000.0);
+	}
+
+	return LastTimestampUs;
+}
+
 bool FTexture2DVideoSourceAdapter::AdaptVideoFrame(int64 TimestampUs, FIntPoint Resolution)
 {
 	int out_width, out_height, crop_width, crop_height, crop_x, crop_y;
@@ -3,12 +3,19 @@
 #pragma once
 
 #include "WebRTCInc.h"
+#include "MillicastSimulcastLayer.h"
+#include "IMillicastSource.h"
+#include "EncoderAdaptationController.h"
+#include "EncoderInputQueue.h"
+#include "KeyFrameGovernor.h"
 #if WITH_AVENCODER
 #include "AVEncoderContext.h"
 #endif
 /** Video Source adapter to create webrtc video frame from a Texture 2D and push it into webrtc pipelines */
 namespace Millicast::Publisher
 {
+	class FEncodedFrameFanOut;
+
 	class FTexture2DVideoSourceAdapter : public rtc::AdaptedVideoTrackSource
 	{
 	public:
@@ -17,19 +24,64 @@ namespace Millicast::Publisher
 		// rtc::AdaptedVideoTrackSource
 		webrtc::MediaSourceInterface::SourceState state() const override { return webrtc::MediaSourceInterface::kLive; }
 		absl::optional<bool> needs_denoising() const override { return false; }
-		bool is_screencast() const override { return false; }
+		bool is_screencast() const override { return ContentHint == EMillicastVideoContentHint::Detail; }
 		bool remote() const override { return false; }
 		// ~rtc::AdaptedVideoTrackSource
 
 		void SetSimulcast(bool InSimulcast) { Simulcast = InSimulcast; }
+		void SetSimulcastLayers(const TArray<FMillicastSimulcastLayer>& InSimulcastLayers) { SimulcastLayers = InSimulcastLayers; }
+
+		/** Detail content is encoded as screen content and gives up framerate before resolution */
+		void SetContentHint(EMillicastVideoContentHint InContentHint);
+		webrtc::VideoTrackInterface::ContentHint GetTrackContentHint() const;
+
+		/** Attached to every frame captured from now on, null to encode the whole frame uniformly */
+		void SetImportanceMap(TSharedPtr<const FMillicastImportanceMap, ESPMode::ThreadSafe> InImportanceMap);
+
+		/** Share the encoded frames with other peer connections, set before the capture starts */
+		void SetFanOut(TSharedPtr<FEncodedFrameFanOut, ESPMode::ThreadSafe> InFanOut) { FanOut = MoveTemp(InFanOut); }
+
+		/** When the encoder produces key frames, set before the capture starts */
+		void SetKeyFrameSettings(TSharedPtr<const FKeyFrameGovernorSettings, ESPMode::ThreadSafe> InSettings) { KeyFrameSettings = MoveTemp(InSettings); }
+
+		/** Bound the frames waiting for the encoder, set before the capture starts */
+		void SetEncoderQueue(int32 InDepth, EMillicastEncoderQueuePolicy InPolicy);
+		FEncoderInputQueue::FStats GetEncoderQueueStats() const { return InputQueue->GetStats(); }
+
+		/** Whether a simulcast layer is captured for the frame rendered at TimestampUs, false until its framerate cap allows */
+		bool ShouldCaptureLayer(int32 LayerIndex, int64 TimestampUs);
 		
 	private:
+		/** Capture time of the engine frame being rendered, on the clock of the audio capture times */
+		int64 GetCaptureTimestampUs();
 		bool AdaptVideoFrame(int64 TimestampUs, FIntPoint Resolution);
-		void TryInitializeCaptureContexts(const FTexture2DRHIRef& FrameBuffer);
+		void TryInitializeCaptureContexts(const FIntPoint& FBSize);
+		/** Returns the resolution to capture at, restricted by the encoder adaptation level */
+		FIntPoint ApplyEncoderAdaptation(const FIntPoint& SourceSize);
 #if WITH_AVENCODER
+		/** Size of the pool of encoder input frames of each capture context, enough to never run out with a full queue */
+		int32 GetNumEncoderInputFrames() const;
 
-		TArray<TUniquePtr<FAVEncoderContext>> CaptureContexts;
+		// Shared with the frames in flight and the encoders, a context replaced on a resolution change is destroyed once
+		// its last frame is released and its encoder moved to the new context
+		TArray<TSharedPtr<FAVEncoderContext, ESPMode::ThreadSafe>> CaptureContexts;
 #endif
 		bool Simulcast = false;
+		TArray<FMillicastSimulcastLayer> SimulcastLayers;
+		EMillicastVideoContentHint ContentHint = EMillicastVideoContentHint::Motion;
+
+		FCriticalSection ImportanceMapSection;
+		TSharedPtr<const FMillicastImportanceMap, ESPMode::ThreadSafe> ImportanceMap;
+		TArray<int64> LastLayerCaptureUs;
+		int64 LastTimestampUs = 0;
+
+		TSharedPtr<FEncodedFrameFanOut, ESPMode::ThreadSafe> FanOut;
+		TSharedPtr<const FKeyFrameGovernorSettings, ESPMode::ThreadSafe> KeyFrameSettings;
+
+		TSharedPtr<FEncoderInputQueue, ESPMode::ThreadSafe> InputQueue = MakeShared<FEncoderInputQueue, ESPMode::ThreadSafe>(1, EMillicastEncoderQueuePolicy::DropOldest);
+
+		TSharedPtr<FEncoderAdaptationController, ESPMode::ThreadSafe> AdaptationController = MakeShared<FEncoderAdaptationController, ESPMode::ThreadSafe>();
+		float AdaptedResolutionScale = 1.f;
+		int32 AdaptedMaxFramerate = 0;
 	};
 }
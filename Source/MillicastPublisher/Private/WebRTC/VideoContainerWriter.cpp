@@ -0,0 +1,719 @@
+// Copyright Dolby.io 2023. All Rights Reserved.
+
+#include "VideoContainerWriter.h"
+
+#include "H264NalIndexer.h"
+#include "MillicastPublisherPrivate.h"
+
+#include "HAL/FileManager.h"
+
+namespace Millicast::Publisher
+{
+
+// Writes are gathered until this size before hitting the disk
+constexpr int32 FileBufferSize = 1024 * 1024;
+
+// Timescale of the recorded timestamps, the RTP video clock rate
+constexpr uint32 VideoTimescale = 90000;
+
+FBufferedFileWriter::~FBufferedFileWriter()
+{
+	Close();
+}
+
+bool FBufferedFileWriter::Open(const FString& Path)
+{
+	Archive.Reset(IFileManager::Get().CreateFileWriter(*Path));
+	if (!Archive)
+	{
+		UE_LOG(LogMillicastPublisher, Error, TEXT("Could not create the recording file %s"), *Path);
+		return false;
+	}
+
+	Buffer.Reserve(FileBufferSize);
+	FlushedBytes = 0;
+	return true;
+}
+
+void FBufferedFileWriter::Close()
+{
+	if (Archive)
+	{
+		Flush();
+		Archive->Close();
+		Archive.Reset();
+	}
+}
+
+void FBufferedFileWriter::Write(const uint8* Data, int64 Size)
+{
+	if (!Archive)
+	{
+		return;
+	}
+
+	if (Buffer.Num() + Size > FileBufferSize)
+	{
+		Flush();
+	}
+
+	// Large frames go straight to the file instead of going through the buffer
+	if (Size >= FileBufferSize)
+	{
+		Archive->Serialize(const_cast<uint8*>(Data), Size);
+		FlushedBytes += Size;
+		return;
+	}
+
+	Buffer.Append(Data, Size);
+}
+
+void FBufferedFileWriter::Patch(int64 Offset, const uint8* Data, int64 Size)
+{
+	if (!Archive)
+	{
+		return;
+	}
+
+	Flush();
+
+	const int64 End = Archive->Tell();
+	Archive->Seek(Offset);
+	Archive->Serialize(const_cast<uint8*>(Data), Size);
+	Archive->Seek(End);
+}
+
+void FBufferedFileWriter::Flush()
+{
+	if (Buffer.Num() > 0)
+	{
+		Archive->Serialize(Buffer.GetData(), Buffer.Num());
+		FlushedBytes += Buffer.Num();
+		Buffer.Reset();
+	}
+}
+
+/*
+ * IVF, the raw container of the libvpx tools: a 32 bytes header then a 12 bytes header per frame.
+ * All fields are little endian.
+ */
+class FIvfWriter : public IVideoContainerWriter
+{
+public:
+	explicit FIvfWriter(webrtc::VideoCodecType InCodecType) : CodecType(InCodecType) {}
+
+	bool Open(const FString& Path) override
+	{
+		return File.Open(Path);
+	}
+
+	void WriteFrame(const FRecordedFrame& Frame) override
+	{
+		if (!bHeaderWritten)
+		{
+			if (!Frame.bKeyFrame)
+			{
+				return;
+			}
+
+			WriteHeader(Frame.Width, Frame.Height);
+			bHeaderWritten = true;
+		}
+
+		uint8 FrameHeader[12];
+		WriteLE32(FrameHeader, Frame.Data.Num());
+		WriteLE64(FrameHeader + 4, Timestamps.Unwrap(Frame.RtpTimestamp));
+
+		File.Write(FrameHeader, sizeof(FrameHeader));
+		File.Write(Frame.Data);
+		++NumFrames;
+	}
+
+	void Close() override
+	{
+		if (bHeaderWritten)
+		{
+			uint8 FrameCount[4];
+			WriteLE32(FrameCount, NumFrames);
+			File.Patch(24, FrameCount, sizeof(FrameCount));
+		}
+
+		File.Close();
+	}
+
+private:
+	static void WriteLE16(uint8* Out, uint16 Value)
+	{
+		Out[0] = Value & 0xFF;
+		Out[1] = Value >> 8;
+	}
+
+	static void WriteLE32(uint8* Out, uint32 Value)
+	{
+		WriteLE16(Out, Value & 0xFFFF);
+		WriteLE16(Out + 2, Value >> 16);
+	}
+
+	static void WriteLE64(uint8* Out, uint64 Value)
+	{
+		WriteLE32(Out, Value & 0xFFFFFFFF);
+		WriteLE32(Out + 4, Value >> 32);
+	}
+
+	void WriteHeader(int32 Width, int32 Height)
+	{
+		uint8 Header[32] = { 'D', 'K', 'I', 'F' };
+		WriteLE16(Header + 4, 0); // Version
+		WriteLE16(Header + 6, sizeof(Header));
+		FMemory::Memcpy(Header + 8, CodecType == webrtc::kVideoCodecVP9 ? "VP90" : "VP80", 4);
+		WriteLE16(Header + 12, Width);
+		WriteLE16(Header + 14, Height);
+		WriteLE32(Header + 16, VideoTimescale); // Time base denominator
+		WriteLE32(Header + 20, 1); // Time base numerator
+		WriteLE32(Header + 24, 0); // Frame count, patched when closing
+
+		File.Write(Header, sizeof(Header));
+	}
+
+	webrtc::VideoCodecType CodecType;
+	FBufferedFileWriter File;
+	FTimestampUnwrapper Timestamps;
+	bool bHeaderWritten = false;
+	uint32 NumFrames = 0;
+};
+
+/** Builds big endian ISO BMFF boxes in memory */
+class FMp4BoxWriter
+{
+public:
+	void U8(uint8 Value) { Data.Add(Value); }
+	void U16(uint16 Value) { U8(Value >> 8); U8(Value & 0xFF); }
+	void U32(uint32 Value) { U16(Value >> 16); U16(Value & 0xFFFF); }
+	void U64(uint64 Value) { U32(Value >> 32); U32(Value & 0xFFFFFFFF); }
+	void Bytes(const uint8* In, int32 Size) { Data.Append(In, Size); }
+	void Zeros(int32 Count) { Data.AddZeroed(Count); }
+	void FourCC(const char* Type) { Bytes(reinterpret_cast<const uint8*>(Type), 4); }
+
+	void BeginBox(const char* Type)
+	{
+		BoxStarts.Push(Data.Num());
+		U32(0); // Size, set by EndBox
+		FourCC(Type);
+	}
+
+	void BeginFullBox(const char* Type, uint8 Version, uint32 Flags)
+	{
+		BeginBox(Type);
+		U32((static_cast<uint32>(Version) << 24) | (Flags & 0xFFFFFF));
+	}
+
+	void EndBox()
+	{
+		const int32 Start = BoxStarts.Pop();
+		const uint32 Size = Data.Num() - Start;
+		Data[Start] = Size >> 24;
+		Data[Start + 1] = (Size >> 16) & 0xFF;
+		Data[Start + 2] = (Size >> 8) & 0xFF;
+		Data[Start + 3] = Size & 0xFF;
+	}
+
+	void Matrix()
+	{
+		// Identity transform
+		const uint32 Values[] = { 0x00010000, 0, 0, 0, 0x00010000, 0, 0, 0, 0x40000000 };
+		for (uint32 Value : Values)
+		{
+			U32(Value);
+		}
+	}
+
+	TArray<uint8> Data;
+
+private:
+	TArray<int32> BoxStarts;
+};
+
+/*
+ * Fragmented MP4 with one fragment per frame, so that the file is playable up to the last written frame
+ * even if the application does not close it. The samples use the avc3 entry: the parameter sets stay in band
+ * and the resolution can change in the middle of the recording.
+ * The duration of a sample is only known with the next one, so frames are written with one frame of delay.
+ */
+class FFragmentedMp4Writer : public IVideoContainerWriter
+{
+public:
+	bool Open(const FString& Path) override
+	{
+		return File.Open(Path);
+	}
+
+	void WriteFrame(const FRecordedFrame& Frame) override
+	{
+		if (!bHeaderWritten)
+		{
+			if (!Frame.bKeyFrame || !WriteHeader(Frame))
+			{
+				return;
+			}
+			bHeaderWritten = true;
+		}
+
+		const uint64 Time = Timestamps.Unwrap(Frame.RtpTimestamp);
+
+		if (PendingSample.Num() > 0)
+		{
+			LastDuration = static_cast<uint32>(Time - PendingTime);
+			WriteFragment();
+		}
+
+		// Annex B to length prefixed NAL units, access unit delimiters are not needed in MP4
+		PendingSample.Reset();
+		for (const FH264NalUnit& Unit : NalIndexer.Index(Frame.Data.GetData(), Frame.Data.Num()))
+		{
+			if (Unit.Size == 0 || Unit.GetType(Frame.Data.GetData()) == 9)
+			{
+				continue;
+			}
+
+			const uint8 Length[4] = { uint8(Unit.Size >> 24), uint8((Unit.Size >> 16) & 0xFF), uint8((Unit.Size >> 8) & 0xFF), uint8(Unit.Size & 0xFF) };
+			PendingSample.Append(Length, 4);
+			PendingSample.Append(Frame.Data.GetData() + Unit.Offset, Unit.Size);
+		}
+
+		PendingTime = Time;
+		bPendingKeyFrame = Frame.bKeyFrame;
+	}
+
+	void Close() override
+	{
+		if (PendingSample.Num() > 0)
+		{
+			WriteFragment();
+		}
+
+		File.Close();
+	}
+
+private:
+	bool WriteHeader(const FRecordedFrame& Frame)
+	{
+		const uint8* Data = Frame.Data.GetData();
+		const FH264NalUnit* Sps = nullptr;
+		const FH264NalUnit* Pps = nullptr;
+
+		for (const FH264NalUnit& Unit : NalIndexer.Index(Data, Frame.Data.Num()))
+		{
+			// A start code at the very end of the frame has no header byte to read
+			if (Unit.Size == 0)
+			{
+				continue;
+			}
+
+			const uint8 Type = Unit.GetType(Data);
+			if (Type == 7 && !Sps && Unit.Size >= 4)
+			{
+				Sps = &Unit;
+			}
+			else if (Type == 8 && !Pps)
+			{
+				Pps = &Unit;
+			}
+		}
+
+		if (!Sps || !Pps)
+		{
+			UE_LOG(LogMillicastPublisher, Warning, TEXT("H264 key frame without parameter sets, waiting for the next one to start the recording"));
+			return false;
+		}
+
+		FMp4BoxWriter Box;
+
+		Box.BeginBox("ftyp");
+		Box.FourCC("isom");
+		Box.U32(0x200);
+		Box.FourCC("isom");
+		Box.FourCC("iso6");
+		Box.FourCC("avc1");
+		Box.FourCC("mp41");
+		Box.EndBox();
+
+		Box.BeginBox("moov");
+		{
+			Box.BeginFullBox("mvhd", 0, 0);
+			Box.U32(0); // Creation time
+			Box.U32(0); // Modification time
+			Box.U32(1000); // Timescale
+			Box.U32(0); // Duration, given by the fragments
+			Box.U32(0x00010000); // Rate
+			Box.U16(0x0100); // Volume
+			Box.Zeros(10);
+			Box.Matrix();
+			Box.Zeros(24);
+			Box.U32(2); // Next track id
+			Box.EndBox();
+
+			Box.BeginBox("trak");
+			{
+				Box.BeginFullBox("tkhd", 0, 0x3); // Enabled, in movie
+				Box.U32(0);
+				Box.U32(0);
+				Box.U32(TrackId);
+				Box.U32(0);
+				Box.U32(0); // Duration
+				Box.Zeros(8);
+				Box.U16(0); // Layer
+				Box.U16(0); // Alternate group
+				Box.U16(0); // Volume
+				Box.U16(0);
+				Box.Matrix();
+				Box.U32(static_cast<uint32>(Frame.Width) << 16);
+				Box.U32(static_cast<uint32>(Frame.Height) << 16);
+				Box.EndBox();
+
+				Box.BeginBox("mdia");
+				{
+					Box.BeginFullBox("mdhd", 0, 0);
+					Box.U32(0);
+					Box.U32(0);
+					Box.U32(VideoTimescale);
+					Box.U32(0);
+					Box.U16(0x55C4); // "und" language
+					Box.U16(0);
+					Box.EndBox();
+
+					Box.BeginFullBox("hdlr", 0, 0);
+					Box.U32(0);
+					Box.FourCC("vide");
+					Box.Zeros(12);
+					Box.Bytes(reinterpret_cast<const uint8*>("VideoHandler"), 13);
+					Box.EndBox();
+
+					Box.BeginBox("minf");
+					{
+						Box.BeginFullBox("vmhd", 0, 1);
+						Box.Zeros(8); // Graphics mode and opcolor
+						Box.EndBox();
+
+						Box.BeginBox("dinf");
+						Box.BeginFullBox("dref", 0, 0);
+						Box.U32(1);
+						Box.BeginFullBox("url ", 0, 1); // Media data in the same file
+						Box.EndBox();
+						Box.EndBox();
+						Box.EndBox();
+
+						Box.BeginBox("stbl");
+						{
+							Box.BeginFullBox("stsd", 0, 0);
+							Box.U32(1);
+							WriteSampleEntry(Box, Frame, Data, *Sps, *Pps);
+							Box.EndBox();
+
+							// The samples are all in the fragments
+							for (const char* Type : { "stts", "stsc", "stco" })
+							{
+								Box.BeginFullBox(Type, 0, 0);
+								Box.U32(0);
+								Box.EndBox();
+							}
+
+							Box.BeginFullBox("stsz", 0, 0);
+							Box.U32(0);
+							Box.U32(0);
+							Box.EndBox();
+						}
+						Box.EndBox();
+					}
+					Box.EndBox();
+				}
+				Box.EndBox();
+			}
+			Box.EndBox();
+
+			Box.BeginBox("mvex");
+			Box.BeginFullBox("trex", 0, 0);
+			Box.U32(TrackId);
+			Box.U32(1); // Sample description index
+			Box.U32(0);
+			Box.U32(0);
+			Box.U32(0);
+			Box.EndBox();
+			Box.EndBox();
+		}
+		Box.EndBox();
+
+		File.Write(Box.Data);
+		return true;
+	}
+
+	static void WriteSampleEntry(FMp4BoxWriter& Box, const FRecordedFrame& Frame, const uint8* Data, const FH264NalUnit& Sps, const FH264NalUnit& Pps)
+	{
+		const uint8* SpsData = Data + Sps.Offset;
+		const uint8* PpsData = Data + Pps.Offset;
+
+		Box.BeginBox("avc3");
+		Box.Zeros(6);
+		Box.U16(1); // Data reference index
+		Box.Zeros(16);
+		Box.U16(Frame.Width);
+		Box.U16(Frame.Height);
+		Box.U32(0x00480000); // 72 dpi
+		Box.U32(0x00480000);
+		Box.U32(0);
+		Box.U16(1); // Frame count
+		Box.Zeros(32); // Compressor name
+		Box.U16(0x0018); // Depth
+		Box.U16(0xFFFF);
+
+		Box.BeginBox("avcC");
+		Box.U8(1); // Configuration version
+		Box.U8(SpsData[1]); // Profile
+		Box.U8(SpsData[2]); // Profile compatibility
+		Box.U8(SpsData[3]); // Level
+		Box.U8(0xFF); // 4 bytes NAL unit lengths
+		Box.U8(0xE1); // One SPS
+		Box.U16(Sps.Size);
+		Box.Bytes(SpsData, Sps.Size);
+		Box.U8(1); // One PPS
+		Box.U16(Pps.Size);
+		Box.Bytes(PpsData, Pps.Size);
+		Box.EndBox();
+
+		Box.EndBox();
+	}
+
+	void WriteFragment()
+	{
+		FMp4BoxWriter Box;
+		int32 DataOffsetPosition = 0;
+
+		Box.BeginBox("moof");
+		{
+			Box.BeginFullBox("mfhd", 0, 0);
+			Box.U32(++SequenceNumber);
+			Box.EndBox();
+
+			Box.BeginBox("traf");
+			{
+				Box.BeginFullBox("tfhd", 0, 0x020000); // Default base is moof
+				Box.U32(TrackId);
+				Box.EndBox();
+
+				Box.BeginFullBox("tfdt", 1, 0);
+				Box.U64(PendingTime);
+				Box.EndBox();
+
+				Box.BeginFullBox("trun", 0, 0x000701); // Data offset, sample duration, size and flags
+				Box.U32(1);
+				DataOffsetPosition = Box.Data.Num();
+				Box.U32(0); // Data offset, set once the size of the moof is known
+				Box.U32(LastDuration);
+				Box.U32(PendingSample.Num());
+				Box.U32(bPendingKeyFrame ? 0x02000000 : 0x01010000); // Sync sample, or depends on others and not sync
+				Box.EndBox();
+			}
+			Box.EndBox();
+		}
+		Box.EndBox();
+
+		// The sample starts right after the mdat header
+		const uint32 DataOffset = Box.Data.Num() + 8;
+		Box.Data[DataOffsetPosition] = DataOffset >> 24;
+		Box.Data[DataOffsetPosition + 1] = (DataOffset >> 16) & 0xFF;
+		Box.Data[DataOffsetPosition + 2] = (DataOffset >> 8) & 0xFF;
+		Box.Data[DataOffsetPosition + 3] = DataOffset & 0xFF;
+
+		Box.U32(PendingSample.Num() + 8);
+		Box.FourCC("mdat");
+
+		File.Write(Box.Data);
+		File.Write(PendingSample);
+
+		PendingSample.Reset();
+	}
+
+	static constexpr uint32 TrackId = 1;
+
+	FBufferedFileWriter File;
+	FH264NalIndexer NalIndexer;
+	FTimestampUnwrapper Timestamps;
+	bool bHeaderWritten = false;
+
+	uint32 SequenceNumber = 0;
+	TArray<uint8> PendingSample;
+	uint64 PendingTime = 0;
+	bool bPendingKeyFrame = false;
+	uint32 LastDuration = VideoTimescale / 30;
+};
+
+TUniquePtr<IVideoContainerWriter> IVideoContainerWriter::Create(webrtc::VideoCodecType CodecType)
+{
+	switch (CodecType)
+	{
+	case webrtc::kVideoCodecVP8:
+	case webrtc::kVideoCodecVP9:
+		return MakeUnique<FIvfWriter>(CodecType);
+	case webrtc::kVideoCodecH264:
+		return MakeUnique<FFragmentedMp4Writer>();
+	default:
+		return nullptr;
+	}
+}
+
+const TCHAR* IVideoContainerWriter::GetExtension(webrtc::VideoCodecType CodecType)
+{
+	return CodecType == webrtc::kVideoCodecH264 ? TEXT("mp4") : TEXT("ivf");
+}
+
+// Opus packets are timed on a 48 kHz clock whatever the input rate
+constexpr uint32 OpusTimescale = 48000;
+
+// Ogg page header flags
+constexpr uint8 OggFirstPage = 0x02;
+constexpr uint8 OggLastPage = 0x04;
+
+// A page has at most 255 segments of up to 255 bytes, the larger packets are not recorded
+constexpr int32 OggMaxPacketSize = 255 * 254;
+
+template<typename T>
+static void AppendLE(TArray<uint8>& Out, T Value)
+{
+	for (int32 i = 0; i < static_cast<int32>(sizeof(T)); ++i)
+	{
+		Out.Add(static_cast<uint8>(static_cast<uint64>(Value) >> (8 * i)));
+	}
+}
+
+bool FOggOpusWriter::Open(const FString& Path)
+{
+	SerialNumber = FPlatformTime::Cycles();
+	return File.Open(Path);
+}
+
+void FOggOpusWriter::WritePacket(const FRecordedAudioPacket& Packet)
+{
+	if (Packet.Data.Num() > OggMaxPacketSize || !Packet.StreamInfo)
+	{
+		return;
+	}
+
+	if (!bHeaderWritten)
+	{
+		WriteHeaders(*Packet.StreamInfo);
+		bHeaderWritten = true;
+	}
+
+	if (PendingPacket.Num() > 0)
+	{
+		WritePage(PendingPacket.GetData(), PendingPacket.Num(), PendingGranulePosition, 0);
+	}
+
+	// The granule position is the end of the last packet of the page, pre-skip included
+	PendingPacket = Packet.Data;
+	PendingGranulePosition = Timestamps.Unwrap(Packet.RtpTimestamp) + Packet.Duration;
+}
+
+void FOggOpusWriter::Close()
+{
+	if (PendingPacket.Num() > 0)
+	{
+		WritePage(PendingPacket.GetData(), PendingPacket.Num(), PendingGranulePosition, OggLastPage);
+		PendingPacket.Reset();
+	}
+
+	File.Close();
+}
+
+uint32 FOggOpusWriter::Crc32(const uint8* Data, int32 Size)
+{
+	// Polynomial 0x04C11DB7, most significant bit first, no reflection and no final xor
+	static const TArray<uint32> Table = []()
+	{
+		TArray<uint32> Result;
+		Result.SetNumUninitialized(256);
+		for (uint32 i = 0; i < 256; ++i)
+		{
+			uint32 Value = i << 24;
+			for (int32 Bit = 0; Bit < 8; ++Bit)
+			{
+				Value = (Value & 0x80000000) ? (Value << 1) ^ 0x04C11DB7 : Value << 1;
+			}
+			Result[i] = Value;
+		}
+		return Result;
+	}();
+
+	uint32 Crc = 0;
+	for (int32 i = 0; i < Size; ++i)
+	{
+		Crc = (Crc << 8) ^ Table[((Crc >> 24) ^ Data[i]) & 0xFF];
+	}
+
+	return Crc;
+}
+
+void FOggOpusWriter::WriteHeaders(const FOpusStreamInfo& StreamInfo)
+{
+	const bool bMultistream = StreamInfo.ChannelMapping.Num() > 0;
+
+	TArray<uint8> Head;
+	Head.Append(reinterpret_cast<const uint8*>("OpusHead"), 8);
+	Head.Add(1); // Version
+	Head.Add(static_cast<uint8>(StreamInfo.NumChannels));
+	AppendLE<uint16>(Head, StreamInfo.PreSkip);
+	AppendLE<uint32>(Head, OpusTimescale); // Input sample rate, informative only
+	AppendLE<int16>(Head, 0); // Output gain
+	Head.Add(bMultistream ? 1 : 0); // Channel mapping family, the Vorbis order for multistream
+	if (bMultistream)
+	{
+		Head.Add(static_cast<uint8>(StreamInfo.NumStreams));
+		Head.Add(static_cast<uint8>(StreamInfo.NumCoupledStreams));
+		Head.Append(StreamInfo.ChannelMapping);
+	}
+
+	WritePage(Head.GetData(), Head.Num(), 0, OggFirstPage);
+
+	static const char Vendor[] = "Millicast Publisher";
+
+	TArray<uint8> Tags;
+	Tags.Append(reinterpret_cast<const uint8*>("OpusTags"), 8);
+	AppendLE<uint32>(Tags, sizeof(Vendor) - 1);
+	Tags.Append(reinterpret_cast<const uint8*>(Vendor), sizeof(Vendor) - 1);
+	AppendLE<uint32>(Tags, 0); // No user comment
+
+	WritePage(Tags.GetData(), Tags.Num(), 0, 0);
+}
+
+void FOggOpusWriter::WritePage(const uint8* Data, int32 Size, uint64 GranulePosition, uint8 HeaderType)
+{
+	TArray<uint8> Page;
+	Page.Reserve(27 + 255 + Size);
+	Page.Append(reinterpret_cast<const uint8*>("OggS"), 4);
+	Page.Add(0); // Version
+	Page.Add(HeaderType);
+	AppendLE<uint64>(Page, GranulePosition);
+	AppendLE<uint32>(Page, SerialNumber);
+	AppendLE<uint32>(Page, PageSequenceNumber++);
+	AppendLE<uint32>(Page, 0); // CRC, computed over the whole page
+
+	// Lacing values, a segment shorter than 255 bytes ends the packet
+	const int32 NumSegments = Size / 255 + 1;
+	Page.Add(static_cast<uint8>(NumSegments));
+	for (int32 i = 0; i < NumSegments - 1; ++i)
+	{
+		Page.Add(255);
+	}
+	Page.Add(static_cast<uint8>(Size % 255));
+
+	Page.Append(Data, Size);
+
+	const uint32 Crc = Crc32(Page.GetData(), Page.Num());
+	for (int32 i = 0; i < 4; ++i)
+	{
+		Page[22 + i] = static_cast<uint8>(Crc >> (8 * i));
+	}
+
+	File.Write(Page);
+}
+
+}
@@ -0,0 +1,144 @@
+// Copyright Dolby.io 2023. All Rights Reserved.
+
+#pragma once
+
+#include "WebRTCInc.h"
+
+class FArchive;
+
+namespace Millicast::Publisher
+{
+	/** An encoded frame as it has been sent */
+	struct FRecordedFrame
+	{
+		webrtc::VideoCodecType CodecType;
+		TArray<uint8> Data;
+		uint32 RtpTimestamp;
+		int32 Width;
+		int32 Height;
+		bool bKeyFrame;
+	};
+
+	/** Layout of a recorded Opus stream, for the identification header of the file */
+	struct FOpusStreamInfo
+	{
+		int32 NumChannels = 2;
+		/** Samples at 48 kHz the decoder discards at the start, the look-ahead of the encoder */
+		int32 PreSkip = 312;
+		/** Multistream only, empty for the streams of one or two channels */
+		int32 NumStreams = 1;
+		int32 NumCoupledStreams = 1;
+		TArray<uint8> ChannelMapping;
+	};
+
+	/** An encoded Opus packet as it has been sent */
+	struct FRecordedAudioPacket
+	{
+		TSharedPtr<const FOpusStreamInfo, ESPMode::ThreadSafe> StreamInfo;
+		TArray<uint8> Data;
+		/** At the 48 kHz clock of Opus */
+		uint32 RtpTimestamp;
+		uint32 Duration;
+	};
+
+	/** File writer that only does large sequential writes */
+	class FBufferedFileWriter
+	{
+	public:
+		~FBufferedFileWriter();
+
+		bool Open(const FString& Path);
+		void Close();
+
+		void Write(const uint8* Data, int64 Size);
+		void Write(const TArray<uint8>& Data) { Write(Data.GetData(), Data.Num()); }
+
+		/** Overwrite bytes that have already been written, e.g. a header field only known at the end */
+		void Patch(int64 Offset, const uint8* Data, int64 Size);
+
+		int64 Tell() const { return FlushedBytes + Buffer.Num(); }
+
+	private:
+		void Flush();
+
+		TUniquePtr<FArchive> Archive;
+		TArray<uint8> Buffer;
+		int64 FlushedBytes = 0;
+	};
+
+	/** Turns the 32 bits RTP timestamps into a 64 bits timeline starting at 0 */
+	class FTimestampUnwrapper
+	{
+	public:
+		uint64 Unwrap(uint32 RtpTimestamp)
+		{
+			if (bFirst)
+			{
+				bFirst = false;
+			}
+			else
+			{
+				// Frames are in order, the difference is small even across the wrap around
+				Time += FMath::Max(static_cast<int32>(RtpTimestamp - LastRtpTimestamp), 0);
+			}
+
+			LastRtpTimestamp = RtpTimestamp;
+			return Time;
+		}
+
+	private:
+		bool bFirst = true;
+		uint32 LastRtpTimestamp = 0;
+		uint64 Time = 0;
+	};
+
+	/*
+	 * Writes the encoded frames of a stream into a container without re-encoding them.
+	 * The container starts at the first key frame. Only used from the writer thread of the recorder.
+	 */
+	class IVideoContainerWriter
+	{
+	public:
+		virtual ~IVideoContainerWriter() = default;
+
+		virtual bool Open(const FString& Path) = 0;
+		virtual void WriteFrame(const FRecordedFrame& Frame) = 0;
+		virtual void Close() = 0;
+
+		/** IVF for VP8 and VP9, fragmented MP4 for H264, null for the other codecs */
+		static TUniquePtr<IVideoContainerWriter> Create(webrtc::VideoCodecType CodecType);
+
+		/** The file extension of the container used for this codec, without the dot */
+		static const TCHAR* GetExtension(webrtc::VideoCodecType CodecType);
+	};
+
+	/*
+	 * Ogg Opus (RFC 7845), the audio of the recording goes to its own file next to the video.
+	 * One packet per page, written with one packet of delay to flag the last page when closing.
+	 * Only used from the writer thread of the recorder.
+	 */
+	class FOggOpusWriter
+	{
+	public:
+		bool Open(const FString& Path);
+		void WritePacket(const FRecordedAudioPacket& Packet);
+		void Close();
+
+		/** The CRC of the Ogg pages, exposed for the tests */
+		static uint32 Crc32(const uint8* Data, int32 Size);
+
+	private:
+		void WriteHeaders(const FOpusStreamInfo& StreamInfo);
+		void WritePage(const uint8* Data, int32 Size, uint64 GranulePosition, uint8 HeaderType);
+
+		FBufferedFileWriter File;
+		uint32 SerialNumber = 0;
+		uint32 PageSequenceNumber = 0;
+		bool bHeaderWritten = false;
+
+		FTimestampUnwrapper Timestamps;
+
+		TArray<uint8> PendingPacket;
+		uint64 PendingGranulePosition = 0;
+	};
+}
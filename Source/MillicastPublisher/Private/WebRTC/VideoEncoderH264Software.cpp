@@ -0,0 +1,137 @@
+// Copyright Dolby.io 2023. All Rights Reserved.
+
+#include "VideoEncoderH264Software.h"
+#include "FrameBufferRHI.h"
+#include "Stats.h"
+
+#include "modules/video_coding/codecs/h264/include/h264.h"
+
+namespace Millicast::Publisher
+{
+
+FVideoEncoderH264Software::FVideoEncoderH264Software(const webrtc::SdpVideoFormat& Format)
+	: WebRTCEncoder(webrtc::H264Encoder::Create(cricket::VideoCodec(Format)))
+{
+}
+
+FVideoEncoderH264Software::~FVideoEncoderH264Software()
+{
+}
+
+bool FVideoEncoderH264Software::IsSupported()
+{
+	return webrtc::H264Encoder::IsSupported();
+}
+
+void FVideoEncoderH264Software::SetFecControllerOverride(webrtc::FecControllerOverride* fec_controller_override)
+{
+	WebRTCEncoder->SetFecControllerOverride(fec_controller_override);
+}
+
+int FVideoEncoderH264Software::InitEncode(webrtc::VideoCodec const* codec_settings, webrtc::VideoEncoder::Settings const& settings)
+{
+	// OpenH264 spreads the slices of a frame over one thread per core. Keep to the cores webrtc budgets for the encoder
+	// so the game and render threads keep theirs, and never more than the machine has.
+	const int NumberOfCores = FMath::Clamp(settings.number_of_cores, 1, FPlatformMisc::NumberOfCoresIncludingHyperthreads());
+	const webrtc::VideoEncoder::Settings EncoderSettings(settings.capabilities, NumberOfCores, settings.max_payload_size);
+
+	if (codec_settings->maxFramerate > 0)
+	{
+		Framerate = codec_settings->maxFramerate;
+	}
+
+	// The rate control mode (realtime camera or screen content) is derived from codec_settings->mode by libwebrtc
+	return WebRTCEncoder->InitEncode(codec_settings, EncoderSettings);
+}
+
+int32 FVideoEncoderH264Software::RegisterEncodeCompleteCallback(webrtc::EncodedImageCallback* callback)
+{
+	OnEncodedImageCallback = callback;
+	return WebRTCEncoder->RegisterEncodeCompleteCallback(callback ? this : nullptr);
+}
+
+int32 FVideoEncoderH264Software::Release()
+{
+	return WebRTCEncoder->Release();
+}
+
+int32 FVideoEncoderH264Software::Encode(webrtc::VideoFrame const& frame, std::vector<webrtc::VideoFrameType> const* frame_types)
+{
+	// OpenH264 encodes synchronously, OnEncodedImage is called before Encode returns
+	EncodeStartCycles = FPlatformTime::Cycles64();
+
+	// OpenH264 needs I420, the RHI frames of the plugin are read back and converted here
+	if (frame.video_frame_buffer()->type() != webrtc::VideoFrameBuffer::Type::kI420)
+	{
+		rtc::scoped_refptr<webrtc::I420BufferInterface> I420Buffer = frame.video_frame_buffer()->ToI420();
+		if (!I420Buffer)
+		{
+			return WEBRTC_VIDEO_CODEC_ERROR;
+		}
+
+		webrtc::VideoFrame I420Frame(frame);
+		I420Frame.set_video_frame_buffer(I420Buffer);
+		return WebRTCEncoder->Encode(I420Frame, frame_types);
+	}
+
+	return WebRTCEncoder->Encode(frame, frame_types);
+}
+
+void FVideoEncoderH264Software::SetRates(RateControlParameters const& parameters)
+{
+	if (parameters.framerate_fps >= 1.0)
+	{
+		Framerate = parameters.framerate_fps;
+	}
+
+	WebRTCEncoder->SetRates(parameters);
+}
+
+void FVideoEncoderH264Software::OnPacketLossRateUpdate(float packet_loss_rate)
+{
+	WebRTCEncoder->OnPacketLossRateUpdate(packet_loss_rate);
+}
+
+void FVideoEncoderH264Software::OnRttUpdate(int64_t rtt_ms)
+{
+	WebRTCEncoder->OnRttUpdate(rtt_ms);
+}
+
+void FVideoEncoderH264Software::OnLossNotification(const LossNotification& loss_notification)
+{
+	WebRTCEncoder->OnLossNotification(loss_notification);
+}
+
+webrtc::VideoEncoder::EncoderInfo FVideoEncoderH264Software::GetEncoderInfo() const
+{
+	VideoEncoder::EncoderInfo info = WebRTCEncoder->GetEncoderInfo();
+	info.supports_native_handle = false;
+	info.is_hardware_accelerated = false;
+	info.implementation_name = "MILLICAST_SW_ENCODER_OpenH264";
+	return info;
+}
+
+#if WEBRTC_VERSION == 84
+webrtc::EncodedImageCallback::Result FVideoEncoderH264Software::OnEncodedImage(const webrtc::EncodedImage& encoded_image, const webrtc::CodecSpecificInfo* codec_specific_info, const webrtc::RTPFragmentationHeader* fragmentation)
+#else
+webrtc::EncodedImageCallback::Result FVideoEncoderH264Software::OnEncodedImage(const webrtc::EncodedImage& encoded_image, const webrtc::CodecSpecificInfo* codec_specific_info)
+#endif
+{
+	const double EncoderLatencyMs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - EncodeStartCycles);
+	const double BitrateMbps = encoded_image.size() * 8 * Framerate / 1000000.0;
+
+	FPublisherStats::Get().SetEncoderStats(EncoderLatencyMs, BitrateMbps, encoded_image.qp_);
+
+	if (!OnEncodedImageCallback)
+	{
+		return Result(Result::ERROR_SEND_FAILED);
+	}
+
+#if WEBRTC_VERSION == 84
+	return OnEncodedImageCallback->OnEncodedImage(encoded_image, codec_specific_info, fragmentation);
+#else
+	return OnEncodedImageCallback->OnEncodedImage(encoded_image, codec_specific_info);
+#endif
+}
+
+}
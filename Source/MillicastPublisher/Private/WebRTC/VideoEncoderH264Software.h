@@ -0,0 +1,48 @@
+// Copyright Dolby.io 2023. All Rights Reserved.
+
+#pragma once
+
+#include "WebRTCInc.h"
+
+// Wrapper for the libwebrtc OpenH264 encoder, used as a fallback when no hardware H264 encoder is available.
+// It doesn't take native buffers, Encode converts the RHI texture of the frame to I420 through its frame buffer.
+
+namespace Millicast::Publisher
+{
+
+	class FVideoEncoderH264Software : public webrtc::VideoEncoder, public webrtc::EncodedImageCallback
+	{
+	public:
+		explicit FVideoEncoderH264Software(const webrtc::SdpVideoFormat& Format);
+		virtual ~FVideoEncoderH264Software() override;
+
+		/** Whether libwebrtc has been built with OpenH264 support */
+		static bool IsSupported();
+
+		virtual void SetFecControllerOverride(webrtc::FecControllerOverride* fec_controller_override) override;
+		virtual int InitEncode(webrtc::VideoCodec const* codec_settings, webrtc::VideoEncoder::Settings const& settings) override;
+		virtual int32 RegisterEncodeCompleteCallback(webrtc::EncodedImageCallback* callback) override;
+		virtual int32 Release() override;
+		virtual int32 Encode(webrtc::VideoFrame const& frame, std::vector<webrtc::VideoFrameType> const* frame_types) override;
+		virtual void SetRates(RateControlParameters const& parameters) override;
+		virtual void OnPacketLossRateUpdate(float packet_loss_rate) override;
+		virtual void OnRttUpdate(int64_t rtt_ms) override;
+		virtual void OnLossNotification(const LossNotification& loss_notification) override;
+		virtual EncoderInfo GetEncoderInfo() const override;
+
+		// webrtc::EncodedImageCallback, used to measure the encoder latency and output bitrate
+#if WEBRTC_VERSION == 84
+		virtual Result OnEncodedImage(const webrtc::EncodedImage& encoded_image, const webrtc::CodecSpecificInfo* codec_specific_info, const webrtc::RTPFragmentationHeader* fragmentation) override;
+#else
+		virtual Result OnEncodedImage(const webrtc::EncodedImage& encoded_image, const webrtc::CodecSpecificInfo* codec_specific_info) override;
+#endif
+
+	private:
+		std::unique_ptr<webrtc::VideoEncoder> WebRTCEncoder;
+		webrtc::EncodedImageCallback* OnEncodedImageCallback = nullptr;
+
+		uint64 EncodeStartCycles = 0;
+		double Framerate = 30.0;
+	};
+
+}
@@ -2,16 +2,26 @@
 #if WITH_AVENCODER
 
 #include "VideoEncoderNVENC.h"
+#include "CodecPacketBuffer.h"
 #include "FrameBufferRHI.h"
 #include "AVEncoderContext.h"
 #include "RHI/CopyTexture.h"
 #include "Stats.h"
 #include "VideoEncoderFactory.h"
+#include "MillicastPublisherPrivate.h"
+
+#if ENGINE_MAJOR_VERSION < 5 || ENGINE_MINOR_VERSION == 0
+#include "media/base/h264_profile_level_id.h"
+#else
+#include "api/video_codecs/h264_profile_level_id.h"
+#endif
 
 namespace Millicast::Publisher
 {
 
-FVideoEncoderNVENC::FVideoEncoderNVENC()
+FVideoEncoderNVENC::FVideoEncoderNVENC(const webrtc::SdpVideoFormat& Format, EMillicastVideoEncoderPreset InPreset)
+	: Preset(InPreset)
+	, H264Profile(GetH264Profile(Format))
 {
 	SharedContext = MakeShared<FVideoEncoderNVENC::FSharedContext>();
 	SharedContext->ParentSection = &ContextSection;
@@ -40,14 +50,8 @@ int32 FVideoEncoderNVENC::Release()
 
 void FVideoEncoderNVENC::HandlePendingRateChange()
 {
-	if (PendingRateChange.IsSet())
+	if (bPendingRateChange)
 	{
-		const RateControlParameters& RateChangeParams = PendingRateChange.GetValue();
-
-		EncoderConfig.MaxFramerate = RateChangeParams.framerate_fps;
-		EncoderConfig.TargetBitrate = RateChangeParams.bitrate.get_sum_bps();
-		EncoderConfig.MaxBitrate = RateChangeParams.bandwidth_allocation.bps();
-
 		// Only the quality controlling peer should update the underlying encoder configuration with new bitrate/framerate.
 		if (NVENCEncoder)
 		{
@@ -55,15 +59,19 @@ void FVideoEncoderNVENC::HandlePendingRateChange()
 		}
 
 		// Clear the rate change request
-		PendingRateChange.Reset();
+		bPendingRateChange = false;
 	}
 }
 
 // Pass rate control parameters from WebRTC to our encoder
 // This is how WebRTC can control the bitrate/framerate of the encoder.
+// The config is updated right away, the encoder gets it with the next frame.
 void FVideoEncoderNVENC::SetRates(RateControlParameters const& parameters)
 {
-	PendingRateChange.Emplace(parameters);
+	EncoderConfig.MaxFramerate = parameters.framerate_fps;
+	EncoderConfig.TargetBitrate = parameters.bitrate.get_sum_bps();
+	EncoderConfig.MaxBitrate = GetPresetMaxBitrate(Preset, EncoderConfig.TargetBitrate, parameters.bandwidth_allocation.bps());
+	bPendingRateChange = true;
 }
 
 webrtc::VideoEncoder::EncoderInfo FVideoEncoderNVENC::GetEncoderInfo() const
@@ -96,18 +104,97 @@ void FVideoEncoderNVENC::UpdateConfig(AVEncoder::FVideoEncoder::FLayerConfig con
 
 int FVideoEncoderNVENC::InitEncode(webrtc::VideoCodec const* codec_settings, VideoEncoder::Settings const& settings)
 {
-	checkf(AVEncoder::FVideoEncoderFactory::Get().IsSetup(), TEXT("FVideoEncoderFactory not setup"));
-
 	EncoderConfig.Width = codec_settings->width;
 	EncoderConfig.Height = codec_settings->height;
-	EncoderConfig.MaxBitrate = codec_settings->maxBitrate * 1000;
 	EncoderConfig.TargetBitrate = codec_settings->startBitrate * 1000;
+	EncoderConfig.MaxBitrate = GetPresetMaxBitrate(Preset, EncoderConfig.TargetBitrate, codec_settings->maxBitrate * 1000);
 	EncoderConfig.MaxFramerate = codec_settings->maxFramerate;
-	EncoderConfig.H264Profile = AVEncoder::FVideoEncoder::H264Profile::MAIN;
-	EncoderConfig.RateControlMode = AVEncoder::FVideoEncoder::RateControlMode::VBR;
+	EncoderConfig.H264Profile = H264Profile;
+	ApplyPreset(Preset, EncoderConfig);
+
+	{
+		FScopeLock Lock(&ContextSection);
+		SharedContext->ContentType = codec_settings->mode == webrtc::VideoCodecMode::kScreensharing
+			? webrtc::VideoContentType::SCREENSHARE
+			: webrtc::VideoContentType::UNSPECIFIED;
+	}
+
 	return WEBRTC_VIDEO_CODEC_OK;
 }
 
+AVEncoder::FVideoEncoder::H264Profile FVideoEncoderNVENC::GetH264Profile(const webrtc::SdpVideoFormat& Format)
+{
+	using FVideoEncoder = AVEncoder::FVideoEncoder;
+
+#if WEBRTC_VERSION < 96
+	using EProfile = webrtc::H264::Profile;
+	const auto ProfileLevelId = webrtc::H264::ParseSdpProfileLevelId(Format.parameters);
+#else
+	using EProfile = webrtc::H264Profile;
+	const auto ProfileLevelId = webrtc::ParseSdpForH264ProfileLevelId(Format.parameters);
+#endif
+
+	if (!ProfileLevelId)
+	{
+		return FVideoEncoder::H264Profile::CONSTRAINED_BASELINE;
+	}
+
+	switch (ProfileLevelId->profile)
+	{
+	case EProfile::kProfileConstrainedBaseline:
+		return FVideoEncoder::H264Profile::CONSTRAINED_BASELINE;
+	case EProfile::kProfileBaseline:
+		return FVideoEncoder::H264Profile::BASELINE;
+	case EProfile::kProfileMain:
+		return FVideoEncoder::H264Profile::MAIN;
+	default:
+		// Not advertised by the factory, the hardware encoders never produce B-frames which suits constrained high too
+		return FVideoEncoder::H264Profile::HIGH;
+	}
+}
+
+void FVideoEncoderNVENC::ApplyPreset(EMillicastVideoEncoderPreset InPreset, AVEncoder::FVideoEncoder::FLayerConfig& Config)
+{
+	using FVideoEncoder = AVEncoder::FVideoEncoder;
+
+	// The hardware encoders never produce B-frames, so every preset has a single frame of encoder latency.
+	// The VBV size is not exposed by the layer config, it is bounded through the max bitrate instead.
+	switch (InPreset)
+	{
+	case EMillicastVideoEncoderPreset::UltraLowLatency:
+		// Constant frame sizes so that a frame never waits behind a large one in the pacer
+		Config.RateControlMode = FVideoEncoder::RateControlMode::CBR;
+		Config.MultipassMode = FVideoEncoder::MultipassMode::DISABLED;
+		Config.FillData = false;
+		break;
+	case EMillicastVideoEncoderPreset::Quality:
+		Config.RateControlMode = FVideoEncoder::RateControlMode::VBR;
+		Config.MultipassMode = FVideoEncoder::MultipassMode::FULL;
+		break;
+	case EMillicastVideoEncoderPreset::Balanced:
+	default:
+		// The settings the encoder always had, the multipass mode is left to AVEncoder
+		Config.RateControlMode = FVideoEncoder::RateControlMode::VBR;
+		break;
+	}
+}
+
+int32 FVideoEncoderNVENC::GetPresetMaxBitrate(EMillicastVideoEncoderPreset InPreset, int32 TargetBitrate, int32 AllocatedBitrate)
+{
+	switch (InPreset)
+	{
+	case EMillicastVideoEncoderPreset::UltraLowLatency:
+		// Peak equal to the target, the smallest VBV the encoder allows
+		return TargetBitrate;
+	case EMillicastVideoEncoderPreset::Quality:
+		// Let complex frames take up to 1.5 times the target, within what webrtc allocated
+		return FMath::Min(TargetBitrate + TargetBitrate / 2, FMath::Max(AllocatedBitrate, TargetBitrate));
+	case EMillicastVideoEncoderPreset::Balanced:
+	default:
+		return FMath::Max(AllocatedBitrate, TargetBitrate);
+	}
+}
+
 int32 FVideoEncoderNVENC::Encode(webrtc::VideoFrame const& frame, std::vector<webrtc::VideoFrameType> const* frame_types)
 {
 	// the buffer is modified by a black frame buffer by libwebrtc when the track is muted
@@ -121,8 +208,16 @@ int32 FVideoEncoderNVENC::Encode(webrtc::VideoFrame const& frame, std::vector<we
 	// Get the frame buffer out of the frame
 	auto* VideoFrameBuffer = static_cast<FFrameBufferRHI*>(frame.video_frame_buffer().get());
 
+	// The capture moved to a new context on a resolution change, the encoder is bound to the input of the previous one.
+	// It returns the frames it holds to the previous context before letting go of it.
+	if (NVENCEncoder && VideoFrameBuffer->GetEncoderContext() != EncoderContext)
+	{
+		NVENCEncoder.Reset();
+	}
+
 	if (!NVENCEncoder)
 	{
+		EncoderContext = VideoFrameBuffer->GetEncoderContext();
 		CreateAVEncoder(VideoFrameBuffer->GetVideoEncoderInput());
 		if (!NVENCEncoder)
 		{
@@ -160,54 +255,20 @@ int32 FVideoEncoderNVENC::Encode(webrtc::VideoFrame const& frame, std::vector<we
 }
 
 #if ENGINE_MAJOR_VERSION < 5 || ENGINE_MINOR_VERSION == 0
-void CreateH264FragmentHeader(const uint8* CodedData, size_t CodedDataSize, webrtc::RTPFragmentationHeader& Fragments)
+void CreateH264FragmentHeader(const uint8* CodedData, size_t CodedDataSize, FH264NalIndexer& NalIndexer, webrtc::RTPFragmentationHeader& Fragments)
 {
-	// count the number of nal units
-	for (int pass = 0; pass < 2; ++pass)
+	const FH264NalIndexer::FNalUnits& NalUnits = NalIndexer.Index(CodedData, CodedDataSize);
+
+	Fragments.VerifyAndAllocateFragmentationHeader(NalUnits.Num());
+	for (int32 i = 0; i < NalUnits.Num(); ++i)
 	{
-		size_t num_nal = 0;
-		size_t offset = 0;
-		while (offset < CodedDataSize)
-		{
-			// either a 0,0,1 or 0,0,0,1 sequence indicates a new 'nal'
-			size_t nal_maker_length = 3;
-			if (offset < (CodedDataSize - 3) && CodedData[offset] == 0 && CodedData[offset + 1] == 0 && CodedData[offset + 2] == 1)
-			{
-			}
-			else if (offset < (CodedDataSize - 4) && CodedData[offset] == 0 && CodedData[offset + 1] == 0 && CodedData[offset + 2] == 0 && CodedData[offset + 3] == 1)
-			{
-				nal_maker_length = 4;
-			}
-			else
-			{
-				++offset;
-				continue;
-			}
-			if (pass == 1)
-			{
-				Fragments.fragmentationOffset[num_nal] = offset + nal_maker_length;
-				Fragments.fragmentationLength[num_nal] = 0;
-				if (num_nal > 0)
-				{
-					Fragments.fragmentationLength[num_nal - 1] = offset - Fragments.fragmentationOffset[num_nal - 1];
-				}
-			}
-			offset += nal_maker_length;
-			++num_nal;
-		}
-		if (pass == 0)
-		{
-			Fragments.VerifyAndAllocateFragmentationHeader(num_nal);
-		}
-		else if (pass == 1 && num_nal > 0)
-		{
-			Fragments.fragmentationLength[num_nal - 1] = offset - Fragments.fragmentationOffset[num_nal - 1];
-		}
+		Fragments.fragmentationOffset[i] = NalUnits[i].Offset;
+		Fragments.fragmentationLength[i] = NalUnits[i].Size;
 	}
 }
 #endif
 
-void OnEncodedPacket(uint32 InLayerIndex, const FVideoEncoderInputFrameType InFrame, const AVEncoder::FCodecPacket& InPacket, webrtc::EncodedImageCallback* OnEncodedImageCallback)
+void OnEncodedPacket(uint32 InLayerIndex, const FVideoEncoderInputFrameType InFrame, const AVEncoder::FCodecPacket& InPacket, webrtc::EncodedImageCallback* OnEncodedImageCallback, FH264NalIndexer& NalIndexer, webrtc::VideoContentType ContentType)
 {
 	webrtc::EncodedImage Image;
 
@@ -216,15 +277,11 @@ void OnEncodedPacket(uint32 InLayerIndex, const FVideoEncoderInputFrameType InFr
 	Image.timing_.encode_finish_ms = InPacket.Timings.FinishTs.GetTotalMilliseconds();
 	Image.timing_.flags = webrtc::VideoSendTiming::kTriggeredByTimer;
 
-#if ENGINE_MAJOR_VERSION < 5
-	Image.SetEncodedData(webrtc::EncodedImageBuffer::Create(const_cast<uint8_t*>(InPacket.Data), InPacket.DataSize));
-#else
-	Image.SetEncodedData(webrtc::EncodedImageBuffer::Create(const_cast<uint8_t*>(InPacket.Data.Get()), InPacket.DataSize));
-#endif
+	Image.SetEncodedData(FCodecPacketBuffer::Create(InPacket));
 	Image._encodedWidth = InFrame->GetWidth();
 	Image._encodedHeight = InFrame->GetHeight();
 	Image._frameType = InPacket.IsKeyFrame ? webrtc::VideoFrameType::kVideoFrameKey : webrtc::VideoFrameType::kVideoFrameDelta;
-	Image.content_type_ = webrtc::VideoContentType::UNSPECIFIED;
+	Image.content_type_ = ContentType;
 	Image.qp_ = InPacket.VideoQP;
 	Image.SetSpatialIndex(InLayerIndex);
 	Image.rotation_ = webrtc::VideoRotation::kVideoRotation_0;
@@ -253,9 +310,9 @@ void OnEncodedPacket(uint32 InLayerIndex, const FVideoEncoderInputFrameType InFr
 		webrtc::RTPFragmentationHeader FragHeader;
 
 		#if ENGINE_MAJOR_VERSION < 5
-		CreateH264FragmentHeader(InPacket.Data, InPacket.DataSize, FragHeader);
+		CreateH264FragmentHeader(InPacket.Data, InPacket.DataSize, NalIndexer, FragHeader);
 		#else
-		CreateH264FragmentHeader(InPacket.Data.Get(), InPacket.DataSize, FragHeader);
+		CreateH264FragmentHeader(InPacket.Data.Get(), InPacket.DataSize, NalIndexer, FragHeader);
 		#endif
 
 		OnEncodedImageCallback->OnEncodedImage(Image, &CodecInfo, &FragHeader);
@@ -267,11 +324,14 @@ void OnEncodedPacket(uint32 InLayerIndex, const FVideoEncoderInputFrameType InFr
 
 void FVideoEncoderNVENC::CreateAVEncoder(TSharedPtr<AVEncoder::FVideoEncoderInput> EncoderInput)
 {
+	checkf(AVEncoder::FVideoEncoderFactory::Get().IsSetup(), TEXT("FVideoEncoderFactory not setup"));
+
 	const TArray<AVEncoder::FVideoEncoderInfo>& Available = AVEncoder::FVideoEncoderFactory::Get().GetAvailable();
-	checkf(Available.Num() > 0, TEXT("No AVEncoders available. Check that the Hardware Encoders plugin is loaded."));
 
+	// FMillicastVideoEncoderFactory falls back on OpenH264 when there is no hardware encoder, so this should not happen
 	if (Available.Num() == 0)
 	{
+		UE_LOG(LogMillicastPublisher, Error, TEXT("No AVEncoders available. Check that the Hardware Encoders plugin is loaded."));
 		return;
 	}
 
@@ -285,7 +345,7 @@ void FVideoEncoderNVENC::CreateAVEncoder(TSharedPtr<AVEncoder::FVideoEncoderInpu
 			if (TSharedPtr<FVideoEncoderNVENC::FSharedContext> Context = WeakContext.Pin())
 			{
 				FScopeLock Lock(Context->ParentSection);
-				OnEncodedPacket(InLayerIndex, InputFrame, InPacket, Context->OnEncodedImageCallback);
+				OnEncodedPacket(InLayerIndex, InputFrame, InPacket, Context->OnEncodedImageCallback, Context->NalIndexer, Context->ContentType);
 			}
 		});
 }
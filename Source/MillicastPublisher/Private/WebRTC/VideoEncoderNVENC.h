@@ -5,6 +5,8 @@
 
 #if WITH_AVENCODER
 #include "VideoEncoder.h"
+#include "H264NalIndexer.h"
+#include "RtcCodecsConstants.h"
 
 namespace Millicast::Publisher
 {
@@ -13,7 +15,7 @@ namespace Millicast::Publisher
 	class FVideoEncoderNVENC : public webrtc::VideoEncoder
 	{
 	public:
-		FVideoEncoderNVENC();
+		explicit FVideoEncoderNVENC(const webrtc::SdpVideoFormat& Format, EMillicastVideoEncoderPreset InPreset = EMillicastVideoEncoderPreset::Balanced);
 		virtual ~FVideoEncoderNVENC() override;
 
 		virtual int32 RegisterEncodeCompleteCallback(webrtc::EncodedImageCallback* callback) override;
@@ -27,6 +29,18 @@ namespace Millicast::Publisher
 
 		AVEncoder::FVideoEncoder::FLayerConfig GetConfig() const { return EncoderConfig; }
 
+		/** Profile of the negotiated format, constrained baseline when it has no profile-level-id */
+		static AVEncoder::FVideoEncoder::H264Profile GetH264Profile(const webrtc::SdpVideoFormat& Format);
+
+		/** Set the rate control and multipass settings of the preset, the profile is the negotiated one whatever the preset */
+		static void ApplyPreset(EMillicastVideoEncoderPreset InPreset, AVEncoder::FVideoEncoder::FLayerConfig& Config);
+
+		/**
+		 * Peak bitrate allowed by the preset for the target bitrate, within the bandwidth webrtc allocated to the encoder.
+		 * The peak is never below the target: with an allocation under the target bitrate, the target wins.
+		 */
+		static int32 GetPresetMaxBitrate(EMillicastVideoEncoderPreset InPreset, int32 TargetBitrate, int32 AllocatedBitrate);
+
 	private:
 		void UpdateConfig(AVEncoder::FVideoEncoder::FLayerConfig const& Config);
 		void HandlePendingRateChange();
@@ -38,13 +52,18 @@ namespace Millicast::Publisher
 		{
 			webrtc::EncodedImageCallback* OnEncodedImageCallback = nullptr;
 			FCriticalSection* ParentSection = nullptr;
+			FH264NalIndexer NalIndexer; // Reused for every packet, only accessed under ParentSection
+			webrtc::VideoContentType ContentType = webrtc::VideoContentType::UNSPECIFIED;
 		};
 		TSharedPtr<FSharedContext> SharedContext;
 		FCriticalSection ContextSection; // used to prevent clearing of the callback while we're using it
 
+		TSharedPtr<FAVEncoderContext, ESPMode::ThreadSafe> EncoderContext; // Outlives NVENCEncoder, which releases its frames into it
 		TSharedPtr<AVEncoder::FVideoEncoder> NVENCEncoder;
 		AVEncoder::FVideoEncoder::FLayerConfig EncoderConfig;
-		TOptional<RateControlParameters> PendingRateChange;
+		bool bPendingRateChange = false;
+		EMillicastVideoEncoderPreset Preset;
+		AVEncoder::FVideoEncoder::H264Profile H264Profile;
 	};
 }
 #endif
\ No newline at end of file
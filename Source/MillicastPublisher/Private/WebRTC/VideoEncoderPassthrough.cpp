@@ -0,0 +1,190 @@
+// Copyright Dolby.io 2023. All Rights Reserved.
+
+#include "VideoEncoderPassthrough.h"
+
+#include "EncodedFrameBuffer.h"
+#include "H264NalIndexer.h"
+#include "MillicastPublisherPrivate.h"
+#include "Stats.h"
+
+namespace Millicast::Publisher
+{
+
+FVideoEncoderPassthrough::FVideoEncoderPassthrough()
+	: NalIndexer(MakeUnique<FH264NalIndexer>())
+{
+	memset(&Codec, 0, sizeof(webrtc::VideoCodec));
+}
+
+FVideoEncoderPassthrough::~FVideoEncoderPassthrough()
+{
+}
+
+int FVideoEncoderPassthrough::InitEncode(webrtc::VideoCodec const* codec_settings, webrtc::VideoEncoder::Settings const& settings)
+{
+	Codec = *codec_settings;
+	bWaitingForKeyFrame = true;
+	bCodecMismatchReported = false;
+	LastSequence.Reset();
+
+	return WEBRTC_VIDEO_CODEC_OK;
+}
+
+int32 FVideoEncoderPassthrough::RegisterEncodeCompleteCallback(webrtc::EncodedImageCallback* callback)
+{
+	OnEncodedImageCallback = callback;
+	return WEBRTC_VIDEO_CODEC_OK;
+}
+
+int32 FVideoEncoderPassthrough::Release()
+{
+	OnEncodedImageCallback = nullptr;
+	return WEBRTC_VIDEO_CODEC_OK;
+}
+
+int32 FVideoEncoderPassthrough::Encode(webrtc::VideoFrame const& frame, std::vector<webrtc::VideoFrameType> const* frame_types)
+{
+	if (!OnEncodedImageCallback)
+	{
+		return WEBRTC_VIDEO_CODEC_UNINITIALIZED;
+	}
+
+	rtc::scoped_refptr<FEncodedFrameBuffer> Frame(static_cast<FEncodedFrameBuffer*>(frame.video_frame_buffer().get()));
+
+	if (Frame->GetCodecType() != Codec.codecType)
+	{
+		UE_CLOG(!bCodecMismatchReported, LogMillicastPublisher, Warning, TEXT("The codec of the encoded video does not match the negotiated one, its frames are dropped"));
+		bCodecMismatchReported = true;
+		return WEBRTC_VIDEO_CODEC_OK;
+	}
+
+	// A frame dropped before reaching us breaks the references of the following deltas
+	if (LastSequence.IsSet() && Frame->GetSequence() != LastSequence.GetValue() + 1)
+	{
+		bWaitingForKeyFrame = true;
+	}
+	LastSequence = Frame->GetSequence();
+
+	const bool bKeyFrameRequested = frame_types && std::any_of(frame_types->begin(), frame_types->end(), [](webrtc::VideoFrameType Type) {
+		return Type == webrtc::VideoFrameType::kVideoFrameKey;
+	});
+
+	Frame->GetSource().SetTargetBitrate(TargetBitrateBps);
+
+	if (!Frame->IsKeyFrame() && (bKeyFrameRequested || bWaitingForKeyFrame))
+	{
+		Frame->GetSource().RequestKeyFrame();
+	}
+
+	if (Frame->IsKeyFrame())
+	{
+		bWaitingForKeyFrame = false;
+	}
+	else if (bWaitingForKeyFrame)
+	{
+		return WEBRTC_VIDEO_CODEC_OK;
+	}
+
+	webrtc::EncodedImage Image;
+	Image.SetEncodedData(Frame->GetEncodedData());
+	Image._encodedWidth = Frame->width();
+	Image._encodedHeight = Frame->height();
+	Image._frameType = Frame->IsKeyFrame() ? webrtc::VideoFrameType::kVideoFrameKey : webrtc::VideoFrameType::kVideoFrameDelta;
+	Image.content_type_ = Codec.mode == webrtc::VideoCodecMode::kScreensharing ? webrtc::VideoContentType::SCREENSHARE : webrtc::VideoContentType::UNSPECIFIED;
+	Image.rotation_ = frame.rotation();
+	Image.SetTimestamp(frame.timestamp());
+	Image.capture_time_ms_ = frame.render_time_ms();
+	Image.ntp_time_ms_ = frame.ntp_time_ms();
+	Image.timing_.flags = webrtc::VideoSendTiming::kInvalid;
+
+#if ENGINE_MAJOR_VERSION < 5 || ENGINE_MINOR_VERSION == 0
+	Image._completeFrame = true;
+#endif
+
+	webrtc::CodecSpecificInfo CodecInfo;
+	CodecInfo.codecType = Codec.codecType;
+
+	switch (Codec.codecType)
+	{
+	case webrtc::kVideoCodecVP8:
+		CodecInfo.codecSpecific.VP8.nonReference = false;
+		CodecInfo.codecSpecific.VP8.temporalIdx = webrtc::kNoTemporalIdx;
+		CodecInfo.codecSpecific.VP8.layerSync = false;
+		CodecInfo.codecSpecific.VP8.keyIdx = webrtc::kNoKeyIdx;
+		break;
+	case webrtc::kVideoCodecVP9:
+		// Single spatial and temporal layer in non flexible mode, as the libvpx wrapper describes such a stream
+		CodecInfo.codecSpecific.VP9.first_frame_in_picture = true;
+		CodecInfo.codecSpecific.VP9.inter_pic_predicted = !Frame->IsKeyFrame();
+		CodecInfo.codecSpecific.VP9.flexible_mode = false;
+		CodecInfo.codecSpecific.VP9.ss_data_available = Frame->IsKeyFrame();
+		CodecInfo.codecSpecific.VP9.non_ref_for_inter_layer_pred = true;
+		CodecInfo.codecSpecific.VP9.temporal_idx = webrtc::kNoTemporalIdx;
+		CodecInfo.codecSpecific.VP9.temporal_up_switch = false;
+		CodecInfo.codecSpecific.VP9.inter_layer_predicted = false;
+		CodecInfo.codecSpecific.VP9.gof_idx = 0;
+		CodecInfo.codecSpecific.VP9.num_spatial_layers = 1;
+		CodecInfo.codecSpecific.VP9.first_active_layer = 0;
+		CodecInfo.codecSpecific.VP9.end_of_picture = true;
+		CodecInfo.codecSpecific.VP9.spatial_layer_resolution_present = Frame->IsKeyFrame();
+		CodecInfo.codecSpecific.VP9.width[0] = Frame->width();
+		CodecInfo.codecSpecific.VP9.height[0] = Frame->height();
+		CodecInfo.codecSpecific.VP9.gof.SetGofInfoVP9(webrtc::kTemporalStructureMode1);
+		break;
+	case webrtc::kVideoCodecH264:
+		CodecInfo.codecSpecific.H264.packetization_mode = webrtc::H264PacketizationMode::NonInterleaved;
+		CodecInfo.codecSpecific.H264.temporal_idx = webrtc::kNoTemporalIdx;
+		CodecInfo.codecSpecific.H264.idr_frame = Frame->IsKeyFrame();
+		CodecInfo.codecSpecific.H264.base_layer_sync = false;
+		break;
+	default:
+		break;
+	}
+
+	FPublisherStats::Get().SetEncoderStats(0.0, Frame->GetSize() * 8 * Framerate / 1000000.0, -1);
+
+#if WEBRTC_VERSION == 84
+	webrtc::RTPFragmentationHeader FragHeader;
+	if (Codec.codecType == webrtc::kVideoCodecH264)
+	{
+		const FH264NalIndexer::FNalUnits& NalUnits = NalIndexer->Index(Frame->GetData(), Frame->GetSize());
+
+		FragHeader.VerifyAndAllocateFragmentationHeader(NalUnits.Num());
+		for (int32 i = 0; i < NalUnits.Num(); ++i)
+		{
+			FragHeader.fragmentationOffset[i] = NalUnits[i].Offset;
+			FragHeader.fragmentationLength[i] = NalUnits[i].Size;
+		}
+	}
+
+	OnEncodedImageCallback->OnEncodedImage(Image, &CodecInfo, Codec.codecType == webrtc::kVideoCodecH264 ? &FragHeader : nullptr);
+#else
+	OnEncodedImageCallback->OnEncodedImage(Image, &CodecInfo);
+#endif
+
+	return WEBRTC_VIDEO_CODEC_OK;
+}
+
+void FVideoEncoderPassthrough::SetRates(RateControlParameters const& parameters)
+{
+	// The bitrate is up to the source, a file ignores it while a shared encoder may follow it
+	TargetBitrateBps = parameters.bitrate.get_sum_bps();
+
+	if (parameters.framerate_fps >= 1.0)
+	{
+		Framerate = parameters.framerate_fps;
+	}
+}
+
+webrtc::VideoEncoder::EncoderInfo FVideoEncoderPassthrough::GetEncoderInfo() const
+{
+	EncoderInfo Info;
+	Info.implementation_name = "MILLICAST_PASSTHROUGH";
+	Info.supports_native_handle = true;
+	Info.has_trusted_rate_controller = true;
+	Info.is_hardware_accelerated = false;
+	Info.scaling_settings = VideoEncoder::ScalingSettings::kOff;
+	return Info;
+}
+
+}
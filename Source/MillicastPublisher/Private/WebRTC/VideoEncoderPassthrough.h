@@ -0,0 +1,40 @@
+// Copyright Dolby.io 2023. All Rights Reserved.
+
+#pragma once
+
+#include "WebRTCInc.h"
+
+// Encoder for the pre-encoded sources: the frames of a file or of an encoder shared with another stream are sent as they are.
+// A key frame can't be produced on demand, the source is asked for one instead.
+
+namespace Millicast::Publisher
+{
+	class FH264NalIndexer;
+
+	class FVideoEncoderPassthrough : public webrtc::VideoEncoder
+	{
+	public:
+		FVideoEncoderPassthrough();
+		virtual ~FVideoEncoderPassthrough() override;
+
+		virtual int InitEncode(webrtc::VideoCodec const* codec_settings, webrtc::VideoEncoder::Settings const& settings) override;
+		virtual int32 RegisterEncodeCompleteCallback(webrtc::EncodedImageCallback* callback) override;
+		virtual int32 Release() override;
+		virtual int32 Encode(webrtc::VideoFrame const& frame, std::vector<webrtc::VideoFrameType> const* frame_types) override;
+		virtual void SetRates(RateControlParameters const& parameters) override;
+		virtual EncoderInfo GetEncoderInfo() const override;
+
+	private:
+		webrtc::EncodedImageCallback* OnEncodedImageCallback = nullptr;
+		webrtc::VideoCodec Codec;
+
+		/** Deltas can't be decoded after a gap, they are dropped until the next key frame */
+		bool bWaitingForKeyFrame = true;
+		TOptional<uint32> LastSequence;
+		bool bCodecMismatchReported = false;
+		double Framerate = 30.0;
+		uint32 TargetBitrateBps = 0;
+
+		TUniquePtr<FH264NalIndexer> NalIndexer;
+	};
+}
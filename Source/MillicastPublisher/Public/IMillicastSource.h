@@ -6,8 +6,16 @@
 #include "Engine/TextureRenderTarget2D.h"
 #include "Misc/Optional.h"
 #include "Templates/SharedPointer.h"
+#include "MillicastSimulcastLayer.h"
+#include "MillicastRegionOfInterest.h"
 #include "MillicastWebRTCInc.h"
 
+namespace Millicast::Publisher
+{
+	class FEncodedFrameFanOut;
+	struct FKeyFrameGovernorSettings;
+}
+
 /** Interface to start a capture a write data to WebRTC buffers in order to publish audio/video to Millicast */
 class MILLICASTPUBLISHER_API IMillicastSource
 {
@@ -37,6 +45,26 @@ public:
 	virtual ~IMillicastSource() = default;
 };
 
+/** What the video mostly shows, selects how the encoders trade resolution, framerate and bitrate */
+UENUM(BlueprintType)
+enum class EMillicastVideoContentHint : uint8
+{
+	/** Camera like content, framerate is preserved over resolution */
+	Motion UMETA(DisplayName = "Motion"),
+	/** UI, text or desktop content, resolution and sharpness are preserved over framerate */
+	Detail UMETA(DisplayName = "Detail"),
+};
+
+/** What the capture does when the frames waiting for the encoder fill the queue */
+UENUM(BlueprintType)
+enum class EMillicastEncoderQueuePolicy : uint8
+{
+	/** Drop the oldest frame waiting, the encoder always gets the latest one for the lowest latency */
+	DropOldest UMETA(DisplayName = "Drop Oldest"),
+	/** Wait for the encoder to take a frame before capturing the next one, so that every frame is encoded */
+	Block UMETA(DisplayName = "Block"),
+};
+
 /**
 * Specialized interface for video sources. A video source can be : 
 * a SlateWindow capture (basically a screenshare of the game)
@@ -54,8 +82,29 @@ public:
 	/** Creates VideoSource */
 	static IMillicastVideoSource* Create();
 
+	/** Creates VideoSource replaying a pre-encoded IVF (VP8, VP9) or Annex B (H264) file without encoding it */
+	static TSharedPtr<IMillicastVideoSource> CreateForEncodedFile(const FString& Path);
+
+	/**
+	* Creates VideoSource relaying the frames encoded for another source, nothing is captured or encoded.
+	* StreamIndex selects the simulcast layer to relay, INDEX_NONE for the highest one.
+	*/
+	static TSharedPtr<IMillicastVideoSource> CreateForFanOut(TSharedPtr<Millicast::Publisher::FEncodedFrameFanOut, ESPMode::ThreadSafe> FanOut, int32 StreamIndex);
+
 	virtual void SetSimulcast(bool InSimulcast) = 0;
+	/** Set the layers to capture when simulcast is enabled, one capture context is created per layer */
+	virtual void SetSimulcastLayers(const TArray<FMillicastSimulcastLayer>& InSimulcastLayers) = 0;
 	virtual void SetRenderTarget(UTextureRenderTarget2D* InRenderTarget) = 0;
+	/** Set the content hint of the video, flags the source as a screencast for Detail */
+	virtual void SetContentHint(EMillicastVideoContentHint InContentHint) = 0;
+	/** Set the importance of the areas of the frame for the frames captured from now on, null to clear it */
+	virtual void SetImportanceMap(TSharedPtr<const FMillicastImportanceMap, ESPMode::ThreadSafe> InImportanceMap) = 0;
+	/** Share the encoded frames of this source with other peer connections, set before the capture starts */
+	virtual void SetFanOut(TSharedPtr<Millicast::Publisher::FEncodedFrameFanOut, ESPMode::ThreadSafe> InFanOut) = 0;
+	/** Set how many captured frames may wait for the encoder and what to do when there are more, set before the capture starts */
+	virtual void SetEncoderQueue(int32 InDepth, EMillicastEncoderQueuePolicy InPolicy) = 0;
+	/** Set when the encoder of this source produces key frames, null for the defaults, set before the capture starts */
+	virtual void SetKeyFrameSettings(TSharedPtr<const Millicast::Publisher::FKeyFrameGovernorSettings, ESPMode::ThreadSafe> InSettings) = 0;
 };
 
 UENUM(BlueprintType)
@@ -63,6 +112,7 @@ enum class EAudioCapturerType : uint8
 {
 	Submix   UMETA(DisplayName = "Submix"),
 	Device   UMETA(DisplayName = "Device"),
+	Mixer    UMETA(DisplayName = "Mixer"),
 };
 
 /**
@@ -0,0 +1,44 @@
+// Copyright Dolby.io 2023. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "RtcCodecsConstants.h"
+
+#include "MillicastAudioEncoderSettings.generated.h"
+
+/**
+ * Settings of the Opus encoder of the audio track.
+ * They are applied when publishing starts, through the codec parameters negotiated with the server.
+ */
+USTRUCT(BlueprintType)
+struct MILLICASTPUBLISHER_API FMillicastAudioEncoderSettings
+{
+	GENERATED_BODY()
+
+	/** Target bitrate in kbps. 0 lets webrtc pick it from the number of channels */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Audio, META = (ClampMin = "0", ClampMax = "510"))
+	int32 BitrateKbps = 0;
+
+	/** From 0 to 10, lower values spend less CPU for a slightly lower quality. -1 keeps the webrtc default */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Audio, META = (ClampMin = "-1", ClampMax = "10"))
+	int32 Complexity = -1;
+
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Audio)
+	EMillicastOpusFrameDuration FrameDuration = EMillicastOpusFrameDuration::Ms20;
+
+	/** Discontinuous transmission, hardly any packet is sent during silence */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Audio)
+	bool bDtx = false;
+
+	/** In-band forward error correction, lost packets are partly recovered from the next one */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Audio)
+	bool bInbandFec = true;
+
+	/** Constant bitrate instead of variable bitrate */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Audio)
+	bool bConstantBitrate = false;
+
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Audio)
+	EMillicastOpusApplication Application = EMillicastOpusApplication::Music;
+};
@@ -0,0 +1,43 @@
+// Copyright Dolby.io 2023. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "IMillicastSource.h"
+
+#include "MillicastAudioMixerInput.generated.h"
+
+class USoundSubmix;
+
+/**
+ * One input of the Mixer audio capturer, e.g. the game submix, a commentator microphone or a music device.
+ * The inputs are mixed into the single audio track of the source.
+ */
+USTRUCT(BlueprintType)
+struct MILLICASTPUBLISHER_API FMillicastAudioMixerInput
+{
+	GENERATED_BODY()
+
+	/** Capturer of the input, Submix or Device */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Audio)
+	EAudioCapturerType Type = EAudioCapturerType::Submix;
+
+	/** Submix captured by a Submix input, none for the master submix */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Audio)
+	USoundSubmix* Submix = nullptr;
+
+	/** Name of the device captured by a Device input, as listed by the audio device capture subsystem */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Audio)
+	FString DeviceName;
+
+	/** Gain applied to the input in dB */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Audio)
+	float GainDb = 0.f;
+
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Audio)
+	bool bMuted = false;
+
+	/** Delays the input in ms to line it up with the other ones, e.g. a microphone heard ahead of the game */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Audio, META = (ClampMin = "0", ClampMax = "500"))
+	int32 DelayMs = 0;
+};
@@ -2,6 +2,7 @@
 
 #pragma once
 
+#include "MillicastAudioEncoderSettings.h"
 #include "MillicastPublisherSource.h"
 #include "RtcCodecsConstants.h"
 
@@ -22,6 +23,8 @@ namespace webrtc
 
 namespace Millicast::Publisher
 {
+	class FFailoverController;
+	class FWarmEncoderPool;
 	class FWebRTCPeerConnection;
 	class FWebRTCPeerConnectionConfig;
 }
@@ -44,6 +47,9 @@ DECLARE_DYNAMIC_MULTICAST_SPARSE_DELEGATE(FMillicastPublisherComponentActive, UM
 DECLARE_DYNAMIC_MULTICAST_SPARSE_DELEGATE(FMillicastPublisherComponentInactive, UMillicastPublisherComponent, OnInactive);
 DECLARE_DYNAMIC_MULTICAST_SPARSE_DELEGATE_OneParam(FMillicastPublisherComponentViewerCount, UMillicastPublisherComponent, OnViewerCount, int, Count);
 
+DECLARE_DYNAMIC_MULTICAST_SPARSE_DELEGATE_OneParam(FMillicastPublisherComponentFailover, UMillicastPublisherComponent, OnFailover, float, SwitchTimeMs);
+DECLARE_DYNAMIC_MULTICAST_SPARSE_DELEGATE(FMillicastPublisherComponentFailback, UMillicastPublisherComponent, OnFailback);
+
 DECLARE_DYNAMIC_MULTICAST_SPARSE_DELEGATE_TwoParams(FMillicastPublisherComponentFrameMetadata, UMillicastPublisherComponent, OnAddFrameMetadata, int, Ssrc, int, Timestamp);
 
 /**
@@ -67,14 +73,34 @@ private:
 	UPROPERTY(EditDefaultsOnly, Category = "Properties", META = (DisplayName = "Video Codec"))
 	EMillicastVideoCodecs SelectedVideoCodec;
 
+	/** Trade-off between latency and quality of the hardware H264 encoder */
+	UPROPERTY(EditDefaultsOnly, Category = "Properties", META = (DisplayName = "Encoder Preset", EditCondition = "SelectedVideoCodec == EMillicastVideoCodecs::H264"))
+	EMillicastVideoEncoderPreset EncoderPreset = EMillicastVideoEncoderPreset::Balanced;
+
 	/** The video codec to be used to encode audio */
 	UPROPERTY(EditDefaultsOnly, Category = "Properties", META = (DisplayName = "Audio Codec"))
 	EMillicastAudioCodecs SelectedAudioCodec;
 
+	/** Bitrate, complexity, frame duration, DTX, FEC and application of the Opus encoder */
+	UPROPERTY(EditDefaultsOnly, Category = "Properties", META = (DisplayName = "Audio Encoder Settings"))
+	FMillicastAudioEncoderSettings AudioEncoderSettings;
+
 	/** Whether to enable simulcast */
 	UPROPERTY(EditDefaultsOnly, Category = "Properties", META = (DisplayName = "Simulcast"))
 	bool Simulcast = false;
 
+	/** The simulcast layers to publish, from 2 to 3 layers. The first layer is usually the full resolution one */
+	UPROPERTY(EditDefaultsOnly, Category = "Properties", META = (DisplayName = "Simulcast Layers", EditCondition = "Simulcast"))
+	TArray<FMillicastSimulcastLayer> SimulcastLayers;
+
+	/** Key frame requests from the viewers received within this interval after a key frame are merged into the next one */
+	UPROPERTY(EditDefaultsOnly, Category = "Properties", META = (DisplayName = "Key Frame Min Interval (ms)", ClampMin = 0))
+	int32 KeyFrameMinIntervalMs = 300;
+
+	/** Whether a key frame request only refreshes the simulcast layer it is for, instead of all the layers */
+	UPROPERTY(EditDefaultsOnly, Category = "Properties", META = (DisplayName = "Per Layer Key Frames", EditCondition = "Simulcast"))
+	bool bPerLayerKeyFrames = false;
+
 	/** Whether you want to automute the tracks when the number of viewer reach 0 
 	* And unmute them when there are viewer watching the stream.
 	*/
@@ -88,6 +114,22 @@ private:
 		META = (DisplayName = "Add Frame Metadata", AllowPrivateAccess = true))
 	bool bUseFrameTransformer = false;
 
+	/**
+	* Stream to fail over to when the connection of this publisher is lost. It is connected once this publisher is publishing,
+	* sends nothing while the primary connection works, then sends the tracks of this publisher as soon as it fails.
+	*/
+	UPROPERTY(EditDefaultsOnly, Category = "Properties",
+		META = (DisplayName = "Backup Publisher Source", AllowPrivateAccess = true))
+	UMillicastPublisherSource* BackupMediaSource = nullptr;
+
+	/** Time without response from the server after which the connection is considered lost and the backup takes over */
+	UPROPERTY(EditDefaultsOnly, Category = "Properties", META = (DisplayName = "Failover Timeout (ms)", ClampMin = 100))
+	int32 FailoverTimeoutMs = 1000;
+
+	/** Time the primary connection must stay up again after a disconnection before it takes over back from the backup */
+	UPROPERTY(EditDefaultsOnly, Category = "Properties", META = (DisplayName = "Failback Delay (ms)", ClampMin = 0))
+	int32 FailbackDelayMs = 5000;
+
 public:
 	/**
 		Initialize this component with the media source required for publishing  audio, video to Millicast.
@@ -122,6 +164,19 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "MillicastPublisher", META = (DisplayName = "IsPublishing"))
 	bool IsPublishing() const;
 
+	/**
+	* Record the published video to a file without re-encoding it, from the next key frame.
+	* The extension is set from the codec: ivf for VP8 and VP9, mp4 for H264. Relative paths are in the Saved directory.
+	* The audio is recorded next to it in an Ogg Opus file with the opus extension.
+	* LayerIndex selects the simulcast layer to record, 0 being the first one.
+	*/
+	UFUNCTION(BlueprintCallable, Category = "MillicastPublisher", META = (DisplayName = "StartRecording"))
+	void StartRecording(const FString& FilePath, int32 LayerIndex = 0);
+
+	/** Stop the recording of this publisher and close the file. Unpublishing stops it too */
+	UFUNCTION(BlueprintCallable, Category = "MillicastPublisher", META = (DisplayName = "StopRecording"))
+	void StopRecording();
+
 	/**
 	* Set the minimum bitrate for the peerconnection
 	* Have to be called before Publish
@@ -150,6 +205,13 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "MillicastPublisher", META = (DisplayName = "SetVideoCodec"))
 	bool SetVideoCodec(EMillicastVideoCodecs InVideoCodec);
 
+	/**
+	 * Set the preset of the hardware H264 encoder, must be called before Publish
+	 * Return true if the preset is set successfully, false if it is not set
+	 */
+	UFUNCTION(BlueprintCallable, Category = "MillicastPublisher", META = (DisplayName = "SetEncoderPreset"))
+	bool SetEncoderPreset(EMillicastVideoEncoderPreset InEncoderPreset);
+
 	/**
 	 * Set the audio codec
 	 * Return true if the video codec is set successfully, false if it is not set
@@ -157,6 +219,20 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "MillicastPublisher", META = (DisplayName = "SetAudioCodec"))
 	bool SetAudioCodec(EMillicastAudioCodecs InAudioCodec);
 
+	/**
+	 * Set the settings of the Opus encoder, must be called before Publish
+	 * Return true if the settings are set successfully, false if it is not set
+	 */
+	UFUNCTION(BlueprintCallable, Category = "MillicastPublisher", META = (DisplayName = "SetAudioEncoderSettings"))
+	bool SetAudioEncoderSettings(const FMillicastAudioEncoderSettings& InSettings);
+
+	/**
+	 * Set the simulcast layers, used when simulcast is enabled
+	 * Return true if the layers are valid and set successfully, false if they are not set
+	 */
+	UFUNCTION(BlueprintCallable, Category = "MillicastPublisher", META = (DisplayName = "SetSimulcastLayers"))
+	bool SetSimulcastLayers(const TArray<FMillicastSimulcastLayer>& InSimulcastLayers);
+
 	/**
 	* Enable RTC stats gathering
 	* Enter the cmd: ``stat millicast_publisher`` in order to display them
@@ -215,6 +291,14 @@ public:
 	UPROPERTY(BlueprintAssignable, Category = "Components|Activation")
 	FMillicastPublisherComponentFrameMetadata OnAddFrameMetadata;
 
+	/** Called when the backup publisher took over, with the time from the loss of the connection to the first video frame the backup sent */
+	UPROPERTY(BlueprintAssignable, Category = "Components|Activation")
+	FMillicastPublisherComponentFailover OnFailover;
+
+	/** Called when the primary connection came back and sends again, the backup being back in standby */
+	UPROPERTY(BlueprintAssignable, Category = "Components|Activation")
+	FMillicastPublisherComponentFailback OnFailback;
+
 private:
 	void EndPlay(EEndPlayReason::Type Reason) override;
 
@@ -227,6 +311,26 @@ private:
 
 	/** Media Tracks */
 	void CaptureAndAddTracks();
+	void AddTrack(IMillicastSource::FStreamTrackInterface Track);
+
+	/** Connect the backup publisher in standby */
+	void StartBackup();
+	/** Make the backup send when the connection is lost and the primary once it is back, on the game thread */
+	void FailOver(uint64 ConnectionLostCycles);
+	/** The backup sent its first frame, the switch is complete */
+	void FailedOver(float SwitchTimeMs);
+	void FailBack();
+	/** Fails back once the primary has been up long enough, returns whether it is still waiting to */
+	bool UpdateFailover();
+	/** Whether this is a backup connected in standby, ready to take over */
+	bool IsStandbyReady() const;
+	bool HasVideoSender();
+	/** Start or stop sending on a backup, returns false if it is not connected */
+	bool SetStandby(bool bInStandby);
+	void SetSendersActive(bool bActive);
+
+	/** Start the time to first frame measure and warm up the video encoders */
+	void PrepareForPublish();
 
 	/** Create the peerconnection and starts subscribing*/
 	bool PublishToMillicast();
@@ -239,9 +343,14 @@ private:
 	void ParseViewerCountEvent(TSharedPtr<FJsonObject> JsonMsg);
 
 	void SetSimulcast(webrtc::RtpTransceiverInit& TransceiverInit);
+	TArray<FMillicastSimulcastLayer> GetSimulcastLayers() const;
+	static bool AreSimulcastLayersValid(const TArray<FMillicastSimulcastLayer>& InSimulcastLayers);
 
 	void UpdateBitrateSettings();
 
+	/** Names the recording of this publisher in its answer, its encoders write to it and the others don't */
+	FString GetRecordingId() const;
+
 	bool IsConnectionActive() const;
 
 	void HandleError(const FString& Message);
@@ -265,6 +374,9 @@ private:
 	TUniquePtr<Millicast::Publisher::FWebRTCPeerConnection> PeerConnection;
 	TUniquePtr<Millicast::Publisher::FWebRTCPeerConnectionConfig> PeerConnectionConfig;
 
+	/** Video encoders warmed up for this session, until it ends */
+	TSharedPtr<Millicast::Publisher::FWarmEncoderPool, ESPMode::ThreadSafe> WarmEncoders;
+
 	/** Publisher */
 	TAtomic<EMillicastPublisherState> State = EMillicastPublisherState::Disconnected;
 	bool RtcStatsEnabled = false;
@@ -274,5 +386,19 @@ private:
 
 	TArray<uint8>* Metadata;
 
+	/** Backup publisher, connected while this one is publishing */
+	UPROPERTY()
+	UMillicastPublisherComponent* BackupPublisher = nullptr;
+
+	/** Set on a backup publisher, the source whose tracks it sends instead of capturing */
+	UPROPERTY()
+	UMillicastPublisherSource* PrimarySource = nullptr;
+
+	/** A backup publisher in standby is connected but its encodings are inactive */
+	TAtomic<bool> bStandby { false };
+
+	/** Which of this publisher and its backup sends */
+	TUniquePtr<Millicast::Publisher::FFailoverController> Failover;
+
 	FCriticalSection CriticalSection;
 };
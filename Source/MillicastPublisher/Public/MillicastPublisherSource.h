@@ -4,6 +4,7 @@
 #include "AudioCaptureDeviceInterface.h"
 #include "IMillicastSource.h"
 #include "Media/MillicastRenderTargetCanvas.h"
+#include "MillicastAudioMixerInput.h"
 #include "StreamMediaSource.h"
 
 #include "Engine/TextureRenderTarget2D.h"
@@ -78,12 +79,68 @@ public:
 	/** Publish video from this render target */
 	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Video)
 	UTextureRenderTarget2D* RenderTarget = nullptr;
+
+	/** Use Detail for UI or desktop content so it stays sharp, at the cost of the framerate */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Video)
+	EMillicastVideoContentHint VideoContentHint = EMillicastVideoContentHint::Motion;
+
+	/** How many captured frames may wait for the encoder, 1 always encodes the latest frame */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Video, meta = (ClampMin = "1", ClampMax = "8"))
+	int32 EncoderQueueDepth = 1;
+
+	/** What to do with a new frame when EncoderQueueDepth frames are waiting for the encoder */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Video)
+	EMillicastEncoderQueuePolicy EncoderQueuePolicy = EMillicastEncoderQueuePolicy::DropOldest;
+
+	/**
+	 * Publish this pre-encoded IVF (VP8, VP9) or Annex B (H264) file in a loop instead of capturing the render target or the game.
+	 * The frames are sent as they are, the selected codec must match. Relative to the project directory.
+	 */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Video)
+	FString EncodedVideoFilePath;
+
+	/** Whether the video is replayed from EncodedVideoFilePath rather than captured */
+	bool IsReplayingEncodedFile() const { return !EncodedVideoFilePath.IsEmpty(); }
+
+	/**
+	 * Publish the video encoded for this other source instead of capturing and encoding it again, e.g. to publish the same content
+	 * to a backup stream. The other source must be publishing first, with the same codec.
+	 */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Video)
+	UMillicastPublisherSource* VideoFanOutSource = nullptr;
+
+	/**
+	 * Simulcast layer of VideoFanOutSource to publish, -1 for the highest one.
+	 * The highest layer is encoded at the lowest bitrate allowed by all the streams publishing it.
+	 */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Video, meta = (ClampMin = "-1"))
+	int32 VideoFanOutLayer = -1;
+
+	/** Whether the video is relayed from VideoFanOutSource rather than captured */
+	bool IsRelayingVideo() const { return VideoFanOutSource != nullptr; }
+
+	/** Shares the video encoded for this source with other sources while capturing */
+	TSharedPtr<Millicast::Publisher::FEncodedFrameFanOut, ESPMode::ThreadSafe> GetVideoFanOut() const { return VideoFanOut; }
+
+	/** Key frame settings of the publisher of this source, applied to the next capture */
+	void SetKeyFrameSettings(TSharedPtr<const Millicast::Publisher::FKeyFrameGovernorSettings, ESPMode::ThreadSafe> InSettings) { KeyFrameSettings = MoveTemp(InSettings); }
+
+	/** The tracks of the capturers, null when not capturing */
+	IMillicastSource::FStreamTrackInterface GetVideoTrack() const { return VideoSource ? VideoSource->GetTrack() : nullptr; }
+	IMillicastSource::FStreamTrackInterface GetAudioTrack() const { return AudioSource ? AudioSource->GetTrack() : nullptr; }
+
+	/** Channels of the published audio, 0 when not capturing */
+	int32 GetAudioChannels() const;
 	
 	/** Whether we should capture game audio or not */
 	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Audio)
 	bool CaptureAudio = true;
 
-	/** Which audio capturer to use */
+	/**
+	 * Which audio capturer to use. The audio is published at 48 kHz, other rates are resampled if 100 ms of them is a whole
+	 * number of samples, which includes 11025, 22050 and 44100 Hz. The audio of a device at another rate is dropped.
+	 * Resampling adds up to 10 ms of latency, 20 ms at 22050 Hz and 40 ms at 11025 Hz.
+	 */
 	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Audio)
 	EAudioCapturerType AudioCaptureType = EAudioCapturerType::Submix;
 	
@@ -95,6 +152,22 @@ public:
 	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Audio)
 	float VolumeMultiplier = 20.f;
 
+	/** Publish the submix in 5.1 or 7.1 with Opus multistream when the audio device has that many channels, instead of downmixing it to stereo */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Audio)
+	bool bMultichannelAudio = false;
+
+	/** Inputs mixed into the audio track by the Mixer capturer */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Audio)
+	TArray<FMillicastAudioMixerInput> AudioMixerInputs;
+
+	/** Audio buffered before webrtc in ms, absorbs the irregular delivery of the captured audio at the cost of latency */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Audio, meta = (ClampMin = "10", ClampMax = "160"))
+	int32 AudioTargetLatencyMs = 20;
+
+	/** Continuously measure the offset between the capture times of the audio and video handed to webrtc, shown in the publisher stats */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Stream)
+	bool bMeasureAVOffset = false;
+
 public:
 	/** Mute the video stream */
 	UFUNCTION(BlueprintCallable, Category = "MillicastPublisher", META = (DisplayName = "MuteVideo"))
@@ -103,6 +176,25 @@ public:
 	/** Set a new render target while publishing */
 	UFUNCTION(BlueprintCallable, Category = "MillicastPublisher", META = (DisplayName = "ChangeRenderTarget"))
 	void ChangeRenderTarget(UTextureRenderTarget2D * InRenderTarget);
+
+	/**
+	 * Spend fewer bits outside of these regions, for the frames captured from now on.
+	 * Can be called every frame to follow moving content. BackgroundImportance applies outside of the regions.
+	 * Only applies to the VP8, VP9 and software H264 encoders.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "MillicastPublisher", META = (DisplayName = "SetRegionsOfInterest"))
+	void SetRegionsOfInterest(const TArray<FMillicastRegionOfInterest>& Regions, float BackgroundImportance = 0.25f);
+
+	/**
+	 * Same as SetRegionsOfInterest with a low resolution map stretched over the frame instead of rectangles.
+	 * Values go from 0 to 255, row by row, 255 keeping the full quality.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "MillicastPublisher", META = (DisplayName = "SetImportanceMap"))
+	bool SetImportanceMap(int32 Width, int32 Height, const TArray<uint8>& Values);
+
+	/** Encode the whole frame uniformly again */
+	UFUNCTION(BlueprintCallable, Category = "MillicastPublisher", META = (DisplayName = "ClearRegionsOfInterest"))
+	void ClearRegionsOfInterest();
 	
 public:
 	/** Mute the audio stream */
@@ -121,6 +213,18 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "MillicastPublisher", META = (DisplayName = "SetVolumeMultiplier"))
 	void SetVolumeMultiplier(float Multiplier);
 
+	/** Change the gain in dB of an input of the Mixer capturer, while capturing or not */
+	UFUNCTION(BlueprintCallable, Category = "MillicastPublisher", META = (DisplayName = "SetAudioMixerInputGain"))
+	void SetAudioMixerInputGain(int32 Index, float GainDb);
+
+	/** Mute an input of the Mixer capturer, the other inputs are still heard */
+	UFUNCTION(BlueprintCallable, Category = "MillicastPublisher", META = (DisplayName = "MuteAudioMixerInput"))
+	void MuteAudioMixerInput(int32 Index, bool Muted);
+
+	/** Change the delay in ms of an input of the Mixer capturer */
+	UFUNCTION(BlueprintCallable, Category = "MillicastPublisher", META = (DisplayName = "SetAudioMixerInputDelay"))
+	void SetAudioMixerInputDelay(int32 Index, int32 DelayMs);
+
 public:
 	// IMediaOptions interface
 	FString GetMediaOption(const FName& Key, const FString& DefaultValue) const override;
@@ -147,6 +251,12 @@ public:
 	*/
 	void StartCapture(UWorld* InWorld, bool InSimulcast, TFunction<void(IMillicastSource::FStreamTrackInterface)> Callback = nullptr);
 
+	/**
+	* Same as above but simulcast is enabled with the given layers, one capture context is created per layer.
+	* An empty array disables simulcast.
+	*/
+	void StartCapture(UWorld* InWorld, const TArray<FMillicastSimulcastLayer>& InSimulcastLayers, TFunction<void(IMillicastSource::FStreamTrackInterface)> Callback = nullptr);
+
 	/**
 	* Stop the capture and destroy all capturers
 	* @param bDestroyLayeredTexturesCanvas If true will destroy the canvas created for layered textures.
@@ -162,6 +272,8 @@ private:
 private:
 	TSharedPtr<IMillicastVideoSource> VideoSource;
 	TSharedPtr<IMillicastAudioSource> AudioSource;
+	TSharedPtr<Millicast::Publisher::FEncodedFrameFanOut, ESPMode::ThreadSafe> VideoFanOut;
+	TSharedPtr<const Millicast::Publisher::FKeyFrameGovernorSettings, ESPMode::ThreadSafe> KeyFrameSettings;
 
 	UPROPERTY()
 	UMillicastRenderTargetCanvas* RenderTargetCanvas;
@@ -170,6 +282,10 @@ private:
 	UWorld* World = nullptr;
 
 	bool Simulcast = false;
+	TArray<FMillicastSimulcastLayer> SimulcastLayers;
+
+	void UpdateImportanceMap(TSharedPtr<const FMillicastImportanceMap, ESPMode::ThreadSafe> InImportanceMap);
+	TSharedPtr<const FMillicastImportanceMap, ESPMode::ThreadSafe> ImportanceMap;
 
 	/** Capture device index  */
 	int32 CaptureDeviceIndex;
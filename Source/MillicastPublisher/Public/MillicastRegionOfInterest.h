@@ -0,0 +1,42 @@
+// Copyright Dolby.io 2023. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include "MillicastRegionOfInterest.generated.h"
+
+/**
+ * Region of the frame where the content matters more (HUD, face, scoreboard...).
+ * Coordinates are normalized to the frame size so that they apply to every simulcast layer.
+ */
+USTRUCT(BlueprintType)
+struct MILLICASTPUBLISHER_API FMillicastRegionOfInterest
+{
+	GENERATED_BODY()
+
+	/** Top left corner of the region, from 0 to 1 */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Video)
+	FVector2D Position = FVector2D::ZeroVector;
+
+	/** Size of the region, from 0 to 1 */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Video)
+	FVector2D Size = FVector2D::UnitVector;
+
+	/** From 0 to 1, 1 keeps the full quality. The highest importance wins where regions overlap */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Video, META = (ClampMin = "0.0", ClampMax = "1.0"))
+	float Importance = 1.f;
+};
+
+/**
+ * Importance of each cell of a low resolution grid stretched over the frame, from 0 to 255.
+ * The encoders spend fewer bits on the least important cells.
+ */
+struct MILLICASTPUBLISHER_API FMillicastImportanceMap
+{
+	int32 Width = 0;
+	int32 Height = 0;
+	TArray<uint8> Values; // Row major, Width * Height values
+
+	bool IsValid() const { return Width > 0 && Height > 0 && Values.Num() == Width * Height; }
+};
@@ -0,0 +1,51 @@
+// Copyright Dolby.io 2023. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include "MillicastSimulcastLayer.generated.h"
+
+/**
+ * Description of one simulcast layer.
+ * The layers are sent in the order they are declared, the first one usually being the full resolution one.
+ */
+USTRUCT(BlueprintType)
+struct MILLICASTPUBLISHER_API FMillicastSimulcastLayer
+{
+	GENERATED_BODY()
+
+	/** RTP stream id of the layer, must be unique */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Simulcast)
+	FString Rid;
+
+	/** The layer resolution is the capture resolution divided by this factor */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Simulcast, META = (ClampMin = "1.0"))
+	float ScaleResolutionDownBy = 1.f;
+
+	/** Maximum bitrate of the layer in bps. 0 means the component maximum bitrate divided by the scale factor */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Simulcast, META = (ClampMin = "0"))
+	int32 MaxBitrate = 0;
+
+	/** Maximum framerate of the layer. 0 means no limit */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Simulcast, META = (ClampMin = "0"))
+	int32 MaxFramerate = 0;
+
+	FMillicastSimulcastLayer() = default;
+	FMillicastSimulcastLayer(const FString& InRid, float InScaleResolutionDownBy, int32 InMaxBitrate = 0, int32 InMaxFramerate = 0)
+		: Rid(InRid)
+		, ScaleResolutionDownBy(InScaleResolutionDownBy)
+		, MaxBitrate(InMaxBitrate)
+		, MaxFramerate(InMaxFramerate)
+	{}
+
+	/** The h/m/l ladder at full, half and quarter resolution */
+	static TArray<FMillicastSimulcastLayer> GetDefaultLayers()
+	{
+		return {
+			FMillicastSimulcastLayer(TEXT("h"), 1.f),
+			FMillicastSimulcastLayer(TEXT("m"), 2.f),
+			FMillicastSimulcastLayer(TEXT("l"), 4.f)
+		};
+	}
+};
@@ -12,8 +12,34 @@ enum class EMillicastVideoCodecs : uint8
 	H264 UMETA(DisplayName = "H264")
 };
 
+/** Trade-off of the hardware H264 encoder between latency and quality */
+UENUM(BlueprintType)
+enum class EMillicastVideoEncoderPreset : uint8
+{
+	UltraLowLatency UMETA(DisplayName = "Ultra Low Latency"),
+	Balanced        UMETA(DisplayName = "Balanced"),
+	Quality         UMETA(DisplayName = "Quality")
+};
+
 UENUM()
 enum class EMillicastAudioCodecs : uint8
 {
 	Opus      UMETA(DisplayName = "opus"),
-};
\ No newline at end of file
+};
+/** What the Opus encoder optimizes for */
+UENUM(BlueprintType)
+enum class EMillicastOpusApplication : uint8
+{
+	Music UMETA(DisplayName = "Music"),
+	Voice UMETA(DisplayName = "Voice")
+};
+
+/** Duration of the audio in each Opus packet, longer packets spend less bandwidth on headers at the cost of latency */
+UENUM(BlueprintType)
+enum class EMillicastOpusFrameDuration : uint8
+{
+	Ms10 UMETA(DisplayName = "10 ms"),
+	Ms20 UMETA(DisplayName = "20 ms"),
+	Ms40 UMETA(DisplayName = "40 ms"),
+	Ms60 UMETA(DisplayName = "60 ms")
+};